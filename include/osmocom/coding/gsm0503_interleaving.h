@@ -11,9 +11,11 @@
  * \file gsm0503_interleaving.h */
 
 void gsm0503_xcch_deinterleave(sbit_t *cB, const sbit_t *iB);
+void gsm0503_xcch_deinterleave_bursts(sbit_t *cB, const sbit_t *bursts);
 void gsm0503_xcch_interleave(const ubit_t *cB, ubit_t *iB);
 
 void gsm0503_tch_fr_deinterleave(sbit_t *cB, const sbit_t *iB);
+void gsm0503_tch_fr_deinterleave_bursts(sbit_t *cB, const sbit_t *bursts);
 void gsm0503_tch_fr_interleave(const ubit_t *cB, ubit_t *iB);
 
 void gsm0503_tch_hr_deinterleave(sbit_t *cB, const sbit_t *iB);
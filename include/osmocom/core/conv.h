@@ -134,6 +134,50 @@ int osmo_conv_decode_get_output(struct osmo_conv_decoder *decoder,
 	/* All-in-one */
 int osmo_conv_decode(const struct osmo_conv_code *code,
                      const sbit_t *input, ubit_t *output);
+int osmo_conv_decode_cached(const struct osmo_conv_code *code,
+                            const sbit_t *input, ubit_t *output);
+int osmo_conv_decode_cached_ber(const struct osmo_conv_code *code,
+                                const sbit_t *input, ubit_t *output,
+                                const uint8_t *erased,
+                                int *n_errors, int *n_bits_total, int *metric);
+void osmo_conv_decode_cached_free(void);
+int osmo_conv_decode_batch(const struct osmo_conv_code *code, unsigned int n,
+                           const sbit_t * const *input, ubit_t * const *output,
+                           int *n_errors, int *n_bits_total);
+
+	/* Re-usable accelerated decoder (N=2..8, K=3..9) */
+
+/*! SIMD back-end of the accelerated Viterbi decoder */
+enum osmo_conv_acc_backend {
+	/*! Generic C implementation, always available */
+	OSMO_CONV_ACC_BACKEND_GEN,
+	/*! x86 SSSE3 */
+	OSMO_CONV_ACC_BACKEND_SSE,
+	/*! x86 SSSE3 and AVX2 */
+	OSMO_CONV_ACC_BACKEND_SSE_AVX,
+	/*! x86 AVX-512BW and AVX-512VL */
+	OSMO_CONV_ACC_BACKEND_AVX512,
+	_NUM_OSMO_CONV_ACC_BACKEND
+};
+
+int osmo_conv_acc_set_backend(enum osmo_conv_acc_backend backend);
+enum osmo_conv_acc_backend osmo_conv_acc_get_backend(void);
+
+struct osmo_conv_acc_decoder;
+
+struct osmo_conv_acc_decoder *
+osmo_conv_acc_decoder_alloc(const struct osmo_conv_code *code);
+void osmo_conv_acc_decoder_free(struct osmo_conv_acc_decoder *dec);
+int osmo_conv_acc_decode(struct osmo_conv_acc_decoder *dec,
+                         const sbit_t *input, ubit_t *output);
+int osmo_conv_acc_decode_ber(struct osmo_conv_acc_decoder *dec,
+                             const sbit_t *input, ubit_t *output,
+                             const uint8_t *erased,
+                             int *n_errors, int *n_bits_total, int *metric);
+int osmo_conv_acc_decode_batch(struct osmo_conv_acc_decoder *dec,
+                               unsigned int n, const sbit_t * const *input,
+                               ubit_t * const *output, int *rc,
+                               int *n_errors, int *n_bits_total);
 
 
 /*! @} */
@@ -40,6 +40,8 @@ struct osmo_crcXXgen_code {
 
 uintXX_t osmo_crcXXgen_compute_bits(const struct osmo_crcXXgen_code *code,
                                     const ubit_t *in, int len);
+uintXX_t osmo_crcXXgen_compute_pbits(const struct osmo_crcXXgen_code *code,
+                                     const pbit_t *in, int len);
 int osmo_crcXXgen_check_bits(const struct osmo_crcXXgen_code *code,
                              const ubit_t *in, int len, const ubit_t *crc_bits);
 void osmo_crcXXgen_set_bits(const struct osmo_crcXXgen_code *code,
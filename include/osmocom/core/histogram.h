@@ -0,0 +1,132 @@
+#pragma once
+
+/*! \defgroup osmo_histogram Histograms of measured values
+ *  @{
+ * \file histogram.h */
+
+#include <stdint.h>
+#include <time.h>
+
+#include <osmocom/core/linuxlist.h>
+#include <osmocom/core/timer.h>
+
+/*! Number of bits of a value kept exactly, 2^n sub-buckets per power of
+ *  two; the relative error of a percentile is below 2^-n (6.25%) */
+#define OSMO_HISTOGRAM_SUB_BITS		4
+/*! Values from 2^n on are counted in the highest bucket */
+#define OSMO_HISTOGRAM_MAX_BITS		40
+/*! Number of buckets of each histogram */
+#define OSMO_HISTOGRAM_NUM_BUCKETS \
+	((OSMO_HISTOGRAM_MAX_BITS - OSMO_HISTOGRAM_SUB_BITS + 1) << OSMO_HISTOGRAM_SUB_BITS)
+
+/*! Histogram description */
+struct osmo_histogram_desc {
+	const char *name;	/*!< name of the histogram */
+	const char *description;/*!< description of the histogram */
+	const char *unit;	/*!< unit of a value, e.g. "ns" */
+};
+
+/*! Data we keep for each histogram. All fields are updated with atomic
+ *  operations, so values can be recorded from any thread. */
+struct osmo_histogram {
+	/*! back-reference to the histogram description */
+	const struct osmo_histogram_desc *desc;
+	/*! number of recorded values */
+	uint64_t count;
+	/*! sum of all recorded values */
+	uint64_t sum;
+	/*! smallest recorded value, UINT64_MAX if none */
+	uint64_t min;
+	/*! largest recorded value */
+	uint64_t max;
+	/*! count at the last report, see \ref osmo_histogram_difference() */
+	uint64_t previous;
+	/*! number of values per log-linear bucket, as wide as \a count so
+	 *  that a busy bucket can not wrap around */
+	uint64_t buckets[OSMO_HISTOGRAM_NUM_BUCKETS];
+};
+
+/*! Description of a histogram group */
+struct osmo_histogram_group_desc {
+	/*! The prefix to the name of all histograms in this group */
+	const char *group_name_prefix;
+	/*! The human-readable description of the group */
+	const char *group_description;
+	/*! The class to which this group belongs */
+	int class_id;
+	/*! The number of histograms in this group (size of hist_desc) */
+	const unsigned int num_hist;
+	/*! Pointer to array of histogram descriptions, length as per num_hist */
+	const struct osmo_histogram_desc *hist_desc;
+};
+
+/*! One instance of a histogram group class */
+struct osmo_histogram_group {
+	/*! Linked list of all histogram groups in the system */
+	struct llist_head list;
+	/*! Pointer to the histogram group class */
+	const struct osmo_histogram_group_desc *desc;
+	/*! The index of this histogram group within its class */
+	unsigned int idx;
+	/*! Actual histograms below */
+	struct osmo_histogram hist[0];
+};
+
+struct osmo_histogram_group *osmo_histogram_group_alloc(void *ctx,
+	const struct osmo_histogram_group_desc *desc, unsigned int idx);
+void osmo_histogram_group_free(struct osmo_histogram_group *histg);
+
+struct osmo_histogram_group *osmo_histogram_get_group_by_name_idx(
+	const char *name, const unsigned int idx);
+struct osmo_histogram *osmo_histogram_get_by_name(
+	struct osmo_histogram_group *histg, const char *name);
+
+void osmo_histogram_record(struct osmo_histogram *hist, uint64_t value);
+void osmo_histogram_reset(struct osmo_histogram *hist);
+void osmo_histogram_percentiles(const struct osmo_histogram *hist,
+	const unsigned int *permille, uint64_t *values, unsigned int num);
+uint64_t osmo_histogram_percentile(const struct osmo_histogram *hist,
+	unsigned int permille);
+uint64_t osmo_histogram_difference(struct osmo_histogram *hist);
+
+unsigned int osmo_histogram_bucket(uint64_t value);
+uint64_t osmo_histogram_bucket_upper(unsigned int bucket);
+
+typedef int (*osmo_histogram_group_handler_t)(struct osmo_histogram_group *, void *);
+
+int osmo_histogram_for_each_group(osmo_histogram_group_handler_t handle_group,
+	void *data);
+
+/*! Record the nanoseconds elapsed since \a start (CLOCK_MONOTONIC)
+ *  \param[in] hist Histogram to record in
+ *  \param[in] start Time taken by \ref OSMO_HISTOGRAM_TIMER_START */
+static inline void osmo_histogram_record_since(struct osmo_histogram *hist,
+	const struct timespec *start)
+{
+	struct timespec now;
+	int64_t ns;
+
+	osmo_clock_gettime(CLOCK_MONOTONIC, &now);
+	ns = (int64_t)(now.tv_sec - start->tv_sec) * 1000000000LL +
+		(now.tv_nsec - start->tv_nsec);
+	osmo_histogram_record(hist, ns > 0 ? ns : 0);
+}
+
+/*! Declare \a var and take the start time of a section to be measured */
+#define OSMO_HISTOGRAM_TIMER_START(var) \
+	struct timespec var; \
+	osmo_clock_gettime(CLOCK_MONOTONIC, &var)
+
+/*! Record the time since \ref OSMO_HISTOGRAM_TIMER_START in nanoseconds */
+#define OSMO_HISTOGRAM_TIMER_STOP(hist, var) \
+	osmo_histogram_record_since(hist, &var)
+
+/*! Time the statement (or block) \a code, recording nanoseconds in \a hist */
+#define OSMO_HISTOGRAM_TIME(hist, code) \
+	do { \
+		OSMO_HISTOGRAM_TIMER_START(_osmo_hist_start); \
+		code; \
+		OSMO_HISTOGRAM_TIMER_STOP(hist, _osmo_hist_start); \
+	} while (0)
+
+/*! @} */
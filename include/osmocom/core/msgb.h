@@ -20,6 +20,7 @@
  */
 
 #include <stdint.h>
+#include <string.h>
 #include <osmocom/core/linuxlist.h>
 #include <osmocom/core/utils.h>
 #include <osmocom/core/bits.h>
@@ -462,12 +463,15 @@ static inline uint32_t msgb_pull_u32(struct msgb *msgb)
  * This function reserves some memory at the beginning of the underlying
  * data buffer.  The idea is to reserve space in case further headers
  * have to be pushed to the \ref msgb during further processing.
+ * The reserved memory is zero-initialized, also for buffers recycled by
+ * the msgb pool.
  *
  * Calling this function leads to undefined reusults if it is called on
  * a non-empty \ref msgb.
  */
 static inline void msgb_reserve(struct msgb *msg, int len)
 {
+	memset(msg->tail, 0, len);
 	msg->data += len;
 	msg->tail += len;
 }
@@ -704,6 +708,8 @@ bool _msgb_eq(const char *file, size_t line, const char *func, uint8_t level,
 uint8_t *msgb_data(const struct msgb *msg);
 
 void *msgb_talloc_ctx_init(void *root_ctx, unsigned int pool_size);
+int msgb_pool_init(void *root_ctx, unsigned int max_cached);
+void msgb_pool_exit(void);
 void msgb_set_talloc_ctx(void *ctx) OSMO_DEPRECATED("Use msgb_talloc_ctx_init() instead");
 int msgb_printf(struct msgb *msgb, const char *format, ...);
 
@@ -4,6 +4,7 @@
  *  @{
  * \file rate_ctr.h */
 
+#include <stdbool.h>
 #include <stdint.h>
 
 #include <osmocom/core/linuxlist.h>
@@ -11,7 +12,8 @@
 /*! Number of rate counter intervals */
 #define RATE_CTR_INTV_NUM	4
 
-/*! Rate counter interval */
+/*! Rate counter interval; the length of each can be changed per group
+ *  with \ref rate_ctr_group_set_intv() */
 enum rate_ctr_intv {
 	RATE_CTR_INTV_SEC,	/*!< last second */
 	RATE_CTR_INTV_MIN,	/*!< last minute */
@@ -19,10 +21,12 @@ enum rate_ctr_intv {
 	RATE_CTR_INTV_DAY,	/*!< last day */
 };
 
-/*! data we keep for each of the intervals */
+/*! data we keep for each of the intervals, updated when the rate is read
+ *  by \ref rate_ctr_get_rate() */
 struct rate_ctr_per_intv {
-	uint64_t last;		/*!< counter value in last interval */
-	uint64_t rate;		/*!< counter rate */
+	uint64_t last;		/*!< counter value at the start of the interval */
+	uint64_t rate;		/*!< counter rate in the last complete interval */
+	uint64_t last_ms;	/*!< time of \a last in ms, CLOCK_MONOTONIC */
 };
 
 /*! data we keep for each actual value */
@@ -31,6 +35,15 @@ struct rate_ctr {
 	uint64_t previous;	/*!< previous value, used for delta */
 	/*! per-interval data */
 	struct rate_ctr_per_intv intv[RATE_CTR_INTV_NUM];
+	/*! value at the last stats report */
+	uint64_t reported;
+	/*! the counter itself if allocated by rate_ctr_group_alloc(); a copy
+	 * of the struct does not match its own address and is not tracked */
+	const struct rate_ctr *self;
+	/*! 1 + index of the counter in its group, 0 if not in a group */
+	uint32_t group_idx;
+	/*! changed since the last rate_ctr_for_each_dirty() */
+	uint32_t dirty;
 };
 
 /*! rate counter description */
@@ -61,6 +74,18 @@ struct rate_ctr_group {
 	const struct rate_ctr_group_desc *desc;
 	/*! The index of this ctr_group within its class */
 	unsigned int idx;
+	/*! Entry in the list of groups with changed counters */
+	struct llist_head dirty_list;
+	/*! Number of changed counters, listed in \a dirty_idx */
+	unsigned int num_dirty;
+	/*! Indexes of the counters changed since the last report */
+	unsigned int *dirty_idx;
+	/*! Group name prefix with ':' replaced by '.', as reported by statsd */
+	const char *stats_prefix;
+	/*! Counter names with ':' replaced by '.', as reported by statsd */
+	const char **stats_names;
+	/*! Length of each \ref rate_ctr_intv in milliseconds */
+	uint32_t intv_ms[RATE_CTR_INTV_NUM];
 	/*! Actual counter structures below */
 	struct rate_ctr ctr[0];
 };
@@ -76,6 +101,11 @@ static inline void rate_ctr_group_upd_idx(struct rate_ctr_group *grp, unsigned i
 
 void rate_ctr_group_free(struct rate_ctr_group *grp);
 
+int rate_ctr_group_set_intv(struct rate_ctr_group *grp, enum rate_ctr_intv intv,
+			    uint32_t ms);
+bool rate_ctr_group_intv_is_default(const struct rate_ctr_group *grp,
+				    enum rate_ctr_intv intv);
+
 /*! Increment the counter by \a inc
  *  \param ctr \ref rate_ctr to increment
  *  \param inc quantity to increment \a ctr by */
@@ -100,6 +130,8 @@ static inline void rate_ctr_inc2(struct rate_ctr_group *ctrg, unsigned int idx)
 /*! Return the counter difference since the last call to this function */
 int64_t rate_ctr_difference(struct rate_ctr *ctr);
 
+uint64_t rate_ctr_get_rate(struct rate_ctr *ctr, enum rate_ctr_intv intv);
+
 int rate_ctr_init(void *tall_ctx);
 
 struct rate_ctr_group *rate_ctr_get_group_by_name_idx(const char *name, const unsigned int idx);
@@ -120,4 +152,7 @@ int rate_ctr_for_each_counter(struct rate_ctr_group *ctrg,
 
 int rate_ctr_for_each_group(rate_ctr_group_handler_t handle_group, void *data);
 
+int rate_ctr_for_each_dirty(rate_ctr_handler_t handle_counter, void *data);
+void rate_ctr_clear_dirty(void);
+
 /*! @} */
@@ -19,6 +19,14 @@
 /*! Indicate interest in exceptions from the file descriptor */
 #define BSC_FD_EXCEPT	0x0004
 
+/*! Back-end used by osmo_select_main() to wait for events */
+enum osmo_select_backend {
+	/*! select(); limited to FD_SETSIZE, scans all fds on every iteration */
+	OSMO_SELECT_BACKEND_SELECT,
+	/*! epoll (Linux); dispatches only the fds that became ready */
+	OSMO_SELECT_BACKEND_EPOLL,
+};
+
 /*! Structure representing a file dsecriptor */
 struct osmo_fd {
 	/*! linked list for internal management */
@@ -40,12 +48,15 @@ struct osmo_fd {
 void osmo_fd_setup(struct osmo_fd *ofd, int fd, unsigned int when,
 		   int (*cb)(struct osmo_fd *fd, unsigned int what),
 		   void *data, unsigned int priv_nr);
+void osmo_fd_update_when(struct osmo_fd *ofd, unsigned int and_mask, unsigned int or_mask);
 
 bool osmo_fd_is_registered(struct osmo_fd *fd);
 int osmo_fd_register(struct osmo_fd *fd);
 void osmo_fd_unregister(struct osmo_fd *fd);
 void osmo_fd_close(struct osmo_fd *fd);
 int osmo_select_main(int polling);
+int osmo_select_set_backend(enum osmo_select_backend backend);
+enum osmo_select_backend osmo_select_get_backend(void);
 
 struct osmo_fd *osmo_fd_get_by_fd(int fd);
 
@@ -9,6 +9,7 @@
 #include <osmocom/core/linuxlist.h>
 
 struct osmo_stat_item_desc;
+struct osmo_stat_item_group;
 
 #define OSMO_STAT_ITEM_NOVALUE_ID 0
 #define OSMO_STAT_ITEM_NO_UNIT NULL
@@ -27,6 +28,12 @@ struct osmo_stat_item {
 	int32_t last_value_index;
 	/*! offset to the freshest value in the value FIFO */
 	int16_t last_offs;
+	/*! set since the last osmo_stat_item_for_each_dirty() */
+	uint16_t dirty;
+	/*! index of the item in \a group */
+	unsigned int idx;
+	/*! back-reference to the group of this item */
+	struct osmo_stat_item_group *group;
 	/*! value FIFO */
 	struct osmo_stat_item_value values[0];
 };
@@ -62,6 +69,16 @@ struct osmo_stat_item_group {
 	const struct osmo_stat_item_group_desc *desc;
 	/*! The index of this value group within its class */
 	unsigned int idx;
+	/*! Entry in the list of groups with items set */
+	struct llist_head dirty_list;
+	/*! Number of items set, listed in \a dirty_idx */
+	unsigned int num_dirty;
+	/*! Indexes of the items set since the last report */
+	unsigned int *dirty_idx;
+	/*! Group name prefix with ':' replaced by '.', as reported by statsd */
+	const char *stats_prefix;
+	/*! Item names with ':' replaced by '.', as reported by statsd */
+	const char **stats_names;
 	/*! Actual counter structures below */
 	struct osmo_stat_item *items[0];
 };
@@ -108,6 +125,9 @@ int osmo_stat_item_for_each_item(struct osmo_stat_item_group *statg,
 
 int osmo_stat_item_for_each_group(osmo_stat_item_group_handler_t handle_group, void *data);
 
+int osmo_stat_item_for_each_dirty(osmo_stat_item_handler_t handle_item, void *data);
+void osmo_stat_item_clear_dirty(void);
+
 static inline int32_t osmo_stat_item_get_last(const struct osmo_stat_item *item)
 {
 	return item->values[item->last_offs].value;
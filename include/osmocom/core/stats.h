@@ -55,11 +55,15 @@ enum osmo_stats_class {
 enum osmo_stats_reporter_type {
 	OSMO_STATS_REPORTER_LOG,	/*!< libosmocore logging */
 	OSMO_STATS_REPORTER_STATSD,	/*!< statsd backend */
+	OSMO_STATS_REPORTER_PROMETHEUS,	/*!< Prometheus/OpenMetrics scrape endpoint */
 };
 
+/*! Maximum number of aggregated datagrams a reporter sends at once */
+#define OSMO_STATS_MAX_DGRAMS 16
+
 /*! One statistics reporter instance. */
 struct osmo_stats_reporter {
-	/*! Type of the reporter (log, statsd) */
+	/*! Type of the reporter (log, statsd, prometheus) */
 	enum osmo_stats_reporter_type type;
 	/*! Human-readable name of this reporter */
 	char *name;
@@ -100,6 +104,14 @@ struct osmo_stats_reporter {
 		const struct osmo_stat_item_group *statg,
 		const struct osmo_stat_item_desc *desc,
 		int64_t value);
+
+	int bind_port;		/*!< local bind (TCP) port, prometheus only */
+	void *priv;		/*!< reporter implementation specific state */
+
+	int dgram_size;		/*!< payload size of one datagram in \a buffer */
+	unsigned int num_dgrams;/*!< number of completed datagrams in \a buffer */
+	/*! end offset of each completed datagram in \a buffer */
+	uint16_t dgram_end[OSMO_STATS_MAX_DGRAMS];
 };
 
 struct osmo_stats_config {
@@ -123,6 +135,7 @@ struct osmo_stats_reporter *osmo_stats_reporter_find(enum osmo_stats_reporter_ty
 int osmo_stats_reporter_set_remote_addr(struct osmo_stats_reporter *srep, const char *addr);
 int osmo_stats_reporter_set_remote_port(struct osmo_stats_reporter *srep, int port);
 int osmo_stats_reporter_set_local_addr(struct osmo_stats_reporter *srep, const char *addr);
+int osmo_stats_reporter_set_local_port(struct osmo_stats_reporter *srep, int port);
 int osmo_stats_reporter_set_mtu(struct osmo_stats_reporter *srep, int mtu);
 int osmo_stats_reporter_set_max_class(struct osmo_stats_reporter *srep,
 	enum osmo_stats_class class_id);
@@ -133,11 +146,13 @@ int osmo_stats_reporter_disable(struct osmo_stats_reporter *srep);
 /* reporter creation */
 struct osmo_stats_reporter *osmo_stats_reporter_create_log(const char *name);
 struct osmo_stats_reporter *osmo_stats_reporter_create_statsd(const char *name);
+struct osmo_stats_reporter *osmo_stats_reporter_create_prometheus(const char *name);
 
 /* helper functions for reporter implementations */
 int osmo_stats_reporter_send(struct osmo_stats_reporter *srep, const char *data,
 	int data_len);
 int osmo_stats_reporter_send_buffer(struct osmo_stats_reporter *srep);
+int osmo_stats_reporter_end_dgram(struct osmo_stats_reporter *srep);
 int osmo_stats_reporter_udp_open(struct osmo_stats_reporter *srep);
 int osmo_stats_reporter_udp_close(struct osmo_stats_reporter *srep);
 
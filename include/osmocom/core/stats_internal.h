@@ -0,0 +1,9 @@
+#pragma once
+
+/*! \defgroup stats_internal Osmocom statistics internals
+ *  @{
+ * \file stats_internal.h */
+
+const char *stats_name_ifneeded(const void *ctx, const char *in);
+
+/*! @} */
@@ -56,13 +56,21 @@
 struct osmo_timer_list {
 	struct rb_node node;	  /*!< rb-tree node header */
 	struct llist_head list;   /*!< internal list header */
-	struct timeval timeout;   /*!< expiration time */
+	struct timeval timeout;   /*!< expiration time (CLOCK_MONOTONIC) */
 	unsigned int active  : 1; /*!< is it active? */
 
 	void (*cb)(void*);	  /*!< call-back called at timeout */
 	void *data;		  /*!< user data for callback */
 };
 
+/*! Data structure used to manage the timers */
+enum osmo_timer_backend {
+	/*! red-black tree; microsecond precision, O(log n) add/delete */
+	OSMO_TIMER_BACKEND_RBTREE,
+	/*! hierarchical timing wheel; millisecond slots, O(1) add/delete */
+	OSMO_TIMER_BACKEND_WHEEL,
+};
+
 /*
  * timer management
  */
@@ -87,6 +95,9 @@ struct timeval *osmo_timers_nearest(void);
 void osmo_timers_prepare(void);
 int osmo_timers_update(void);
 int osmo_timers_check(void);
+bool osmo_timers_cache_now(bool enable);
+int osmo_timers_set_backend(enum osmo_timer_backend backend);
+enum osmo_timer_backend osmo_timers_get_backend(void);
 
 int osmo_gettimeofday(struct timeval *tv, struct timezone *tz);
 int osmo_clock_gettime(clockid_t clk_id, struct timespec *tp);
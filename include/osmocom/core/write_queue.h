@@ -30,6 +30,25 @@
 #include <osmocom/core/select.h>
 #include <osmocom/core/msgb.h>
 
+/*! maximum number of msgbs written by one system call, see osmo_wqueue_set_batch() */
+#define OSMO_WQUEUE_MAX_BATCH	64
+
+struct rate_ctr_group;
+struct osmo_stat_item_group;
+
+/*! rate counters of a write queue, see osmo_wqueue_stats_alloc() */
+enum osmo_wqueue_ctr {
+	OSMO_WQUEUE_CTR_BATCH_WRITES,	/*!< batched system calls */
+	OSMO_WQUEUE_CTR_BATCH_MSGS,	/*!< msgbs written by batched system calls */
+	OSMO_WQUEUE_CTR_WRITE_ERRORS,	/*!< msgbs dropped by failed batched writes */
+};
+
+/*! stat items of a write queue, see osmo_wqueue_stats_alloc() */
+enum osmo_wqueue_stat {
+	OSMO_WQUEUE_STAT_LENGTH,	/*!< number of queued msgbs */
+	OSMO_WQUEUE_STAT_BATCH_LEN,	/*!< msgbs written by a batched system call */
+};
+
 /*! write queue instance */
 struct osmo_wqueue {
 	/*! osmocom file descriptor */
@@ -48,11 +67,28 @@ struct osmo_wqueue {
 	int (*write_cb)(struct osmo_fd *fd, struct msgb *msg);
 	/*! call-back in case qeueue has exceptions. Return -EBADF if fd is freed inside cb. */
 	int (*except_cb)(struct osmo_fd *fd);
+
+	/*! if > 1 and write_cb is NULL, number of msgbs written at once by
+	 *  writev()/sendmmsg(), see osmo_wqueue_set_batch() */
+	unsigned int max_batch;
+	/*! call-back in case a batched write of msg failed with err; msg is
+	 *  freed afterwards. Return -EBADF if fd is freed inside cb. */
+	int (*write_err_cb)(struct osmo_fd *fd, struct msgb *msg, int err);
+	/*! rate counters, see osmo_wqueue_stats_alloc(); NULL if none */
+	struct rate_ctr_group *ctrg;
+	/*! stat items, see osmo_wqueue_stats_alloc(); NULL if none */
+	struct osmo_stat_item_group *statg;
+	/*! socket type of bfd (SOCK_STREAM or SOCK_DGRAM), determined on
+	 *  the first batched write; 0 if not known yet */
+	int sock_type;
 };
 
 void osmo_wqueue_init(struct osmo_wqueue *queue, int max_length);
 void osmo_wqueue_clear(struct osmo_wqueue *queue);
 int osmo_wqueue_enqueue(struct osmo_wqueue *queue, struct msgb *data);
 int osmo_wqueue_bfd_cb(struct osmo_fd *fd, unsigned int what);
+int osmo_wqueue_set_batch(struct osmo_wqueue *queue, unsigned int max_batch);
+int osmo_wqueue_stats_alloc(struct osmo_wqueue *queue, void *ctx, unsigned int idx);
+void osmo_wqueue_stats_free(struct osmo_wqueue *queue);
 
 /*! @} */
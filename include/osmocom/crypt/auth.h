@@ -86,6 +86,12 @@ struct osmo_auth_impl {
 			    struct osmo_sub_auth_data *aud,
 			    const uint8_t *auts, const uint8_t *rand_auts,
 			    const uint8_t *_rand);
+
+	/*! callback for generating num vectors at once, optional. The
+	 *  implementation doesn't fill in rand. */
+	int (*gen_vec_batch)(struct osmo_auth_vector *vec,
+			     struct osmo_sub_auth_data *aud,
+			     const uint8_t *_rand, unsigned int num);
 };
 
 int osmo_auth_gen_vec(struct osmo_auth_vector *vec,
@@ -96,6 +102,14 @@ int osmo_auth_gen_vec_auts(struct osmo_auth_vector *vec,
 			   const uint8_t *auts, const uint8_t *rand_auts,
 			   const uint8_t *_rand);
 
+int osmo_auth_gen_vec_batch(struct osmo_auth_vector *vec,
+			    struct osmo_sub_auth_data *aud,
+			    const uint8_t *_rand, unsigned int num);
+
+int osmo_auth_gen_vecs(struct osmo_auth_vector *vec,
+		       struct osmo_sub_auth_data **aud,
+		       const uint8_t *_rand, unsigned int num);
+
 int osmo_auth_register(struct osmo_auth_impl *impl);
 
 int osmo_auth_load(const char *path);
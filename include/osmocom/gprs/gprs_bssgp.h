@@ -66,7 +66,7 @@ struct bssgp_flow_control {
 	uint32_t bucket_leak_rate; 	/*!< leak rate of the bucket (octets/sec) */
 
 	uint32_t bucket_counter;	/*!< number of tokens in the bucket */
-	struct timeval time_last_pdu;	/*!< timestamp of last PDU sent */
+	struct timeval time_last_pdu;	/*!< time up to which the leak of the bucket is accounted for */
 
 	/* the built-in queue */
 	uint32_t max_queue_depth;	/*!< how many packets to queue (mgs) */
@@ -77,6 +77,13 @@ struct bssgp_flow_control {
 	/*! callback to be called at output of flow control */
 	int (*out_cb)(struct bssgp_flow_control *fc, struct msgb *msg,
 			uint32_t llc_pdu_len, void *priv);
+
+	/*! pre-allocated queue elements, linked into \ref queue. Allocated
+	 * as talloc child of the (talloc-allocated) flow control struct when
+	 * the first PDU is queued */
+	struct bssgp_fc_queue_element *ring;
+	uint32_t ring_size;		/*!< number of elements in \ref ring */
+	uint32_t ring_head;		/*!< index of the oldest queued element */
 };
 
 #define BVC_S_BLOCKED	0x0001
@@ -106,12 +113,20 @@ struct bssgp_bvc_ctx {
 	/* we might want to add this as a shortcut later, avoiding the NSVC
 	 * lookup for every packet, similar to a routing cache */
 	//struct gprs_nsvc *nsvc;
+
+	/*! entries in the (NSEI, BVCI) and (RA ID, Cell ID) hash tables,
+	 *  see btsctx_rehash() */
+	struct llist_head hash_bvci_nsei;
+	struct llist_head hash_raid_cid;
 };
 extern struct llist_head bssgp_bvc_ctxts;
 /* Find a BTS Context based on parsed RA ID and Cell ID */
 struct bssgp_bvc_ctx *btsctx_by_raid_cid(const struct gprs_ra_id *raid, uint16_t cid);
 /* Find a BTS context based on BVCI+NSEI tuple */
 struct bssgp_bvc_ctx *btsctx_by_bvci_nsei(uint16_t bvci, uint16_t nsei);
+struct bssgp_bvc_ctx *btsctx_alloc(uint16_t bvci, uint16_t nsei);
+void btsctx_free(struct bssgp_bvc_ctx *ctx);
+void btsctx_rehash(struct bssgp_bvc_ctx *bctx);
 
 #define BVC_F_BLOCKED	0x0001
 
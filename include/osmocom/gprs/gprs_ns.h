@@ -28,6 +28,8 @@
 /* Educated guess - LLC user payload is 1500 bytes plus possible headers */
 #define NS_ALLOC_SIZE	3072
 #define NS_ALLOC_HEADROOM 20
+/* Maximum number of datagrams read at once by the NS/UDP receive path */
+#define NS_RX_MAX_BATCH	32
 
 enum ns_timeout {
 	NS_TOUT_TNS_BLOCK,
@@ -69,6 +71,7 @@ enum gprs_ns_cs {
 };
 
 struct gprs_nsvc;
+struct gprs_ns_active_nsvc;
 /*! Osmocom GPRS callback function type */
 typedef int gprs_ns_cb_t(enum gprs_ns_evt event, struct gprs_nsvc *nsvc,
 			 struct msgb *msg, uint16_t bvci);
@@ -95,6 +98,11 @@ struct gprs_ns_inst {
 		uint32_t remote_ip;
 		uint16_t remote_port;
 		int dscp;
+		/*! number of datagrams read at once with recvmmsg(), up
+		 *  to NS_RX_MAX_BATCH; 0 or 1: one recvfrom() per read event */
+		unsigned int rx_batch;
+		/*! msgbs pre-allocated for the batched receive path */
+		struct llist_head rx_msgs;
 	} nsip;
 	/*! NS-over-FR-over-GRE-over-IP specific bits */
 	struct {
@@ -102,6 +110,16 @@ struct gprs_ns_inst {
 		uint32_t local_ip;
 		unsigned int enabled:1;
 	} frgre;
+
+	/*! NS instance statistics */
+	struct osmo_stat_item_group *statg;
+
+	/*! hash tables to look up NS-VCs, see gprs_nsvc_rehash() */
+	struct llist_head *nsvc_by_nsvci;
+	struct llist_head *nsvc_by_nsei;
+	struct llist_head *nsvc_by_rem_addr;
+	/*! NS-VC used to send to each NSE, hashed by NSEI */
+	struct llist_head *active_nsvc_by_nsei;
 };
 
 enum nsvc_timer_mode {
@@ -150,6 +168,14 @@ struct gprs_nsvc {
 			struct sockaddr_in bts_addr;
 		} frgre;
 	};
+
+	/*! entries in the hash tables of the NS instance */
+	struct llist_head hash_nsvci;
+	struct llist_head hash_nsei;
+	struct llist_head hash_rem_addr;
+	/*! entry in active_nsvc_by_nsei of the NS instance if this NS-VC is
+	 *  used to send to its NSE, NULL otherwise */
+	struct gprs_ns_active_nsvc *active;
 };
 
 /* Create a new NS protocol instance */
@@ -184,6 +210,7 @@ int gprs_ns_frgre_listen(struct gprs_ns_inst *nsi);
 
 struct gprs_nsvc *gprs_nsvc_create(struct gprs_ns_inst *nsi, uint16_t nsvci);
 void gprs_nsvc_delete(struct gprs_nsvc *nsvc);
+void gprs_nsvc_rehash(struct gprs_nsvc *nsvc);
 struct gprs_nsvc *gprs_nsvc_by_nsei(struct gprs_ns_inst *nsi, uint16_t nsei);
 struct gprs_nsvc *gprs_nsvc_by_nsvci(struct gprs_ns_inst *nsi, uint16_t nsvci);
 
@@ -45,10 +45,14 @@ osmo_a5_fn_count(uint32_t fn)
 	/* Notes:
 	 *  - key must be 8 or 16 (for a5/4) bytes long (or NULL for A5/0)
 	 *  - the dl and ul pointer must be either NULL or 114 bits long
+	 *    (15 bytes for the packed osmo_a5_pbits() and osmo_a5_batch())
 	 *  - fn is the _real_ GSM frame number.
 	 *    (converted internally to fn_count)
 	 */
 int osmo_a5(int n, const uint8_t *key, uint32_t fn, ubit_t *dl, ubit_t *ul);
+int osmo_a5_pbits(int n, const uint8_t *key, uint32_t fn, pbit_t *dl, pbit_t *ul);
+int osmo_a5_batch(int n, unsigned int num, const uint8_t * const *keys,
+		  const uint32_t *fns, pbit_t * const *dl, pbit_t * const *ul);
 void osmo_a5_1(const uint8_t *key, uint32_t fn, ubit_t *dl, ubit_t *ul) OSMO_DEPRECATED("Use generic osmo_a5() instead");
 void osmo_a5_2(const uint8_t *key, uint32_t fn, ubit_t *dl, ubit_t *ul) OSMO_DEPRECATED("Use generic osmo_a5() instead");
 
@@ -10,13 +10,42 @@
 #pragma once
 
 #include <osmocom/crypt/gprs_cipher.h>
+#include <osmocom/gsm/kasumi.h>
 
 #include <stdint.h>
 
+/*! GEA3/GEA4 context with the KASUMI subkeys of one Kc, so that many
+ *  keystreams can be generated without expanding the key each time */
+struct osmo_gea_ctx {
+	/*! GPRS_ALGO_GEA3 or GPRS_ALGO_GEA4 */
+	enum gprs_ciph_algo algo;
+	/*! Expanded subkeys */
+	struct osmo_kgcore_key key;
+};
+
+/*! One keystream request for osmo_gea_ctx_run_batch() */
+struct osmo_gea_req {
+	/*! Buffer for the keystream */
+	uint8_t *out;
+	/*! Length of out, in bytes */
+	uint16_t len;
+	/*! Init vector */
+	uint32_t iv;
+	/*! Direction */
+	enum gprs_cipher_direction direction;
+};
+
 int gea3(uint8_t *out, uint16_t len, uint8_t *kc, uint32_t iv,
 	 enum gprs_cipher_direction direct);
 
 int gea4(uint8_t *out, uint16_t len, uint8_t *kc, uint32_t iv,
 	 enum gprs_cipher_direction direct);
 
+int osmo_gea_ctx_init(struct osmo_gea_ctx *ctx, enum gprs_ciph_algo algo,
+		      const uint8_t *kc);
+int osmo_gea_ctx_run(const struct osmo_gea_ctx *ctx, uint8_t *out, uint16_t len,
+		     uint32_t iv, enum gprs_cipher_direction direction);
+int osmo_gea_ctx_run_batch(const struct osmo_gea_ctx *ctx,
+			   const struct osmo_gea_req *reqs, unsigned int num);
+
 /*! @} */
@@ -9,6 +9,30 @@
 
 #include <stdint.h>
 
+/*! Expanded KASUMI subkeys, see _kasumi_key_expand() */
+struct osmo_kasumi_key {
+	uint16_t KLi1[8], KLi2[8];
+	uint16_t KOi1[8], KOi2[8], KOi3[8];
+	uint16_t KIi1[8], KIi2[8], KIi3[8];
+};
+
+/*! Expanded KASUMI subkeys of the key CK and of the modified key CK ^ KM,
+ *  which is all KGCORE needs from CK */
+struct osmo_kgcore_key {
+	struct osmo_kasumi_key ck;
+	struct osmo_kasumi_key km;
+};
+
+/*! One keystream request for _kasumi_kgcore_run_multi() */
+struct osmo_kgcore_req {
+	uint32_t cc;
+	uint8_t cd;
+	/*! output, cl-dependent */
+	uint8_t *co;
+	/*! keystream length in bits */
+	uint16_t cl;
+};
+
 /*! Single iteration of KASUMI cipher
  *  \param[in] P Block, 64 bits to be processed in this round
  *  \param[in] KLi1 Expanded subkeys
@@ -46,3 +70,47 @@ void _kasumi_kgcore(uint8_t CA, uint8_t cb, uint32_t cc, uint8_t cd, const uint8
  *  \param[out] KIi3 Expanded subkeys
  */
 void _kasumi_key_expand(const uint8_t *key, uint16_t *KLi1, uint16_t *KLi2, uint16_t *KOi1, uint16_t *KOi2, uint16_t *KOi3, uint16_t *KIi1, uint16_t *KIi2, uint16_t *KIi3);
+
+/*! Expand key into a set of subkeys, see _kasumi_key_expand()
+ *  \param[in] key (128 bits) as array of bytes
+ *  \param[out] k Expanded subkeys
+ */
+void _kasumi_key_expand_ctx(const uint8_t *key, struct osmo_kasumi_key *k);
+
+/*! Single iteration of KASUMI cipher with expanded subkeys
+ *  \param[in] P Block, 64 bits to be processed in this round
+ *  \param[in] k Expanded subkeys
+ *  \returns processed block of 64 bits
+ */
+uint64_t _kasumi_ctx(uint64_t P, const struct osmo_kasumi_key *k);
+
+/*! Expand the subkeys used by KGCORE for a key, so they can be re-used by
+ *  _kasumi_kgcore_run() for any number of keystreams
+ *  \param[out] kk Expanded subkeys
+ *  \param[in] ck 16-bytes long key
+ */
+void _kasumi_kgcore_init(struct osmo_kgcore_key *kk, const uint8_t *ck);
+
+/*! KGCORE with the subkeys expanded by _kasumi_kgcore_init(), see _kasumi_kgcore()
+ *  \param[in] kk Expanded subkeys
+ *  \param[in] CA
+ *  \param[in] cb
+ *  \param[in] cc
+ *  \param[in] cd
+ *  \param[out] co cl-dependent
+ *  \param[in] cl
+ */
+void _kasumi_kgcore_run(const struct osmo_kgcore_key *kk, uint8_t CA, uint8_t cb, uint32_t cc, uint8_t cd, uint8_t *co, uint16_t cl);
+
+/*! KGCORE for several keystreams with the same key, CA and cb, see _kasumi_kgcore_run()
+ *  \param[in] kk Expanded subkeys
+ *  \param[in] CA
+ *  \param[in] cb
+ *  \param[inout] reqs Array of num requests, only their outputs are written
+ *  \param[in] num Number of requests
+ *
+ * The keystreams are computed several at a time, which is faster than
+ * one after the other.
+ */
+void _kasumi_kgcore_run_multi(const struct osmo_kgcore_key *kk, uint8_t CA, uint8_t cb,
+			      const struct osmo_kgcore_req *reqs, unsigned int num);
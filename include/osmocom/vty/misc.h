@@ -5,6 +5,7 @@
 #include <osmocom/vty/vty.h>
 #include <osmocom/core/rate_ctr.h>
 #include <osmocom/core/stat_item.h>
+#include <osmocom/core/histogram.h>
 #include <osmocom/core/utils.h>
 
 #define VTY_DO_LOWER		1
@@ -20,6 +21,9 @@ void vty_out_rate_ctr_group_fmt(struct vty *vty, const char *fmt,
 void vty_out_stat_item_group(struct vty *vty, const char *prefix,
 			     struct osmo_stat_item_group *statg);
 
+void vty_out_histogram_group(struct vty *vty, const char *prefix,
+			     struct osmo_histogram_group *histg);
+
 void vty_out_statistics_full(struct vty *vty, const char *prefix);
 void vty_out_statistics_partial(struct vty *vty, const char *prefix,
 	int max_level);
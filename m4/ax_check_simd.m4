@@ -19,7 +19,8 @@
 #
 #   And defines:
 #
-#      HAVE_AVX3 / HAVE_SSSE3 / HAVE_SSE4.1
+#      HAVE_AVX3 / HAVE_SSSE3 / HAVE_SSE4.1 / HAVE_AVX512BW
+#      HAVE_AESNI / HAVE_ARM_AES
 #
 # LICENSE
 #
@@ -34,6 +35,9 @@
 # NOTE: The functionality that requests the cpuid has been stripped because
 #       this project detects the CPU capabilities during runtime. However, we
 #       still need to check if the compiler supports the requested SIMD flag.
+#
+# NOTE: HAVE_ARM_AES is only checked for if $enable_neon is "yes", see the
+#       --enable-neon configure option.
 
 #serial 12
 
@@ -44,6 +48,9 @@ AC_DEFUN([AX_CHECK_SIMD],
   AM_CONDITIONAL(HAVE_AVX2, false)
   AM_CONDITIONAL(HAVE_SSSE3, false)
   AM_CONDITIONAL(HAVE_SSE4_1, false)
+  AM_CONDITIONAL(HAVE_AVX512BW, false)
+  AM_CONDITIONAL(HAVE_AESNI, false)
+  AM_CONDITIONAL(HAVE_ARM_AES, false)
 
   case $host_cpu in
     i[[3456]]86*|x86_64*|amd64*)
@@ -76,6 +83,51 @@ AC_DEFUN([AX_CHECK_SIMD],
       else
         AC_MSG_WARN([Your compiler does not support SSE4.1 instructions])
       fi
+
+      AX_CHECK_COMPILE_FLAG([-mavx512bw -mavx512vl], ax_cv_support_avx512bw_ext=yes, [])
+      if test x"$ax_cv_support_avx512bw_ext" = x"yes"; then
+        SIMD_FLAGS="$SIMD_FLAGS -mavx512bw -mavx512vl"
+        AC_DEFINE(HAVE_AVX512BW,,
+          [Support AVX-512BW and AVX-512VL (Advanced Vector Extensions 512) instructions])
+        AM_CONDITIONAL(HAVE_AVX512BW, true)
+      else
+        AC_MSG_WARN([Your compiler does not support AVX-512BW instructions])
+      fi
+
+      AX_CHECK_COMPILE_FLAG([-maes -msse2], ax_cv_support_aesni_ext=yes, [])
+      if test x"$ax_cv_support_aesni_ext" = x"yes"; then
+        AC_DEFINE(HAVE_AESNI,,
+          [Support AES-NI (Advanced Encryption Standard New Instructions)])
+        AM_CONDITIONAL(HAVE_AESNI, true)
+      else
+        AC_MSG_WARN([Your compiler does not support AES-NI instructions])
+      fi
+  ;;
+    aarch64*)
+      # the AES kernel is only built on request, see --enable-neon
+      if test x"$enable_neon" = x"yes"; then
+        AC_CACHE_CHECK([whether the compiler supports the ARMv8 AES instructions],
+          [ax_cv_support_arm_aes_ext], [
+          ax_save_CFLAGS="$CFLAGS"
+          CFLAGS="$CFLAGS -march=armv8-a+crypto"
+          AC_COMPILE_IFELSE([AC_LANG_PROGRAM([[
+            #include <arm_neon.h>
+            #include <sys/auxv.h>
+          ]], [[
+            uint8x16_t a = vdupq_n_u8(0);
+            a = vaesmcq_u8(vaeseq_u8(a, a));
+            return vgetq_lane_u8(a, 0) + !!(getauxval(AT_HWCAP) & HWCAP_AES);
+          ]])], [ax_cv_support_arm_aes_ext=yes], [ax_cv_support_arm_aes_ext=no])
+          CFLAGS="$ax_save_CFLAGS"
+        ])
+        if test x"$ax_cv_support_arm_aes_ext" = x"yes"; then
+          AC_DEFINE(HAVE_ARM_AES,,
+            [Support ARMv8 Cryptographic Extension AES instructions])
+          AM_CONDITIONAL(HAVE_ARM_AES, true)
+        else
+          AC_MSG_WARN([Your compiler does not support ARMv8 AES instructions])
+        fi
+      fi
   ;;
   esac
 
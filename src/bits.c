@@ -23,8 +23,12 @@
  */
 
 #include <stdint.h>
+#include <string.h>
+
+#include "config.h"
 
 #include <osmocom/core/bits.h>
+#include <osmocom/core/endian.h>
 
 /*! \addtogroup bits
  *  @{
@@ -37,32 +41,211 @@
  *
  * \file bits.c */
 
+/* Conversion kernels
+ *
+ * The bulk of each conversion is done by a kernel that handles whole
+ * vectors and returns how much it has converted: the number of packed
+ * bytes (read or written) for ubit2pbit/pbit2ubit, and the number of bits
+ * for the soft bit conversions. The rest is done 8 bits at a time with
+ * 64-bit SWAR code, and the last partial byte bit by bit. The widest
+ * kernel the CPU supports is picked on first use; all of them give the
+ * same results.
+ */
+typedef unsigned int (*ubit2pbit_func)(pbit_t *out, const ubit_t *in,
+	unsigned int num_bytes, int lsb_mode);
+typedef unsigned int (*pbit2ubit_func)(ubit_t *out, const pbit_t *in,
+	unsigned int num_bytes, int lsb_mode);
+typedef unsigned int (*ubit2sbit_func)(sbit_t *out, const ubit_t *in,
+	unsigned int num_bits);
+typedef unsigned int (*sbit2ubit_func)(ubit_t *out, const sbit_t *in,
+	unsigned int num_bits);
+
+#define DECLARE_KERNELS(simd) \
+	unsigned int osmo_bits_##simd##_ubit2pbit(pbit_t *out, \
+		const ubit_t *in, unsigned int num_bytes, int lsb_mode); \
+	unsigned int osmo_bits_##simd##_pbit2ubit(ubit_t *out, \
+		const pbit_t *in, unsigned int num_bytes, int lsb_mode); \
+	unsigned int osmo_bits_##simd##_ubit2sbit(sbit_t *out, \
+		const ubit_t *in, unsigned int num_bits); \
+	unsigned int osmo_bits_##simd##_sbit2ubit(ubit_t *out, \
+		const sbit_t *in, unsigned int num_bits);
+
+#define INIT_KERNELS(simd) \
+{ \
+	ubit2pbit_kernel = osmo_bits_##simd##_ubit2pbit; \
+	pbit2ubit_kernel = osmo_bits_##simd##_pbit2ubit; \
+	ubit2sbit_kernel = osmo_bits_##simd##_ubit2sbit; \
+	sbit2ubit_kernel = osmo_bits_##simd##_sbit2ubit; \
+}
+
+#if defined(HAVE_SSSE3)
+DECLARE_KERNELS(sse)
+#endif
+#if defined(HAVE_AVX2)
+DECLARE_KERNELS(sse_avx)
+#endif
+
+static unsigned int none_ubit2pbit(pbit_t *out, const ubit_t *in,
+	unsigned int num_bytes, int lsb_mode)
+{
+	return 0;
+}
+
+static unsigned int none_pbit2ubit(ubit_t *out, const pbit_t *in,
+	unsigned int num_bytes, int lsb_mode)
+{
+	return 0;
+}
+
+static unsigned int none_ubit2sbit(sbit_t *out, const ubit_t *in,
+	unsigned int num_bits)
+{
+	return 0;
+}
+
+static unsigned int none_sbit2ubit(ubit_t *out, const sbit_t *in,
+	unsigned int num_bits)
+{
+	return 0;
+}
+
+static ubit2pbit_func ubit2pbit_kernel = none_ubit2pbit;
+static pbit2ubit_func pbit2ubit_kernel = none_pbit2ubit;
+static ubit2sbit_func ubit2sbit_kernel = none_ubit2sbit;
+static sbit2ubit_func sbit2ubit_kernel = none_sbit2ubit;
+
+static int init_complete = 0;
+
+static void osmo_bits_init(void)
+{
+	init_complete = 1;
+
+#ifdef HAVE___BUILTIN_CPU_SUPPORTS
+	#if defined(HAVE_AVX2)
+	if (__builtin_cpu_supports("avx2")) {
+		INIT_KERNELS(sse_avx);
+		return;
+	}
+	#endif
+
+	#if defined(HAVE_SSSE3)
+	if (__builtin_cpu_supports("sse2")) {
+		INIT_KERNELS(sse);
+		return;
+	}
+	#endif
+#endif
+}
+
+/* SWAR helpers: 8 unpacked or soft bits in a little-endian uint64_t */
+static inline uint64_t load_8bits(const void *p)
+{
+#if OSMO_IS_LITTLE_ENDIAN
+	uint64_t v;
+
+	memcpy(&v, p, sizeof(v));
+	return v;
+#else
+	return osmo_load64le(p);
+#endif
+}
+
+static inline void store_8bits(uint64_t v, void *p)
+{
+#if OSMO_IS_LITTLE_ENDIAN
+	memcpy(p, &v, sizeof(v));
+#else
+	osmo_store64le(v, p);
+#endif
+}
+
+/* Set the lowest bit of each non-zero byte, clear all other bits */
+static inline uint64_t swar_nonzero(uint64_t v)
+{
+	v |= (v >> 4) & 0x0f0f0f0f0f0f0f0fULL;
+	v |= (v >> 2) & 0x3333333333333333ULL;
+	v |= (v >> 1) & 0x5555555555555555ULL;
+
+	return v & 0x0101010101010101ULL;
+}
+
+static void swar_ubit2pbit(pbit_t *out, const ubit_t *in,
+	unsigned int num_bytes, int lsb_mode)
+{
+	/* Moves the lowest bit of byte j to bit 56 + (7 - j) or 56 + j */
+	const uint64_t mul = lsb_mode ? 0x0102040810204080ULL :
+					0x8040201008040201ULL;
+	unsigned int i;
+
+	for (i = 0; i < num_bytes; i++)
+		out[i] = (swar_nonzero(load_8bits(&in[8 * i])) * mul) >> 56;
+}
+
+static void swar_pbit2ubit(ubit_t *out, const pbit_t *in,
+	unsigned int num_bytes, int lsb_mode)
+{
+	/* Bit of the packed byte that goes to each unpacked byte */
+	const uint64_t mask = lsb_mode ? 0x8040201008040201ULL :
+					 0x0102040810204080ULL;
+	unsigned int i;
+	uint64_t v;
+
+	for (i = 0; i < num_bytes; i++) {
+		v = (in[i] * 0x0101010101010101ULL) & mask;
+		v = ((v + 0x7f7f7f7f7f7f7f7fULL) >> 7) & 0x0101010101010101ULL;
+		store_8bits(v, &out[8 * i]);
+	}
+}
+
+/* Convert whole packed bytes: kernel first, then SWAR */
+static void ubit2pbit_bytes(pbit_t *out, const ubit_t *in,
+	unsigned int num_bytes, int lsb_mode)
+{
+	unsigned int n;
+
+	if (!init_complete)
+		osmo_bits_init();
+
+	n = ubit2pbit_kernel(out, in, num_bytes, lsb_mode);
+	swar_ubit2pbit(&out[n], &in[8 * n], num_bytes - n, lsb_mode);
+}
+
+static void pbit2ubit_bytes(ubit_t *out, const pbit_t *in,
+	unsigned int num_bytes, int lsb_mode)
+{
+	unsigned int n;
+
+	if (!init_complete)
+		osmo_bits_init();
+
+	n = pbit2ubit_kernel(out, in, num_bytes, lsb_mode);
+	swar_pbit2ubit(&out[8 * n], &in[n], num_bytes - n, lsb_mode);
+}
+
 /*! convert unpacked bits to packed bits, return length in bytes
  *  \param[out] out output buffer of packed bits
  *  \param[in] in input buffer of unpacked bits
  *  \param[in] num_bits number of bits
+ *
+ *  Any non-zero unpacked bit is packed as 1.
  */
 int osmo_ubit2pbit(pbit_t *out, const ubit_t *in, unsigned int num_bits)
 {
-	unsigned int i;
+	unsigned int i, num_bytes = num_bits / 8;
 	uint8_t curbyte = 0;
-	pbit_t *outptr = out;
-
-	for (i = 0; i < num_bits; i++) {
-		uint8_t bitnum = 7 - (i % 8);
 
-		curbyte |= (in[i] << bitnum);
+	ubit2pbit_bytes(out, in, num_bytes, 0);
 
-		if(i % 8 == 7){
-			*outptr++ = curbyte;
-			curbyte = 0;
+	/* we have a non-modulo-8 bitcount */
+	if (num_bits % 8) {
+		for (i = 8 * num_bytes; i < num_bits; i++) {
+			if (in[i])
+				curbyte |= 1 << (7 - (i % 8));
 		}
+		out[num_bytes++] = curbyte;
 	}
-	/* we have a non-modulo-8 bitcount */
-	if (i % 8)
-		*outptr++ = curbyte;
 
-	return outptr - out;
+	return num_bytes;
 }
 
 /*! Shift unaligned input to octet-aligned output
@@ -121,7 +304,20 @@ void osmo_nibble_shift_left_unal(uint8_t *out, const uint8_t *in,
 void osmo_ubit2sbit(sbit_t *out, const ubit_t *in, unsigned int num_bits)
 {
 	unsigned int i;
-	for (i = 0; i < num_bits; i++)
+	uint64_t v;
+
+	if (!init_complete)
+		osmo_bits_init();
+
+	i = ubit2sbit_kernel(out, in, num_bits);
+
+	/* 127 for zero bytes, 127 ^ 0xfe = -127 for the others */
+	for (; i + 8 <= num_bits; i += 8) {
+		v = swar_nonzero(load_8bits(&in[i])) * 0xfe;
+		store_8bits(v ^ 0x7f7f7f7f7f7f7f7fULL, &out[i]);
+	}
+
+	for (; i < num_bits; i++)
 		out[i] = in[i] ? -127 : 127;
 }
 
@@ -133,7 +329,20 @@ void osmo_ubit2sbit(sbit_t *out, const ubit_t *in, unsigned int num_bits)
 void osmo_sbit2ubit(ubit_t *out, const sbit_t *in, unsigned int num_bits)
 {
 	unsigned int i;
-	for (i = 0; i < num_bits; i++)
+	uint64_t v;
+
+	if (!init_complete)
+		osmo_bits_init();
+
+	i = sbit2ubit_kernel(out, in, num_bits);
+
+	/* the sign bit of each soft bit is the unpacked bit */
+	for (; i + 8 <= num_bits; i += 8) {
+		v = (load_8bits(&in[i]) >> 7) & 0x0101010101010101ULL;
+		store_8bits(v, &out[i]);
+	}
+
+	for (; i < num_bits; i++)
 		out[i] = in[i] < 0;
 }
 
@@ -145,38 +354,14 @@ void osmo_sbit2ubit(ubit_t *out, const sbit_t *in, unsigned int num_bits)
  */
 int osmo_pbit2ubit(ubit_t *out, const pbit_t *in, unsigned int num_bits)
 {
-	unsigned int i;
-	ubit_t *cur = out;
-	ubit_t *limit = out + num_bits;
-
-	for (i = 0; i < (num_bits/8)+1; i++) {
-		pbit_t byte = in[i];
-		*cur++ = (byte >> 7) & 1;
-		if (cur >= limit)
-			break;
-		*cur++ = (byte >> 6) & 1;
-		if (cur >= limit)
-			break;
-		*cur++ = (byte >> 5) & 1;
-		if (cur >= limit)
-			break;
-		*cur++ = (byte >> 4) & 1;
-		if (cur >= limit)
-			break;
-		*cur++ = (byte >> 3) & 1;
-		if (cur >= limit)
-			break;
-		*cur++ = (byte >> 2) & 1;
-		if (cur >= limit)
-			break;
-		*cur++ = (byte >> 1) & 1;
-		if (cur >= limit)
-			break;
-		*cur++ = (byte >> 0) & 1;
-		if (cur >= limit)
-			break;
-	}
-	return cur - out;
+	unsigned int i, num_bytes = num_bits / 8;
+
+	pbit2ubit_bytes(out, in, num_bytes, 0);
+
+	for (i = 8 * num_bytes; i < num_bits; i++)
+		out[i] = (in[num_bytes] >> (7 - (i % 8))) & 1;
+
+	return num_bits;
 }
 
 /*! convert unpacked bits to packed bits (extended options)
@@ -192,9 +377,19 @@ int osmo_ubit2pbit_ext(pbit_t *out, unsigned int out_ofs,
                        const ubit_t *in, unsigned int in_ofs,
                        unsigned int num_bits, int lsb_mode)
 {
-	int i, op, bn;
+	int i, n, op, bn;
 	for (i=0; i<num_bits; i++) {
 		op = out_ofs + i;
+
+		/* whole output bytes at once */
+		if (!(op & 7) && num_bits - i >= 8) {
+			n = (num_bits - i) / 8;
+			ubit2pbit_bytes(&out[op>>3], &in[in_ofs+i], n,
+				lsb_mode);
+			i += 8 * n - 1;
+			continue;
+		}
+
 		bn = lsb_mode ? (op&7) : (7-(op&7));
 		if (in[in_ofs+i])
 			out[op>>3] |= 1 << bn;
@@ -217,9 +412,19 @@ int osmo_pbit2ubit_ext(ubit_t *out, unsigned int out_ofs,
                        const pbit_t *in, unsigned int in_ofs,
                        unsigned int num_bits, int lsb_mode)
 {
-	int i, ip, bn;
+	int i, n, ip, bn;
 	for (i=0; i<num_bits; i++) {
 		ip = in_ofs + i;
+
+		/* whole input bytes at once */
+		if (!(ip & 7) && num_bits - i >= 8) {
+			n = (num_bits - i) / 8;
+			pbit2ubit_bytes(&out[out_ofs+i], &in[ip>>3], n,
+				lsb_mode);
+			i += 8 * n - 1;
+			continue;
+		}
+
 		bn = lsb_mode ? (ip&7) : (7-(ip&7));
 		out[out_ofs+i] = !!(in[ip>>3] & (1<<bn));
 	}
@@ -0,0 +1,129 @@
+/*! \file bits_sse.c
+ * Bit conversion kernels for x86 architectures with SSE2. */
+/*
+ * (C) 2018 by sysmocom - s.f.m.c. GmbH
+ *
+ * All Rights Reserved
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdint.h>
+#include "config.h"
+
+#include <emmintrin.h>
+
+#include <osmocom/core/bits.h>
+
+/* Each kernel converts the largest multiple of its vector width it can,
+ * and returns the number of packed bytes (ubit2pbit, pbit2ubit) or bits
+ * (soft bit conversions) converted. The caller converts the rest. */
+
+/* Reverse the order of the bytes in each 64-bit half, so that the first
+ * unpacked bit of a byte ends up in the most significant mask bit */
+static inline __m128i _sse_bswap64(__m128i v)
+{
+	v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+	v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+
+	return _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+}
+
+__attribute__ ((visibility("hidden")))
+unsigned int osmo_bits_sse_ubit2pbit(pbit_t *out, const ubit_t *in,
+	unsigned int num_bytes, int lsb_mode)
+{
+	const __m128i zero = _mm_setzero_si128();
+	unsigned int i;
+	__m128i v;
+	int m;
+
+	for (i = 0; i + 2 <= num_bytes; i += 2) {
+		v = _mm_loadu_si128((const __m128i *) &in[8 * i]);
+		if (!lsb_mode)
+			v = _sse_bswap64(v);
+
+		/* Bit j of the mask is set for non-zero input byte j */
+		m = ~_mm_movemask_epi8(_mm_cmpeq_epi8(v, zero));
+		out[i] = m;
+		out[i + 1] = m >> 8;
+	}
+
+	return i;
+}
+
+__attribute__ ((visibility("hidden")))
+unsigned int osmo_bits_sse_pbit2ubit(ubit_t *out, const pbit_t *in,
+	unsigned int num_bytes, int lsb_mode)
+{
+	const __m128i one = _mm_set1_epi8(1);
+	const __m128i mask = lsb_mode ?
+		_mm_set1_epi64x(0x8040201008040201ULL) :
+		_mm_set1_epi64x(0x0102040810204080ULL);
+	unsigned int i;
+	__m128i v;
+
+	for (i = 0; i + 2 <= num_bytes; i += 2) {
+		/* Broadcast each of the two bytes to one 64-bit half */
+		v = _mm_cvtsi32_si128(in[i] | (in[i + 1] << 8));
+		v = _mm_unpacklo_epi8(v, v);
+		v = _mm_unpacklo_epi16(v, v);
+		v = _mm_unpacklo_epi32(v, v);
+
+		v = _mm_cmpeq_epi8(_mm_and_si128(v, mask), mask);
+		_mm_storeu_si128((__m128i *) &out[8 * i], _mm_and_si128(v, one));
+	}
+
+	return i;
+}
+
+__attribute__ ((visibility("hidden")))
+unsigned int osmo_bits_sse_ubit2sbit(sbit_t *out, const ubit_t *in,
+	unsigned int num_bits)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i neg = _mm_set1_epi8(-127);
+	const __m128i flip = _mm_set1_epi8(127 ^ -127);
+	unsigned int i;
+	__m128i v;
+
+	for (i = 0; i + 16 <= num_bits; i += 16) {
+		v = _mm_loadu_si128((const __m128i *) &in[i]);
+		v = _mm_and_si128(_mm_cmpeq_epi8(v, zero), flip);
+		_mm_storeu_si128((__m128i *) &out[i], _mm_xor_si128(v, neg));
+	}
+
+	return i;
+}
+
+__attribute__ ((visibility("hidden")))
+unsigned int osmo_bits_sse_sbit2ubit(ubit_t *out, const sbit_t *in,
+	unsigned int num_bits)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i one = _mm_set1_epi8(1);
+	unsigned int i;
+	__m128i v;
+
+	for (i = 0; i + 16 <= num_bits; i += 16) {
+		v = _mm_loadu_si128((const __m128i *) &in[i]);
+		v = _mm_and_si128(_mm_cmpgt_epi8(zero, v), one);
+		_mm_storeu_si128((__m128i *) &out[i], v);
+	}
+
+	return i;
+}
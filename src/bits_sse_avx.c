@@ -0,0 +1,124 @@
+/*! \file bits_sse_avx.c
+ * Bit conversion kernels for x86 architectures with AVX2. */
+/*
+ * (C) 2018 by sysmocom - s.f.m.c. GmbH
+ *
+ * All Rights Reserved
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdint.h>
+#include "config.h"
+
+#include <immintrin.h>
+
+#include <osmocom/core/bits.h>
+
+/* Same interface as the SSE2 kernels in bits_sse.c, 32 bits at a time */
+
+__attribute__ ((visibility("hidden")))
+unsigned int osmo_bits_sse_avx_ubit2pbit(pbit_t *out, const ubit_t *in,
+	unsigned int num_bytes, int lsb_mode)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i bswap = _mm256_set_epi8(
+		8, 9, 10, 11, 12, 13, 14, 15, 0, 1, 2, 3, 4, 5, 6, 7,
+		8, 9, 10, 11, 12, 13, 14, 15, 0, 1, 2, 3, 4, 5, 6, 7);
+	unsigned int i;
+	uint32_t m;
+	__m256i v;
+
+	for (i = 0; i + 4 <= num_bytes; i += 4) {
+		v = _mm256_loadu_si256((const __m256i *) &in[8 * i]);
+		if (!lsb_mode)
+			v = _mm256_shuffle_epi8(v, bswap);
+
+		m = ~_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, zero));
+		out[i] = m;
+		out[i + 1] = m >> 8;
+		out[i + 2] = m >> 16;
+		out[i + 3] = m >> 24;
+	}
+
+	return i;
+}
+
+__attribute__ ((visibility("hidden")))
+unsigned int osmo_bits_sse_avx_pbit2ubit(ubit_t *out, const pbit_t *in,
+	unsigned int num_bytes, int lsb_mode)
+{
+	const __m256i one = _mm256_set1_epi8(1);
+	const __m256i mask = lsb_mode ?
+		_mm256_set1_epi64x(0x8040201008040201ULL) :
+		_mm256_set1_epi64x(0x0102040810204080ULL);
+	const __m256i spread = _mm256_set_epi8(
+		3, 3, 3, 3, 3, 3, 3, 3, 2, 2, 2, 2, 2, 2, 2, 2,
+		1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0);
+	unsigned int i;
+	__m256i v;
+
+	for (i = 0; i + 4 <= num_bytes; i += 4) {
+		/* Broadcast each of the four bytes to one 64-bit quarter */
+		v = _mm256_set1_epi32(in[i] | (in[i + 1] << 8) |
+				      (in[i + 2] << 16) | ((uint32_t) in[i + 3] << 24));
+		v = _mm256_shuffle_epi8(v, spread);
+
+		v = _mm256_cmpeq_epi8(_mm256_and_si256(v, mask), mask);
+		_mm256_storeu_si256((__m256i *) &out[8 * i],
+				    _mm256_and_si256(v, one));
+	}
+
+	return i;
+}
+
+__attribute__ ((visibility("hidden")))
+unsigned int osmo_bits_sse_avx_ubit2sbit(sbit_t *out, const ubit_t *in,
+	unsigned int num_bits)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i neg = _mm256_set1_epi8(-127);
+	const __m256i flip = _mm256_set1_epi8(127 ^ -127);
+	unsigned int i;
+	__m256i v;
+
+	for (i = 0; i + 32 <= num_bits; i += 32) {
+		v = _mm256_loadu_si256((const __m256i *) &in[i]);
+		v = _mm256_and_si256(_mm256_cmpeq_epi8(v, zero), flip);
+		_mm256_storeu_si256((__m256i *) &out[i], _mm256_xor_si256(v, neg));
+	}
+
+	return i;
+}
+
+__attribute__ ((visibility("hidden")))
+unsigned int osmo_bits_sse_avx_sbit2ubit(ubit_t *out, const sbit_t *in,
+	unsigned int num_bits)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i one = _mm256_set1_epi8(1);
+	unsigned int i;
+	__m256i v;
+
+	for (i = 0; i + 32 <= num_bits; i += 32) {
+		v = _mm256_loadu_si256((const __m256i *) &in[i]);
+		v = _mm256_and_si256(_mm256_cmpgt_epi8(zero, v), one);
+		_mm256_storeu_si256((__m256i *) &out[i], v);
+	}
+
+	return i;
+}
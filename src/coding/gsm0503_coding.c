@@ -541,31 +541,8 @@ static int osmo_conv_decode_ber_punctured(const struct osmo_conv_code *code,
 	int *n_errors, int *n_bits_total,
 	const uint8_t *data_punc)
 {
-	int res, i, coded_len;
-	ubit_t recoded[EGPRS_DATA_C_MAX];
-
-	res = osmo_conv_decode(code, input, output);
-
-	if (n_bits_total || n_errors) {
-		coded_len = osmo_conv_encode(code, output, recoded);
-		OSMO_ASSERT(sizeof(recoded) / sizeof(recoded[0]) >= coded_len);
-	}
-
-	/* Count bit errors */
-	if (n_errors) {
-		*n_errors = 0;
-		for (i = 0; i < coded_len; i++) {
-			if (((!data_punc) || (data_punc && !data_punc[i])) &&
-				!((recoded[i] && input[i] < 0) ||
-					(!recoded[i] && input[i] > 0)) )
-						*n_errors += 1;
-		}
-	}
-
-	if (n_bits_total)
-		*n_bits_total = coded_len;
-
-	return res;
+	return osmo_conv_decode_cached_ber(code, input, output, data_punc,
+		n_errors, n_bits_total, NULL);
 }
 
 /*! Convolutional Decode + compute BER for non-punctured codes
@@ -638,13 +615,9 @@ static int _xcch_encode_cB(ubit_t *cB, const uint8_t *l2_data)
 int gsm0503_xcch_decode(uint8_t *l2_data, const sbit_t *bursts,
 	int *n_errors, int *n_bits_total)
 {
-	sbit_t iB[456], cB[456];
-	int i;
+	sbit_t cB[456];
 
-	for (i = 0; i < 4; i++)
-		gsm0503_xcch_burst_unmap(&iB[i * 114], &bursts[i * 116], NULL, NULL);
-
-	gsm0503_xcch_deinterleave(cB, iB);
+	gsm0503_xcch_deinterleave_bursts(cB, bursts);
 
 	return _xcch_decode_cB(l2_data, cB, n_errors, n_bits_total);
 }
@@ -1808,21 +1781,19 @@ static void tch_amr_unmerge(ubit_t *d, ubit_t *p, const ubit_t *u, int len, int
 int gsm0503_tch_fr_decode(uint8_t *tch_data, const sbit_t *bursts,
 	int net_order, int efr, int *n_errors, int *n_bits_total)
 {
-	sbit_t iB[912], cB[456], h;
+	sbit_t cB[456], h;
 	ubit_t conv[185], s[244], w[260], b[65], d[260], p[8];
 	int i, rv, len, steal = 0;
 
-	/* map from 8 bursts to interleaved data bits (iB) */
+	/* stealing flags of the 8 bursts */
 	for (i = 0; i < 8; i++) {
-		gsm0503_tch_burst_unmap(&iB[i * 114],
-			&bursts[i * 116], &h, i >> 2);
+		gsm0503_tch_burst_unmap(NULL, &bursts[i * 116], &h, i >> 2);
 		steal -= h;
 	}
-	/* we now have the bits of the four bursts (interface 4 in
-	 * Figure 1a of TS 05.03 */
 
-	gsm0503_tch_fr_deinterleave(cB, iB);
-	/* we now have the coded bits c(B): interface 3 in Fig. 1a */
+	/* map from 8 bursts (interface 4 in Figure 1a of TS 05.03) to the
+	 * coded bits c(B), interface 3 in Fig. 1a, in one pass */
+	gsm0503_tch_fr_deinterleave_bursts(cB, bursts);
 
 	if (steal > 0) {
 		rv = _xcch_decode_cB(tch_data, cB, n_errors, n_bits_total);
@@ -2101,17 +2072,17 @@ int gsm0503_tch_afs_decode(uint8_t *tch_data, const sbit_t *bursts,
 	int codec_mode_req, uint8_t *codec, int codecs, uint8_t *ft,
 	uint8_t *cmr, int *n_errors, int *n_bits_total)
 {
-	sbit_t iB[912], cB[456], h;
+	sbit_t cB[456], h;
 	ubit_t d[244], p[6], conv[250];
 	int i, j, k, best = 0, rv, len, steal = 0, id = 0;
 	*n_errors = 0; *n_bits_total = 0;
 
 	for (i=0; i<8; i++) {
-		gsm0503_tch_burst_unmap(&iB[i * 114], &bursts[i * 116], &h, i >> 2);
+		gsm0503_tch_burst_unmap(NULL, &bursts[i * 116], &h, i >> 2);
 		steal -= h;
 	}
 
-	gsm0503_tch_fr_deinterleave(cB, iB);
+	gsm0503_tch_fr_deinterleave_bursts(cB, bursts);
 
 	if (steal > 0) {
 		rv = _xcch_decode_cB(tch_data, cB, n_errors, n_bits_total);
@@ -3003,7 +2974,7 @@ int gsm0503_sch_decode(uint8_t *sb_info, const sbit_t *burst)
 	ubit_t conv[35];
 	int rv;
 
-	osmo_conv_decode(&gsm0503_sch, burst, conv);
+	osmo_conv_decode_cached(&gsm0503_sch, burst, conv);
 
 	rv = osmo_crc16gen_check_bits(&gsm0503_sch_crc10, conv, 25, conv + 25);
 	if (rv)
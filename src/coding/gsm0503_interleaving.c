@@ -80,18 +80,108 @@
  *
  * \file gsm0503_interleaving.c */
 
+/* Index tables
+ *
+ * The index arithmetic of the interleavers below is evaluated at compile
+ * time into constant tables, which give the position of each coded bit in
+ * the interleaved block(s). The Ixx() macros expand F(k) for xx values of k.
+ */
+#define I4(F, k)	F(k), F((k) + 1), F((k) + 2), F((k) + 3)
+#define I8(F, k)	I4(F, k), I4(F, (k) + 4)
+#define I16(F, k)	I8(F, k), I8(F, (k) + 8)
+#define I32(F, k)	I16(F, k), I16(F, (k) + 16)
+#define I64(F, k)	I32(F, k), I32(F, (k) + 32)
+#define I128(F, k)	I64(F, k), I64(F, (k) + 64)
+#define I256(F, k)	I128(F, k), I128(F, (k) + 128)
+#define I512(F, k)	I256(F, k), I256(F, (k) + 256)
+
+#define I100(F, k)	I64(F, k), I32(F, (k) + 64), I4(F, (k) + 96)
+#define I124(F, k)	I64(F, k), I32(F, (k) + 64), I16(F, (k) + 96), \
+			I8(F, (k) + 112), I4(F, (k) + 120)
+#define I136(F, k)	I128(F, k), I8(F, (k) + 128)
+#define I160(F, k)	I128(F, k), I32(F, (k) + 128)
+#define I452(F, k)	I256(F, k), I128(F, (k) + 256), I64(F, (k) + 384), \
+			I4(F, (k) + 448)
+#define I456(F, k)	I452(F, k), I4(F, (k) + 452)
+#define I1224(F, k)	I512(F, k), I512(F, (k) + 512), I128(F, (k) + 1024), \
+			I64(F, (k) + 1152), I8(F, (k) + 1216)
+
+/* Position of interleaved bit i of 114-bit blocks in 116-bit bursts, skipping
+ * the stealing flags, see gsm0503_xcch_burst_unmap() */
+#define BURST_POS(i)	((i) / 114 * 116 + (i) % 114 + ((i) % 114 >= 57) * 2)
+
+/* xCCH and TCH FR/EFR/AFS, TS 05.03 4.1.4 and 3.1.3 */
+#define XCCH_J(k)	(2 * ((49 * (k)) % 57) + (((k) & 7) >> 2))
+#define XCCH_IDX(k)	(((k) & 3) * 114 + XCCH_J(k))
+#define TCH_FR_IDX(k)	(((k) & 7) * 114 + XCCH_J(k))
+#define XCCH_POS(k)	BURST_POS(XCCH_IDX(k))
+#define TCH_FR_POS(k)	BURST_POS(TCH_FR_IDX(k))
+
+/* MCS-1..4: bit k of the 452 coded bits is bit MCS1_CP(k) of the 456 bits
+ * that are interleaved like xCCH, bits 25, 82, 139 and 424 are spare */
+#define MCS1_CP(k)	((k) + ((k) >= 25) + ((k) >= 81) + ((k) >= 137) + \
+			 ((k) >= 421))
+#define MCS1_IDX(k)	XCCH_IDX(MCS1_CP(k))
+
+/* MCS-5..9 headers */
+#define MCS5_UL_HDR_IDX(k)	(34 * ((k) % 4) + 2 * (11 * (k) % 17) + (k) % 8 / 4)
+#define MCS5_DL_HDR_IDX(k)	(25 * ((k) % 4) + ((17 * (k)) % 25))
+#define MCS7_UL_HDR_IDX(k)	(40 * ((k) % 4) + 2 * (13 * ((k) / 8) % 20) + \
+				 (k) % 8 / 4)
+#define MCS7_DL_HDR_IDX(k)	(31 * ((k) % 4) + ((17 * (k)) % 31))
+
+/* MCS-7..9 data, TS 05.03 5.1.11.1.5 and 5.1.12.1.5 */
+#define MCS7_DATA_IDX(k)	(306 * ((k) % 4) + \
+				 3 * (44 * (k) % 102 + (k) / 4 % 2) + \
+				 ((k) + 2 - (k) / 408) % 3)
+#define MCS8_DATA_IDX(k)	(306 * (2 * ((k) / 612) + ((k) % 2)) + \
+				 3 * (74 * (k) % 102 + (k) / 2 % 2) + \
+				 ((k) + 2 - (k) / 204) % 3)
+
+static const uint16_t xcch_idx[456] = { I456(XCCH_IDX, 0) };
+static const uint16_t xcch_pos[456] = { I456(XCCH_POS, 0) };
+static const uint16_t tch_fr_idx[456] = { I456(TCH_FR_IDX, 0) };
+static const uint16_t tch_fr_pos[456] = { I456(TCH_FR_POS, 0) };
+static const uint16_t mcs1_idx[452] = { I452(MCS1_IDX, 0) };
+static const uint8_t mcs5_ul_hdr_idx[136] = { I136(MCS5_UL_HDR_IDX, 0) };
+static const uint8_t mcs5_dl_hdr_idx[100] = { I100(MCS5_DL_HDR_IDX, 0) };
+static const uint8_t mcs7_ul_hdr_idx[160] = { I160(MCS7_UL_HDR_IDX, 0) };
+static const uint8_t mcs7_dl_hdr_idx[124] = { I124(MCS7_DL_HDR_IDX, 0) };
+static const uint16_t mcs7_data_idx[1224] = { I1224(MCS7_DATA_IDX, 0) };
+static const uint16_t mcs8_data_idx[1224] = { I1224(MCS8_DATA_IDX, 0) };
+
+/* Gather / scatter len bits through an index table */
+#define DEINTERLEAVE(out, in, idx, len) \
+	do { \
+		int _k; \
+		for (_k = 0; _k < (len); _k++) \
+			(out)[_k] = (in)[(idx)[_k]]; \
+	} while (0)
+
+#define INTERLEAVE(out, in, idx, len) \
+	do { \
+		int _k; \
+		for (_k = 0; _k < (len); _k++) \
+			(out)[(idx)[_k]] = (in)[_k]; \
+	} while (0)
+
 /*! De-Interleave burst bits according to TS 05.03 4.1.4
  *  \param[out] cB caller-allocated output buffer for 456 soft coded bits
  *  \param[in] iB 456 soft input bits */
 void gsm0503_xcch_deinterleave(sbit_t *cB, const sbit_t *iB)
 {
-	int j, k, B;
+	DEINTERLEAVE(cB, iB, xcch_idx, 456);
+}
 
-	for (k = 0; k < 456; k++) {
-		B = k & 3;
-		j = 2 * ((49 * k) % 57) + ((k & 7) >> 2);
-		cB[k] = iB[B * 114 + j];
-	}
+/*! De-Interleave the bits of 4 xCCH bursts according to TS 05.03 4.1.4
+ *  \param[out] cB caller-allocated output buffer for 456 soft coded bits
+ *  \param[in] bursts 4 bursts of 116 soft bits
+ *
+ *  This is the same as gsm0503_xcch_burst_unmap() of each burst followed
+ *  by gsm0503_xcch_deinterleave(), in a single pass. */
+void gsm0503_xcch_deinterleave_bursts(sbit_t *cB, const sbit_t *bursts)
+{
+	DEINTERLEAVE(cB, bursts, xcch_pos, 456);
 }
 
 /*! Interleave burst bits according to TS 05.03 4.1.4
@@ -99,13 +189,7 @@ void gsm0503_xcch_deinterleave(sbit_t *cB, const sbit_t *iB)
  *  \param[in] cB 456 soft input coded bits */
 void gsm0503_xcch_interleave(const ubit_t *cB, ubit_t *iB)
 {
-	int j, k, B;
-
-	for (k = 0; k < 456; k++) {
-		B = k & 3;
-		j = 2 * ((49 * k) % 57) + ((k & 7) >> 2);
-		iB[B * 114 + j] = cB[k];
-	}
+	INTERLEAVE(iB, cB, xcch_idx, 456);
 }
 
 /*! De-Interleave MCS1 DL burst bits according to TS 05.03 5.1.5.1.5
@@ -116,37 +200,14 @@ void gsm0503_xcch_interleave(const ubit_t *cB, ubit_t *iB)
 void gsm0503_mcs1_dl_deinterleave(sbit_t *u, sbit_t *hc,
 	sbit_t *dc, const sbit_t *iB)
 {
-	int k;
-	sbit_t c[452];
-	sbit_t cp[456];
-
-	gsm0503_xcch_deinterleave(cp, iB);
-
-	for (k = 0; k < 25; k++)
-		c[k] = cp[k];
-	for (k = 26; k < 82; k++)
-		c[k - 1] = cp[k];
-	for (k = 83; k < 139; k++)
-		c[k - 2] = cp[k];
-	for (k = 140; k < 424; k++)
-		c[k - 3] = cp[k];
-	for (k = 425; k < 456; k++)
-		c[k - 4] = cp[k];
-
-	if (u) {
-		for (k = 0; k < 12; k++)
-			u[k] = c[k];
-	}
+	if (u)
+		DEINTERLEAVE(u, iB, &mcs1_idx[0], 12);
 
-	if (hc) {
-		for (k = 12; k < 80; k++)
-			hc[k - 12] = c[k];
-	}
+	if (hc)
+		DEINTERLEAVE(hc, iB, &mcs1_idx[12], 68);
 
-	if (dc) {
-		for (k = 80; k < 452; k++)
-			dc[k - 80] = c[k];
-	}
+	if (dc)
+		DEINTERLEAVE(dc, iB, &mcs1_idx[80], 372);
 }
 
 /*! Interleave MCS1 DL burst bits according to TS 05.03 5.1.5.1.5
@@ -157,34 +218,14 @@ void gsm0503_mcs1_dl_deinterleave(sbit_t *u, sbit_t *hc,
 void gsm0503_mcs1_dl_interleave(const ubit_t *up, const ubit_t *hc,
 	const ubit_t *dc, ubit_t *iB)
 {
-	int k;
-	ubit_t c[452];
-	ubit_t cp[456];
-
-	for (k = 0; k < 12; k++)
-		c[k] = up[k];
-	for (k = 12; k < 80; k++)
-		c[k] = hc[k - 12];
-	for (k = 80; k < 452; k++)
-		c[k] = dc[k - 80];
-
-	for (k = 0; k < 25; k++)
-		cp[k] = c[k];
-	for (k = 26; k < 82; k++)
-		cp[k] = c[k - 1];
-	for (k = 83; k < 139; k++)
-		cp[k] = c[k - 2];
-	for (k = 140; k < 424; k++)
-		cp[k] = c[k - 3];
-	for (k = 425; k < 456; k++)
-		cp[k] = c[k - 4];
-
-	cp[25] = 0;
-	cp[82] = 0;
-	cp[139] = 0;
-	cp[424] = 0;
-
-	gsm0503_xcch_interleave(cp, iB);
+	INTERLEAVE(iB, up, &mcs1_idx[0], 12);
+	INTERLEAVE(iB, hc, &mcs1_idx[12], 68);
+	INTERLEAVE(iB, dc, &mcs1_idx[80], 372);
+
+	iB[XCCH_IDX(25)] = 0;
+	iB[XCCH_IDX(82)] = 0;
+	iB[XCCH_IDX(139)] = 0;
+	iB[XCCH_IDX(424)] = 0;
 }
 
 /*! Interleave MCS1 UL burst bits according to TS 05.03 5.1.5.2.4
@@ -193,32 +234,11 @@ void gsm0503_mcs1_dl_interleave(const ubit_t *up, const ubit_t *hc,
  *  \param[in] iB 456 interleaved soft input bits */
 void gsm0503_mcs1_ul_deinterleave(sbit_t *hc, sbit_t *dc, const sbit_t *iB)
 {
-	int k;
-	sbit_t c[452];
-	sbit_t cp[456];
-
-	gsm0503_xcch_deinterleave(cp, iB);
-
-	for (k = 0; k < 25; k++)
-		c[k] = cp[k];
-	for (k = 26; k < 82; k++)
-		c[k - 1] = cp[k];
-	for (k = 83; k < 139; k++)
-		c[k - 2] = cp[k];
-	for (k = 140; k < 424; k++)
-		c[k - 3] = cp[k];
-	for (k = 425; k < 456; k++)
-		c[k - 4] = cp[k];
-
-	if (hc) {
-		for (k = 0; k < 80; k++)
-			hc[k] = c[k];
-	}
+	if (hc)
+		DEINTERLEAVE(hc, iB, &mcs1_idx[0], 80);
 
-	if (dc) {
-		for (k = 80; k < 452; k++)
-			dc[k - 80] = c[k];
-	}
+	if (dc)
+		DEINTERLEAVE(dc, iB, &mcs1_idx[80], 372);
 }
 
 /*! Interleave MCS1 DL burst bits according to TS 05.03 5.1.5.2.4
@@ -227,32 +247,13 @@ void gsm0503_mcs1_ul_deinterleave(sbit_t *hc, sbit_t *dc, const sbit_t *iB)
  *  \param[out] iB 456 interleaved output bits */
 void gsm0503_mcs1_ul_interleave(const ubit_t *hc, const ubit_t *dc, ubit_t *iB)
 {
-	int k;
-	ubit_t c[452];
-	ubit_t cp[456];
-
-	for (k = 0; k < 80; k++)
-		c[k] = hc[k];
-	for (k = 80; k < 452; k++)
-		c[k] = dc[k - 80];
-
-	for (k = 0; k < 25; k++)
-		cp[k] = c[k];
-	for (k = 26; k < 82; k++)
-		cp[k] = c[k - 1];
-	for (k = 83; k < 139; k++)
-		cp[k] = c[k - 2];
-	for (k = 140; k < 424; k++)
-		cp[k] = c[k - 3];
-	for (k = 425; k < 456; k++)
-		cp[k] = c[k - 4];
-
-	cp[25] = 0;
-	cp[82] = 0;
-	cp[139] = 0;
-	cp[424] = 0;
-
-	gsm0503_xcch_interleave(cp, iB);
+	INTERLEAVE(iB, hc, &mcs1_idx[0], 80);
+	INTERLEAVE(iB, dc, &mcs1_idx[80], 372);
+
+	iB[XCCH_IDX(25)] = 0;
+	iB[XCCH_IDX(82)] = 0;
+	iB[XCCH_IDX(139)] = 0;
+	iB[XCCH_IDX(424)] = 0;
 }
 
 /*! Interleave MCS5 UL burst bits according to TS 05.03 5.1.9.2.4
@@ -263,19 +264,8 @@ void gsm0503_mcs1_ul_interleave(const ubit_t *hc, const ubit_t *dc, ubit_t *iB)
 void gsm0503_mcs5_ul_interleave(const ubit_t *hc, const ubit_t *dc,
 	ubit_t *hi, ubit_t *di)
 {
-	int j, k;
-
-	/* Header */
-	for (k = 0; k < 136; k++) {
-		j = 34 * (k % 4) + 2 * (11 * k % 17) + k % 8 / 4;
-		hi[j] = hc[k];
-	}
-
-	/* Data */
-	for (k = 0; k < 1248; k++) {
-		j = gsm0503_interleave_mcs5[k];
-		di[j] = dc[k];
-	}
+	INTERLEAVE(hi, hc, mcs5_ul_hdr_idx, 136);
+	INTERLEAVE(di, dc, gsm0503_interleave_mcs5, 1248);
 }
 
 /*! De-Interleave MCS5 UL burst bits according to TS 05.03 5.1.9.2.4
@@ -285,23 +275,11 @@ void gsm0503_mcs5_ul_interleave(const ubit_t *hc, const ubit_t *dc,
 void gsm0503_mcs5_ul_deinterleave(sbit_t *hc, sbit_t *dc,
 	const sbit_t *hi, const sbit_t *di)
 {
-	int j, k;
-
-	/* Header */
-	if (hc) {
-		for (k = 0; k < 136; k++) {
-			j = 34 * (k % 4) + 2 * (11 * k % 17) + k % 8 / 4;
-			hc[k] = hi[j];
-		}
-	}
+	if (hc)
+		DEINTERLEAVE(hc, hi, mcs5_ul_hdr_idx, 136);
 
-	/* Data */
-	if (dc) {
-		for (k = 0; k < 1248; k++) {
-			j = gsm0503_interleave_mcs5[k];
-			dc[k] = di[j];
-		}
-	}
+	if (dc)
+		DEINTERLEAVE(dc, di, gsm0503_interleave_mcs5, 1248);
 }
 
 /*! Interleave MCS5 DL burst bits according to TS 05.03 5.1.9.1.5
@@ -312,19 +290,8 @@ void gsm0503_mcs5_ul_deinterleave(sbit_t *hc, sbit_t *dc,
 void gsm0503_mcs5_dl_interleave(const ubit_t *hc, const ubit_t *dc,
 	ubit_t *hi, ubit_t *di)
 {
-	int j, k;
-
-	/* Header */
-	for (k = 0; k < 100; k++) {
-		j = 25 * (k % 4) + ((17 * k) % 25);
-		hi[j] = hc[k];
-	}
-
-	/* Data */
-	for (k = 0; k < 1248; k++) {
-		j = gsm0503_interleave_mcs5[k];
-		di[j] = dc[k];
-	}
+	INTERLEAVE(hi, hc, mcs5_dl_hdr_idx, 100);
+	INTERLEAVE(di, dc, gsm0503_interleave_mcs5, 1248);
 }
 
 /*! De-Interleave MCS5 UL burst bits according to TS 05.03 5.1.9.1.5
@@ -334,23 +301,11 @@ void gsm0503_mcs5_dl_interleave(const ubit_t *hc, const ubit_t *dc,
 void gsm0503_mcs5_dl_deinterleave(sbit_t *hc, sbit_t *dc,
 	const sbit_t *hi, const sbit_t *di)
 {
-	int j, k;
-
-	/* Header */
-	if (hc) {
-		for (k = 0; k < 100; k++) {
-			j = 25 * (k % 4) + ((17 * k) % 25);
-			hc[k] = hi[j];
-		}
-	}
+	if (hc)
+		DEINTERLEAVE(hc, hi, mcs5_dl_hdr_idx, 100);
 
-	/* Data */
-	if (dc) {
-		for (k = 0; k < 1248; k++) {
-			j = gsm0503_interleave_mcs5[k];
-			dc[k] = di[j];
-		}
-	}
+	if (dc)
+		DEINTERLEAVE(dc, di, gsm0503_interleave_mcs5, 1248);
 }
 
 /*! Interleave MCS7 DL burst bits according to TS 05.03 5.1.11.1.5
@@ -362,24 +317,9 @@ void gsm0503_mcs5_dl_deinterleave(sbit_t *hc, sbit_t *dc,
 void gsm0503_mcs7_dl_interleave(const ubit_t *hc, const ubit_t *c1,
 	const ubit_t *c2, ubit_t *hi, ubit_t *di)
 {
-	int j, k;
-	ubit_t dc[1224];
-
-	/* Header */
-	for (k = 0; k < 124; k++) {
-		j = 31 * (k % 4) + ((17 * k) % 31);
-		hi[j] = hc[k];
-	}
-
-	memcpy(&dc[0], c1, 612);
-	memcpy(&dc[612], c2, 612);
-
-	/* Data */
-	for (k = 0; k < 1224; k++) {
-		j = 306 * (k % 4) + 3 * (44 * k % 102 + k / 4 % 2) +
-			(k + 2 - k / 408) % 3;
-		di[j] = dc[k];
-	}
+	INTERLEAVE(hi, hc, mcs7_dl_hdr_idx, 124);
+	INTERLEAVE(di, c1, &mcs7_data_idx[0], 612);
+	INTERLEAVE(di, c2, &mcs7_data_idx[612], 612);
 }
 
 /*! De-Interleave MCS7 DL burst bits according to TS 05.03 5.1.11.1.5
@@ -391,27 +331,12 @@ void gsm0503_mcs7_dl_interleave(const ubit_t *hc, const ubit_t *c1,
 void gsm0503_mcs7_dl_deinterleave(sbit_t *hc, sbit_t *c1, sbit_t *c2,
 	const sbit_t *hi, const sbit_t *di)
 {
-	int j, k;
-	ubit_t dc[1224];
-
-	/* Header */
-	if (hc) {
-		for (k = 0; k < 124; k++) {
-			j = 31 * (k % 4) + ((17 * k) % 31);
-			hc[k] = hi[j];
-		}
-	}
+	if (hc)
+		DEINTERLEAVE(hc, hi, mcs7_dl_hdr_idx, 124);
 
-	/* Data */
 	if (c1 && c2) {
-		for (k = 0; k < 1224; k++) {
-			j = 306 * (k % 4) + 3 * (44 * k % 102 + k / 4 % 2) +
-	(k + 2 - k / 408) % 3;
-			dc[k] = di[j];
-		}
-
-		memcpy(c1, &dc[0], 612);
-		memcpy(c2, &dc[612], 612);
+		DEINTERLEAVE(c1, di, &mcs7_data_idx[0], 612);
+		DEINTERLEAVE(c2, di, &mcs7_data_idx[612], 612);
 	}
 }
 
@@ -424,24 +349,9 @@ void gsm0503_mcs7_dl_deinterleave(sbit_t *hc, sbit_t *c1, sbit_t *c2,
 void gsm0503_mcs7_ul_interleave(const ubit_t *hc, const ubit_t *c1,
 	const ubit_t *c2, ubit_t *hi, ubit_t *di)
 {
-	int j, k;
-	ubit_t dc[1224];
-
-	/* Header */
-	for (k = 0; k < 160; k++) {
-		j = 40 * (k % 4) + 2 * (13 * (k / 8) % 20) + k % 8 / 4;
-		hi[j] = hc[k];
-	}
-
-	memcpy(&dc[0], c1, 612);
-	memcpy(&dc[612], c2, 612);
-
-	/* Data */
-	for (k = 0; k < 1224; k++) {
-		j = 306 * (k % 4) + 3 * (44 * k % 102 + k / 4 % 2) +
-			(k + 2 - k / 408) % 3;
-		di[j] = dc[k];
-	}
+	INTERLEAVE(hi, hc, mcs7_ul_hdr_idx, 160);
+	INTERLEAVE(di, c1, &mcs7_data_idx[0], 612);
+	INTERLEAVE(di, c2, &mcs7_data_idx[612], 612);
 }
 
 /*! De-Interleave MCS7 UL burst bits according to TS 05.03 5.1.11.2.4
@@ -453,27 +363,12 @@ void gsm0503_mcs7_ul_interleave(const ubit_t *hc, const ubit_t *c1,
 void gsm0503_mcs7_ul_deinterleave(sbit_t *hc, sbit_t *c1, sbit_t *c2,
 	const sbit_t *hi, const sbit_t *di)
 {
-	int j, k;
-	ubit_t dc[1224];
-
-	/* Header */
-	if (hc) {
-		for (k = 0; k < 160; k++) {
-			j = 40 * (k % 4) + 2 * (13 * (k / 8) % 20) + k % 8 / 4;
-			hc[k] = hi[j];
-		}
-	}
+	if (hc)
+		DEINTERLEAVE(hc, hi, mcs7_ul_hdr_idx, 160);
 
-	/* Data */
 	if (c1 && c2) {
-		for (k = 0; k < 1224; k++) {
-			j = 306 * (k % 4) + 3 * (44 * k % 102 + k / 4 % 2) +
-	(k + 2 - k / 408) % 3;
-			dc[k] = di[j];
-		}
-
-		memcpy(c1, &dc[0], 612);
-		memcpy(c2, &dc[612], 612);
+		DEINTERLEAVE(c1, di, &mcs7_data_idx[0], 612);
+		DEINTERLEAVE(c2, di, &mcs7_data_idx[612], 612);
 	}
 }
 
@@ -486,24 +381,9 @@ void gsm0503_mcs7_ul_deinterleave(sbit_t *hc, sbit_t *c1, sbit_t *c2,
 void gsm0503_mcs8_ul_interleave(const ubit_t *hc, const ubit_t *c1,
 	const ubit_t *c2, ubit_t *hi, ubit_t *di)
 {
-	int j, k;
-	ubit_t dc[1224];
-
-	/* Header */
-	for (k = 0; k < 160; k++) {
-		j = 40 * (k % 4) + 2 * (13 * (k / 8) % 20) + k % 8 / 4;
-		hi[j] = hc[k];
-	}
-
-	memcpy(&dc[0], c1, 612);
-	memcpy(&dc[612], c2, 612);
-
-	/* Data */
-	for (k = 0; k < 1224; k++) {
-		j = 306 * (2 * (k / 612) + (k % 2)) +
-			3 * (74 * k % 102 + k / 2 % 2) + (k + 2 - k / 204) % 3;
-		di[j] = dc[k];
-	}
+	INTERLEAVE(hi, hc, mcs7_ul_hdr_idx, 160);
+	INTERLEAVE(di, c1, &mcs8_data_idx[0], 612);
+	INTERLEAVE(di, c2, &mcs8_data_idx[612], 612);
 }
 
 
@@ -516,27 +396,12 @@ void gsm0503_mcs8_ul_interleave(const ubit_t *hc, const ubit_t *c1,
 void gsm0503_mcs8_ul_deinterleave(sbit_t *hc, sbit_t *c1, sbit_t *c2,
 	const sbit_t *hi, const sbit_t *di)
 {
-	int j, k;
-	ubit_t dc[1224];
-
-	/* Header */
-	if (hc) {
-		for (k = 0; k < 160; k++) {
-			j = 40 * (k % 4) + 2 * (13 * (k / 8) % 20) + k % 8 / 4;
-			hc[k] = hi[j];
-		}
-	}
+	if (hc)
+		DEINTERLEAVE(hc, hi, mcs7_ul_hdr_idx, 160);
 
-	/* Data */
 	if (c1 && c2) {
-		for (k = 0; k < 1224; k++) {
-			j = 306 * (2 * (k / 612) + (k % 2)) +
-	3 * (74 * k % 102 + k / 2 % 2) + (k + 2 - k / 204) % 3;
-			dc[k] = di[j];
-		}
-
-		memcpy(c1, &dc[0], 612);
-		memcpy(c2, &dc[612], 612);
+		DEINTERLEAVE(c1, di, &mcs8_data_idx[0], 612);
+		DEINTERLEAVE(c2, di, &mcs8_data_idx[612], 612);
 	}
 }
 
@@ -549,24 +414,9 @@ void gsm0503_mcs8_ul_deinterleave(sbit_t *hc, sbit_t *c1, sbit_t *c2,
 void gsm0503_mcs8_dl_interleave(const ubit_t *hc, const ubit_t *c1,
 	const ubit_t *c2, ubit_t *hi, ubit_t *di)
 {
-	int j, k;
-	ubit_t dc[1224];
-
-	/* Header */
-	for (k = 0; k < 124; k++) {
-		j = 31 * (k % 4) + ((17 * k) % 31);
-		hi[j] = hc[k];
-	}
-
-	memcpy(&dc[0], c1, 612);
-	memcpy(&dc[612], c2, 612);
-
-	/* Data */
-	for (k = 0; k < 1224; k++) {
-		j = 306 * (2 * (k / 612) + (k % 2)) +
-			3 * (74 * k % 102 + k / 2 % 2) + (k + 2 - k / 204) % 3;
-		di[j] = dc[k];
-	}
+	INTERLEAVE(hi, hc, mcs7_dl_hdr_idx, 124);
+	INTERLEAVE(di, c1, &mcs8_data_idx[0], 612);
+	INTERLEAVE(di, c2, &mcs8_data_idx[612], 612);
 }
 
 /*! De-Interleave MCS8 DL burst bits according to TS 05.03 5.1.12.1.5
@@ -578,27 +428,12 @@ void gsm0503_mcs8_dl_interleave(const ubit_t *hc, const ubit_t *c1,
 void gsm0503_mcs8_dl_deinterleave(sbit_t *hc, sbit_t *c1, sbit_t *c2,
 	const sbit_t *hi, const sbit_t *di)
 {
-	int j, k;
-	ubit_t dc[1224];
-
-	/* Header */
-	if (hc) {
-		for (k = 0; k < 124; k++) {
-			j = 31 * (k % 4) + ((17 * k) % 31);
-			hc[k] = hi[j];
-		}
-	}
+	if (hc)
+		DEINTERLEAVE(hc, hi, mcs7_dl_hdr_idx, 124);
 
-	/* Data */
 	if (c1 && c2) {
-		for (k = 0; k < 1224; k++) {
-			j = 306 * (2 * (k / 612) + (k % 2)) +
-	3 * (74 * k % 102 + k / 2 % 2) + (k + 2 - k / 204) % 3;
-			dc[k] = di[j];
-		}
-
-		memcpy(c1, &dc[0], 612);
-		memcpy(c2, &dc[612], 612);
+		DEINTERLEAVE(c1, di, &mcs8_data_idx[0], 612);
+		DEINTERLEAVE(c2, di, &mcs8_data_idx[612], 612);
 	}
 }
 
@@ -631,13 +466,19 @@ void gsm0503_mcs8_dl_deinterleave(sbit_t *hc, sbit_t *c1, sbit_t *c2,
  *  \param[in] iB 456 unpacked interleaved input bits */
 void gsm0503_tch_fr_deinterleave(sbit_t *cB, const sbit_t *iB)
 {
-	int j, k, B;
+	DEINTERLEAVE(cB, iB, tch_fr_idx, 456);
+}
 
-	for (k = 0; k < 456; k++) {
-		B = k & 7;
-		j = 2 * ((49 * k) % 57) + ((k & 7) >> 2);
-		cB[k] = iB[B * 114 + j];
-	}
+/*! GSM TCH FR/EFR/AFS De-Interleaving of the bits of 8 bursts
+ *  \param[out] cB caller-allocated buffer for 456 unpacked output bits
+ *  \param[in] bursts 8 bursts of 116 soft bits
+ *
+ *  This is the same as gsm0503_tch_burst_unmap() of each burst, with the
+ *  even bits of the first and the odd bits of the last 4 bursts, followed
+ *  by gsm0503_tch_fr_deinterleave(), in a single pass. */
+void gsm0503_tch_fr_deinterleave_bursts(sbit_t *cB, const sbit_t *bursts)
+{
+	DEINTERLEAVE(cB, bursts, tch_fr_pos, 456);
 }
 
 /*! GSM TCH FR/EFR/AFS Interleaving and burst mapping
@@ -645,13 +486,7 @@ void gsm0503_tch_fr_deinterleave(sbit_t *cB, const sbit_t *iB)
  *  \param[out] iB 456 unpacked interleaved output bits */
 void gsm0503_tch_fr_interleave(const ubit_t *cB, ubit_t *iB)
 {
-	int j, k, B;
-
-	for (k = 0; k < 456; k++) {
-		B = k & 7;
-		j = 2 * ((49 * k) % 57) + ((k & 7) >> 2);
-		iB[B * 114 + j] = cB[k];
-	}
+	INTERLEAVE(iB, cB, tch_fr_idx, 456);
 }
 
 /*! GSM TCH HR/AHS De-Interleaving and burst mapping
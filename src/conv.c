@@ -241,6 +241,8 @@ osmo_conv_encode(const struct osmo_conv_code *code,
 int
 osmo_conv_decode_acc(const struct osmo_conv_code *code,
                      const sbit_t *input, ubit_t *output);
+int
+osmo_conv_acc_code_supported(const struct osmo_conv_code *code);
 
 void
 osmo_conv_decode_init(struct osmo_conv_decoder *decoder,
@@ -611,7 +613,7 @@ osmo_conv_decode(const struct osmo_conv_code *code,
 	int rv, l;
 
 	/* Use accelerated implementation for supported codes */
-	if ((code->N <= 4) && ((code->K == 5) || (code->K == 7)))
+	if (osmo_conv_acc_code_supported(code))
 		return osmo_conv_decode_acc(code, input, output);
 
 	osmo_conv_decode_init(&decoder, code, 0, 0);
@@ -636,4 +638,203 @@ osmo_conv_decode(const struct osmo_conv_code *code,
 	return rv;
 }
 
+/* Cache of accelerated decoder contexts, keyed by the address of the code.
+ * The contexts hold the trellis and path memory of a decode in progress,
+ * so each thread has its own cache. */
+#define DEC_CACHE_SIZE	64
+
+static __thread struct {
+	const struct osmo_conv_code *code;
+	struct osmo_conv_acc_decoder *dec;
+} dec_cache[DEC_CACHE_SIZE];
+
+static struct osmo_conv_acc_decoder *
+dec_cache_get(const struct osmo_conv_code *code)
+{
+	unsigned int i, idx = ((uintptr_t)code / sizeof(void *)) % DEC_CACHE_SIZE;
+
+	/* open addressing with linear probing; entries are only removed all at
+	 * once by osmo_conv_decode_cached_free() */
+	for (i = 0; i < DEC_CACHE_SIZE; i++, idx = (idx + 1) % DEC_CACHE_SIZE) {
+		if (dec_cache[idx].code == code)
+			return dec_cache[idx].dec;
+		if (!dec_cache[idx].code)
+			break;
+	}
+
+	/* cache is full: decode without caching */
+	if (i == DEC_CACHE_SIZE)
+		return NULL;
+
+	/* a NULL entry also records that the code isn't supported */
+	dec_cache[idx].code = code;
+	dec_cache[idx].dec = osmo_conv_acc_decoder_alloc(code);
+
+	return dec_cache[idx].dec;
+}
+
+/*! Release the decoder contexts cached by the calling thread
+ *
+ * Frees all decoder contexts that \ref osmo_conv_decode_cached and
+ * friends have set up in the calling thread. A thread that used them
+ * should call this before it exits, as the contexts are not released
+ * automatically. They are set up again on the next cached decode.
+ */
+void osmo_conv_decode_cached_free(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < DEC_CACHE_SIZE; i++) {
+		if (dec_cache[i].dec)
+			osmo_conv_acc_decoder_free(dec_cache[i].dec);
+		dec_cache[i].code = NULL;
+		dec_cache[i].dec = NULL;
+	}
+}
+
+/*! All-in-one convolutional decoding function, re-using decoder state
+ *  \param[in] code description of convolutional code to be used
+ *  \param[in] input array of soft bits (coded)
+ *  \param[out] output array of unpacked bits (decoded)
+ *
+ * Like \ref osmo_conv_decode, but the accelerated decoder context for
+ * \a code is set up on the first call and kept for all later calls with
+ * the same code. Hence \a code must be a constant object that lives for
+ * the rest of the program, like the codes of the GSM 05.03 coding.
+ *
+ * The decoder contexts are cached per thread, so this function may be
+ * called from several threads at once. The contexts of a thread are not
+ * released when the thread exits, see \ref osmo_conv_decode_cached_free.
+ */
+int
+osmo_conv_decode_cached(const struct osmo_conv_code *code,
+                        const sbit_t *input, ubit_t *output)
+{
+	struct osmo_conv_acc_decoder *dec;
+
+	dec = dec_cache_get(code);
+	if (dec)
+		return osmo_conv_acc_decode(dec, input, output);
+
+	return osmo_conv_decode(code, input, output);
+}
+
+/* Count the coded bits whose hard decision differs from the re-encoded
+ * output of the decoder, for codes without an accelerated decoder */
+static int
+conv_count_errors(const struct osmo_conv_code *code,
+                  const sbit_t *input, const ubit_t *output,
+                  const uint8_t *erased,
+                  int *n_errors, int *n_bits_total, int *metric)
+{
+	ubit_t recoded[osmo_conv_get_output_length(code, 0)];
+	int i, coded_len, corr;
+	int errors = 0, bits = 0, sum = 0;
+
+	coded_len = osmo_conv_encode(code, output, recoded);
+	if (coded_len < 0)
+		return coded_len;
+
+	for (i = 0; i < coded_len; i++) {
+		bits++;
+		if (erased && erased[i])
+			continue;
+
+		corr = recoded[i] ? -input[i] : input[i];
+		sum += corr;
+		if (corr <= 0)
+			errors++;
+	}
+
+	if (n_errors)
+		*n_errors = errors;
+	if (n_bits_total)
+		*n_bits_total = bits;
+	if (metric)
+		*metric = sum;
+
+	return 0;
+}
+
+/*! All-in-one convolutional decoding function with bit error statistics
+ *  \param[in] code description of convolutional code to be used
+ *  \param[in] input array of soft bits (coded)
+ *  \param[out] output array of unpacked bits (decoded)
+ *  \param[in] erased coded bits to leave out of the error count and the
+ *		      metric, one flag per soft bit of \a input. Can be NULL.
+ *  \param[out] n_errors number of coded bits whose hard decision differs
+ *			 from the decoded path. Can be NULL.
+ *  \param[out] n_bits_total number of coded bits. Can be NULL.
+ *  \param[out] metric correlation of the soft bits with the decoded path,
+ *		       up to 127 per coded bit that is not erased. Can be
+ *		       NULL.
+ *  \returns 0 on success; negative on error
+ *
+ * Like \ref osmo_conv_decode_cached, so the same restrictions on \a code
+ * apply. A soft bit of 0 counts as error unless it is flagged in
+ * \a erased. Where possible, the statistics are taken from the Viterbi
+ * traceback, without encoding the decoded bits again.
+ */
+int
+osmo_conv_decode_cached_ber(const struct osmo_conv_code *code,
+                            const sbit_t *input, ubit_t *output,
+                            const uint8_t *erased,
+                            int *n_errors, int *n_bits_total, int *metric)
+{
+	struct osmo_conv_acc_decoder *dec;
+	int rv;
+
+	dec = dec_cache_get(code);
+	if (dec)
+		return osmo_conv_acc_decode_ber(dec, input, output, erased,
+			n_errors, n_bits_total, metric);
+
+	rv = osmo_conv_decode(code, input, output);
+
+	if (n_errors || n_bits_total || metric)
+		conv_count_errors(code, input, output, erased,
+			n_errors, n_bits_total, metric);
+
+	return rv;
+}
+
+/*! Decode a batch of blocks coded with the same convolutional code
+ *  \param[in] code description of convolutional code to be used
+ *  \param[in] n number of blocks
+ *  \param[in] input array of pointers to the soft bits of each block
+ *  \param[out] output array of pointers to the decoded bits of each block
+ *  \param[out] n_errors number of bit errors per block, can be NULL
+ *  \param[out] n_bits_total number of coded bits per block, can be NULL
+ *  \returns 0 if all blocks were decoded; negative on error
+ *
+ * Uses the cached decoder context of \ref osmo_conv_decode_cached, hence
+ * the same restrictions on \a code apply. Where possible, several blocks
+ * are decoded at the same time. The bit errors are counted like in
+ * \ref osmo_conv_decode_cached_ber.
+ */
+int
+osmo_conv_decode_batch(const struct osmo_conv_code *code, unsigned int n,
+                       const sbit_t * const *input, ubit_t * const *output,
+                       int *n_errors, int *n_bits_total)
+{
+	struct osmo_conv_acc_decoder *dec;
+	unsigned int i;
+	int rv = 0, rc;
+
+	dec = dec_cache_get(code);
+	if (dec)
+		return osmo_conv_acc_decode_batch(dec, n, input, output, NULL,
+			n_errors, n_bits_total);
+
+	for (i = 0; i < n; i++) {
+		rc = osmo_conv_decode_cached_ber(code, input[i], output[i], NULL,
+			n_errors ? &n_errors[i] : NULL,
+			n_bits_total ? &n_bits_total[i] : NULL, NULL);
+		if (rc < 0)
+			rv = rc;
+	}
+
+	return rv;
+}
+
 /*! @} */
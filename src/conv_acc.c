@@ -31,7 +31,16 @@
 #include <osmocom/core/conv.h>
 
 #define BIT2NRZ(REG,N)	(((REG >> N) & 0x01) * 2 - 1) * -1
-#define NUM_STATES(K)	(K == 7 ? 64 : 16)
+#define NUM_STATES(K)	(1 << ((K) - 1))
+
+/* Outputs per state in the trellis, N=3 is padded to 4 for the SIMD units */
+#define NUM_OUTPUTS(N)	((N) == 3 ? 4 : (N))
+
+/* Range of codes the decoder handles */
+#define MIN_K	3
+#define MAX_K	9
+#define MIN_N	2
+#define MAX_N	8
 
 #define INIT_POINTERS(simd) \
 { \
@@ -43,6 +52,7 @@
 	osmo_conv_metrics_k7_n4 = osmo_conv_##simd##_metrics_k7_n4; \
 	vdec_malloc = &osmo_conv_##simd##_vdec_malloc; \
 	vdec_free = &osmo_conv_##simd##_vdec_free; \
+	metrics_kx = NULL; \
 }
 
 static int init_complete = 0;
@@ -50,6 +60,10 @@ static int init_complete = 0;
 __attribute__ ((visibility("hidden"))) int avx2_supported = 0;
 __attribute__ ((visibility("hidden"))) int ssse3_supported = 0;
 __attribute__ ((visibility("hidden"))) int sse41_supported = 0;
+__attribute__ ((visibility("hidden"))) int avx512bw_supported = 0;
+
+/* Currently selected back-end, see osmo_conv_acc_set_backend() */
+static enum osmo_conv_acc_backend acc_backend;
 
 /**
  * These pointers are being initialized at runtime by the
@@ -85,6 +99,42 @@ int16_t *osmo_conv_sse_avx_vdec_malloc(size_t n);
 void osmo_conv_sse_avx_vdec_free(int16_t *ptr);
 #endif
 
+#if defined(HAVE_AVX512BW)
+int16_t *osmo_conv_avx512_vdec_malloc(size_t n);
+void osmo_conv_avx512_vdec_free(int16_t *ptr);
+#endif
+
+/* Metric function of a code other than K=5 and K=7 with N=2 to N=4 */
+typedef void (*metric_func)(const int8_t *seq, const int16_t *out,
+	int16_t *sums, int16_t *paths, int norm);
+
+/* Lookup of the back-end for these codes, NULL if it has none; the
+ * generic units cover all of them */
+static metric_func (*metrics_kx)(int k, int n);
+
+metric_func osmo_conv_gen_metrics_kx(int k, int n);
+
+#if defined(HAVE_SSSE3)
+metric_func osmo_conv_sse_metrics_kx(int k, int n);
+#endif
+
+#if defined(HAVE_SSSE3) && defined(HAVE_AVX2)
+metric_func osmo_conv_sse_avx_metrics_kx(int k, int n);
+#endif
+
+/* Two-block forward recursion for K=5, NULL if not available */
+typedef void (*forward_k5_x2_func)(int n, int len, int intrvl,
+	const int8_t *seq0, const int8_t *seq1, const int16_t *out,
+	int16_t *sums0, int16_t *sums1, int16_t **paths0, int16_t **paths1);
+
+static forward_k5_x2_func forward_k5_x2;
+
+#if defined(HAVE_SSSE3) && defined(HAVE_AVX2)
+void osmo_conv_sse_avx_forward_k5_x2(int n, int len, int intrvl,
+	const int8_t *seq0, const int8_t *seq1, const int16_t *out,
+	int16_t *sums0, int16_t *sums1, int16_t **paths0, int16_t **paths1);
+#endif
+
 /* Forward Metric Units */
 void osmo_conv_gen_metrics_k5_n2(const int8_t *seq, const int16_t *out,
 	int16_t *sums, int16_t *paths, int norm);
@@ -129,6 +179,21 @@ void osmo_conv_sse_avx_metrics_k7_n4(const int8_t *seq, const int16_t *out,
 	int16_t *sums, int16_t *paths, int norm);
 #endif
 
+#if defined(HAVE_AVX512BW)
+void osmo_conv_avx512_metrics_k5_n2(const int8_t *seq, const int16_t *out,
+	int16_t *sums, int16_t *paths, int norm);
+void osmo_conv_avx512_metrics_k5_n3(const int8_t *seq, const int16_t *out,
+	int16_t *sums, int16_t *paths, int norm);
+void osmo_conv_avx512_metrics_k5_n4(const int8_t *seq, const int16_t *out,
+	int16_t *sums, int16_t *paths, int norm);
+void osmo_conv_avx512_metrics_k7_n2(const int8_t *seq, const int16_t *out,
+	int16_t *sums, int16_t *paths, int norm);
+void osmo_conv_avx512_metrics_k7_n3(const int8_t *seq, const int16_t *out,
+	int16_t *sums, int16_t *paths, int norm);
+void osmo_conv_avx512_metrics_k7_n4(const int8_t *seq, const int16_t *out,
+	int16_t *sums, int16_t *paths, int norm);
+#endif
+
 /* Trellis State
  * state - Internal lshift register value
  * prev  - Register values of previous 0 and 1 states
@@ -159,8 +224,13 @@ struct vtrellis {
  * intrvl    - Normalization interval
  * trellis   - Trellis object
  * paths     - Trellis paths
+ *
+ * The metric functions and the memory allocator of the back-end that was
+ * selected at initialization are kept, so that a decoder stays valid when
+ * the back-end is changed.
  */
 struct vdecoder {
+	const struct osmo_conv_code *code;
 	int n;
 	int k;
 	int len;
@@ -169,8 +239,9 @@ struct vdecoder {
 	struct vtrellis trellis;
 	int16_t **paths;
 
-	void (*metric_func)(const int8_t *, const int16_t *,
-		int16_t *, int16_t *, int);
+	metric_func metric_func;
+	forward_k5_x2_func forward_k5_x2;
+	void (*vdec_free)(int16_t *ptr);
 };
 
 /* Accessor calls */
@@ -182,14 +253,7 @@ static inline int conv_code_recursive(const struct osmo_conv_code *code)
 /* Left shift and mask for finding the previous state */
 static unsigned vstate_lshift(unsigned reg, int k, int val)
 {
-	unsigned mask;
-
-	if (k == 5)
-		mask = 0x0e;
-	else if (k == 7)
-		mask = 0x3e;
-	else
-		mask = 0;
+	unsigned mask = (NUM_STATES(k) - 1) & ~0x01;
 
 	return ((reg << 1) & mask) | val;
 }
@@ -240,8 +304,11 @@ static unsigned bitswap(unsigned v, unsigned n)
 	case 6:
 		return bitswap6(v);
 	default:
-		return 0;
+		break;
 	}
+
+	/* Longer registers of K=8 and K=9, and up to N=8 outputs */
+	return (bitswap(v & 0x0f, 4) << (n - 4)) | bitswap(v >> 4, n - 4);
 }
 
 /* Generate non-recursive state output from generator state table
@@ -366,16 +433,30 @@ static int gen_recursive_state_info(uint8_t *val,
 }
 
 /* Release the trellis */
-static void free_trellis(struct vtrellis *trellis)
+static void free_trellis(struct vdecoder *dec)
 {
-	if (!trellis)
-		return;
+	struct vtrellis *trellis = &dec->trellis;
 
-	vdec_free(trellis->outputs);
-	vdec_free(trellis->sums);
+	dec->vdec_free(trellis->outputs);
+	dec->vdec_free(trellis->sums);
 	free(trellis->vals);
 }
 
+/* Reset the accumulated path metrics of the trellis
+ * For termination other than tail-biting, initialize the zero state
+ * as the encoder starting state. Initialize with the maximum
+ * accumulated sum at length equal to the constraint length.
+ */
+static void reset_trellis(struct vdecoder *dec)
+{
+	struct vtrellis *trellis = &dec->trellis;
+
+	memset(trellis->sums, 0, trellis->num_states * sizeof(int16_t));
+
+	if (dec->code->term != CONV_TERM_TAIL_BITING)
+		trellis->sums[0] = INT8_MAX * dec->n * dec->k;
+}
+
 /* Initialize the trellis object
  * Initialization consists of generating the outputs and output value of a
  * given state. Due to trellis symmetry and anti-symmetry, only one of the
@@ -390,7 +471,7 @@ static int generate_trellis(struct vdecoder *dec,
 	int i, rc;
 
 	int ns = NUM_STATES(code->K);
-	int olen = (code->N == 2) ? 2 : 4;
+	int olen = NUM_OUTPUTS(code->N);
 
 	trellis->num_states = ns;
 	trellis->sums =	vdec_malloc(ns);
@@ -415,28 +496,67 @@ static int generate_trellis(struct vdecoder *dec,
 
 		if (rc < 0)
 			goto fail;
-
-		/* Set accumulated path metrics to zero */
-		trellis->sums[i] = 0;
 	}
 
-	/**
-	 * For termination other than tail-biting, initialize the zero state
-	 * as the encoder starting state. Initialize with the maximum
-	 * accumulated sum at length equal to the constraint length.
-	 */
-	if (code->term != CONV_TERM_TAIL_BITING)
-		trellis->sums[0] = INT8_MAX * code->N * code->K;
+	reset_trellis(dec);
 
 	return 0;
 
 fail:
-	free_trellis(trellis);
+	free_trellis(dec);
 	return rc;
 }
 
+/* Bit error statistics of the decoded path
+ * seq    - Depunctured soft input
+ * erased - Positions to leave out of the error count, NULL if none. After
+ *          depuncturing, punctured positions are marked ERASED_PUNCTURED
+ *          and aren't counted at all.
+ */
+#define ERASED_PUNCTURED	2
+
+struct vber {
+	const int8_t *seq;
+	const uint8_t *erased;
+	int depunctured;
+	int n_errors;
+	int n_bits;
+	int metric;
+};
+
+/* Compare the trellis output on the traced back branch into 'state' with
+ * the soft input. The butterflies add the branch metric of state (S mod
+ * num_states/2) on the branch from the even predecessor into the lower
+ * half of the states and on the branch from the odd predecessor into the
+ * upper half; the other two branches use the negated metric.
+ */
+static void ber_step(struct vdecoder *dec, struct vber *ber,
+	int i, unsigned state, unsigned path)
+{
+	unsigned half = dec->trellis.num_states / 2;
+	int olen = NUM_OUTPUTS(dec->n);
+	const int16_t *outputs = &dec->trellis.outputs[olen * (state % half)];
+	int sign = (path == (state >= half)) ? 1 : -1;
+	int j, idx, corr;
+
+	for (j = 0; j < dec->n; j++) {
+		idx = i * dec->n + j;
+		if (ber->erased && ber->erased[idx]) {
+			if (!ber->depunctured || ber->erased[idx] != ERASED_PUNCTURED)
+				ber->n_bits++;
+			continue;
+		}
+
+		corr = sign * outputs[j] * ber->seq[idx];
+		ber->metric += corr;
+		ber->n_bits++;
+		if (corr <= 0)
+			ber->n_errors++;
+	}
+}
+
 static void _traceback(struct vdecoder *dec,
-	unsigned state, uint8_t *out, int len)
+	unsigned state, uint8_t *out, int len, struct vber *ber)
 {
 	int i;
 	unsigned path;
@@ -444,12 +564,47 @@ static void _traceback(struct vdecoder *dec,
 	for (i = len - 1; i >= 0; i--) {
 		path = dec->paths[i][state] + 1;
 		out[i] = dec->trellis.vals[state];
+		if (ber && i >= dec->k - 1)
+			ber_step(dec, ber, i, state, path);
 		state = vstate_lshift(state, dec->k, path);
 	}
 }
 
+/* Bit error statistics of the first K-1 steps of a non-recursive code
+ * The traced back path may start in any state, while the encoder starts
+ * in the zero state or, for tail-biting, in the state given by the last
+ * bits of the block. Use the latter, so that the statistics are those of
+ * the codeword of the decoded bits.
+ */
+static void ber_head(struct vdecoder *dec, struct vber *ber,
+	const uint8_t *out, int len, int term)
+{
+	int i, j, b;
+	unsigned state;
+
+	for (i = 0; i < dec->k - 1 && i < len; i++) {
+		state = 0;
+		for (j = 0; j < dec->k; j++) {
+			b = i - j;
+			if (b >= 0)
+				b = out[b];
+			else if (term == CONV_TERM_TAIL_BITING)
+				b = out[((b % len) + len) % len];
+			else
+				b = 0;
+
+			/* the most recent bit is the MSB of the state, the
+			 * oldest one selects the path into it */
+			if (j < dec->k - 1)
+				state |= b << (dec->k - 2 - j);
+			else
+				ber_step(dec, ber, i, state, b);
+		}
+	}
+}
+
 static void _traceback_rec(struct vdecoder *dec,
-	unsigned state, uint8_t *out, int len)
+	unsigned state, uint8_t *out, int len, struct vber *ber)
 {
 	int i;
 	unsigned path;
@@ -457,6 +612,8 @@ static void _traceback_rec(struct vdecoder *dec,
 	for (i = len - 1; i >= 0; i--) {
 		path = dec->paths[i][state] + 1;
 		out[i] = path ^ dec->trellis.vals[state];
+		if (ber)
+			ber_step(dec, ber, i, state, path);
 		state = vstate_lshift(state, dec->k, path);
 	}
 }
@@ -464,8 +621,10 @@ static void _traceback_rec(struct vdecoder *dec,
 /* Traceback and generate decoded output
  * Find the largest accumulated path metric at the final state except for
  * the zero terminated case, where we assume the final state is always zero.
+ * Optionally count the coded bits that disagree with the decoded path.
  */
-static int traceback(struct vdecoder *dec, uint8_t *out, int term, int len)
+static int traceback(struct vdecoder *dec, uint8_t *out, int term, int len,
+	struct vber *ber)
 {
 	int i, sum, max = -1;
 	unsigned path, state = 0;
@@ -485,13 +644,18 @@ static int traceback(struct vdecoder *dec, uint8_t *out, int term, int len)
 
 	for (i = dec->len - 1; i >= len; i--) {
 		path = dec->paths[i][state] + 1;
+		if (ber)
+			ber_step(dec, ber, i, state, path);
 		state = vstate_lshift(state, dec->k, path);
 	}
 
-	if (dec->recursive)
-		_traceback_rec(dec, state, out, len);
-	else
-		_traceback(dec, state, out, len);
+	if (dec->recursive) {
+		_traceback_rec(dec, state, out, len, ber);
+	} else {
+		_traceback(dec, state, out, len, ber);
+		if (ber)
+			ber_head(dec, ber, out, len, term);
+	}
 
 	return 0;
 }
@@ -502,17 +666,20 @@ static void vdec_deinit(struct vdecoder *dec)
 	if (!dec)
 		return;
 
-	free_trellis(&dec->trellis);
+	free_trellis(dec);
 
 	if (dec->paths != NULL) {
-		vdec_free(dec->paths[0]);
+		dec->vdec_free(dec->paths[0]);
 		free(dec->paths);
 	}
 }
 
 /* Initialize decoder object with code specific params
- * Subtract the constraint length K on the normalization interval to
- * accommodate the initialization path metric at state zero.
+ * After normalization, the path metrics of two states differ by up to
+ * K-1 times the largest difference of branch metrics, which covers the
+ * initialization path metric at state zero as well. Subtract that from the
+ * normalization interval, so that the sums don't overflow for the larger
+ * codes.
  */
 static int vdec_init(struct vdecoder *dec, const struct osmo_conv_code *code)
 {
@@ -520,10 +687,14 @@ static int vdec_init(struct vdecoder *dec, const struct osmo_conv_code *code)
 
 	ns = NUM_STATES(code->K);
 
+	dec->code = code;
 	dec->n = code->N;
 	dec->k = code->K;
 	dec->recursive = conv_code_recursive(code);
-	dec->intrvl = INT16_MAX / (dec->n * INT8_MAX) - dec->k;
+	dec->paths = NULL;
+	dec->intrvl = INT16_MAX / (dec->n * INT8_MAX) - 2 * (dec->k - 1);
+	dec->forward_k5_x2 = forward_k5_x2;
+	dec->vdec_free = vdec_free;
 
 	if (dec->k == 5) {
 		switch (dec->n) {
@@ -537,7 +708,8 @@ static int vdec_init(struct vdecoder *dec, const struct osmo_conv_code *code)
 			dec->metric_func = osmo_conv_metrics_k5_n4;
 			break;
 		default:
-			return -EINVAL;
+			dec->metric_func = NULL;
+			break;
 		}
 	} else if (dec->k == 7) {
 		switch (dec->n) {
@@ -551,12 +723,21 @@ static int vdec_init(struct vdecoder *dec, const struct osmo_conv_code *code)
 			dec->metric_func = osmo_conv_metrics_k7_n4;
 			break;
 		default:
-			return -EINVAL;
+			dec->metric_func = NULL;
+			break;
 		}
 	} else {
-		return -EINVAL;
+		dec->metric_func = NULL;
 	}
 
+	/* Other codes use the back-end's units where it has them */
+	if (!dec->metric_func && metrics_kx)
+		dec->metric_func = metrics_kx(dec->k, dec->n);
+	if (!dec->metric_func)
+		dec->metric_func = osmo_conv_gen_metrics_kx(dec->k, dec->n);
+	if (!dec->metric_func)
+		return -EINVAL;
+
 	if (code->term == CONV_TERM_FLUSH)
 		dec->len = code->len + code->K - 1;
 	else
@@ -584,18 +765,26 @@ enomem:
 	return -ENOMEM;
 }
 
-/* Depuncture sequence with nagative value terminated puncturing matrix */
-static int depuncture(const int8_t *in, const int *punc, int8_t *out, int len)
+/* Depuncture sequence with nagative value terminated puncturing matrix
+ * If 'erased' is given, punctured positions are marked in it, along with
+ * the positions that are marked in 'in_erased' for the punctured input.
+ */
+static int depuncture(const int8_t *in, const int *punc, int8_t *out, int len,
+	const uint8_t *in_erased, uint8_t *erased)
 {
 	int i, n = 0, m = 0;
 
 	for (i = 0; i < len; i++) {
 		if (i == punc[n]) {
 			out[i] = 0;
+			if (erased)
+				erased[i] = ERASED_PUNCTURED;
 			n++;
 			continue;
 		}
 
+		if (erased)
+			erased[i] = (in_erased && in_erased[m]) ? 1 : 0;
 		out[i] = in[m++];
 	}
 
@@ -626,13 +815,19 @@ static void forward_traverse(struct vdecoder *dec, const int8_t *seq)
  * traceback operation.
  */
 static int conv_decode(struct vdecoder *dec, const int8_t *seq,
-	const int *punc, uint8_t *out, int len, int term)
+	const int *punc, uint8_t *out, int len, int term, struct vber *ber)
 {
 	int8_t depunc[dec->len * dec->n];
+	uint8_t erased[(ber && punc) ? dec->len * dec->n : 1];
 
 	if (punc) {
-		depuncture(seq, punc, depunc, dec->len * dec->n);
+		depuncture(seq, punc, depunc, dec->len * dec->n,
+			ber ? ber->erased : NULL, ber ? erased : NULL);
 		seq = depunc;
+		if (ber) {
+			ber->erased = erased;
+			ber->depunctured = 1;
+		}
 	}
 
 	/* Propagate through the trellis with interval normalization */
@@ -641,7 +836,74 @@ static int conv_decode(struct vdecoder *dec, const int8_t *seq,
 	if (term == CONV_TERM_TAIL_BITING)
 		forward_traverse(dec, seq);
 
-	return traceback(dec, out, term, len);
+	if (ber)
+		ber->seq = seq;
+
+	return traceback(dec, out, term, len, ber);
+}
+
+/* Set up the function pointers of a back-end that is supported
+ * Usage of curly braces is mandatory, because we use multi-line define.
+ */
+static void backend_init(enum osmo_conv_acc_backend b)
+{
+	forward_k5_x2 = NULL;
+
+	switch (b) {
+#if defined(HAVE_SSSE3)
+	case OSMO_CONV_ACC_BACKEND_SSE:
+		INIT_POINTERS(sse);
+		metrics_kx = osmo_conv_sse_metrics_kx;
+		break;
+#endif
+#if defined(HAVE_SSSE3) && defined(HAVE_AVX2)
+	case OSMO_CONV_ACC_BACKEND_SSE_AVX:
+		INIT_POINTERS(sse_avx);
+		metrics_kx = osmo_conv_sse_avx_metrics_kx;
+		forward_k5_x2 = osmo_conv_sse_avx_forward_k5_x2;
+		break;
+#endif
+#if defined(HAVE_AVX512BW)
+	case OSMO_CONV_ACC_BACKEND_AVX512:
+		INIT_POINTERS(avx512);
+#if defined(HAVE_SSSE3) && defined(HAVE_AVX2)
+		/* AVX-512BW implies AVX2, so use its two-block recursion
+		 * and its units for the other codes */
+		metrics_kx = osmo_conv_sse_avx_metrics_kx;
+		forward_k5_x2 = osmo_conv_sse_avx_forward_k5_x2;
+#endif
+		break;
+#endif
+	default:
+		INIT_POINTERS(gen);
+		b = OSMO_CONV_ACC_BACKEND_GEN;
+		break;
+	}
+
+	acc_backend = b;
+}
+
+/* Check whether a back-end is built in and supported by the CPU */
+static int backend_supported(enum osmo_conv_acc_backend b)
+{
+	switch (b) {
+	case OSMO_CONV_ACC_BACKEND_GEN:
+		return 1;
+#if defined(HAVE_SSSE3)
+	case OSMO_CONV_ACC_BACKEND_SSE:
+		return ssse3_supported;
+#endif
+#if defined(HAVE_SSSE3) && defined(HAVE_AVX2)
+	case OSMO_CONV_ACC_BACKEND_SSE_AVX:
+		return ssse3_supported && avx2_supported;
+#endif
+#if defined(HAVE_AVX512BW)
+	case OSMO_CONV_ACC_BACKEND_AVX512:
+		return avx512bw_supported;
+#endif
+	default:
+		return 0;
+	}
 }
 
 static void osmo_conv_init(void)
@@ -661,29 +923,404 @@ static void osmo_conv_init(void)
 	#ifdef HAVE_SSE4_1
 		sse41_supported = __builtin_cpu_supports("sse4.1");
 	#endif
+
+	#ifdef HAVE_AVX512BW
+		avx512bw_supported = __builtin_cpu_supports("avx512bw") &&
+			__builtin_cpu_supports("avx512vl");
+	#endif
 #endif
 
-/**
- * Usage of curly braces is mandatory,
- * because we use multi-line define.
+	/* Pick the widest back-end that is supported */
+	if (backend_supported(OSMO_CONV_ACC_BACKEND_AVX512))
+		backend_init(OSMO_CONV_ACC_BACKEND_AVX512);
+	else if (backend_supported(OSMO_CONV_ACC_BACKEND_SSE_AVX))
+		backend_init(OSMO_CONV_ACC_BACKEND_SSE_AVX);
+	else if (backend_supported(OSMO_CONV_ACC_BACKEND_SSE))
+		backend_init(OSMO_CONV_ACC_BACKEND_SSE);
+	else
+		backend_init(OSMO_CONV_ACC_BACKEND_GEN);
+}
+
+/*! Select the SIMD back-end of the accelerated Viterbi decoder
+ *  \param[in] backend the back-end to use from now on
+ *  \returns 0 on success; -ENOTSUP if \a backend is not built in or not
+ *	     supported by the CPU
+ *
+ *  By default, the widest back-end that the CPU supports is used. All
+ *  back-ends give the same results; selecting one is mostly useful for
+ *  testing and benchmarking. Decoder contexts that have been allocated
+ *  before, including the ones cached by \ref osmo_conv_decode_cached,
+ *  keep using the back-end they were set up with.
  */
-#if defined(HAVE_SSSE3) && defined(HAVE_AVX2)
-	if (ssse3_supported && avx2_supported) {
-		INIT_POINTERS(sse_avx);
-	} else if (ssse3_supported) {
-		INIT_POINTERS(sse);
-	} else {
-		INIT_POINTERS(gen);
+int osmo_conv_acc_set_backend(enum osmo_conv_acc_backend backend)
+{
+	if (!init_complete)
+		osmo_conv_init();
+
+	if (!backend_supported(backend))
+		return -ENOTSUP;
+
+	backend_init(backend);
+	return 0;
+}
+
+/*! Get the SIMD back-end of the accelerated Viterbi decoder
+ *  \returns the back-end that new decoders are set up with */
+enum osmo_conv_acc_backend osmo_conv_acc_get_backend(void)
+{
+	if (!init_complete)
+		osmo_conv_init();
+
+	return acc_backend;
+}
+
+/* Find the input bit of the transition from 'state' into 'next' */
+static int conv_code_bit(const struct osmo_conv_code *code,
+	unsigned state, unsigned next)
+{
+	if (code->next_state[state][0] == next)
+		return 0;
+	if (code->next_state[state][1] == next)
+		return 1;
+	return -1;
+}
+
+/* Check the trellis symmetry that the butterflies rely on
+ * The two predecessors of a state differ in the oldest bit of the register
+ * and the two successors of a state in the newest one. Inverting either
+ * bit has to invert all N outputs of the transition, which holds when all
+ * generator polynomials use both the oldest and the newest bit. Only the
+ * output of one of the four transitions of a butterfly is kept.
+ */
+static int conv_code_symmetric(const struct osmo_conv_code *code)
+{
+	unsigned ns = NUM_STATES(code->K);
+	unsigned inv = (1 << code->N) - 1;
+	unsigned s, next, out;
+	int b, b1;
+
+	for (s = 0; s < ns; s++) {
+		for (b = 0; b < 2; b++) {
+			next = code->next_state[s][b];
+			out = code->next_output[s][b];
+
+			/* Shift register in the low bits of the state */
+			if ((next >> 1) != (s & (ns / 2 - 1)))
+				return 0;
+
+			/* Other predecessor */
+			b1 = conv_code_bit(code, s ^ (ns / 2), next);
+			if (b1 < 0 || code->next_output[s ^ (ns / 2)][b1] != (out ^ inv))
+				return 0;
+
+			/* Other successor */
+			b1 = conv_code_bit(code, s, next ^ 0x01);
+			if (b1 < 0 || code->next_output[s][b1] != (out ^ inv))
+				return 0;
+		}
 	}
-#elif defined(HAVE_SSSE3)
-	if (ssse3_supported) {
-		INIT_POINTERS(sse);
-	} else {
-		INIT_POINTERS(gen);
+
+	return 1;
+}
+
+/* Results of conv_code_symmetric(), which walks all states of the code.
+ * Keyed by the code and its (constant) state tables, so that a code
+ * object re-used for another code is checked again. */
+#define SUPPORTED_CACHE_SIZE	32
+
+static __thread struct {
+	const struct osmo_conv_code *code;
+	const uint8_t (*next_output)[2];
+	const uint8_t (*next_state)[2];
+	int K, N;
+	int symmetric;
+} supported_cache[SUPPORTED_CACHE_SIZE];
+
+static int conv_code_symmetric_cached(const struct osmo_conv_code *code)
+{
+	unsigned int idx = ((uintptr_t)code / sizeof(void *)) % SUPPORTED_CACHE_SIZE;
+
+	if (supported_cache[idx].code != code ||
+	    supported_cache[idx].next_output != code->next_output ||
+	    supported_cache[idx].next_state != code->next_state ||
+	    supported_cache[idx].K != code->K ||
+	    supported_cache[idx].N != code->N) {
+		supported_cache[idx].code = code;
+		supported_cache[idx].next_output = code->next_output;
+		supported_cache[idx].next_state = code->next_state;
+		supported_cache[idx].K = code->K;
+		supported_cache[idx].N = code->N;
+		supported_cache[idx].symmetric = conv_code_symmetric(code);
 	}
-#else
-	INIT_POINTERS(gen);
-#endif
+
+	return supported_cache[idx].symmetric;
+}
+
+/* Check whether a code can be handled by the accelerated decoder */
+static int conv_code_supported(const struct osmo_conv_code *code)
+{
+	if ((code->N < MIN_N) || (code->N > MAX_N) || (code->len < 1))
+		return 0;
+	if ((code->K < MIN_K) || (code->K > MAX_K))
+		return 0;
+
+	return conv_code_symmetric_cached(code);
+}
+
+/* Check whether osmo_conv_decode_acc() handles a code */
+__attribute__ ((visibility("hidden")))
+int osmo_conv_acc_code_supported(const struct osmo_conv_code *code)
+{
+	return conv_code_supported(code);
+}
+
+/* Convolutional decode of two blocks at once
+ * Both decoder objects are set up for the same K=5 code. The forward
+ * recursion of both blocks runs interleaved in the lanes of one set of
+ * SIMD registers, the traceback is done per block.
+ */
+static int conv_decode_x2(struct vdecoder *dec0, struct vdecoder *dec1,
+	const int8_t *seq0, const int8_t *seq1, const int *punc,
+	uint8_t *out0, uint8_t *out1, int len, int term, int *rc1,
+	struct vber *ber0, struct vber *ber1)
+{
+	int8_t depunc0[dec0->len * dec0->n];
+	int8_t depunc1[dec1->len * dec1->n];
+	uint8_t erased0[(ber0 && punc) ? dec0->len * dec0->n : 1];
+	uint8_t erased1[(ber1 && punc) ? dec1->len * dec1->n : 1];
+	int pass;
+
+	if (punc) {
+		depuncture(seq0, punc, depunc0, dec0->len * dec0->n,
+			NULL, ber0 ? erased0 : NULL);
+		depuncture(seq1, punc, depunc1, dec1->len * dec1->n,
+			NULL, ber1 ? erased1 : NULL);
+		seq0 = depunc0;
+		seq1 = depunc1;
+		if (ber0) {
+			ber0->erased = erased0;
+			ber0->depunctured = 1;
+		}
+		if (ber1) {
+			ber1->erased = erased1;
+			ber1->depunctured = 1;
+		}
+	}
+
+	for (pass = 0; pass < (term == CONV_TERM_TAIL_BITING ? 2 : 1); pass++) {
+		dec0->forward_k5_x2(dec0->n, dec0->len, dec0->intrvl, seq0, seq1,
+			dec0->trellis.outputs, dec0->trellis.sums,
+			dec1->trellis.sums, dec0->paths, dec1->paths);
+	}
+
+	if (ber0)
+		ber0->seq = seq0;
+	if (ber1)
+		ber1->seq = seq1;
+
+	*rc1 = traceback(dec1, out1, term, len, ber1);
+	return traceback(dec0, out0, term, len, ber0);
+}
+
+/*! Opaque decoder context, see \ref osmo_conv_acc_decoder_alloc */
+struct osmo_conv_acc_decoder {
+	struct vdecoder vdec;
+	/* second set of path metrics and decisions for batched decoding */
+	struct vdecoder *vdec_x2;
+};
+
+/*! Allocate an accelerated Viterbi decoder context for a given code
+ *  \param[in] code Description of the convolutional code, which must
+ *		    outlive the decoder context
+ *  \returns decoder context; NULL if the code is not supported or on error
+ *
+ *  The trellis tables and path memory are set up once, so that decoding
+ *  many blocks with \ref osmo_conv_acc_decode only runs the Viterbi
+ *  recursion itself.
+ *
+ *  Codes of rate 1/2 to 1/8 with constraint lengths 3 to 9 are supported,
+ *  provided that every generator polynomial uses both the newest and the
+ *  oldest bit of the shift register. K=5 and K=7 codes up to rate 1/4 have
+ *  dedicated SIMD units, K=6, 8 and 9 ones share a templated SSE/AVX2 unit
+ *  and all others use the generic C units.
+ */
+struct osmo_conv_acc_decoder *
+osmo_conv_acc_decoder_alloc(const struct osmo_conv_code *code)
+{
+	struct osmo_conv_acc_decoder *dec;
+
+	if (!init_complete)
+		osmo_conv_init();
+
+	if (!conv_code_supported(code))
+		return NULL;
+
+	dec = calloc(1, sizeof(*dec));
+	if (!dec)
+		return NULL;
+
+	if (vdec_init(&dec->vdec, code)) {
+		free(dec);
+		return NULL;
+	}
+
+	return dec;
+}
+
+/*! Release a decoder context allocated by \ref osmo_conv_acc_decoder_alloc
+ *  \param[in] dec Decoder context to release, may be NULL */
+void osmo_conv_acc_decoder_free(struct osmo_conv_acc_decoder *dec)
+{
+	if (!dec)
+		return;
+
+	vdec_deinit(&dec->vdec);
+	if (dec->vdec_x2) {
+		vdec_deinit(dec->vdec_x2);
+		free(dec->vdec_x2);
+	}
+	free(dec);
+}
+
+/*! Decode one block with a decoder context
+ *  \param[in] dec Decoder context
+ *  \param[in] input Soft-bits of the (punctured) coded block
+ *  \param[out] output Decoded bits, code->len of them
+ *  \returns 0 on success; negative on error
+ */
+int osmo_conv_acc_decode(struct osmo_conv_acc_decoder *dec,
+	const sbit_t *input, ubit_t *output)
+{
+	const struct osmo_conv_code *code = dec->vdec.code;
+
+	reset_trellis(&dec->vdec);
+
+	return conv_decode(&dec->vdec, input, code->puncture,
+		output, code->len, code->term, NULL);
+}
+
+/*! Decode one block with a decoder context and count the bit errors
+ *  \param[in] dec Decoder context
+ *  \param[in] input Soft-bits of the (punctured) coded block
+ *  \param[out] output Decoded bits, code->len of them
+ *  \param[in] erased Coded bits to leave out of the error count and the
+ *		      metric, one flag per soft-bit of \a input. Can be NULL.
+ *  \param[out] n_errors Number of coded bits whose hard decision differs
+ *			 from the decoded path. Can be NULL.
+ *  \param[out] n_bits_total Number of coded bits. Can be NULL.
+ *  \param[out] metric Correlation of the soft-bits with the decoded path,
+ *		       up to 127 per coded bit that is not erased. Can be
+ *		       NULL.
+ *  \returns 0 on success; negative on error
+ *
+ *  The statistics are gathered during the traceback from the trellis, so
+ *  the decoded block doesn't need to be encoded again. A soft-bit of 0
+ *  counts as error unless it is flagged in \a erased.
+ */
+int osmo_conv_acc_decode_ber(struct osmo_conv_acc_decoder *dec,
+	const sbit_t *input, ubit_t *output, const uint8_t *erased,
+	int *n_errors, int *n_bits_total, int *metric)
+{
+	const struct osmo_conv_code *code = dec->vdec.code;
+	struct vber ber = { .erased = erased };
+	int rc;
+
+	reset_trellis(&dec->vdec);
+
+	rc = conv_decode(&dec->vdec, input, code->puncture,
+		output, code->len, code->term, &ber);
+
+	if (n_errors)
+		*n_errors = ber.n_errors;
+	if (n_bits_total)
+		*n_bits_total = ber.n_bits;
+	if (metric)
+		*metric = ber.metric;
+
+	return rc;
+}
+
+/*! Decode a batch of blocks of the same code with a decoder context
+ *  \param[in] dec Decoder context
+ *  \param[in] n Number of blocks
+ *  \param[in] input Soft-bits of each of the (punctured) coded blocks
+ *  \param[out] output Decoded bits of each block, code->len of them
+ *  \param[out] rc Result of each block, like \ref osmo_conv_acc_decode.
+ *		    Can be NULL.
+ *  \param[out] n_errors Number of bit errors per block, see
+ *			 \ref osmo_conv_acc_decode_ber. Can be NULL.
+ *  \param[out] n_bits_total Number of coded bits per block. Can be NULL.
+ *  \returns 0 if all blocks were decoded; negative on error
+ *
+ *  Where the CPU allows it, two K=5 blocks are decoded at a time in the
+ *  two lanes of the AVX2 registers, otherwise the blocks are decoded one
+ *  after another. The results are the same either way.
+ */
+int osmo_conv_acc_decode_batch(struct osmo_conv_acc_decoder *dec,
+	unsigned int n, const sbit_t * const *input, ubit_t * const *output,
+	int *rc, int *n_errors, int *n_bits_total)
+{
+	const struct osmo_conv_code *code = dec->vdec.code;
+	struct vber ber[2], *ber0 = NULL, *ber1 = NULL;
+	unsigned int i = 0;
+	int rc0, rc1, res = 0;
+
+	if (n_errors || n_bits_total) {
+		ber0 = &ber[0];
+		ber1 = &ber[1];
+	}
+
+	/* the second decoder is only needed for two-block decoding */
+	if (dec->vdec.forward_k5_x2 && code->K == 5 && code->N <= 4 &&
+	    n > 1 && !dec->vdec_x2) {
+		dec->vdec_x2 = calloc(1, sizeof(*dec->vdec_x2));
+		if (dec->vdec_x2 && vdec_init(dec->vdec_x2, code)) {
+			free(dec->vdec_x2);
+			dec->vdec_x2 = NULL;
+		}
+	}
+
+	if (dec->vdec_x2 && dec->vdec_x2->forward_k5_x2 ==
+	    dec->vdec.forward_k5_x2) {
+		for (; i + 1 < n; i += 2) {
+			reset_trellis(&dec->vdec);
+			reset_trellis(dec->vdec_x2);
+			memset(ber, 0, sizeof(ber));
+			rc0 = conv_decode_x2(&dec->vdec, dec->vdec_x2,
+				input[i], input[i + 1], code->puncture,
+				output[i], output[i + 1], code->len,
+				code->term, &rc1, ber0, ber1);
+			if (rc) {
+				rc[i] = rc0;
+				rc[i + 1] = rc1;
+			}
+			if (n_errors) {
+				n_errors[i] = ber[0].n_errors;
+				n_errors[i + 1] = ber[1].n_errors;
+			}
+			if (n_bits_total) {
+				n_bits_total[i] = ber[0].n_bits;
+				n_bits_total[i + 1] = ber[1].n_bits;
+			}
+			if (rc0 < 0 || rc1 < 0)
+				res = rc0 < 0 ? rc0 : rc1;
+		}
+	}
+
+	for (; i < n; i++) {
+		if (!ber0)
+			rc0 = osmo_conv_acc_decode(dec, input[i], output[i]);
+		else
+			rc0 = osmo_conv_acc_decode_ber(dec, input[i], output[i],
+				NULL, n_errors ? &n_errors[i] : NULL,
+				n_bits_total ? &n_bits_total[i] : NULL, NULL);
+		if (rc)
+			rc[i] = rc0;
+		if (rc0 < 0)
+			res = rc0;
+	}
+
+	return res;
 }
 
 /* All-in-one Viterbi decoding  */
@@ -696,8 +1333,7 @@ int osmo_conv_decode_acc(const struct osmo_conv_code *code,
 	if (!init_complete)
 		osmo_conv_init();
 
-	if ((code->N < 2) || (code->N > 4) || (code->len < 1) ||
-		((code->K != 5) && (code->K != 7)))
+	if (!conv_code_supported(code))
 		return -EINVAL;
 
 	rc = vdec_init(&dec, code);
@@ -705,7 +1341,7 @@ int osmo_conv_decode_acc(const struct osmo_conv_code *code,
 		return rc;
 
 	rc = conv_decode(&dec, input, code->puncture,
-		output, code->len, code->term);
+		output, code->len, code->term, NULL);
 
 	vdec_deinit(&dec);
 
@@ -0,0 +1,317 @@
+/*! \file conv_acc_avx512.c
+ * Accelerated Viterbi decoder implementation
+ * for architectures with AVX-512BW and AVX-512VL support. */
+/*
+ * (C) 2018 by sysmocom - s.f.m.c. GmbH
+ *
+ * All Rights Reserved
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdint.h>
+#include "config.h"
+
+#include <immintrin.h>
+
+#ifndef __always_inline
+#define __always_inline         inline __attribute__((always_inline))
+#endif
+
+#define AVX512_ALIGN 64
+
+/* Even and odd state indices of the 64-state trellis for vpermt2w */
+static const int16_t _k7_even[32] __attribute__ ((aligned(AVX512_ALIGN))) = {
+	 0,  2,  4,  6,  8, 10, 12, 14, 16, 18, 20, 22, 24, 26, 28, 30,
+	32, 34, 36, 38, 40, 42, 44, 46, 48, 50, 52, 54, 56, 58, 60, 62,
+};
+
+static const int16_t _k7_odd[32] __attribute__ ((aligned(AVX512_ALIGN))) = {
+	 1,  3,  5,  7,  9, 11, 13, 15, 17, 19, 21, 23, 25, 27, 29, 31,
+	33, 35, 37, 39, 41, 43, 45, 47, 49, 51, 53, 55, 57, 59, 61, 63,
+};
+
+/* Even and odd state indices of the 16-state trellis for vpermw, repeated
+ * in both 128-bit lanes */
+static const int16_t _k5_even[16] __attribute__ ((aligned(32))) = {
+	0, 2, 4, 6, 8, 10, 12, 14, 0, 2, 4, 6, 8, 10, 12, 14,
+};
+
+static const int16_t _k5_odd[16] __attribute__ ((aligned(32))) = {
+	1, 3, 5, 7, 9, 11, 13, 15, 1, 3, 5, 7, 9, 11, 13, 15,
+};
+
+/* Expand soft input
+ * Pack N 8-bit soft input values as 16-bit integers, repeated to fill a
+ * 32-bit (N = 2) or 64-bit (N = 3 and N = 4) element. Missing values are
+ * set to zero.
+ */
+#define AVX512_VAL_N2(val) \
+	((uint16_t) (val)[0] | ((uint32_t) (uint16_t) (val)[1] << 16))
+
+#define AVX512_VAL_N4(val, n) \
+	((uint64_t) AVX512_VAL_N2(val) | \
+	 ((uint64_t) (uint16_t) (val)[2] << 32) | \
+	 ((uint64_t) (uint16_t) ((n) > 3 ? (val)[3] : 0) << 48))
+
+/* Branch metrics N = 2
+ * Multiply-add the 16-bit trellis outputs with the input pairs. The sums
+ * of two products can't overflow, so they are exact and the 32-bit results
+ * are narrowed without saturation.
+ *
+ * Input:
+ * M0 - 16 x 2 packed 16-bit trellis outputs
+ * V  - Broadcasted 32-bit input pair
+ *
+ * Returns 16 branch metrics
+ */
+__always_inline static __m256i _avx512_branch_metrics_n2(__m512i m0, __m512i v)
+{
+	return _mm512_cvtepi32_epi16(_mm512_madd_epi16(m0, v));
+}
+
+/* Branch metrics N = 3 and N = 4
+ * Multiply-add as above, then add the two 32-bit sums of each 64-bit
+ * element in its low half.
+ *
+ * Input:
+ * M0 - 8 x 4 packed 16-bit trellis outputs
+ * V  - Broadcasted 64-bit input quad
+ *
+ * Returns 8 branch metrics
+ */
+__always_inline static __m128i _avx512_branch_metrics_n4(__m512i m0, __m512i v)
+{
+	m0 = _mm512_madd_epi16(m0, v);
+	m0 = _mm512_add_epi32(m0, _mm512_srli_epi64(m0, 32));
+
+	return _mm512_cvtepi64_epi16(m0);
+}
+
+/* Horizontal minimum
+ * Compute the signed minimum of 16 packed 16-bit integers, like the generic
+ * implementation, and broadcast it to all elements.
+ */
+__always_inline static __m256i _avx512_hmin_epi16(__m256i m0)
+{
+	__m256i m1;
+
+	m1 = _mm256_permute4x64_epi64(m0, _MM_SHUFFLE(1, 0, 3, 2));
+	m0 = _mm256_min_epi16(m0, m1);
+	m1 = _mm256_shuffle_epi32(m0, _MM_SHUFFLE(1, 0, 3, 2));
+	m0 = _mm256_min_epi16(m0, m1);
+	m1 = _mm256_shuffle_epi32(m0, _MM_SHUFFLE(2, 3, 0, 1));
+	m0 = _mm256_min_epi16(m0, m1);
+	m1 = _mm256_shufflelo_epi16(m0, _MM_SHUFFLE(2, 3, 0, 1));
+	m0 = _mm256_min_epi16(m0, m1);
+
+	return _mm256_broadcastw_epi16(_mm256_castsi256_si128(m0));
+}
+
+/* Path metrics K = 5
+ * All 16 states fit into one 256-bit register. The even and odd
+ * predecessors are gathered with vpermw into both 128-bit lanes, and the
+ * branch metric is added in the low lane and subtracted in the high lane
+ * with a masked operation. Accumulated sums and path decisions come out in
+ * state order, so no interleaving is needed to store them.
+ *
+ * Input:
+ * M - 8 branch metrics, repeated in both 128-bit lanes
+ */
+__always_inline static void _avx512_path_metrics_k5(__m256i m,
+	int16_t *sums, int16_t *paths, int norm)
+{
+	__m256i s, e, o, x, y;
+
+	s = _mm256_loadu_si256((__m256i *) sums);
+	e = _mm256_permutexvar_epi16(_mm256_load_si256((__m256i *) _k5_even), s);
+	o = _mm256_permutexvar_epi16(_mm256_load_si256((__m256i *) _k5_odd), s);
+
+	x = _mm256_mask_subs_epi16(_mm256_adds_epi16(e, m), 0xff00, e, m);
+	y = _mm256_mask_adds_epi16(_mm256_subs_epi16(o, m), 0xff00, o, m);
+
+	s = _mm256_max_epi16(x, y);
+	_mm256_storeu_si256((__m256i *) paths,
+		_mm256_movm_epi16(_mm256_cmpge_epi16_mask(x, y)));
+
+	if (norm)
+		s = _mm256_subs_epi16(s, _avx512_hmin_epi16(s));
+
+	_mm256_storeu_si256((__m256i *) sums, s);
+}
+
+/* Path metrics K = 7
+ * The 64 states take two 512-bit registers. The 32 even and odd
+ * predecessors are gathered with vpermt2w, followed by 32 butterflies.
+ *
+ * Input:
+ * M - 32 branch metrics
+ */
+__always_inline static void _avx512_path_metrics_k7(__m512i m,
+	int16_t *sums, int16_t *paths, int norm)
+{
+	__m512i s0, s1, e, o, x0, y0, x1, y1;
+	__m256i min;
+
+	s0 = _mm512_loadu_si512((__m512i *) &sums[0]);
+	s1 = _mm512_loadu_si512((__m512i *) &sums[32]);
+	e = _mm512_permutex2var_epi16(s0,
+		_mm512_load_si512((__m512i *) _k7_even), s1);
+	o = _mm512_permutex2var_epi16(s0,
+		_mm512_load_si512((__m512i *) _k7_odd), s1);
+
+	x0 = _mm512_adds_epi16(e, m);
+	y0 = _mm512_subs_epi16(o, m);
+	x1 = _mm512_subs_epi16(e, m);
+	y1 = _mm512_adds_epi16(o, m);
+
+	s0 = _mm512_max_epi16(x0, y0);
+	s1 = _mm512_max_epi16(x1, y1);
+	_mm512_storeu_si512((__m512i *) &paths[0],
+		_mm512_movm_epi16(_mm512_cmpge_epi16_mask(x0, y0)));
+	_mm512_storeu_si512((__m512i *) &paths[32],
+		_mm512_movm_epi16(_mm512_cmpge_epi16_mask(x1, y1)));
+
+	if (norm) {
+		x0 = _mm512_min_epi16(s0, s1);
+		min = _mm256_min_epi16(_mm512_castsi512_si256(x0),
+			_mm512_extracti64x4_epi64(x0, 1));
+		min = _avx512_hmin_epi16(min);
+		x0 = _mm512_broadcastw_epi16(_mm256_castsi256_si128(min));
+		s0 = _mm512_subs_epi16(s0, x0);
+		s1 = _mm512_subs_epi16(s1, x0);
+	}
+
+	_mm512_storeu_si512((__m512i *) &sums[0], s0);
+	_mm512_storeu_si512((__m512i *) &sums[32], s1);
+}
+
+/* Aligned Memory Allocator
+ * Align to the 64-byte size of the AVX-512 registers. We store relevant
+ * trellis values (accumulated sums, outputs, and path decisions) as 16 bit
+ * signed integers so the allocated memory is casted as such.
+ */
+__attribute__ ((visibility("hidden")))
+int16_t *osmo_conv_avx512_vdec_malloc(size_t n)
+{
+	return (int16_t *) _mm_malloc(sizeof(int16_t) * n, AVX512_ALIGN);
+}
+
+__attribute__ ((visibility("hidden")))
+void osmo_conv_avx512_vdec_free(int16_t *ptr)
+{
+	_mm_free(ptr);
+}
+
+__attribute__ ((visibility("hidden")))
+void osmo_conv_avx512_metrics_k5_n2(const int8_t *val,
+	const int16_t *out, int16_t *sums, int16_t *paths, int norm)
+{
+	__m256i v;
+	__m128i m;
+
+	/* 8 branch metrics from 8 x 2 outputs, as in _avx512_branch_metrics_n2() */
+	v = _mm256_set1_epi32(AVX512_VAL_N2(val));
+	m = _mm256_cvtepi32_epi16(_mm256_madd_epi16(
+		_mm256_loadu_si256((__m256i *) out), v));
+
+	_avx512_path_metrics_k5(_mm256_broadcastsi128_si256(m),
+		sums, paths, norm);
+}
+
+__attribute__ ((visibility("hidden")))
+void osmo_conv_avx512_metrics_k5_n3(const int8_t *val,
+	const int16_t *out, int16_t *sums, int16_t *paths, int norm)
+{
+	__m512i v;
+	__m128i m;
+
+	v = _mm512_set1_epi64(AVX512_VAL_N4(val, 3));
+	m = _avx512_branch_metrics_n4(_mm512_loadu_si512((__m512i *) out), v);
+
+	_avx512_path_metrics_k5(_mm256_broadcastsi128_si256(m),
+		sums, paths, norm);
+}
+
+__attribute__ ((visibility("hidden")))
+void osmo_conv_avx512_metrics_k5_n4(const int8_t *val,
+	const int16_t *out, int16_t *sums, int16_t *paths, int norm)
+{
+	__m512i v;
+	__m128i m;
+
+	v = _mm512_set1_epi64(AVX512_VAL_N4(val, 4));
+	m = _avx512_branch_metrics_n4(_mm512_loadu_si512((__m512i *) out), v);
+
+	_avx512_path_metrics_k5(_mm256_broadcastsi128_si256(m),
+		sums, paths, norm);
+}
+
+__attribute__ ((visibility("hidden")))
+void osmo_conv_avx512_metrics_k7_n2(const int8_t *val,
+	const int16_t *out, int16_t *sums, int16_t *paths, int norm)
+{
+	__m512i v, m;
+
+	v = _mm512_set1_epi32(AVX512_VAL_N2(val));
+	m = _mm512_castsi256_si512(_avx512_branch_metrics_n2(
+		_mm512_loadu_si512((__m512i *) &out[0]), v));
+	m = _mm512_inserti64x4(m, _avx512_branch_metrics_n2(
+		_mm512_loadu_si512((__m512i *) &out[32]), v), 1);
+
+	_avx512_path_metrics_k7(m, sums, paths, norm);
+}
+
+/* Branch metrics K = 7, N = 3 and N = 4
+ * 32 branch metrics from 128 trellis outputs in four 512-bit registers.
+ */
+__always_inline static __m512i _avx512_branch_metrics_k7_n4(
+	const int16_t *out, __m512i v)
+{
+	__m512i m;
+
+	m = _mm512_castsi128_si512(_avx512_branch_metrics_n4(
+		_mm512_loadu_si512((__m512i *) &out[0]), v));
+	m = _mm512_inserti32x4(m, _avx512_branch_metrics_n4(
+		_mm512_loadu_si512((__m512i *) &out[32]), v), 1);
+	m = _mm512_inserti32x4(m, _avx512_branch_metrics_n4(
+		_mm512_loadu_si512((__m512i *) &out[64]), v), 2);
+	m = _mm512_inserti32x4(m, _avx512_branch_metrics_n4(
+		_mm512_loadu_si512((__m512i *) &out[96]), v), 3);
+
+	return m;
+}
+
+__attribute__ ((visibility("hidden")))
+void osmo_conv_avx512_metrics_k7_n3(const int8_t *val,
+	const int16_t *out, int16_t *sums, int16_t *paths, int norm)
+{
+	__m512i v = _mm512_set1_epi64(AVX512_VAL_N4(val, 3));
+
+	_avx512_path_metrics_k7(_avx512_branch_metrics_k7_n4(out, v),
+		sums, paths, norm);
+}
+
+__attribute__ ((visibility("hidden")))
+void osmo_conv_avx512_metrics_k7_n4(const int8_t *val,
+	const int16_t *out, int16_t *sums, int16_t *paths, int norm)
+{
+	__m512i v = _mm512_set1_epi64(AVX512_VAL_N4(val, 4));
+
+	_avx512_path_metrics_k7(_avx512_branch_metrics_k7_n4(out, v),
+		sums, paths, norm);
+}
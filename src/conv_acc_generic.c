@@ -104,6 +104,24 @@ static void gen_branch_metrics_n4(int num_states, const int8_t *seq,
 	}
 }
 
+/* Branch metrics unit for any N
+ * The outputs of N = 3 are padded to 4, like the ones of the N = 4 codes.
+ * With N as a constant, the compiler unrolls the inner loop.
+ */
+static inline void gen_branch_metrics_nx(int n, int num_states,
+	const int8_t *seq, const int16_t *out, int16_t *metrics)
+{
+	int i, j, olen = (n == 3) ? 4 : n;
+	int16_t m;
+
+	for (i = 0; i < num_states / 2; i++) {
+		m = 0;
+		for (j = 0; j < n; j++)
+			m += seq[j] * out[olen * i + j];
+		metrics[i] = m;
+	}
+}
+
 /* Path metric unit */
 static void gen_path_metrics(int num_states, int16_t *sums,
 	int16_t *metrics, int16_t *paths, int norm)
@@ -208,3 +226,64 @@ void osmo_conv_gen_metrics_k7_n4(const int8_t *seq, const int16_t *out,
 	gen_branch_metrics_n4(64, seq, out, metrics);
 	gen_path_metrics(64, sums, metrics, paths, norm);
 }
+
+/* Branch-path metrics units of the other codes (K=3 to K=9, N=2 to N=8)
+ * Generated from one template for each combination, so that the number
+ * of states and outputs are constants.
+ */
+#define GEN_METRICS(K, N) \
+static void gen_metrics_k##K##_n##N(const int8_t *seq, const int16_t *out, \
+	int16_t *sums, int16_t *paths, int norm) \
+{ \
+	int16_t metrics[1 << (K - 2)]; \
+\
+	gen_branch_metrics_nx(N, 1 << (K - 1), seq, out, metrics); \
+	gen_path_metrics(1 << (K - 1), sums, metrics, paths, norm); \
+}
+
+#define GEN_METRICS_N5_TO_N8(K) \
+	GEN_METRICS(K, 5) GEN_METRICS(K, 6) GEN_METRICS(K, 7) GEN_METRICS(K, 8)
+
+#define GEN_METRICS_N2_TO_N8(K) \
+	GEN_METRICS(K, 2) GEN_METRICS(K, 3) GEN_METRICS(K, 4) \
+	GEN_METRICS_N5_TO_N8(K)
+
+GEN_METRICS_N2_TO_N8(3)
+GEN_METRICS_N2_TO_N8(4)
+GEN_METRICS_N5_TO_N8(5)
+GEN_METRICS_N2_TO_N8(6)
+GEN_METRICS_N5_TO_N8(7)
+GEN_METRICS_N2_TO_N8(8)
+GEN_METRICS_N2_TO_N8(9)
+
+#define GEN_METRICS_ROW(K) \
+	{ gen_metrics_k##K##_n2, gen_metrics_k##K##_n3, gen_metrics_k##K##_n4, \
+	  gen_metrics_k##K##_n5, gen_metrics_k##K##_n6, gen_metrics_k##K##_n7, \
+	  gen_metrics_k##K##_n8 }
+
+typedef void (*metric_func)(const int8_t *seq, const int16_t *out,
+	int16_t *sums, int16_t *paths, int norm);
+
+static const metric_func gen_metrics[7][7] = {
+	GEN_METRICS_ROW(3),
+	GEN_METRICS_ROW(4),
+	{ osmo_conv_gen_metrics_k5_n2, osmo_conv_gen_metrics_k5_n3,
+	  osmo_conv_gen_metrics_k5_n4, gen_metrics_k5_n5, gen_metrics_k5_n6,
+	  gen_metrics_k5_n7, gen_metrics_k5_n8 },
+	GEN_METRICS_ROW(6),
+	{ osmo_conv_gen_metrics_k7_n2, osmo_conv_gen_metrics_k7_n3,
+	  osmo_conv_gen_metrics_k7_n4, gen_metrics_k7_n5, gen_metrics_k7_n6,
+	  gen_metrics_k7_n7, gen_metrics_k7_n8 },
+	GEN_METRICS_ROW(8),
+	GEN_METRICS_ROW(9),
+};
+
+/* Metric function for any K=3 to K=9 and N=2 to N=8 */
+__attribute__ ((visibility("hidden")))
+metric_func osmo_conv_gen_metrics_kx(int k, int n)
+{
+	if (k < 3 || k > 9 || n < 2 || n > 8)
+		return NULL;
+
+	return gen_metrics[k - 3][n - 2];
+}
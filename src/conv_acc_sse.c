@@ -130,3 +130,10 @@ void osmo_conv_sse_metrics_k7_n4(const int8_t *val, const int16_t *out,
 
 	_sse_metrics_k7_n4(_val, out, sums, paths, norm);
 }
+
+/* Metric function of the other codes, NULL if there is none */
+__attribute__ ((visibility("hidden")))
+_sse_metric_func osmo_conv_sse_metrics_kx(int k, int n)
+{
+	return _sse_metrics_kx_func(k, n);
+}
@@ -130,3 +130,120 @@ void osmo_conv_sse_avx_metrics_k7_n4(const int8_t *val,
 
 	_sse_metrics_k7_n4(_val, out, sums, paths, norm);
 }
+
+/* Two-block forward recursion (K=5)
+ * The 16 states of a K=5 trellis fill two 128-bit lanes, so the low lane
+ * of each 256-bit register carries block 0 and the high lane carries block
+ * 1. All shuffles, horizontal adds and compares used by the butterflies
+ * operate within a lane, hence both blocks are decoded bit-exact to
+ * _sse_metrics_k5_n2() and _sse_metrics_k5_n4(). Accumulated sums are kept
+ * in registers for the whole block; path decisions are stored per block.
+ */
+#define AVX_INSERT_LANES(LO, HI) \
+	_mm256_inserti128_si256(_mm256_castsi128_si256(LO), HI, 1)
+
+__attribute__ ((visibility("hidden")))
+void osmo_conv_sse_avx_forward_k5_x2(int n, int len, int intrvl,
+	const int8_t *seq0, const int8_t *seq1, const int16_t *out,
+	int16_t *sums0, int16_t *sums1, int16_t **paths0, int16_t **paths1)
+{
+	__m256i m0, m1, m2, m3, m4, m5, m6;
+	__m256i s0, s1, t0, t1, t2, t3, mask;
+	const int8_t *v0, *v1;
+	int i;
+
+	mask = _mm256_broadcastsi128_si256(_mm_set_epi8(_I8_SHUFFLE_MASK));
+
+	/* (BMU) Trellis outputs are the same for both blocks */
+	t0 = _mm256_broadcastsi128_si256(_mm_load_si128((__m128i *) &out[0]));
+	t1 = _mm256_broadcastsi128_si256(_mm_load_si128((__m128i *) &out[8]));
+	if (n > 2) {
+		t2 = _mm256_broadcastsi128_si256(_mm_load_si128((__m128i *) &out[16]));
+		t3 = _mm256_broadcastsi128_si256(_mm_load_si128((__m128i *) &out[24]));
+	} else {
+		t2 = t3 = _mm256_setzero_si256();
+	}
+
+	/* (PMU) Load accumulated path metrics */
+	s0 = AVX_INSERT_LANES(_mm_load_si128((__m128i *) &sums0[0]),
+			      _mm_load_si128((__m128i *) &sums1[0]));
+	s1 = AVX_INSERT_LANES(_mm_load_si128((__m128i *) &sums0[8]),
+			      _mm_load_si128((__m128i *) &sums1[8]));
+
+	for (i = 0; i < len; i++) {
+		v0 = &seq0[n * i];
+		v1 = &seq1[n * i];
+
+		/* (BMU) Compute branch metrics */
+		if (n == 2) {
+			m2 = AVX_INSERT_LANES(
+				_mm_set1_epi32((uint16_t) v0[0] | ((uint32_t) (uint16_t) v0[1] << 16)),
+				_mm_set1_epi32((uint16_t) v1[0] | ((uint32_t) (uint16_t) v1[1] << 16)));
+			m0 = _mm256_sign_epi16(m2, t0);
+			m1 = _mm256_sign_epi16(m2, t1);
+			m2 = _mm256_hadds_epi16(m0, m1);
+		} else {
+			m4 = AVX_INSERT_LANES(
+				_mm_set_epi16(n > 3 ? v0[3] : 0, v0[2], v0[1], v0[0],
+					      n > 3 ? v0[3] : 0, v0[2], v0[1], v0[0]),
+				_mm_set_epi16(n > 3 ? v1[3] : 0, v1[2], v1[1], v1[0],
+					      n > 3 ? v1[3] : 0, v1[2], v1[1], v1[0]));
+			m0 = _mm256_sign_epi16(m4, t0);
+			m1 = _mm256_sign_epi16(m4, t1);
+			m2 = _mm256_sign_epi16(m4, t2);
+			m3 = _mm256_sign_epi16(m4, t3);
+			m0 = _mm256_hadds_epi16(m0, m1);
+			m1 = _mm256_hadds_epi16(m2, m3);
+			m2 = _mm256_hadds_epi16(m0, m1);
+		}
+
+		/* (PMU) Deinterleave to even-odd registers */
+		m0 = _mm256_shuffle_epi8(s0, mask);
+		m1 = _mm256_shuffle_epi8(s1, mask);
+		m3 = _mm256_unpacklo_epi64(m0, m1);
+		m4 = _mm256_unpackhi_epi64(m0, m1);
+
+		/* (PMU) Butterflies: 0-7 of both blocks */
+		m5 = _mm256_adds_epi16(m3, m2);
+		m6 = _mm256_subs_epi16(m4, m2);
+		m3 = _mm256_subs_epi16(m3, m2);
+		m4 = _mm256_adds_epi16(m4, m2);
+		s0 = _mm256_max_epi16(m5, m6);
+		m5 = _mm256_or_si256(_mm256_cmpgt_epi16(m5, m6), _mm256_cmpeq_epi16(m5, m6));
+		s1 = _mm256_max_epi16(m3, m4);
+		m4 = _mm256_or_si256(_mm256_cmpgt_epi16(m3, m4), _mm256_cmpeq_epi16(m3, m4));
+
+		/* Normalize by the minimum of each lane, with the same
+		 * (un)signedness as SSE_NORMALIZE_K5() */
+		if (!(i % intrvl)) {
+			m0 = _mm256_min_epi16(s0, s1);
+			m1 = _mm256_shuffle_epi32(m0, _MM_SHUFFLE(1, 0, 3, 2));
+			m0 = sse41_supported ? _mm256_min_epu16(m0, m1) : _mm256_min_epi16(m0, m1);
+			m1 = _mm256_shuffle_epi32(m0, _MM_SHUFFLE(2, 3, 0, 1));
+			m0 = sse41_supported ? _mm256_min_epu16(m0, m1) : _mm256_min_epi16(m0, m1);
+			m1 = _mm256_shufflelo_epi16(m0, _MM_SHUFFLE(2, 3, 0, 1));
+			m0 = sse41_supported ? _mm256_min_epu16(m0, m1) : _mm256_min_epi16(m0, m1);
+			m0 = _mm256_shufflelo_epi16(m0, 0);
+			m0 = _mm256_shuffle_epi32(m0, 0);
+			s0 = _mm256_subs_epi16(s0, m0);
+			s1 = _mm256_subs_epi16(s1, m0);
+		}
+
+		_mm_store_si128((__m128i *) &paths0[i][0], _mm256_castsi256_si128(m5));
+		_mm_store_si128((__m128i *) &paths0[i][8], _mm256_castsi256_si128(m4));
+		_mm_store_si128((__m128i *) &paths1[i][0], _mm256_extracti128_si256(m5, 1));
+		_mm_store_si128((__m128i *) &paths1[i][8], _mm256_extracti128_si256(m4, 1));
+	}
+
+	_mm_store_si128((__m128i *) &sums0[0], _mm256_castsi256_si128(s0));
+	_mm_store_si128((__m128i *) &sums0[8], _mm256_castsi256_si128(s1));
+	_mm_store_si128((__m128i *) &sums1[0], _mm256_extracti128_si256(s0, 1));
+	_mm_store_si128((__m128i *) &sums1[8], _mm256_extracti128_si256(s1, 1));
+}
+
+/* Metric function of the other codes, NULL if there is none */
+__attribute__ ((visibility("hidden")))
+_sse_metric_func osmo_conv_sse_avx_metrics_kx(int k, int n)
+{
+	return _sse_metrics_kx_func(k, n);
+}
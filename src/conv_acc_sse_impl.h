@@ -503,3 +503,108 @@ __always_inline static void _sse_metrics_k7_n4(const int16_t *val,
 	_mm_store_si128((__m128i *) &sums[48], m2);
 	_mm_store_si128((__m128i *) &sums[56], m11);
 }
+
+/* Combined BMU/PMU (K=6, K=8 and K=9, N=2 to N=4)
+ * Compute branch metrics followed by path metrics for trellis sizes without
+ * a dedicated implementation, 16 states at a time like the K=5 case. The new
+ * sums would overwrite sums of states that are yet to be read, so they are
+ * kept on the stack and normalized while copying them back. The number of
+ * states is a constant after inlining, so that the loops are unrolled.
+ */
+__always_inline static void _sse_metrics_kx(const int16_t *val, int n,
+	int ns, const int16_t *out, int16_t *sums, int16_t *paths, int norm)
+{
+	__m128i m0, m1, m2, m3, m4, m5, m6, m7, min;
+	int16_t _sums[ns] __attribute__((aligned(SSE_ALIGN)));
+	int i;
+
+	/* (BMU) Load input sequence */
+	m7 = _mm_castpd_si128(_mm_loaddup_pd((double const *) val));
+	min = _mm_set1_epi16(INT16_MAX);
+
+	/* (BMU/PMU) Butterflies: 8 per iteration, new states i and i + ns/2 */
+	for (i = 0; i < ns / 16; i++) {
+		if (n == 2) {
+			m0 = _mm_load_si128((__m128i *) &out[16 * i + 0]);
+			m1 = _mm_load_si128((__m128i *) &out[16 * i + 8]);
+			m0 = _mm_sign_epi16(m7, m0);
+			m1 = _mm_sign_epi16(m7, m1);
+			m2 = _mm_hadds_epi16(m0, m1);
+		} else {
+			m0 = _mm_load_si128((__m128i *) &out[32 * i + 0]);
+			m1 = _mm_load_si128((__m128i *) &out[32 * i + 8]);
+			m2 = _mm_load_si128((__m128i *) &out[32 * i + 16]);
+			m3 = _mm_load_si128((__m128i *) &out[32 * i + 24]);
+
+			SSE_BRANCH_METRIC_N4(m0, m1, m2, m3, m7, m2)
+		}
+
+		m0 = _mm_load_si128((__m128i *) &sums[16 * i + 0]);
+		m1 = _mm_load_si128((__m128i *) &sums[16 * i + 8]);
+
+		SSE_DEINTERLEAVE_K5(m0, m1, m3, m4)
+		SSE_BUTTERFLY(m3, m4, m2, m5, m6)
+
+		if (norm)
+			min = _mm_min_epi16(min, _mm_min_epi16(m2, m6));
+
+		_mm_store_si128((__m128i *) &_sums[8 * i], m2);
+		_mm_store_si128((__m128i *) &_sums[8 * i + ns / 2], m6);
+		_mm_store_si128((__m128i *) &paths[8 * i], m5);
+		_mm_store_si128((__m128i *) &paths[8 * i + ns / 2], m4);
+	}
+
+	if (norm) {
+		SSE_MINPOS(min, m0)
+		SSE_BROADCAST(min)
+	} else {
+		min = _mm_setzero_si128();
+	}
+
+	for (i = 0; i < ns / 8; i++) {
+		m0 = _mm_load_si128((__m128i *) &_sums[8 * i]);
+		_mm_store_si128((__m128i *) &sums[8 * i],
+				_mm_subs_epi16(m0, min));
+	}
+}
+
+/* Metric functions of the codes without a dedicated implementation,
+ * generated for each constraint length and rate. The input sequence is
+ * read four 16-bit values at a time as in the K=5 and K=7 cases.
+ */
+#define _SSE_METRICS_KX(K, N) \
+static void _sse_metrics_k##K##_n##N(const int8_t *val, const int16_t *out, \
+	int16_t *sums, int16_t *paths, int norm) \
+{ \
+	const int16_t _val[4] = { val[0], val[1], \
+		N == 2 ? val[0] : val[2], \
+		N == 2 ? val[1] : (N == 4 ? val[3] : 0) }; \
+\
+	_sse_metrics_kx(_val, N, 1 << (K - 1), out, sums, paths, norm); \
+}
+
+#define _SSE_METRICS_KX_N2_TO_N4(K) \
+	_SSE_METRICS_KX(K, 2) _SSE_METRICS_KX(K, 3) _SSE_METRICS_KX(K, 4)
+
+_SSE_METRICS_KX_N2_TO_N4(6)
+_SSE_METRICS_KX_N2_TO_N4(8)
+_SSE_METRICS_KX_N2_TO_N4(9)
+
+typedef void (*_sse_metric_func)(const int8_t *val, const int16_t *out,
+	int16_t *sums, int16_t *paths, int norm);
+
+/* Look up the metric function of a code, NULL if there is none */
+static _sse_metric_func _sse_metrics_kx_func(int k, int n)
+{
+	static const _sse_metric_func funcs[][3] = {
+		{ _sse_metrics_k6_n2, _sse_metrics_k6_n3, _sse_metrics_k6_n4 },
+		{ NULL, NULL, NULL },
+		{ _sse_metrics_k8_n2, _sse_metrics_k8_n3, _sse_metrics_k8_n4 },
+		{ _sse_metrics_k9_n2, _sse_metrics_k9_n3, _sse_metrics_k9_n4 },
+	};
+
+	if (k < 6 || k > 9 || n < 2 || n > 4)
+		return NULL;
+
+	return funcs[k - 6][n - 2];
+}
@@ -29,20 +29,133 @@
  *  \file crcXXgen.c.tpl */
 
 #include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include <osmocom/core/bits.h>
+#include <osmocom/core/endian.h>
 #include <osmocom/core/crcXXgen.h>
 
 
-/*! Compute the CRC value of a given array of hard-bits
- *  \param[in] code The CRC code description to apply
- *  \param[in] in Array of hard bits
- *  \param[in] len Length of the array of hard bits
- *  \returns The CRC value
+/* Table-driven computation
+ *
+ * The CRC register is kept aligned to the MSB of a uintXX_t, so that
+ * codes of any number of bits up to XX share the same byte-wise update.
+ * The tables only depend on the polynomial and on the number of bits, and
+ * are set up on first use of a code. Table t[k] gives the effect of a
+ * byte that is followed by k zero bytes, so that the packed-bit variant
+ * consumes sizeof(uintXX_t) bytes at a time (slice-by-N).
  */
-uintXX_t
-osmo_crcXXgen_compute_bits(const struct osmo_crcXXgen_code *code,
-                           const ubit_t *in, int len)
+#define SLICES		sizeof(uintXX_t)
+#define TABLE_CACHE_SIZE	16
+
+struct crcXX_tables {
+	int bits;
+	uintXX_t poly;
+	uintXX_t t[SLICES][256];
+};
+
+static struct crcXX_tables *table_cache[TABLE_CACHE_SIZE];
+
+static void
+crcXX_tables_init(struct crcXX_tables *tbl, int bits, uintXX_t poly)
+{
+	const uintXX_t top = (uintXX_t)1 << (XX - 1);
+	const uintXX_t poly_al = poly << (XX - bits);
+	uintXX_t reg;
+	unsigned int i, j, k;
+
+	tbl->bits = bits;
+	tbl->poly = poly;
+
+	for (i = 0; i < 256; i++) {
+		reg = (uintXX_t)i << (XX - 8);
+		for (j = 0; j < 8; j++)
+			reg = (reg & top) ? (uintXX_t)(reg << 1) ^ poly_al : (uintXX_t)(reg << 1);
+		tbl->t[0][i] = reg;
+	}
+
+	for (k = 1; k < SLICES; k++) {
+		for (i = 0; i < 256; i++) {
+			reg = tbl->t[k - 1][i];
+			tbl->t[k][i] = (uintXX_t)(reg << 8) ^ tbl->t[0][reg >> (XX - 8)];
+		}
+	}
+}
+
+/* Get the tables of a code, NULL if they can't be set up.
+ * Tables are built completely before they are published in the cache with
+ * an atomic compare-and-swap, so concurrent callers either see no entry or
+ * complete tables. */
+static const struct crcXX_tables *
+crcXX_tables_get(const struct osmo_crcXXgen_code *code)
+{
+	struct crcXX_tables *tbl, *new_tbl = NULL;
+	unsigned int i, idx;
+
+	if (code->bits < 1 || code->bits > XX)
+		return NULL;
+
+	idx = (unsigned int)((code->poly ^ (uintXX_t)code->bits) % TABLE_CACHE_SIZE);
+
+	/* open addressing with linear probing; entries are never removed */
+	for (i = 0; i < TABLE_CACHE_SIZE; i++, idx = (idx + 1) % TABLE_CACHE_SIZE) {
+		tbl = __atomic_load_n(&table_cache[idx], __ATOMIC_ACQUIRE);
+		if (!tbl) {
+			if (!new_tbl) {
+				new_tbl = malloc(sizeof(struct crcXX_tables));
+				if (!new_tbl)
+					return NULL;
+				crcXX_tables_init(new_tbl, code->bits, code->poly);
+			}
+			if (__atomic_compare_exchange_n(&table_cache[idx], &tbl, new_tbl, 0,
+							__ATOMIC_RELEASE, __ATOMIC_ACQUIRE))
+				return new_tbl;
+			/* another thread took this entry, tbl now points to it */
+		}
+		if (tbl->bits == code->bits && tbl->poly == code->poly) {
+			free(new_tbl);
+			return tbl;
+		}
+	}
+
+	/* cache is full: compute bit by bit */
+	free(new_tbl);
+	return NULL;
+}
+
+/* Feed one bit into the aligned CRC register */
+static inline uintXX_t
+crcXX_update_bit(uintXX_t reg, uintXX_t poly_al, int bit)
+{
+	reg ^= (uintXX_t)(bit & 1) << (XX - 1);
+
+	if (reg & ((uintXX_t)1 << (XX - 1)))
+		return (uintXX_t)(reg << 1) ^ poly_al;
+	else
+		return (uintXX_t)(reg << 1);
+}
+
+/* Pack 8 hard bits MSB first, with a single multiply for the gather */
+static inline uint8_t
+crcXX_pack_ubits(const ubit_t *in)
+{
+	uint64_t v;
+
+#if OSMO_IS_LITTLE_ENDIAN
+	memcpy(&v, in, sizeof(v));
+#else
+	v = osmo_load64le(in);
+#endif
+	v &= 0x0101010101010101ULL;
+
+	return (v * 0x8040201008040201ULL) >> 56;
+}
+
+/* Bit by bit computation, for codes whose tables can't be set up */
+static uintXX_t
+crcXX_compute_bits_slow(const struct osmo_crcXXgen_code *code,
+                        const ubit_t *in, int len)
 {
 	const uintXX_t poly = code->poly;
 	uintXX_t crc = code->init;
@@ -66,6 +179,90 @@ osmo_crcXXgen_compute_bits(const struct osmo_crcXXgen_code *code,
 }
 
 
+/*! Compute the CRC value of a given array of hard-bits
+ *  \param[in] code The CRC code description to apply
+ *  \param[in] in Array of hard bits
+ *  \param[in] len Length of the array of hard bits
+ *  \returns The CRC value
+ *
+ *  Hard bits are packed and processed 8 at a time with a look-up table,
+ *  which is set up on the first use of a polynomial.
+ */
+uintXX_t
+osmo_crcXXgen_compute_bits(const struct osmo_crcXXgen_code *code,
+                           const ubit_t *in, int len)
+{
+	const struct crcXX_tables *tbl = crcXX_tables_get(code);
+	const int shift = XX - code->bits;
+	uintXX_t reg, poly_al;
+	int i;
+
+	if (!tbl)
+		return crcXX_compute_bits_slow(code, in, len);
+
+	reg = code->init << shift;
+	poly_al = code->poly << shift;
+
+	for (i = 0; i + 8 <= len; i += 8) {
+		reg = (uintXX_t)(reg << 8) ^
+			tbl->t[0][(reg >> (XX - 8)) ^ crcXX_pack_ubits(&in[i])];
+	}
+
+	for (; i < len; i++)
+		reg = crcXX_update_bit(reg, poly_al, in[i]);
+
+	return (reg >> shift) ^ code->remainder;
+}
+
+
+/*! Compute the CRC value of a given array of packed bits
+ *  \param[in] code The CRC code description to apply
+ *  \param[in] in Array of packed bits, MSB first
+ *  \param[in] len Number of bits in the array
+ *  \returns The CRC value, the same as for the unpacked bits
+ */
+uintXX_t
+osmo_crcXXgen_compute_pbits(const struct osmo_crcXXgen_code *code,
+                            const pbit_t *in, int len)
+{
+	const struct crcXX_tables *tbl = crcXX_tables_get(code);
+	const int shift = XX - code->bits;
+	uintXX_t reg, poly_al, v;
+	int i, j, k;
+
+	if (!tbl) {
+		ubit_t bits[len];
+
+		osmo_pbit2ubit(bits, in, len);
+		return crcXX_compute_bits_slow(code, bits, len);
+	}
+
+	reg = code->init << shift;
+	poly_al = code->poly << shift;
+
+	/* sizeof(uintXX_t) bytes at a time */
+	for (i = 0; (i + (int)SLICES) * 8 <= len; i += SLICES) {
+		for (v = 0, k = 0; k < (int)SLICES; k++)
+			v = (uintXX_t)(v << 8) | in[i + k];
+
+		reg ^= v;
+
+		for (v = 0, k = 0; k < (int)SLICES; k++)
+			v ^= tbl->t[SLICES - 1 - k][(reg >> (XX - 8 * (k + 1))) & 0xff];
+
+		reg = v;
+	}
+
+	for (; (i + 1) * 8 <= len; i++)
+		reg = (uintXX_t)(reg << 8) ^ tbl->t[0][(reg >> (XX - 8)) ^ in[i]];
+
+	for (j = 0; i * 8 + j < len; j++)
+		reg = crcXX_update_bit(reg, poly_al, in[i] >> (7 - j));
+
+	return (reg >> shift) ^ code->remainder;
+}
+
+
 /*! Checks the CRC value of a given array of hard-bits
  *  \param[in] code The CRC code description to apply
  *  \param[in] in Array of hard bits
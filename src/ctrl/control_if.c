@@ -53,6 +53,7 @@
 
 #include <osmocom/core/msgb.h>
 #include <osmocom/core/rate_ctr.h>
+#include <osmocom/core/histogram.h>
 #include <osmocom/core/select.h>
 #include <osmocom/core/counter.h>
 #include <osmocom/core/talloc.h>
@@ -568,7 +569,7 @@ static int listen_fd_cb(struct osmo_fd *listen_bfd, unsigned int what)
 	return ret;
 }
 
-static uint64_t get_rate_ctr_value(const struct rate_ctr *ctr, int intv, const char *grp)
+static uint64_t get_rate_ctr_value(struct rate_ctr *ctr, int intv, const char *grp)
 {
 	if (intv >= RATE_CTR_INTV_NUM) {
 		LOGP(DLCTRL, LOGL_ERROR, "Unexpected interval value %d while trying to get rate counter value in %s\n",
@@ -580,11 +581,11 @@ static uint64_t get_rate_ctr_value(const struct rate_ctr *ctr, int intv, const c
 	if (intv == -1) {
 		return  ctr->current;
 	} else {
-		return ctr->intv[intv].rate;
+		return rate_ctr_get_rate(ctr, intv);
 	}
 }
 
-static int get_rate_ctr_group_idx(const struct rate_ctr_group *ctrg, int intv, struct ctrl_cmd *cmd)
+static int get_rate_ctr_group_idx(struct rate_ctr_group *ctrg, int intv, struct ctrl_cmd *cmd)
 {
 	unsigned int i;
 	for (i = 0; i < ctrg->desc->num_ctr; i++) {
@@ -620,7 +621,8 @@ static int get_rate_ctr(struct ctrl_cmd *cmd, void *data)
 	unsigned int idx;
 	char *ctr_group, *ctr_idx, *tmp, *dup, *saveptr, *interval;
 	struct rate_ctr_group *ctrg;
-	const struct rate_ctr *ctr;
+	const struct rate_ctr *found;
+	struct rate_ctr *ctr;
 
 	dup = talloc_strdup(cmd, cmd->variable);
 	if (!dup)
@@ -686,12 +688,14 @@ static int get_rate_ctr(struct ctrl_cmd *cmd, void *data)
 		return get_rate_ctr_group_idx(ctrg, intv, cmd);
 	}
 
-	ctr = rate_ctr_get_by_name(ctrg, saveptr);
-	if (!ctr) {
+	found = rate_ctr_get_by_name(ctrg, saveptr);
+	if (!found) {
 		cmd->reply = "Counter name not found.";
 		talloc_free(dup);
 		goto err;
 	}
+	/* reading the rate updates its snapshot in our (non-const) group */
+	ctr = &ctrg->ctr[found - ctrg->ctr];
 
 	talloc_free(dup);
 
@@ -776,6 +780,84 @@ static int verify_counter(struct ctrl_cmd *cmd, const char *value, void *data)
 	return 0;
 }
 
+/* histogram */
+static int get_histogram_value(const struct osmo_histogram *hist, struct ctrl_cmd *cmd)
+{
+	static const unsigned int permille[] = { 500, 900, 990, 999 };
+	uint64_t pct[ARRAY_SIZE(permille)];
+
+	osmo_histogram_percentiles(hist, permille, pct, ARRAY_SIZE(pct));
+
+	ctrl_cmd_reply_printf(cmd, "count %"PRIu64";sum %"PRIu64";min %"PRIu64
+			      ";max %"PRIu64";p50 %"PRIu64";p90 %"PRIu64
+			      ";p99 %"PRIu64";p999 %"PRIu64";",
+			      hist->count, hist->sum,
+			      hist->count ? hist->min : 0, hist->max,
+			      pct[0], pct[1], pct[2], pct[3]);
+	if (!cmd->reply) {
+		cmd->reply = "OOM";
+		return CTRL_CMD_ERROR;
+	}
+
+	return CTRL_CMD_REPLY;
+}
+
+CTRL_CMD_DEFINE(histogram, "histogram *");
+static int get_histogram(struct ctrl_cmd *cmd, void *data)
+{
+	unsigned int idx;
+	char *grp_name, *grp_idx, *tmp, *dup, *saveptr;
+	struct osmo_histogram_group *histg;
+	const struct osmo_histogram *hist;
+
+	dup = talloc_strdup(cmd, cmd->variable);
+	if (!dup) {
+		cmd->reply = "OOM";
+		return CTRL_CMD_ERROR;
+	}
+
+	/* Skip over possible prefixes (net.) */
+	tmp = strstr(dup, "histogram");
+	if (!tmp) {
+		talloc_free(dup);
+		cmd->reply = "histogram not a token in histogram command!";
+		return CTRL_CMD_ERROR;
+	}
+
+	strtok_r(tmp, ".", &saveptr);
+	grp_name = strtok_r(NULL, ".", &saveptr);
+	grp_idx = strtok_r(NULL, ".", &saveptr);
+	if (!grp_name || !grp_idx || !strlen(saveptr)) {
+		talloc_free(dup);
+		cmd->reply = "Histogram must be of group.index.name form";
+		return CTRL_CMD_ERROR;
+	}
+
+	idx = atoi(grp_idx);
+
+	histg = osmo_histogram_get_group_by_name_idx(grp_name, idx);
+	hist = osmo_histogram_get_by_name(histg, saveptr);
+	talloc_free(dup);
+	if (!hist) {
+		cmd->reply = "Histogram not found.";
+		return CTRL_CMD_ERROR;
+	}
+
+	return get_histogram_value(hist, cmd);
+}
+
+static int set_histogram(struct ctrl_cmd *cmd, void *data)
+{
+	cmd->reply = "Can't set histogram.";
+
+	return CTRL_CMD_ERROR;
+}
+
+static int verify_histogram(struct ctrl_cmd *cmd, const char *value, void *data)
+{
+	return 0;
+}
+
 struct ctrl_handle *ctrl_interface_setup(void *data, uint16_t port,
 					 ctrl_cmd_lookup lookup)
 {
@@ -806,6 +888,9 @@ static int ctrl_init(unsigned int node_count)
 	if (ret)
 		goto err_vec;
 	ret = ctrl_cmd_install(CTRL_NODE_ROOT, &cmd_counter);
+	if (ret)
+		goto err_vec;
+	ret = ctrl_cmd_install(CTRL_NODE_ROOT, &cmd_histogram);
 	if (ret)
 		goto err_vec;
 
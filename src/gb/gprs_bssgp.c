@@ -27,6 +27,7 @@
 
 #include <errno.h>
 #include <stdint.h>
+#include <stdbool.h>
 
 #include <osmocom/core/msgb.h>
 #include <osmocom/core/byteswap.h>
@@ -67,16 +68,93 @@ LLIST_HEAD(bssgp_bvc_ctxts);
 static int _bssgp_tx_dl_ud(struct bssgp_flow_control *fc, struct msgb *msg,
 			   uint32_t llc_pdu_len, void *priv);
 
+/* BVC contexts are indexed by (NSEI, BVCI) and by (RA ID, Cell ID).  As
+ * users like osmo-pcu assign these members directly, a lookup that misses in
+ * the hash table falls back to a scan of bssgp_bvc_ctxts and re-indexes the
+ * context it finds there. */
+#define BVC_HASH_BITS	8
+#define BVC_HASH_SIZE	(1 << BVC_HASH_BITS)
+
+static struct llist_head bvc_by_bvci_nsei[BVC_HASH_SIZE];
+static struct llist_head bvc_by_raid_cid[BVC_HASH_SIZE];
+
+static inline unsigned int bvc_hash(uint32_t val)
+{
+	val ^= val >> 16;
+	val ^= val >> BVC_HASH_BITS;
+	return val & (BVC_HASH_SIZE - 1);
+}
+
+static inline unsigned int bvc_hash_bvci_nsei(uint16_t bvci, uint16_t nsei)
+{
+	return bvc_hash(bvci ^ (nsei << 5));
+}
+
+static inline unsigned int bvc_hash_raid_cid(const struct gprs_ra_id *raid, uint16_t cid)
+{
+	return bvc_hash((raid->lac << 16 | cid) ^ raid->rac ^ raid->mcc ^ raid->mnc);
+}
+
+static inline bool bvc_raid_cid_equal(const struct bssgp_bvc_ctx *bctx,
+				      const struct gprs_ra_id *raid, uint16_t cid)
+{
+	return !memcmp(&bctx->ra_id, raid, sizeof(bctx->ra_id)) && bctx->cell_id == cid;
+}
+
+static __attribute__((constructor)) void on_dso_load_bvc_hash(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < BVC_HASH_SIZE; i++) {
+		INIT_LLIST_HEAD(&bvc_by_bvci_nsei[i]);
+		INIT_LLIST_HEAD(&bvc_by_raid_cid[i]);
+	}
+}
+
+/*! Update the lookup tables after changing the NSEI, BVCI, RA ID or Cell
+ *  ID of a BVC context
+ *  \param[in] bctx BVC context allocated by btsctx_alloc()
+ *
+ *  Not calling this function is not fatal, as lookups fall back to a
+ *  linear search, but it keeps the lookups fast.
+ */
+void btsctx_rehash(struct bssgp_bvc_ctx *bctx)
+{
+	llist_del(&bctx->hash_bvci_nsei);
+	llist_del(&bctx->hash_raid_cid);
+	llist_add(&bctx->hash_bvci_nsei, &bvc_by_bvci_nsei[bvc_hash_bvci_nsei(bctx->bvci, bctx->nsei)]);
+	llist_add(&bctx->hash_raid_cid, &bvc_by_raid_cid[bvc_hash_raid_cid(&bctx->ra_id, bctx->cell_id)]);
+}
+
+/* re-index a context found by a linear search, unless it was not allocated
+ * by btsctx_alloc() and thus is not part of the hash tables */
+static struct bssgp_bvc_ctx *btsctx_found_by_scan(struct bssgp_bvc_ctx *bctx)
+{
+	if (bctx->hash_bvci_nsei.next)
+		btsctx_rehash(bctx);
+	return bctx;
+}
+
+static int btsctx_destructor(struct bssgp_bvc_ctx *bctx)
+{
+	llist_del(&bctx->hash_bvci_nsei);
+	llist_del(&bctx->hash_raid_cid);
+	return 0;
+}
+
 /* Find a BTS Context based on parsed RA ID and Cell ID */
 struct bssgp_bvc_ctx *btsctx_by_raid_cid(const struct gprs_ra_id *raid, uint16_t cid)
 {
 	struct bssgp_bvc_ctx *bctx;
 
-	llist_for_each_entry(bctx, &bssgp_bvc_ctxts, list) {
-		if (!memcmp(&bctx->ra_id, raid, sizeof(bctx->ra_id)) &&
-		    bctx->cell_id == cid)
+	llist_for_each_entry(bctx, &bvc_by_raid_cid[bvc_hash_raid_cid(raid, cid)], hash_raid_cid) {
+		if (bvc_raid_cid_equal(bctx, raid, cid))
 			return bctx;
 	}
+	llist_for_each_entry(bctx, &bssgp_bvc_ctxts, list) {
+		if (bvc_raid_cid_equal(bctx, raid, cid))
+			return btsctx_found_by_scan(bctx);
+	}
 	return NULL;
 }
 
@@ -110,10 +188,14 @@ struct bssgp_bvc_ctx *btsctx_by_bvci_nsei(uint16_t bvci, uint16_t nsei)
 {
 	struct bssgp_bvc_ctx *bctx;
 
-	llist_for_each_entry(bctx, &bssgp_bvc_ctxts, list) {
+	llist_for_each_entry(bctx, &bvc_by_bvci_nsei[bvc_hash_bvci_nsei(bvci, nsei)], hash_bvci_nsei) {
 		if (bctx->nsei == nsei && bctx->bvci == bvci)
 			return bctx;
 	}
+	llist_for_each_entry(bctx, &bssgp_bvc_ctxts, list) {
+		if (bctx->nsei == nsei && bctx->bvci == bvci)
+			return btsctx_found_by_scan(bctx);
+	}
 	return NULL;
 }
 
@@ -134,9 +216,27 @@ struct bssgp_bvc_ctx *btsctx_alloc(uint16_t bvci, uint16_t nsei)
 
 	llist_add(&ctx->list, &bssgp_bvc_ctxts);
 
+	INIT_LLIST_HEAD(&ctx->hash_bvci_nsei);
+	INIT_LLIST_HEAD(&ctx->hash_raid_cid);
+	btsctx_rehash(ctx);
+	talloc_set_destructor(ctx, btsctx_destructor);
+
 	return ctx;
 }
 
+/*! Release a BTS context allocated by btsctx_alloc()
+ *  \param[in] ctx BTS context to be released
+ */
+void btsctx_free(struct bssgp_bvc_ctx *ctx)
+{
+	/* the queued PDUs and the dequeue timer must not outlive the fc */
+	if (ctx->fc)
+		bssgp_fc_flush_queue(ctx->fc);
+	llist_del(&ctx->list);
+	rate_ctr_group_free(ctx->ctrg);
+	talloc_free(ctx);
+}
+
 /* Chapter 10.4.5: Flow Control BVC ACK */
 static int bssgp_tx_fc_bvc_ack(uint16_t nsei, uint8_t tag, uint16_t ns_bvci)
 {
@@ -284,6 +384,7 @@ static int bssgp_rx_bvc_reset(struct msgb *msg, struct tlv_parsed *tp,
 		/* actually extract RAC / CID */
 		bctx->cell_id = bssgp_parse_cell_id(&bctx->ra_id,
 						TLVP_VAL(tp, BSSGP_IE_CELL_ID));
+		btsctx_rehash(bctx);
 		LOGP(DBSSGP, LOGL_NOTICE, "Cell %s CI %u on BVCI %u\n",
 		     osmo_rai_name(&bctx->ra_id), bctx->cell_id, bvci);
 	}
@@ -585,51 +686,82 @@ struct bssgp_fc_queue_element {
 };
 
 static int fc_queue_timer_cfg(struct bssgp_flow_control *fc);
-static int bssgp_fc_needs_queueing(struct bssgp_flow_control *fc, uint32_t pdu_len);
+static int bssgp_fc_needs_queueing(struct bssgp_flow_control *fc, uint32_t pdu_len,
+				   const struct timeval *now);
 
 static void fc_timer_cb(void *data)
 {
 	struct bssgp_flow_control *fc = data;
 	struct bssgp_fc_queue_element *fcqe;
 	struct timeval time_now;
+	struct msgb *msg;
+	uint32_t llc_pdu_len;
+	void *priv;
 
-	/* if the queue is empty, we return without sending something
-	 * and without re-starting the timer */
-	if (llist_empty(&fc->queue))
-		return;
-
-	/* get the first entry from the queue */
-	fcqe = llist_entry(fc->queue.next, struct bssgp_fc_queue_element,
-			   list);
+	osmo_gettimeofday(&time_now, NULL);
 
-	if (bssgp_fc_needs_queueing(fc, fcqe->llc_pdu_len)) {
-		LOGP(DBSSGP, LOGL_NOTICE, "BSSGP-FC: fc_timer_cb() but still "
-			"not able to send PDU of %u bytes\n", fcqe->llc_pdu_len);
-		/* make sure we re-start the timer */
-		fc_queue_timer_cfg(fc);
-		return;
+	/* send as many PDUs as the bucket has leaked room for, so that a
+	 * late timer or a burst of small PDUs doesn't cost throughput */
+	while (!llist_empty(&fc->queue)) {
+		fcqe = llist_entry(fc->queue.next, struct bssgp_fc_queue_element,
+				   list);
+		if (bssgp_fc_needs_queueing(fc, fcqe->llc_pdu_len, &time_now))
+			break;
+
+		/* remove from the queue; the ring slot is free after this */
+		msg = fcqe->msg;
+		llc_pdu_len = fcqe->llc_pdu_len;
+		priv = fcqe->priv;
+		llist_del(&fcqe->list);
+		fcqe->msg = NULL;
+		fc->ring_head = (fc->ring_head + 1) % fc->ring_size;
+		fc->queue_depth--;
+
+		/* call the output callback for this FC instance.  We
+		 * expect that out_cb will in the end free the msgb once
+		 * it is no longer needed */
+		fc->out_cb(priv, msg, llc_pdu_len, NULL);
 	}
 
-	/* remove from the queue */
-	llist_del(&fcqe->list);
+	/* re-configure the timer for the next PDU */
+	fc_queue_timer_cfg(fc);
+}
 
-	fc->queue_depth--;
+/* add the leak of the bucket since fc->time_last_pdu to the bucket
+ * counter.  The reference time is only advanced by the time it took to
+ * leak the integer number of octets, so that no fraction of an octet
+ * is lost at high PDU rates. */
+static void fc_bucket_leak(struct bssgp_flow_control *fc, const struct timeval *now)
+{
+	struct timeval time_diff;
+	uint64_t usecs_elapsed, usecs_empty, leaked;
 
-	/* record the time we transmitted this PDU */
-	osmo_gettimeofday(&time_now, NULL);
-	fc->time_last_pdu = time_now;
+	if (timercmp(now, &fc->time_last_pdu, <)) {
+		/* the clock went backwards, start counting anew */
+		fc->time_last_pdu = *now;
+		return;
+	}
 
-	/* call the output callback for this FC instance */
-	fc->out_cb(fcqe->priv, fcqe->msg, fcqe->llc_pdu_len, NULL);
+	if (fc->bucket_leak_rate == 0)
+		return;
 
-	/* we expect that out_cb will in the end free the msgb once
-	 * it is no longer needed */
+	timersub(now, &fc->time_last_pdu, &time_diff);
+	usecs_elapsed = (uint64_t)time_diff.tv_sec * 1000000 + time_diff.tv_usec;
 
-	/* but we have to free the queue element ourselves */
-	talloc_free(fcqe);
+	/* time after which the bucket has run empty */
+	usecs_empty = ((uint64_t)fc->bucket_counter * 1000000) / fc->bucket_leak_rate;
+	if (usecs_elapsed >= usecs_empty) {
+		fc->bucket_counter = 0;
+		fc->time_last_pdu = *now;
+		return;
+	}
 
-	/* re-configure the timer for the next PDU */
-	fc_queue_timer_cfg(fc);
+	leaked = (usecs_elapsed * fc->bucket_leak_rate) / 1000000;
+	fc->bucket_counter -= leaked;
+	usecs_elapsed = (leaked * 1000000) / fc->bucket_leak_rate;
+	time_diff.tv_sec = usecs_elapsed / 1000000;
+	time_diff.tv_usec = usecs_elapsed % 1000000;
+	timeradd(&fc->time_last_pdu, &time_diff, &fc->time_last_pdu);
 }
 
 /* configure/schedule the flow control timer to expire once the bucket
@@ -638,27 +770,71 @@ static void fc_timer_cb(void *data)
 static int fc_queue_timer_cfg(struct bssgp_flow_control *fc)
 {
 	struct bssgp_fc_queue_element *fcqe;
-	uint32_t msecs;
+	struct timeval time_now, time_diff;
+	uint64_t needed, usecs;
 
-	if (llist_empty(&fc->queue))
+	if (llist_empty(&fc->queue)) {
+		osmo_timer_del(&fc->timer);
 		return 0;
+	}
+
+	if (fc->bucket_leak_rate == 0) {
+		/* If the PCU is telling us to not send any more data at all,
+		 * there's no point starting a timer. */
+		osmo_timer_del(&fc->timer);
+		return 0;
+	}
 
 	fcqe = llist_entry(fc->queue.next, struct bssgp_fc_queue_element,
 			   list);
 
-	if (fc->bucket_leak_rate != 0) {
-		/* Calculate the point in time at which we will have leaked
-		 * a sufficient number of bytes from the bucket to transmit
-		 * the first PDU in the queue */
-		msecs = (fcqe->llc_pdu_len * 1000) / fc->bucket_leak_rate;
-		/* FIXME: add that time to fc->time_last_pdu and subtract it from
-		 * current time */
-		osmo_timer_setup(&fc->timer, fc_timer_cb, fc);
-		osmo_timer_schedule(&fc->timer, msecs / 1000, (msecs % 1000) * 1000);
-	} else {
-		/* If the PCU is telling us to not send any more data at all,
-		* there's no point starting a timer. */
-	}
+	osmo_gettimeofday(&time_now, NULL);
+	fc_bucket_leak(fc, &time_now);
+
+	/* Calculate the point in time at which we will have leaked a
+	 * sufficient number of bytes from the bucket to transmit the first
+	 * PDU in the queue, relative to the time of the last leak */
+	needed = (uint64_t)fc->bucket_counter + fcqe->llc_pdu_len;
+	if (needed > fc->bucket_size_max)
+		needed -= fc->bucket_size_max;
+	else
+		needed = 0;
+	usecs = (needed * 1000000 + fc->bucket_leak_rate - 1) / fc->bucket_leak_rate;
+	time_diff.tv_sec = usecs / 1000000;
+	time_diff.tv_usec = usecs % 1000000;
+	timeradd(&fc->time_last_pdu, &time_diff, &time_diff);
+
+	/* ... and subtract the current time from it */
+	if (timercmp(&time_diff, &time_now, >))
+		timersub(&time_diff, &time_now, &time_diff);
+	else
+		timerclear(&time_diff);
+
+	osmo_timer_setup(&fc->timer, fc_timer_cb, fc);
+	osmo_timer_schedule(&fc->timer, time_diff.tv_sec, time_diff.tv_usec);
+
+	return 0;
+}
+
+/* (re-)allocate the ring of queue elements.  Only done while the queue is
+ * empty, as the queue list links into the ring */
+static int fc_ring_alloc(struct bssgp_flow_control *fc)
+{
+	struct bssgp_fc_queue_element *ring;
+
+	if (fc->ring && fc->ring_size >= fc->max_queue_depth)
+		return 0;
+	if (fc->queue_depth)
+		return 0;
+
+	ring = talloc_zero_array(fc, struct bssgp_fc_queue_element,
+				 fc->max_queue_depth);
+	if (!ring)
+		return -ENOMEM;
+	talloc_free(fc->ring);
+	fc->ring = ring;
+	fc->ring_size = fc->max_queue_depth;
+	fc->ring_head = 0;
 
 	return 0;
 }
@@ -668,13 +844,19 @@ static int fc_enqueue(struct bssgp_flow_control *fc, struct msgb *msg,
 		      uint32_t llc_pdu_len, void *priv)
 {
 	struct bssgp_fc_queue_element *fcqe;
+	int rc;
 
 	if (fc->queue_depth >= fc->max_queue_depth)
 		return -ENOSPC;
 
-	fcqe = talloc_zero(fc, struct bssgp_fc_queue_element);
-	if (!fcqe)
-		return -ENOMEM;
+	rc = fc_ring_alloc(fc);
+	if (rc < 0)
+		return rc;
+	/* the ring may not grow while PDUs are queued */
+	if (fc->queue_depth >= fc->ring_size)
+		return -ENOSPC;
+
+	fcqe = &fc->ring[(fc->ring_head + fc->queue_depth) % fc->ring_size];
 	fcqe->msg = msg;
 	fcqe->llc_pdu_len = llc_pdu_len;
 	fcqe->priv = priv;
@@ -684,45 +866,27 @@ static int fc_enqueue(struct bssgp_flow_control *fc, struct msgb *msg,
 	fc->queue_depth++;
 
 	/* re-configure the timer for dequeueing the pdu */
-	fc_queue_timer_cfg(fc);
+	if (fc->queue_depth == 1)
+		fc_queue_timer_cfg(fc);
 
 	return 0;
 }
 
-/* According to Section 8.2 */
-static int bssgp_fc_needs_queueing(struct bssgp_flow_control *fc, uint32_t pdu_len)
+/* According to Section 8.2: B' = B + L(p) - (Tc - Tp)*R.  If the PDU fits
+ * in the bucket, it is accounted for and 0 is returned */
+static int bssgp_fc_needs_queueing(struct bssgp_flow_control *fc, uint32_t pdu_len,
+				   const struct timeval *now)
 {
-	struct timeval time_now, time_diff;
-	int64_t bucket_predicted;
-	uint32_t csecs_elapsed, leaked;
-
-	/* B' = B + L(p) - (Tc - Tp)*R */
-
-	/* compute number of centi-seconds that have elapsed since transmitting
-	 * the last PDU (Tc - Tp) */
-	osmo_gettimeofday(&time_now, NULL);
-	timersub(&time_now, &fc->time_last_pdu, &time_diff);
-	csecs_elapsed = time_diff.tv_sec*100 + time_diff.tv_usec/10000;
-
-	/* compute number of bytes that have leaked in the elapsed number
-	 * of centi-seconds */
-	leaked = csecs_elapsed * (fc->bucket_leak_rate / 100);
-	/* add the current PDU length to the last bucket level */
-	bucket_predicted = fc->bucket_counter + pdu_len;
-	/* ... and subtract the number of leaked bytes */
-	bucket_predicted -= leaked;
-
-	if (bucket_predicted < pdu_len)
-		return 0;
-
-	if (bucket_predicted <= fc->bucket_size_max) {
-		/* the bucket is not full yet, we can pass the packet */
-		fc->bucket_counter = bucket_predicted;
-		return 0;
-	}
+	/* subtract the number of bytes that have leaked since the last PDU */
+	fc_bucket_leak(fc, now);
 
 	/* bucket is full, PDU needs to be delayed */
-	return 1;
+	if ((uint64_t)fc->bucket_counter + pdu_len > fc->bucket_size_max)
+		return 1;
+
+	/* the bucket is not full yet, we can pass the packet */
+	fc->bucket_counter += pdu_len;
+	return 0;
 }
 
 /* output callback for BVC flow control */
@@ -748,34 +912,49 @@ int bssgp_fc_in(struct bssgp_flow_control *fc, struct msgb *msg,
 		return -EIO;
 	}
 
-	if (bssgp_fc_needs_queueing(fc, llc_pdu_len)) {
+	osmo_gettimeofday(&time_now, NULL);
+
+	/* PDUs must not overtake those already in the queue */
+	if (!llist_empty(&fc->queue) ||
+	    bssgp_fc_needs_queueing(fc, llc_pdu_len, &time_now)) {
 		int rc;
 		rc = fc_enqueue(fc, msg, llc_pdu_len, priv);
 		if (rc)
 			msgb_free(msg);
 		return rc;
-	} else {
-		/* record the time we transmitted this PDU */
-		osmo_gettimeofday(&time_now, NULL);
-		fc->time_last_pdu = time_now;
+	} else
 		return fc->out_cb(priv, msg, llc_pdu_len, NULL);
-	}
 }
 
 
-/* Initialize the Flow Control structure */
+/* Initialize the Flow Control structure.  The structure needs to be zeroed
+ * before the first call; later calls, e.g. for every FLOW-CONTROL-MS, only
+ * update the parameters and keep the PDUs that are already queued */
 void bssgp_fc_init(struct bssgp_flow_control *fc,
 		   uint32_t bucket_size_max, uint32_t bucket_leak_rate,
 		   uint32_t max_queue_depth,
 		   int (*out_cb)(struct bssgp_flow_control *fc, struct msgb *msg,
 				 uint32_t llc_pdu_len, void *priv))
 {
+	struct timeval time_now;
+
+	osmo_gettimeofday(&time_now, NULL);
+	if (!fc->queue.next) {
+		INIT_LLIST_HEAD(&fc->queue);
+		fc->time_last_pdu = time_now;
+	} else {
+		/* what leaked so far leaked at the old rate */
+		fc_bucket_leak(fc, &time_now);
+	}
+
 	fc->out_cb = out_cb;
 	fc->bucket_size_max = bucket_size_max;
 	fc->bucket_leak_rate = bucket_leak_rate;
 	fc->max_queue_depth = max_queue_depth;
-	INIT_LLIST_HEAD(&fc->queue);
-	osmo_gettimeofday(&fc->time_last_pdu, NULL);
+
+	/* the queue may have stalled with a leak rate of 0 before, or its
+	 * head may now be due earlier or later */
+	fc_queue_timer_cfg(fc);
 }
 
 /* Initialize the Flow Control parameters for a new MS according to
@@ -1275,8 +1454,11 @@ void bssgp_fc_flush_queue(struct bssgp_flow_control *fc)
 	llist_for_each_entry_safe(element, tmp, &fc->queue, list) {
 		msgb_free(element->msg);
 		llist_del(&element->list);
-		talloc_free(element);
+		element->msg = NULL;
 	}
+	fc->queue_depth = 0;
+	fc->ring_head = 0;
+	osmo_timer_del(&fc->timer);
 }
 
 /*!
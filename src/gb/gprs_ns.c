@@ -62,10 +62,14 @@
  *
  * \file gprs_ns.c */
 
+#define _GNU_SOURCE	/* recvmmsg() */
+#include "config.h"
+
 #include <stdlib.h>
 #include <unistd.h>
 #include <errno.h>
 #include <stdint.h>
+#include <stdbool.h>
 
 #include <sys/types.h>
 #include <sys/socket.h>
@@ -156,6 +160,22 @@ static const struct osmo_stat_item_group_desc nsvc_statg_desc = {
 	.class_id = OSMO_STATS_CLASS_PEER,
 };
 
+enum ns_inst_stat {
+	NS_INST_STAT_NSIP_RX_BATCH,
+};
+
+static const struct osmo_stat_item_desc nsi_stat_description[] = {
+	{ "nsip.rx.batch", "Datagrams received per read event", "", 16, 0 },
+};
+
+static const struct osmo_stat_item_group_desc nsi_statg_desc = {
+	.group_name_prefix = "ns.inst",
+	.group_description = "NS Instance Statistics",
+	.num_items = ARRAY_SIZE(nsi_stat_description),
+	.item_desc = nsi_stat_description,
+	.class_id = OSMO_STATS_CLASS_GLOBAL,
+};
+
 const struct value_string gprs_ns_signal_ns_names[] = {
 	{ S_NS_RESET,		"NS-RESET" },
 	{ S_NS_BLOCK,		"NS-BLOCK" },
@@ -199,6 +219,110 @@ static inline void ns_set_state_with_log(struct gprs_nsvc *nsvc, uint32_t state,
 		nsvc->state = state;
 }
 
+/* The NS-VCs of an instance are indexed by NSVCI, NSEI and remote address.
+ * As these are public members of struct gprs_nsvc that users may modify
+ * directly, a lookup that misses in the hash table falls back to a scan of
+ * nsi->gprs_nsvcs and re-indexes the NS-VC it finds there. */
+#define NSVC_HASH_BITS	8
+#define NSVC_HASH_SIZE	(1 << NSVC_HASH_BITS)
+
+/* NS-VC used to send to an NSE, entry of nsi->active_nsvc_by_nsei */
+struct gprs_ns_active_nsvc {
+	struct llist_head list;
+	uint16_t nsei;
+	/* the entry is freed once the NS-VC is deleted or re-indexed */
+	struct gprs_nsvc *nsvc;
+};
+
+static inline unsigned int nsvc_hash16(uint16_t val)
+{
+	return (val ^ (val >> NSVC_HASH_BITS)) & (NSVC_HASH_SIZE - 1);
+}
+
+static inline unsigned int nsvc_hash_addr(const struct sockaddr_in *sin)
+{
+	uint32_t val = sin->sin_addr.s_addr ^ sin->sin_port;
+
+	val ^= val >> 16;
+	return nsvc_hash16(val);
+}
+
+static inline bool nsvc_is_active(const struct gprs_nsvc *nsvc)
+{
+	return !(nsvc->state & NSE_S_BLOCKED) && nsvc->state & NSE_S_ALIVE;
+}
+
+static inline bool nsvc_addr_equal(const struct gprs_nsvc *nsvc,
+				   const struct sockaddr_in *sin)
+{
+	return nsvc->ip.bts_addr.sin_addr.s_addr == sin->sin_addr.s_addr &&
+	       nsvc->ip.bts_addr.sin_port == sin->sin_port;
+}
+
+static int nsvc_hash_init(struct gprs_ns_inst *nsi)
+{
+	unsigned int i;
+
+	nsi->nsvc_by_nsvci = talloc_array(nsi, struct llist_head, NSVC_HASH_SIZE);
+	nsi->nsvc_by_nsei = talloc_array(nsi, struct llist_head, NSVC_HASH_SIZE);
+	nsi->nsvc_by_rem_addr = talloc_array(nsi, struct llist_head, NSVC_HASH_SIZE);
+	nsi->active_nsvc_by_nsei = talloc_array(nsi, struct llist_head, NSVC_HASH_SIZE);
+	if (!nsi->nsvc_by_nsvci || !nsi->nsvc_by_nsei || !nsi->nsvc_by_rem_addr
+	    || !nsi->active_nsvc_by_nsei)
+		return -ENOMEM;
+
+	for (i = 0; i < NSVC_HASH_SIZE; i++) {
+		INIT_LLIST_HEAD(&nsi->nsvc_by_nsvci[i]);
+		INIT_LLIST_HEAD(&nsi->nsvc_by_nsei[i]);
+		INIT_LLIST_HEAD(&nsi->nsvc_by_rem_addr[i]);
+		INIT_LLIST_HEAD(&nsi->active_nsvc_by_nsei[i]);
+	}
+	return 0;
+}
+
+/* stop using a NS-VC to send to its NSE, the next lookup picks another one */
+static void nsvc_deactivate(struct gprs_nsvc *nsvc)
+{
+	if (nsvc->active) {
+		llist_del(&nsvc->active->list);
+		talloc_free(nsvc->active);
+		nsvc->active = NULL;
+	}
+}
+
+static void nsvc_unhash(struct gprs_nsvc *nsvc)
+{
+	llist_del_init(&nsvc->hash_nsvci);
+	llist_del_init(&nsvc->hash_nsei);
+	llist_del_init(&nsvc->hash_rem_addr);
+	nsvc_deactivate(nsvc);
+}
+
+/*! Update the lookup tables after changing the NSVCI, NSEI or remote
+ *  address of a NS-VC
+ *  \param[in] nsvc NS-VC whose members were modified
+ *
+ *  Not calling this function is not fatal, as lookups fall back to a
+ *  linear search, but it keeps the lookups fast.
+ */
+void gprs_nsvc_rehash(struct gprs_nsvc *nsvc)
+{
+	struct gprs_ns_inst *nsi = nsvc->nsi;
+
+	/* the NS-VC for unknown peers is not part of the instance */
+	if (llist_empty(&nsvc->list))
+		return;
+
+	nsvc_deactivate(nsvc);
+
+	llist_del(&nsvc->hash_nsvci);
+	llist_del(&nsvc->hash_nsei);
+	llist_del(&nsvc->hash_rem_addr);
+	llist_add(&nsvc->hash_nsvci, &nsi->nsvc_by_nsvci[nsvc_hash16(nsvc->nsvci)]);
+	llist_add(&nsvc->hash_nsei, &nsi->nsvc_by_nsei[nsvc_hash16(nsvc->nsei)]);
+	llist_add(&nsvc->hash_rem_addr, &nsi->nsvc_by_rem_addr[nsvc_hash_addr(&nsvc->ip.bts_addr)]);
+}
+
 /*! Lookup struct gprs_nsvc based on NSVCI
  *  \param[in] nsi NS instance in which to search
  *  \param[in] nsvci NSVCI to be searched
@@ -207,10 +331,16 @@ static inline void ns_set_state_with_log(struct gprs_nsvc *nsvc, uint32_t state,
 struct gprs_nsvc *gprs_nsvc_by_nsvci(struct gprs_ns_inst *nsi, uint16_t nsvci)
 {
 	struct gprs_nsvc *nsvc;
-	llist_for_each_entry(nsvc, &nsi->gprs_nsvcs, list) {
+	llist_for_each_entry(nsvc, &nsi->nsvc_by_nsvci[nsvc_hash16(nsvci)], hash_nsvci) {
 		if (nsvc->nsvci == nsvci)
 			return nsvc;
 	}
+	llist_for_each_entry(nsvc, &nsi->gprs_nsvcs, list) {
+		if (nsvc->nsvci == nsvci) {
+			gprs_nsvc_rehash(nsvc);
+			return nsvc;
+		}
+	}
 	return NULL;
 }
 
@@ -222,25 +352,65 @@ struct gprs_nsvc *gprs_nsvc_by_nsvci(struct gprs_ns_inst *nsi, uint16_t nsvci)
 struct gprs_nsvc *gprs_nsvc_by_nsei(struct gprs_ns_inst *nsi, uint16_t nsei)
 {
 	struct gprs_nsvc *nsvc;
-	llist_for_each_entry(nsvc, &nsi->gprs_nsvcs, list) {
+	llist_for_each_entry(nsvc, &nsi->nsvc_by_nsei[nsvc_hash16(nsei)], hash_nsei) {
 		if (nsvc->nsei == nsei)
 			return nsvc;
 	}
+	llist_for_each_entry(nsvc, &nsi->gprs_nsvcs, list) {
+		if (nsvc->nsei == nsei) {
+			gprs_nsvc_rehash(nsvc);
+			return nsvc;
+		}
+	}
 	return NULL;
 }
 
+/* Lookup an unblocked and alive NS-VC of the given NSE.  The result is
+ * remembered per NSEI, so that all traffic of the NSE uses it as long as it
+ * is active. */
 static struct gprs_nsvc *gprs_active_nsvc_by_nsei(struct gprs_ns_inst *nsi,
 						  uint16_t nsei)
 {
+	unsigned int idx = nsvc_hash16(nsei);
+	struct gprs_ns_active_nsvc *act;
 	struct gprs_nsvc *nsvc;
+
+	llist_for_each_entry(act, &nsi->active_nsvc_by_nsei[idx], list) {
+		if (act->nsei == nsei)
+			goto found_nse;
+	}
+	act = NULL;
+
+found_nse:
+	if (act && act->nsvc->nsei == nsei && nsvc_is_active(act->nsvc))
+		return act->nsvc;
+
+	llist_for_each_entry(nsvc, &nsi->nsvc_by_nsei[idx], hash_nsei) {
+		if (nsvc->nsei == nsei && nsvc_is_active(nsvc))
+			goto found;
+	}
 	llist_for_each_entry(nsvc, &nsi->gprs_nsvcs, list) {
-		if (nsvc->nsei == nsei) {
-			if (!(nsvc->state & NSE_S_BLOCKED) &&
-			    nsvc->state & NSE_S_ALIVE)
-				return nsvc;
+		if (nsvc->nsei == nsei && nsvc_is_active(nsvc)) {
+			gprs_nsvc_rehash(nsvc);
+			goto found;
 		}
 	}
 	return NULL;
+
+found:
+	if (act) {
+		act->nsvc->active = NULL;
+	} else {
+		act = talloc_zero(nsi, struct gprs_ns_active_nsvc);
+		if (!act)
+			return nsvc;
+		act->nsei = nsei;
+		llist_add(&act->list, &nsi->active_nsvc_by_nsei[idx]);
+	}
+	nsvc_deactivate(nsvc);
+	act->nsvc = nsvc;
+	nsvc->active = act;
+	return nsvc;
 }
 
 /* Lookup struct gprs_nsvc based on remote peer socket addr */
@@ -248,11 +418,15 @@ static struct gprs_nsvc *nsvc_by_rem_addr(struct gprs_ns_inst *nsi,
 					  struct sockaddr_in *sin)
 {
 	struct gprs_nsvc *nsvc;
+	llist_for_each_entry(nsvc, &nsi->nsvc_by_rem_addr[nsvc_hash_addr(sin)], hash_rem_addr) {
+		if (nsvc_addr_equal(nsvc, sin))
+			return nsvc;
+	}
 	llist_for_each_entry(nsvc, &nsi->gprs_nsvcs, list) {
-		if (nsvc->ip.bts_addr.sin_addr.s_addr ==
-					sin->sin_addr.s_addr &&
-		    nsvc->ip.bts_addr.sin_port == sin->sin_port)
+		if (nsvc_addr_equal(nsvc, sin)) {
+			gprs_nsvc_rehash(nsvc);
 			return nsvc;
+		}
 	}
 	return NULL;
 }
@@ -276,6 +450,10 @@ struct gprs_nsvc *gprs_nsvc_create(struct gprs_ns_inst *nsi, uint16_t nsvci)
 	nsvc->statg = osmo_stat_item_group_alloc(nsvc, &nsvc_statg_desc, nsvci);
 
 	llist_add(&nsvc->list, &nsi->gprs_nsvcs);
+	INIT_LLIST_HEAD(&nsvc->hash_nsvci);
+	INIT_LLIST_HEAD(&nsvc->hash_nsei);
+	INIT_LLIST_HEAD(&nsvc->hash_rem_addr);
+	gprs_nsvc_rehash(nsvc);
 
 	return nsvc;
 }
@@ -287,6 +465,7 @@ void gprs_nsvc_delete(struct gprs_nsvc *nsvc)
 {
 	if (osmo_timer_pending(&nsvc->timer))
 		osmo_timer_del(&nsvc->timer);
+	nsvc_unhash(nsvc);
 	llist_del(&nsvc->list);
 	rate_ctr_group_free(nsvc->ctrg);
 	osmo_stat_item_group_free(nsvc->statg);
@@ -912,6 +1091,7 @@ static int gprs_ns_rx_reset(struct gprs_nsvc **nsvc, struct msgb *msg)
 			orig_nsvc = *nsvc;
 			*nsvc = gprs_nsvc_create((*nsvc)->nsi, nsvci);
 			(*nsvc)->nsei  = nsei;
+			gprs_nsvc_rehash(*nsvc);
 		}
 	}
 
@@ -933,6 +1113,7 @@ static int gprs_ns_rx_reset(struct gprs_nsvc **nsvc, struct msgb *msg)
 		/* NSEI has changed */
 		rate_ctr_inc(&(*nsvc)->ctrg->ctr[NS_CTR_NSEI_CHG]);
 		(*nsvc)->nsei = nsei;
+		gprs_nsvc_rehash(*nsvc);
 	}
 
 	/* Mark NS-VC as blocked and alive */
@@ -949,6 +1130,7 @@ static int gprs_ns_rx_reset(struct gprs_nsvc **nsvc, struct msgb *msg)
 		(*nsvc)->nsei  = nsei;
 		(*nsvc)->nsvci = nsvci;
 		(*nsvc)->nsvci_is_valid = 1;
+		gprs_nsvc_rehash(*nsvc);
 		rate_ctr_group_upd_idx((*nsvc)->ctrg, nsvci);
 		osmo_stat_item_group_udp_idx((*nsvc)->statg, nsvci);
 	}
@@ -1073,6 +1255,7 @@ static int gprs_ns_rx_reset_ack(struct gprs_nsvc **nsvc, struct msgb *msg)
 		/* NSEI has changed */
 		rate_ctr_inc(&(*nsvc)->ctrg->ctr[NS_CTR_NSEI_CHG]);
 		(*nsvc)->nsei = nsei;
+		gprs_nsvc_rehash(*nsvc);
 	}
 
 	/* Mark NS-VC as blocked and alive */
@@ -1210,6 +1393,7 @@ void gprs_ns_ll_copy(struct gprs_nsvc *nsvc, struct gprs_nsvc *other)
 	default:
 		break;
 	}
+	gprs_nsvc_rehash(nsvc);
 }
 
 void gprs_ns_ll_clear(struct gprs_nsvc *nsvc)
@@ -1226,6 +1410,7 @@ void gprs_ns_ll_clear(struct gprs_nsvc *nsvc)
 	default:
 		break;
 	}
+	gprs_nsvc_rehash(nsvc);
 }
 
 /*! Create/get NS-VC independently from underlying transport layer
@@ -1340,6 +1525,7 @@ int gprs_ns_vc_create(struct gprs_ns_inst *nsi, struct msgb *msg,
 
 		/* Override old NSEI */
 		existing_nsvc->nsei  = nsei;
+		gprs_nsvc_rehash(existing_nsvc);
 
 		/* Do statistics */
 		rate_ctr_inc(&existing_nsvc->ctrg->ctr[NS_CTR_NSEI_CHG]);
@@ -1456,8 +1642,20 @@ struct gprs_ns_inst *gprs_ns_instantiate(gprs_ns_cb_t *cb, void *ctx)
 {
 	struct gprs_ns_inst *nsi = talloc_zero(ctx, struct gprs_ns_inst);
 
+	if (!nsi)
+		return NULL;
 	nsi->cb = cb;
 	INIT_LLIST_HEAD(&nsi->gprs_nsvcs);
+	INIT_LLIST_HEAD(&nsi->nsip.rx_msgs);
+	if (nsvc_hash_init(nsi) < 0) {
+		talloc_free(nsi);
+		return NULL;
+	}
+	nsi->statg = osmo_stat_item_group_alloc(nsi, &nsi_statg_desc, 0);
+	if (!nsi->statg) {
+		talloc_free(nsi);
+		return NULL;
+	}
 	nsi->timeout[NS_TOUT_TNS_BLOCK] = 3;
 	nsi->timeout[NS_TOUT_TNS_BLOCK_RETRIES] = 3;
 	nsi->timeout[NS_TOUT_TNS_RESET] = 3;
@@ -1470,6 +1668,7 @@ struct gprs_ns_inst *gprs_ns_instantiate(gprs_ns_cb_t *cb, void *ctx)
 	 * messages to non-existant/unknown NS-VC's */
 	nsi->unknown_nsvc = gprs_nsvc_create(nsi, 0xfffe);
 	nsi->unknown_nsvc->nsvci_is_valid = 0;
+	nsvc_unhash(nsi->unknown_nsvc);
 	llist_del(&nsi->unknown_nsvc->list);
 	INIT_LLIST_HEAD(&nsi->unknown_nsvc->list);
 
@@ -1492,6 +1691,7 @@ void gprs_ns_close(struct gprs_ns_inst *nsi)
 		osmo_fd_unregister(&nsi->nsip.fd);
 		nsi->nsip.fd.data = NULL;
 	}
+	msgb_queue_free(&nsi->nsip.rx_msgs);
 }
 
 /*! Destroy an entire NS instance
@@ -1503,6 +1703,7 @@ void gprs_ns_close(struct gprs_ns_inst *nsi)
 void gprs_ns_destroy(struct gprs_ns_inst *nsi)
 {
 	gprs_ns_close(nsi);
+	osmo_stat_item_group_free(nsi->statg);
 	/* free the NSI */
 	talloc_free(nsi);
 }
@@ -1544,13 +1745,80 @@ static struct msgb *read_nsip_msg(struct osmo_fd *bfd, int *error,
 	return msg;
 }
 
+#ifdef HAVE_RECVMMSG
+/* Read up to nsi->nsip.rx_batch NS-over-IP messages with one recvmmsg().
+ * The msgbs are kept across calls and re-used, as gprs_ns_rcvmsg() does
+ * not take ownership of them. */
+static int handle_nsip_read_batch(struct osmo_fd *bfd)
+{
+	struct gprs_ns_inst *nsi = bfd->data;
+	unsigned int num = OSMO_MIN(nsi->nsip.rx_batch, NS_RX_MAX_BATCH);
+	struct msgb *msg[NS_RX_MAX_BATCH];
+	struct sockaddr_in saddr[NS_RX_MAX_BATCH];
+	struct mmsghdr mmsg[NS_RX_MAX_BATCH];
+	struct iovec iov[NS_RX_MAX_BATCH];
+	unsigned int i;
+	int n, rc = 0;
+
+	for (i = 0; i < num; i++) {
+		msg[i] = msgb_dequeue(&nsi->nsip.rx_msgs);
+		if (!msg[i])
+			msg[i] = gprs_ns_msgb_alloc();
+		if (!msg[i]) {
+			num = i;
+			break;
+		}
+		iov[i].iov_base = msg[i]->data;
+		iov[i].iov_len = msgb_tailroom(msg[i]);
+		memset(&mmsg[i], 0, sizeof(mmsg[i]));
+		mmsg[i].msg_hdr.msg_name = &saddr[i];
+		mmsg[i].msg_hdr.msg_namelen = sizeof(saddr[i]);
+		mmsg[i].msg_hdr.msg_iov = &iov[i];
+		mmsg[i].msg_hdr.msg_iovlen = 1;
+	}
+	if (!num)
+		return -ENOMEM;
+
+	n = recvmmsg(bfd->fd, mmsg, num, MSG_DONTWAIT, NULL);
+	if (n < 0) {
+		LOGP(DNS, LOGL_ERROR, "recv error %s during NSIP recv\n",
+			strerror(errno));
+		rc = -errno;
+		n = 0;
+	} else
+		osmo_stat_item_set(nsi->statg->items[NS_INST_STAT_NSIP_RX_BATCH], n);
+
+	for (i = 0; i < num; i++) {
+		if (i < n && mmsg[i].msg_len > 0) {
+			msg[i]->l2h = msg[i]->data;
+			msgb_put(msg[i], mmsg[i].msg_len);
+			rc = gprs_ns_rcvmsg(nsi, msg[i], &saddr[i], GPRS_NS_LL_UDP);
+			/* back to the state after gprs_ns_msgb_alloc();
+			 * msgb_reset() also clears cb[], so that msgb_nsei()
+			 * and msgb_bvci() don't leak into the next datagram */
+			msgb_reset(msg[i]);
+			msgb_reserve(msg[i], NS_ALLOC_HEADROOM);
+		}
+		msgb_enqueue(&nsi->nsip.rx_msgs, msg[i]);
+	}
+
+	return rc;
+}
+#endif
+
 static int handle_nsip_read(struct osmo_fd *bfd)
 {
 	int error;
 	struct sockaddr_in saddr;
 	struct gprs_ns_inst *nsi = bfd->data;
-	struct msgb *msg = read_nsip_msg(bfd, &error, &saddr);
+	struct msgb *msg;
+
+#ifdef HAVE_RECVMMSG
+	if (nsi->nsip.rx_batch > 1)
+		return handle_nsip_read_batch(bfd);
+#endif
 
+	msg = read_nsip_msg(bfd, &error, &saddr);
 	if (!msg)
 		return error;
 
@@ -1706,6 +1974,7 @@ struct gprs_nsvc *gprs_ns_nsip_connect(struct gprs_ns_inst *nsi,
 	nsvc->ip.bts_addr = *dest;
 	nsvc->nsei = nsei;
 	nsvc->remote_end_is_sgsn = 1;
+	gprs_nsvc_rehash(nsvc);
 
 	gprs_nsvc_reset(nsvc, NS_CAUSE_OM_INTERVENTION);
 	return nsvc;
@@ -139,6 +139,9 @@ static int config_write_ns(struct vty *vty)
 	if (vty_nsi->nsip.dscp)
 		vty_out(vty, " encapsulation udp dscp %d%s",
 			vty_nsi->nsip.dscp, VTY_NEWLINE);
+	if (vty_nsi->nsip.rx_batch > 1)
+		vty_out(vty, " encapsulation udp rx-batch %u%s",
+			vty_nsi->nsip.rx_batch, VTY_NEWLINE);
 
 	vty_out(vty, " encapsulation framerelay-gre enabled %u%s",
 		vty_nsi->frgre.enabled ? 1 : 0, VTY_NEWLINE);
@@ -285,6 +288,7 @@ DEFUN(cfg_nse_nsvc, cfg_nse_nsvci_cmd,
 		nsvc->nsei = nsei;
 	}
 	nsvc->nsvci = nsvci;
+	gprs_nsvc_rehash(nsvc);
 	/* All NSVCs that are explicitly configured by VTY are
 	 * marked as persistent so we can write them to the config
 	 * file at some later point */
@@ -308,6 +312,7 @@ DEFUN(cfg_nse_remoteip, cfg_nse_remoteip_cmd,
 		return CMD_WARNING;
 	}
 	inet_aton(argv[1], &nsvc->ip.bts_addr.sin_addr);
+	gprs_nsvc_rehash(nsvc);
 
 	return CMD_SUCCESS;
 
@@ -336,6 +341,7 @@ DEFUN(cfg_nse_remoteport, cfg_nse_remoteport_cmd,
 	}
 
 	nsvc->ip.bts_addr.sin_port = osmo_htons(port);
+	gprs_nsvc_rehash(nsvc);
 
 	return CMD_SUCCESS;
 }
@@ -363,6 +369,7 @@ DEFUN(cfg_nse_fr_dlci, cfg_nse_fr_dlci_cmd,
 	}
 
 	nsvc->frgre.bts_addr.sin_port = osmo_htons(dlci);
+	gprs_nsvc_rehash(nsvc);
 
 	return CMD_SUCCESS;
 }
@@ -495,6 +502,16 @@ DEFUN(cfg_nsip_dscp, cfg_nsip_dscp_cmd,
 	return CMD_SUCCESS;
 }
 
+DEFUN(cfg_nsip_rx_batch, cfg_nsip_rx_batch_cmd,
+      "encapsulation udp rx-batch <1-32>",
+	ENCAPS_STR "NS over UDP Encapsulation\n"
+	"Set the number of datagrams read at once from the UDP socket\n"
+	"Number of datagrams (1 to read them one by one)\n")
+{
+	vty_nsi->nsip.rx_batch = atoi(argv[0]);
+	return CMD_SUCCESS;
+}
+
 DEFUN(cfg_frgre_local_ip, cfg_frgre_local_ip_cmd,
       "encapsulation framerelay-gre local-ip A.B.C.D",
 	ENCAPS_STR "NS over Frame Relay over GRE Encapsulation\n"
@@ -630,6 +647,7 @@ int gprs_ns_vty_init(struct gprs_ns_inst *nsi)
 	install_element(L_NS_NODE, &cfg_nsip_local_ip_cmd);
 	install_element(L_NS_NODE, &cfg_nsip_local_port_cmd);
 	install_element(L_NS_NODE, &cfg_nsip_dscp_cmd);
+	install_element(L_NS_NODE, &cfg_nsip_rx_batch_cmd);
 	install_element(L_NS_NODE, &cfg_frgre_enable_cmd);
 	install_element(L_NS_NODE, &cfg_frgre_local_ip_cmd);
 
@@ -48,6 +48,34 @@
 /* A5/3&4                                                                   */
 /* ------------------------------------------------------------------------ */
 
+/*! Generate a GSM A5/4 cipher stream as packed bits
+ *  \param[in] ck 16 byte array for the key (as received from the SIM)
+ *  \param[in] fn Frame number
+ *  \param[out] dl Pointer to 15 bytes to return Downlink cipher stream
+ *  \param[out] ul Pointer to 15 bytes to return Uplink cipher stream
+ *  \param[in] fn_correct true if fn is a real GSM frame number and thus requires internal conversion
+ *
+ * Either (or both) of dl/ul should be NULL if not needed.
+ */
+static void
+_a5_4_pbits(const uint8_t *ck, uint32_t fn, pbit_t *dl, pbit_t *ul, bool fn_correct)
+{
+	uint8_t i, gamma[32];
+	uint32_t fn_count = (fn_correct) ? osmo_a5_fn_count(fn) : fn;
+
+	if (ul) {
+		_kasumi_kgcore(0xF, 0, fn_count, 0, ck, gamma, 228);
+		for (i = 0; i < 15; i++)
+			ul[i] = (gamma[i + 14] << 2) + (gamma[i + 15] >> 6);
+		ul[14] &= 0xc0;
+	}
+	if (dl) {
+		_kasumi_kgcore(0xF, 0, fn_count, 0, ck, gamma, 114);
+		memcpy(dl, gamma, 15);
+		dl[14] &= 0xc0;
+	}
+}
+
 /*! Generate a GSM A5/4 cipher stream
  *  \param[in] key 16 byte array for the key (as received from the SIM)
  *  \param[in] fn Frame number
@@ -63,18 +91,14 @@
 void
 _a5_4(const uint8_t *ck, uint32_t fn, ubit_t *dl, ubit_t *ul, bool fn_correct)
 {
-       uint8_t i, gamma[32], uplink[15];
-       uint32_t fn_count = (fn_correct) ? osmo_a5_fn_count(fn) : fn;
+       uint8_t dl_p[15], ul_p[15];
+
+       _a5_4_pbits(ck, fn, dl ? dl_p : NULL, ul ? ul_p : NULL, fn_correct);
 
-       if (ul) {
-               _kasumi_kgcore(0xF, 0, fn_count, 0, ck, gamma, 228);
-               for(i = 0; i < 15; i++) uplink[i] = (gamma[i + 14] << 2) + (gamma[i + 15] >> 6);
-               osmo_pbit2ubit(ul, uplink, 114);
-       }
-       if (dl) {
-               _kasumi_kgcore(0xF, 0, fn_count, 0, ck, gamma, 114);
-               osmo_pbit2ubit(dl, gamma, 114);
-       }
+       if (ul)
+               osmo_pbit2ubit(ul, ul_p, 114);
+       if (dl)
+               osmo_pbit2ubit(dl, dl_p, 114);
 }
 
 /*! Generate a GSM A5/3 cipher stream
@@ -98,6 +122,21 @@ _a5_3(const uint8_t *key, uint32_t fn, ubit_t *dl, ubit_t *ul, bool fn_correct)
        _a5_4(ck, fn, dl, ul, fn_correct);
 }
 
+/*! Generate a GSM A5/3 cipher stream as packed bits
+ *  \param[in] key 8 byte array for the key (as received from the SIM)
+ *  \param[in] fn Frame number
+ *  \param[out] dl Pointer to 15 bytes to return Downlink cipher stream
+ *  \param[out] ul Pointer to 15 bytes to return Uplink cipher stream
+ *  \param[in] fn_correct true if fn is a real GSM frame number and thus requires internal conversion
+ */
+static void
+_a5_3_pbits(const uint8_t *key, uint32_t fn, pbit_t *dl, pbit_t *ul, bool fn_correct)
+{
+	uint8_t ck[16];
+	osmo_c4(ck, key);
+	_a5_4_pbits(ck, fn, dl, ul, fn_correct);
+}
+
 /* ------------------------------------------------------------------------ */
 /* A5/1&2 common stuff                                                                     */
 /* ------------------------------------------------------------------------ */
@@ -155,6 +194,137 @@ _a5_12_clock(uint32_t r, uint32_t mask, uint32_t taps)
 	return ((r << 1) & mask) | _a5_12_parity(r & taps);
 }
 
+/*! Append one output bit to a packed (MSB first) cipher stream
+ *  \param[inout] acc Bit accumulator
+ *  \param[out] out Packed cipher stream, can be NULL
+ *  \param[in] i Index of the bit
+ *  \param[in] b The output bit (0 or 1)
+ */
+static inline void
+_a5_12_put_bit(uint8_t *acc, pbit_t *out, int i, uint8_t b)
+{
+	*acc = (*acc << 1) | b;
+	if ((i & 7) == 7)
+		out[i >> 3] = *acc;
+	else if (i == 113)
+		out[i >> 3] = *acc << 6;
+}
+
+/* Bitsliced A5/1 and A5/2: each register bit is a 64-bit word holding that
+ * bit for 64 independent (key, fn) instances, one per bit position (lane).
+ * Majority and conditional clocking become a handful of bitwise operations
+ * shared by all lanes, which is much faster than 64 scalar runs. */
+
+#define A5_LANES	64
+
+/*! Bitsliced A5/1 and A5/2 state, bit i of register x is rx[i] */
+struct a5_12_slices {
+	uint64_t r1[A5_R1_LEN];
+	uint64_t r2[A5_R2_LEN];
+	uint64_t r3[A5_R3_LEN];
+	uint64_t r4[A5_R4_LEN];	/* A5/2 only */
+};
+
+static inline uint64_t
+_a5_12_slice_majority(uint64_t a, uint64_t b, uint64_t c)
+{
+	return (a & b) | (a & c) | (b & c);
+}
+
+/*! Clock the lanes of a bitsliced LFSR selected by a mask
+ *  \param[inout] r Register bits
+ *  \param[in] len Register length
+ *  \param[in] fb Feedback bit of each lane
+ *  \param[in] m Lanes to be clocked
+ */
+static inline void
+_a5_12_slice_clock(uint64_t *r, int len, uint64_t fb, uint64_t m)
+{
+	int i;
+
+	for (i = len - 1; i > 0; i--)
+		r[i] ^= (r[i] ^ r[i - 1]) & m;
+	r[0] ^= (r[0] ^ fb) & m;
+}
+
+/* Feedback functions, see the A5_Rx_TAPS above */
+#define A5_R1_SLICE_FB(r)	((r)[13] ^ (r)[16] ^ (r)[17] ^ (r)[18])
+#define A5_R2_SLICE_FB(r)	((r)[20] ^ (r)[21])
+#define A5_R3_SLICE_FB(r)	((r)[7] ^ (r)[20] ^ (r)[21] ^ (r)[22])
+#define A5_R4_SLICE_FB(r)	((r)[11] ^ (r)[16])
+
+/*! Transpose a 8x8 bit matrix, bit (8*i + j) moves to (8*j + i) */
+static inline uint64_t
+_a5_12_transpose8(uint64_t x)
+{
+	uint64_t t;
+
+	t = (x ^ (x >> 7)) & 0x00aa00aa00aa00aaULL;
+	x ^= t ^ (t << 7);
+	t = (x ^ (x >> 14)) & 0x0000cccc0000ccccULL;
+	x ^= t ^ (t << 14);
+	t = (x ^ (x >> 28)) & 0x00000000f0f0f0f0ULL;
+	x ^= t ^ (t << 28);
+
+	return x;
+}
+
+/*! Transpose the keys and frame counts of up to 64 lanes into lane words
+ *  \param[in] num Number of lanes in use (up to A5_LANES)
+ *  \param[in] keys 8 byte keys, one per lane
+ *  \param[in] fns Frame numbers, one per lane
+ *  \param[out] kb Key bits (64) followed by frame count bits (22), as lane words
+ */
+static void
+_a5_12_slice_load_bits(unsigned int num, const uint8_t * const *keys,
+		       const uint32_t *fns, uint64_t kb[64 + 22])
+{
+	unsigned int l, i;
+	uint32_t fn_count;
+
+	memset(kb, 0, sizeof(uint64_t) * (64 + 22));
+
+	for (l = 0; l < num; l++) {
+		for (i = 0; i < 64; i++)
+			kb[i] |= (uint64_t) ((keys[l][7 - (i >> 3)] >> (i & 7)) & 1) << l;
+
+		fn_count = osmo_a5_fn_count(fns[l]);
+		for (i = 0; i < 22; i++)
+			kb[64 + i] |= (uint64_t) ((fn_count >> i) & 1) << l;
+	}
+}
+
+/*! Store 8 bitsliced output bits as one byte of each lane's cipher stream
+ *  \param[in] o Output bits 8*k .. 8*k+7 as lane words
+ *  \param[in] num Number of lanes in use
+ *  \param[out] out Packed cipher stream of each lane, entries can be NULL
+ *  \param[in] k Index of the byte
+ *  \param[in] mask Mask applied to the byte
+ */
+static void
+_a5_12_slice_store(const uint64_t o[8], unsigned int num, pbit_t * const *out,
+		   int k, uint8_t mask)
+{
+	unsigned int g, c, l;
+	uint64_t x;
+	int b;
+
+	for (g = 0; g < A5_LANES / 8 && 8 * g < num; g++) {
+		/* Row 7-b holds output bit b of lanes 8g..8g+7, so the
+		 * transpose yields one byte per lane, MSB first */
+		x = 0;
+		for (b = 0; b < 8; b++)
+			x |= ((o[b] >> (8 * g)) & 0xff) << (8 * (7 - b));
+		x = _a5_12_transpose8(x);
+
+		for (c = 0; c < 8; c++) {
+			l = 8 * g + c;
+			if (l < num && out[l])
+				out[l][k] = (x >> (8 * c)) & mask;
+		}
+	}
+}
+
 
 /* ------------------------------------------------------------------------ */
 /* A5/1                                                                     */
@@ -201,20 +371,21 @@ _a5_1_get_output(uint32_t r[])
 		(r[2] >> (A5_R3_LEN-1));
 }
 
-/*! Generate a GSM A5/1 cipher stream
+/*! Generate a GSM A5/1 cipher stream as packed bits
  *  \param[in] key 8 byte array for the key (as received from the SIM)
  *  \param[in] fn Frame number
- *  \param[out] dl Pointer to array of ubits to return Downlink cipher stream
- *  \param[out] ul Pointer to array of ubits to return Uplink cipher stream
+ *  \param[out] dl Pointer to 15 bytes to return Downlink cipher stream
+ *  \param[out] ul Pointer to 15 bytes to return Uplink cipher stream
  *
  * Either (or both) of dl/ul can be NULL if not needed.
  */
-void
-_a5_1(const uint8_t *key, uint32_t fn, ubit_t *dl, ubit_t *ul)
+static void
+_a5_1_pbits(const uint8_t *key, uint32_t fn, pbit_t *dl, pbit_t *ul)
 {
 	uint32_t r[3] = {0, 0, 0};
 	uint32_t fn_count;
 	uint32_t b;
+	uint8_t acc = 0;
 	int i;
 
 	/* Key load */
@@ -253,16 +424,113 @@ _a5_1(const uint8_t *key, uint32_t fn, ubit_t *dl, ubit_t *ul)
 	for (i=0; i<114; i++) {
 		_a5_1_clock(r, 0);
 		if (dl)
-			dl[i] = _a5_1_get_output(r);
+			_a5_12_put_bit(&acc, dl, i, _a5_1_get_output(r));
 	}
 
+	/* The uplink stream follows the downlink one */
+	if (!ul)
+		return;
+
 	for (i=0; i<114; i++) {
 		_a5_1_clock(r, 0);
-		if (ul)
-			ul[i] = _a5_1_get_output(r);
+		_a5_12_put_bit(&acc, ul, i, _a5_1_get_output(r));
 	}
 }
 
+/*! Generate a GSM A5/1 cipher stream
+ *  \param[in] key 8 byte array for the key (as received from the SIM)
+ *  \param[in] fn Frame number
+ *  \param[out] dl Pointer to array of ubits to return Downlink cipher stream
+ *  \param[out] ul Pointer to array of ubits to return Uplink cipher stream
+ *
+ * Either (or both) of dl/ul can be NULL if not needed.
+ */
+void
+_a5_1(const uint8_t *key, uint32_t fn, ubit_t *dl, ubit_t *ul)
+{
+	pbit_t dl_p[15], ul_p[15];
+
+	_a5_1_pbits(key, fn, dl ? dl_p : NULL, ul ? ul_p : NULL);
+
+	if (dl)
+		osmo_pbit2ubit(dl, dl_p, 114);
+	if (ul)
+		osmo_pbit2ubit(ul, ul_p, 114);
+}
+
+/*! Clock a bitsliced A5/1 state
+ *  \param[inout] s Bitsliced state
+ *  \param[in] force Lanes in which the conditional clocking is disabled
+ */
+static inline void
+_a5_1_slice_clock(struct a5_12_slices *s, uint64_t force)
+{
+	uint64_t cb1 = s->r1[8], cb2 = s->r2[10], cb3 = s->r3[10];
+	uint64_t maj = _a5_12_slice_majority(cb1, cb2, cb3);
+
+	_a5_12_slice_clock(s->r1, A5_R1_LEN, A5_R1_SLICE_FB(s->r1), force | ~(cb1 ^ maj));
+	_a5_12_slice_clock(s->r2, A5_R2_LEN, A5_R2_SLICE_FB(s->r2), force | ~(cb2 ^ maj));
+	_a5_12_slice_clock(s->r3, A5_R3_LEN, A5_R3_SLICE_FB(s->r3), force | ~(cb3 ^ maj));
+}
+
+static inline uint64_t
+_a5_1_slice_output(const struct a5_12_slices *s)
+{
+	return s->r1[A5_R1_LEN-1] ^ s->r2[A5_R2_LEN-1] ^ s->r3[A5_R3_LEN-1];
+}
+
+/*! Generate the A5/1 cipher streams of up to 64 instances at once
+ *  \param[in] num Number of instances (up to A5_LANES)
+ *  \param[in] keys 8 byte keys, one per instance
+ *  \param[in] fns Frame numbers, one per instance
+ *  \param[out] dl Downlink cipher streams (15 bytes), can be NULL
+ *  \param[out] ul Uplink cipher streams (15 bytes), can be NULL
+ */
+static void
+_a5_1_slice(unsigned int num, const uint8_t * const *keys, const uint32_t *fns,
+	    pbit_t * const *dl, pbit_t * const *ul)
+{
+	struct a5_12_slices s;
+	uint64_t kb[64 + 22], o[8];
+	int i;
+
+	memset(&s, 0, sizeof(s));
+	_a5_12_slice_load_bits(num, keys, fns, kb);
+
+	/* Key and frame count load */
+	for (i = 0; i < 64 + 22; i++) {
+		_a5_1_slice_clock(&s, ~0ULL);
+		s.r1[0] ^= kb[i];
+		s.r2[0] ^= kb[i];
+		s.r3[0] ^= kb[i];
+	}
+
+	/* Mix */
+	for (i = 0; i < 100; i++)
+		_a5_1_slice_clock(&s, 0);
+
+	/* Output */
+	for (i = 0; i < 114; i++) {
+		_a5_1_slice_clock(&s, 0);
+		o[i & 7] = _a5_1_slice_output(&s);
+		if (dl && (i & 7) == 7)
+			_a5_12_slice_store(o, num, dl, i >> 3, 0xff);
+	}
+	if (dl)
+		_a5_12_slice_store(o, num, dl, 14, 0xc0);
+
+	if (!ul)
+		return;
+
+	for (i = 0; i < 114; i++) {
+		_a5_1_slice_clock(&s, 0);
+		o[i & 7] = _a5_1_slice_output(&s);
+		if ((i & 7) == 7)
+			_a5_12_slice_store(o, num, ul, i >> 3, 0xff);
+	}
+	_a5_12_slice_store(o, num, ul, 14, 0xc0);
+}
+
 void osmo_a5_1(const uint8_t *key, uint32_t fn, ubit_t *dl, ubit_t *ul)
 {
 	osmo_a5(1, key, fn, dl, ul);
@@ -322,20 +590,21 @@ _a5_2_get_output(uint32_t r[])
 	return b;
 }
 
-/*! Generate a GSM A5/1 cipher stream
+/*! Generate a GSM A5/2 cipher stream as packed bits
  *  \param[in] key 8 byte array for the key (as received from the SIM)
  *  \param[in] fn Frame number
- *  \param[out] dl Pointer to array of ubits to return Downlink cipher stream
- *  \param[out] ul Pointer to array of ubits to return Uplink cipher stream
+ *  \param[out] dl Pointer to 15 bytes to return Downlink cipher stream
+ *  \param[out] ul Pointer to 15 bytes to return Uplink cipher stream
  *
  * Either (or both) of dl/ul can be NULL if not needed.
  */
-void
-_a5_2(const uint8_t *key, uint32_t fn, ubit_t *dl, ubit_t *ul)
+static void
+_a5_2_pbits(const uint8_t *key, uint32_t fn, pbit_t *dl, pbit_t *ul)
 {
 	uint32_t r[4] = {0, 0, 0, 0};
 	uint32_t fn_count;
 	uint32_t b;
+	uint8_t acc = 0;
 	int i;
 
 	/* Key load */
@@ -381,16 +650,123 @@ _a5_2(const uint8_t *key, uint32_t fn, ubit_t *dl, ubit_t *ul)
 	for (i=0; i<114; i++) {
 		_a5_2_clock(r, 0);
 		if (dl)
-			dl[i] = _a5_2_get_output(r);
+			_a5_12_put_bit(&acc, dl, i, _a5_2_get_output(r));
 	}
 
+	/* The uplink stream follows the downlink one */
+	if (!ul)
+		return;
+
 	for (i=0; i<114; i++) {
 		_a5_2_clock(r, 0);
-		if (ul)
-			ul[i] = _a5_2_get_output(r);
+		_a5_12_put_bit(&acc, ul, i, _a5_2_get_output(r));
 	}
 }
 
+/*! Generate a GSM A5/2 cipher stream
+ *  \param[in] key 8 byte array for the key (as received from the SIM)
+ *  \param[in] fn Frame number
+ *  \param[out] dl Pointer to array of ubits to return Downlink cipher stream
+ *  \param[out] ul Pointer to array of ubits to return Uplink cipher stream
+ *
+ * Either (or both) of dl/ul can be NULL if not needed.
+ */
+void
+_a5_2(const uint8_t *key, uint32_t fn, ubit_t *dl, ubit_t *ul)
+{
+	pbit_t dl_p[15], ul_p[15];
+
+	_a5_2_pbits(key, fn, dl ? dl_p : NULL, ul ? ul_p : NULL);
+
+	if (dl)
+		osmo_pbit2ubit(dl, dl_p, 114);
+	if (ul)
+		osmo_pbit2ubit(ul, ul_p, 114);
+}
+
+/*! Clock a bitsliced A5/2 state
+ *  \param[inout] s Bitsliced state
+ *  \param[in] force Lanes in which the conditional clocking is disabled
+ */
+static inline void
+_a5_2_slice_clock(struct a5_12_slices *s, uint64_t force)
+{
+	uint64_t cb1 = s->r4[10], cb2 = s->r4[3], cb3 = s->r4[7];
+	uint64_t maj = _a5_12_slice_majority(cb1, cb2, cb3);
+
+	_a5_12_slice_clock(s->r1, A5_R1_LEN, A5_R1_SLICE_FB(s->r1), force | ~(cb1 ^ maj));
+	_a5_12_slice_clock(s->r2, A5_R2_LEN, A5_R2_SLICE_FB(s->r2), force | ~(cb2 ^ maj));
+	_a5_12_slice_clock(s->r3, A5_R3_LEN, A5_R3_SLICE_FB(s->r3), force | ~(cb3 ^ maj));
+	_a5_12_slice_clock(s->r4, A5_R4_LEN, A5_R4_SLICE_FB(s->r4), ~0ULL);
+}
+
+static inline uint64_t
+_a5_2_slice_output(const struct a5_12_slices *s)
+{
+	return s->r1[A5_R1_LEN-1] ^ s->r2[A5_R2_LEN-1] ^ s->r3[A5_R3_LEN-1] ^
+	       _a5_12_slice_majority( s->r1[15], ~s->r1[14],  s->r1[12]) ^
+	       _a5_12_slice_majority(~s->r2[16],  s->r2[13],  s->r2[9]) ^
+	       _a5_12_slice_majority( s->r3[18],  s->r3[16], ~s->r3[13]);
+}
+
+/*! Generate the A5/2 cipher streams of up to 64 instances at once
+ *  \param[in] num Number of instances (up to A5_LANES)
+ *  \param[in] keys 8 byte keys, one per instance
+ *  \param[in] fns Frame numbers, one per instance
+ *  \param[out] dl Downlink cipher streams (15 bytes), can be NULL
+ *  \param[out] ul Uplink cipher streams (15 bytes), can be NULL
+ */
+static void
+_a5_2_slice(unsigned int num, const uint8_t * const *keys, const uint32_t *fns,
+	    pbit_t * const *dl, pbit_t * const *ul)
+{
+	struct a5_12_slices s;
+	uint64_t kb[64 + 22], o[8];
+	int i;
+
+	memset(&s, 0, sizeof(s));
+	_a5_12_slice_load_bits(num, keys, fns, kb);
+
+	/* Key and frame count load */
+	for (i = 0; i < 64 + 22; i++) {
+		_a5_2_slice_clock(&s, ~0ULL);
+		s.r1[0] ^= kb[i];
+		s.r2[0] ^= kb[i];
+		s.r3[0] ^= kb[i];
+		s.r4[0] ^= kb[i];
+	}
+
+	s.r1[15] = ~0ULL;
+	s.r2[16] = ~0ULL;
+	s.r3[18] = ~0ULL;
+	s.r4[10] = ~0ULL;
+
+	/* Mix */
+	for (i = 0; i < 99; i++)
+		_a5_2_slice_clock(&s, 0);
+
+	/* Output */
+	for (i = 0; i < 114; i++) {
+		_a5_2_slice_clock(&s, 0);
+		o[i & 7] = _a5_2_slice_output(&s);
+		if (dl && (i & 7) == 7)
+			_a5_12_slice_store(o, num, dl, i >> 3, 0xff);
+	}
+	if (dl)
+		_a5_12_slice_store(o, num, dl, 14, 0xc0);
+
+	if (!ul)
+		return;
+
+	for (i = 0; i < 114; i++) {
+		_a5_2_slice_clock(&s, 0);
+		o[i & 7] = _a5_2_slice_output(&s);
+		if ((i & 7) == 7)
+			_a5_12_slice_store(o, num, ul, i >> 3, 0xff);
+	}
+	_a5_12_slice_store(o, num, ul, 14, 0xc0);
+}
+
 void osmo_a5_2(const uint8_t *key, uint32_t fn, ubit_t *dl, ubit_t *ul)
 {
 	osmo_a5(2, key, fn, dl, ul);
@@ -443,4 +819,103 @@ osmo_a5(int n, const uint8_t *key, uint32_t fn, ubit_t *dl, ubit_t *ul)
 	return 0;
 }
 
+/*! Generate a A5/x cipher stream as packed bits
+ *  \param[in] n Which A5/x method to use
+ *  \param[in] key 8 or 16 (for a5/4) byte array for the key (as received from the SIM)
+ *  \param[in] fn Frame number
+ *  \param[out] dl Pointer to 15 bytes to return Downlink cipher stream
+ *  \param[out] ul Pointer to 15 bytes to return Uplink cipher stream
+ *  \returns 0 for success, -ENOTSUP for invalid cipher selection.
+ *
+ * Same as osmo_a5(), but the 114 bits of each stream are packed MSB first
+ * and the last 6 bits of the 15th byte are zero, so the stream can be XORed
+ * onto a packed burst a byte at a time.
+ * Either (or both) of dl/ul can be NULL if not needed.
+ */
+int
+osmo_a5_pbits(int n, const uint8_t *key, uint32_t fn, pbit_t *dl, pbit_t *ul)
+{
+	switch (n)
+	{
+	case 0:
+		if (dl)
+			memset(dl, 0x00, 15);
+		if (ul)
+			memset(ul, 0x00, 15);
+		break;
+
+	case 1:
+		_a5_1_pbits(key, fn, dl, ul);
+		break;
+
+	case 2:
+		_a5_2_pbits(key, fn, dl, ul);
+		break;
+
+	case 3:
+		_a5_3_pbits(key, fn, dl, ul, true);
+		break;
+
+	case 4:
+		_a5_4_pbits(key, fn, dl, ul, true);
+		break;
+
+	default:
+		/* a5/[5..7] not supported here/yet */
+		return -ENOTSUP;
+	}
+
+	return 0;
+}
+
+/*! Generate the A5/x cipher streams of many (key, frame number) pairs
+ *  \param[in] n Which A5/x method to use
+ *  \param[in] num Number of cipher streams to generate
+ *  \param[in] keys Array of num keys, see osmo_a5()
+ *  \param[in] fns Array of num frame numbers
+ *  \param[out] dl Array of num pointers to 15 bytes to return the packed Downlink cipher streams
+ *  \param[out] ul Array of num pointers to 15 bytes to return the packed Uplink cipher streams
+ *  \returns 0 for success, -ENOTSUP for invalid cipher selection.
+ *
+ * The result is the same as calling osmo_a5_pbits() for each pair, but A5/1
+ * and A5/2 are computed bitsliced, 64 streams at a time, which is several
+ * times faster per stream.
+ * Either (or both) of dl/ul, as well as individual entries, can be NULL if
+ * not needed.
+ */
+int
+osmo_a5_batch(int n, unsigned int num, const uint8_t * const *keys,
+	      const uint32_t *fns, pbit_t * const *dl, pbit_t * const *ul)
+{
+	unsigned int i, cnt;
+
+	switch (n)
+	{
+	case 1:
+	case 2:
+		for (i = 0; i < num; i += cnt) {
+			cnt = num - i < A5_LANES ? num - i : A5_LANES;
+			if (n == 1)
+				_a5_1_slice(cnt, &keys[i], &fns[i], dl ? &dl[i] : NULL, ul ? &ul[i] : NULL);
+			else
+				_a5_2_slice(cnt, &keys[i], &fns[i], dl ? &dl[i] : NULL, ul ? &ul[i] : NULL);
+		}
+		break;
+
+	case 0:
+	case 3:
+	case 4:
+		for (i = 0; i < num; i++)
+			osmo_a5_pbits(n, keys ? keys[i] : NULL, fns[i],
+				      dl ? dl[i] : NULL, ul ? ul[i] : NULL);
+		break;
+
+	default:
+		/* a5/[5..7] not supported here/yet */
+		return -ENOTSUP;
+	}
+
+	return 0;
+}
+
 /*! @} */
@@ -172,6 +172,77 @@ int osmo_auth_gen_vec(struct osmo_auth_vector *vec,
 	return 0;
 }
 
+/*! Generate a number of authentication vectors for one subscriber
+ *  \param[out] vec Array of num generated authentication vectors
+ *  \param[in] aud Subscriber-specific key material
+ *  \param[in] _rand num random challenges of 16 bytes each, back to back
+ *  \param[in] num Number of vectors to generate
+ *  \returns 0 on success, negative error on failure
+ *
+ * Gives the same vectors as num calls of osmo_auth_gen_vec(), including
+ * the progression of the sequence number in aud. Implementations that
+ * support it set up the subscriber key once and compute the vectors
+ * together, which is considerably faster than separate calls when an
+ * AUC pre-generates several vectors per request.
+ */
+int osmo_auth_gen_vec_batch(struct osmo_auth_vector *vec,
+			    struct osmo_sub_auth_data *aud,
+			    const uint8_t *_rand, unsigned int num)
+{
+	struct osmo_auth_impl *impl = selected_auths[aud->algo];
+	unsigned int i;
+	int rc;
+
+	if (!impl)
+		return -ENOENT;
+
+	if (impl->gen_vec_batch) {
+		rc = impl->gen_vec_batch(vec, aud, _rand, num);
+		if (rc < 0)
+			return rc;
+	} else {
+		for (i = 0; i < num; i++) {
+			rc = impl->gen_vec(&vec[i], aud, &_rand[16 * i]);
+			if (rc < 0)
+				return rc;
+		}
+	}
+
+	for (i = 0; i < num; i++)
+		memcpy(vec[i].rand, &_rand[16 * i], sizeof(vec[i].rand));
+
+	return 0;
+}
+
+/*! Generate authentication vectors for a number of subscribers
+ *  \param[out] vec Array of num generated authentication vectors
+ *  \param[in] aud Array of num pointers to subscriber-specific key material
+ *  \param[in] _rand num random challenges of 16 bytes each, back to back
+ *  \param[in] num Number of vectors to generate
+ *  \returns 0 on success, negative error on failure
+ *
+ * vec[i] is generated for aud[i]. Consecutive entries pointing to the same
+ * subscriber are passed to osmo_auth_gen_vec_batch() together. On failure,
+ * the vectors before the failing subscriber have been generated.
+ */
+int osmo_auth_gen_vecs(struct osmo_auth_vector *vec,
+		       struct osmo_sub_auth_data **aud,
+		       const uint8_t *_rand, unsigned int num)
+{
+	unsigned int i, n;
+	int rc;
+
+	for (i = 0; i < num; i += n) {
+		for (n = 1; i + n < num && aud[i + n] == aud[i]; n++);
+
+		rc = osmo_auth_gen_vec_batch(&vec[i], aud[i], &_rand[16 * i], n);
+		if (rc < 0)
+			return rc;
+	}
+
+	return 0;
+}
+
 /*! Generate authentication vector and re-sync sequence
  *  \param[out] vec Generated authentication vector
  *  \param[in] aud Subscriber-specific key material
@@ -26,6 +26,7 @@
 #include <osmocom/crypt/auth.h>
 #include <osmocom/core/bits.h>
 #include "milenage/common.h"
+#include "milenage/aes.h"
 #include "milenage/milenage.h"
 
 /*! \addtogroup auth
@@ -46,17 +47,22 @@ static const uint8_t *gen_opc_if_needed(const struct osmo_sub_auth_data *aud, ui
 		return aud->u.umts.opc;
 }
 
-static int milenage_gen_vec(struct osmo_auth_vector *vec,
-			    struct osmo_sub_auth_data *aud,
-			    const uint8_t *_rand)
+static int milenage_gen_vec_batch(struct osmo_auth_vector *vec,
+				  struct osmo_sub_auth_data *aud,
+				  const uint8_t *_rand, unsigned int num)
 {
-	size_t res_len = sizeof(vec->res);
+	struct aes_128_enc_key k;
+	uint8_t sqn[MILENAGE_MULTI][6];
+	uint8_t autn[MILENAGE_MULTI][16];
+	uint8_t ik[MILENAGE_MULTI][16];
+	uint8_t ck[MILENAGE_MULTI][16];
+	uint8_t res[MILENAGE_MULTI][8];
 	uint64_t next_sqn;
 	uint8_t gen_opc[16];
 	const uint8_t *opc;
-	uint8_t sqn[6];
 	uint64_t ind_mask;
 	uint64_t seq_1;
+	unsigned int i, n;
 	int rc;
 
 	opc = gen_opc_if_needed(aud, gen_opc);
@@ -112,6 +118,9 @@ static int milenage_gen_vec(struct osmo_auth_vector *vec,
 	 * be sure that this code will increment SQN by exactly one before
 	 * generating a tuple, thus a caller would simply pass
 	 * { .ind_bitlen = 0, .ind = 0, .sqn = (desired_sqn - 1) }
+	 *
+	 * A batch of num vectors gets the num SQNs that num calls for a single
+	 * vector would have used, in the same order.
 	 */
 
 	if (aud->u.umts.ind_bitlen > OSMO_MILENAGE_IND_BITLEN_MAX)
@@ -124,19 +133,43 @@ static int milenage_gen_vec(struct osmo_auth_vector *vec,
 	if (aud->u.umts.ind >= seq_1)
 		return -3;
 
-	/* keep the incremented SQN local until gsm_milenage() succeeded. */
-	next_sqn = ((aud->u.umts.sqn + seq_1) & ind_mask) + aud->u.umts.ind;
-
-	osmo_store64be_ext(next_sqn, sqn, 6);
-	milenage_generate(opc, aud->u.umts.amf, aud->u.umts.k,
-			  sqn, _rand,
-			  vec->autn, vec->ik, vec->ck, vec->res, &res_len);
-	vec->res_len = res_len;
-	rc = gsm_milenage(opc, aud->u.umts.k, _rand, vec->sres, vec->kc);
-	if (rc < 0)
-		return rc;
-
-	vec->auth_types = OSMO_AUTH_TYPE_UMTS | OSMO_AUTH_TYPE_GSM;
+	/* K is expanded once for all AES blocks of all vectors */
+	aes_128_enc_key_setup(&k, aud->u.umts.k);
+
+	/* keep the incremented SQN local until all vectors are generated */
+	next_sqn = aud->u.umts.sqn;
+
+	for (; num; num -= n, vec += n, _rand += 16 * n) {
+		n = num < MILENAGE_MULTI ? num : MILENAGE_MULTI;
+
+		for (i = 0; i < n; i++) {
+			next_sqn = ((next_sqn + seq_1) & ind_mask) + aud->u.umts.ind;
+			osmo_store64be_ext(next_sqn, sqn[i], 6);
+		}
+
+		rc = milenage_generate_multi(opc, aud->u.umts.amf, &k, sqn[0],
+					     _rand, autn[0], ik[0], ck[0],
+					     res[0], n);
+		if (rc < 0) {
+			aes_128_enc_key_clear(&k);
+			return rc;
+		}
+
+		for (i = 0; i < n; i++) {
+			memcpy(vec[i].autn, autn[i], sizeof(vec[i].autn));
+			memcpy(vec[i].ik, ik[i], sizeof(vec[i].ik));
+			memcpy(vec[i].ck, ck[i], sizeof(vec[i].ck));
+			memcpy(vec[i].res, res[i], sizeof(res[i]));
+			vec[i].res_len = sizeof(res[i]);
+			gsm_milenage_from_umts(res[i], ck[i], ik[i],
+					       vec[i].sres, vec[i].kc);
+			vec[i].auth_types = OSMO_AUTH_TYPE_UMTS | OSMO_AUTH_TYPE_GSM;
+		}
+	}
+
+	aes_128_enc_key_clear(&k);
+	memset(ik, 0, sizeof(ik));
+	memset(ck, 0, sizeof(ck));
 
 	/* for storage in the caller's AUC database */
 	aud->u.umts.sqn = next_sqn;
@@ -144,6 +177,13 @@ static int milenage_gen_vec(struct osmo_auth_vector *vec,
 	return 0;
 }
 
+static int milenage_gen_vec(struct osmo_auth_vector *vec,
+			    struct osmo_sub_auth_data *aud,
+			    const uint8_t *_rand)
+{
+	return milenage_gen_vec_batch(vec, aud, _rand, 1);
+}
+
 static int milenage_gen_vec_auts(struct osmo_auth_vector *vec,
 				 struct osmo_sub_auth_data *aud,
 				 const uint8_t *auts, const uint8_t *rand_auts,
@@ -174,6 +214,7 @@ static struct osmo_auth_impl milenage_alg = {
 	.priority = 1000,
 	.gen_vec = &milenage_gen_vec,
 	.gen_vec_auts = &milenage_gen_vec_auts,
+	.gen_vec_batch = &milenage_gen_vec_batch,
 };
 
 static __attribute__((constructor)) void on_dso_load_milenage(void)
@@ -22,7 +22,9 @@
 #include <osmocom/crypt/gprs_cipher.h>
 #include <osmocom/crypt/auth.h>
 #include <osmocom/gsm/kasumi.h>
+#include <osmocom/gsm/gea.h>
 
+#include <errno.h>
 #include <stdint.h>
 #include <string.h>
 
@@ -60,4 +62,78 @@ int gea3(uint8_t *out, uint16_t len, uint8_t *kc, uint32_t iv,
 	return gea4(out, len, ck, iv, direction);
 }
 
+/*! Initialize a GEA3/GEA4 context for a ciphering key
+ *  \param[out] ctx Context to initialize
+ *  \param[in] algo GPRS_ALGO_GEA3 or GPRS_ALGO_GEA4
+ *  \param[in] kc Buffer with the ciphering key, see gprs_cipher_key_length()
+ *  \returns 0 on success, -ENOTSUP for any other algorithm
+ *
+ * The KASUMI key schedule (and for GEA3 the key expansion by osmo_c4()) is
+ * computed once here instead of for every keystream, so keep the context
+ * around for as long as the key is in use, e.g. per LLME.
+ */
+int osmo_gea_ctx_init(struct osmo_gea_ctx *ctx, enum gprs_ciph_algo algo,
+		      const uint8_t *kc)
+{
+	uint8_t ck[16];
+
+	switch (algo) {
+	case GPRS_ALGO_GEA3:
+		osmo_c4(ck, kc);
+		break;
+	case GPRS_ALGO_GEA4:
+		memcpy(ck, kc, sizeof(ck));
+		break;
+	default:
+		return -ENOTSUP;
+	}
+
+	ctx->algo = algo;
+	_kasumi_kgcore_init(&ctx->key, ck);
+
+	return 0;
+}
+
+/*! Performs the GEA3/GEA4 algorithm with a context, see gea3() and gea4()
+ *  \param[in] ctx Context set up by osmo_gea_ctx_init()
+ *  \param[out] out Buffer for gamma for encrypted/decrypted
+ *  \param[in] len Length of out, in bytes
+ *  \param[in] iv Init vector
+ *  \param[in] direction Direction: 0 (MS -> SGSN) or 1 (SGSN -> MS)
+ */
+int osmo_gea_ctx_run(const struct osmo_gea_ctx *ctx, uint8_t *out, uint16_t len,
+		     uint32_t iv, enum gprs_cipher_direction direction)
+{
+	_kasumi_kgcore_run(&ctx->key, 0xFF, 0, iv, direction, out, len * 8);
+	return 0;
+}
+
+/*! Performs the GEA3/GEA4 algorithm for several keystreams of one context
+ *  \param[in] ctx Context set up by osmo_gea_ctx_init()
+ *  \param[in] reqs Array of keystream requests
+ *  \param[in] num Number of requests
+ *
+ * Same as calling osmo_gea_ctx_run() for each request, but the keystreams are
+ * computed several at a time, which is faster for a queue of LLC frames.
+ */
+int osmo_gea_ctx_run_batch(const struct osmo_gea_ctx *ctx,
+			   const struct osmo_gea_req *reqs, unsigned int num)
+{
+	struct osmo_kgcore_req kreqs[16];
+	unsigned int i, n;
+
+	for (; num > 0; num -= n, reqs += n) {
+		n = num < ARRAY_SIZE(kreqs) ? num : ARRAY_SIZE(kreqs);
+		for (i = 0; i < n; i++) {
+			kreqs[i].cc = reqs[i].iv;
+			kreqs[i].cd = reqs[i].direction;
+			kreqs[i].co = reqs[i].out;
+			kreqs[i].cl = reqs[i].len * 8;
+		}
+		_kasumi_kgcore_run_multi(&ctx->key, 0xFF, 0, kreqs, n);
+	}
+
+	return 0;
+}
+
 /*! @} */
@@ -27,73 +27,85 @@
 #include <osmocom/gsm/kasumi.h>
 
 /* See TS 135 202 for constants and full Kasumi spec. */
-inline static uint16_t kasumi_FI(uint16_t I, uint16_t skey)
-{
-	static const uint16_t S7[] = {
-		54, 50, 62, 56, 22, 34, 94, 96, 38, 6, 63, 93, 2, 18, 123, 33,
-		55, 113, 39, 114, 21, 67, 65, 12, 47, 73, 46, 27, 25, 111, 124, 81,
-		53, 9, 121, 79, 52, 60, 58, 48, 101, 127, 40, 120, 104, 70, 71, 43,
-		20, 122, 72, 61, 23, 109, 13, 100, 77, 1, 16, 7, 82, 10, 105, 98,
-		117, 116, 76, 11, 89, 106, 0,125,118, 99, 86, 69, 30, 57, 126, 87,
-		112, 51, 17, 5, 95, 14, 90, 84, 91, 8, 35,103, 32, 97, 28, 66,
-		102, 31, 26, 45, 75, 4, 85, 92, 37, 74, 80, 49, 68, 29, 115, 44,
-		64, 107, 108, 24, 110, 83, 36, 78, 42, 19, 15, 41, 88, 119, 59, 3
-	};
-	static const uint16_t S9[] = {
-		167, 239, 161, 379, 391, 334,  9, 338, 38, 226, 48, 358, 452, 385, 90, 397,
-		183, 253, 147, 331, 415, 340, 51, 362, 306, 500, 262, 82, 216, 159, 356, 177,
-		175, 241, 489, 37, 206, 17, 0, 333, 44, 254, 378, 58, 143, 220, 81, 400,
-		95, 3, 315, 245, 54, 235, 218, 405, 472, 264, 172, 494, 371, 290, 399, 76,
-		165, 197, 395, 121, 257, 480, 423, 212, 240, 28, 462, 176, 406, 507, 288, 223,
-		501, 407, 249, 265, 89, 186, 221, 428,164, 74, 440, 196, 458, 421, 350, 163,
-		232, 158, 134, 354, 13, 250, 491, 142,191, 69, 193, 425, 152, 227, 366, 135,
-		344, 300, 276, 242, 437, 320, 113, 278, 11, 243, 87, 317, 36, 93, 496, 27,
-		487, 446, 482, 41, 68, 156, 457, 131, 326, 403, 339, 20, 39, 115, 442, 124,
-		475, 384, 508, 53, 112, 170, 479, 151, 126, 169, 73, 268, 279, 321, 168, 364,
-		363, 292, 46, 499, 393, 327, 324, 24, 456, 267, 157, 460, 488, 426, 309, 229,
-		439, 506, 208, 271, 349, 401, 434, 236, 16, 209, 359, 52, 56, 120, 199, 277,
-		465, 416, 252, 287, 246,  6, 83, 305, 420, 345, 153,502, 65, 61, 244, 282,
-		173, 222, 418, 67, 386, 368, 261, 101, 476, 291, 195,430, 49, 79, 166, 330,
-		280, 383, 373, 128, 382, 408, 155, 495, 367, 388, 274, 107, 459, 417, 62, 454,
-		132, 225, 203, 316, 234, 14, 301, 91, 503, 286, 424, 211, 347, 307, 140, 374,
-		35, 103, 125, 427, 19, 214, 453, 146, 498, 314, 444, 230, 256, 329, 198, 285,
-		50, 116, 78, 410, 10, 205, 510, 171, 231, 45, 139, 467, 29, 86, 505, 32,
-		72, 26, 342, 150, 313, 490, 431, 238, 411, 325, 149, 473, 40, 119, 174, 355,
-		185, 233, 389, 71, 448, 273, 372, 55, 110, 178, 322, 12, 469, 392, 369, 190,
-		1, 109, 375, 137, 181, 88, 75, 308, 260, 484, 98, 272, 370, 275, 412, 111,
-		336, 318, 4, 504, 492, 259, 304, 77, 337, 435, 21, 357, 303, 332, 483, 18,
-		47, 85, 25, 497, 474, 289, 100, 269, 296, 478, 270, 106, 31, 104, 433, 84,
-		414, 486, 394, 96, 99, 154, 511, 148, 413, 361, 409, 255, 162, 215, 302, 201,
-		266, 351, 343, 144, 441, 365, 108, 298, 251, 34, 182, 509, 138, 210, 335, 133,
-		311, 352, 328, 141, 396, 346, 123, 319, 450, 281, 429, 228, 443, 481, 92, 404,
-		485, 422, 248, 297, 23, 213, 130, 466, 22, 217, 283, 70, 294, 360, 419, 127,
-		312, 377, 7, 468, 194, 2, 117, 295, 463, 258, 224, 447, 247, 187, 80, 398,
-		284, 353, 105, 390, 299, 471, 470, 184, 57, 200, 348, 63, 204, 188, 33, 451,
-		97, 30, 310, 219, 94, 160, 129, 493, 64, 179, 263, 102, 189, 207, 114, 402,
-		438, 477, 387, 122, 192, 42, 381, 5, 145, 118, 180, 449, 293, 323, 136, 380,
-		43, 66, 60, 455, 341, 445, 202, 432, 8, 237, 15, 376, 436, 464, 59, 461
-	};
-	uint16_t L, R;
-
-	/* Split 16 bit input into two unequal halves: 9 and 7 bits, same for subkey */
-	L = I >> 7; /* take 9 bits */
-	R = I & 0x7F; /* take 7 bits */
-
-	L = S9[L]  ^ R;
-	R = S7[R] ^ (L & 0x7F);
-
-	L ^= (skey & 0x1FF);
-	R ^= (skey >> 9);
-
-	L = S9[L]  ^ R;
-	R = S7[R] ^ (L & 0x7F);
-
-	return (R << 9) + L;
+static const uint16_t S7[128] = {
+	54, 50, 62, 56, 22, 34, 94, 96, 38, 6, 63, 93, 2, 18, 123, 33,
+	55, 113, 39, 114, 21, 67, 65, 12, 47, 73, 46, 27, 25, 111, 124, 81,
+	53, 9, 121, 79, 52, 60, 58, 48, 101, 127, 40, 120, 104, 70, 71, 43,
+	20, 122, 72, 61, 23, 109, 13, 100, 77, 1, 16, 7, 82, 10, 105, 98,
+	117, 116, 76, 11, 89, 106, 0,125,118, 99, 86, 69, 30, 57, 126, 87,
+	112, 51, 17, 5, 95, 14, 90, 84, 91, 8, 35,103, 32, 97, 28, 66,
+	102, 31, 26, 45, 75, 4, 85, 92, 37, 74, 80, 49, 68, 29, 115, 44,
+	64, 107, 108, 24, 110, 83, 36, 78, 42, 19, 15, 41, 88, 119, 59, 3
+};
+
+static const uint16_t S9[512] = {
+	167, 239, 161, 379, 391, 334,  9, 338, 38, 226, 48, 358, 452, 385, 90, 397,
+	183, 253, 147, 331, 415, 340, 51, 362, 306, 500, 262, 82, 216, 159, 356, 177,
+	175, 241, 489, 37, 206, 17, 0, 333, 44, 254, 378, 58, 143, 220, 81, 400,
+	95, 3, 315, 245, 54, 235, 218, 405, 472, 264, 172, 494, 371, 290, 399, 76,
+	165, 197, 395, 121, 257, 480, 423, 212, 240, 28, 462, 176, 406, 507, 288, 223,
+	501, 407, 249, 265, 89, 186, 221, 428,164, 74, 440, 196, 458, 421, 350, 163,
+	232, 158, 134, 354, 13, 250, 491, 142,191, 69, 193, 425, 152, 227, 366, 135,
+	344, 300, 276, 242, 437, 320, 113, 278, 11, 243, 87, 317, 36, 93, 496, 27,
+	487, 446, 482, 41, 68, 156, 457, 131, 326, 403, 339, 20, 39, 115, 442, 124,
+	475, 384, 508, 53, 112, 170, 479, 151, 126, 169, 73, 268, 279, 321, 168, 364,
+	363, 292, 46, 499, 393, 327, 324, 24, 456, 267, 157, 460, 488, 426, 309, 229,
+	439, 506, 208, 271, 349, 401, 434, 236, 16, 209, 359, 52, 56, 120, 199, 277,
+	465, 416, 252, 287, 246,  6, 83, 305, 420, 345, 153,502, 65, 61, 244, 282,
+	173, 222, 418, 67, 386, 368, 261, 101, 476, 291, 195,430, 49, 79, 166, 330,
+	280, 383, 373, 128, 382, 408, 155, 495, 367, 388, 274, 107, 459, 417, 62, 454,
+	132, 225, 203, 316, 234, 14, 301, 91, 503, 286, 424, 211, 347, 307, 140, 374,
+	35, 103, 125, 427, 19, 214, 453, 146, 498, 314, 444, 230, 256, 329, 198, 285,
+	50, 116, 78, 410, 10, 205, 510, 171, 231, 45, 139, 467, 29, 86, 505, 32,
+	72, 26, 342, 150, 313, 490, 431, 238, 411, 325, 149, 473, 40, 119, 174, 355,
+	185, 233, 389, 71, 448, 273, 372, 55, 110, 178, 322, 12, 469, 392, 369, 190,
+	1, 109, 375, 137, 181, 88, 75, 308, 260, 484, 98, 272, 370, 275, 412, 111,
+	336, 318, 4, 504, 492, 259, 304, 77, 337, 435, 21, 357, 303, 332, 483, 18,
+	47, 85, 25, 497, 474, 289, 100, 269, 296, 478, 270, 106, 31, 104, 433, 84,
+	414, 486, 394, 96, 99, 154, 511, 148, 413, 361, 409, 255, 162, 215, 302, 201,
+	266, 351, 343, 144, 441, 365, 108, 298, 251, 34, 182, 509, 138, 210, 335, 133,
+	311, 352, 328, 141, 396, 346, 123, 319, 450, 281, 429, 228, 443, 481, 92, 404,
+	485, 422, 248, 297, 23, 213, 130, 466, 22, 217, 283, 70, 294, 360, 419, 127,
+	312, 377, 7, 468, 194, 2, 117, 295, 463, 258, 224, 447, 247, 187, 80, 398,
+	284, 353, 105, 390, 299, 471, 470, 184, 57, 200, 348, 63, 204, 188, 33, 451,
+	97, 30, 310, 219, 94, 160, 129, 493, 64, 179, 263, 102, 189, 207, 114, 402,
+	438, 477, 387, 122, 192, 42, 381, 5, 145, 118, 180, 449, 293, 323, 136, 380,
+	43, 66, 60, 455, 341, 445, 202, 432, 8, 237, 15, 376, 436, 464, 59, 461
+};
+
+/* Each half of FI, S9[L] ^ R and S7[R] ^ (S9[L] ^ R) & 0x7F, is linear in
+ * R apart from S7[R], so it is split into a lookup on the 9 bit and one on
+ * the 7 bit part of the input, with the result already laid out as R << 9 | L
+ * (which is also how the subkey is split).  Both are derived from the S-boxes
+ * above on load. */
+static uint16_t FI_T9[512];
+static uint16_t FI_T7[128];
+
+static __attribute__((constructor)) void on_dso_load_kasumi(void)
+{
+	unsigned int x;
+
+	for (x = 0; x < 512; x++)
+		FI_T9[x] = (S9[x] & 0x7F) << 9 | S9[x];
+	for (x = 0; x < 128; x++)
+		FI_T7[x] = (S7[x] ^ x) << 9 | x;
+}
+
+inline static uint32_t kasumi_FI(uint32_t I, uint32_t skey)
+{
+	uint32_t X;
+
+	/* Input split into 9 and 7 bits, output and subkey as 7 and 9 bits */
+	X = FI_T9[I >> 7] ^ FI_T7[I & 0x7F] ^ skey;
+
+	return FI_T9[X & 0x1FF] ^ FI_T7[X >> 9];
 }
 
 inline static uint32_t kasumi_FO(uint32_t I, const uint16_t *KOi1, const uint16_t *KOi2, const uint16_t *KOi3, const uint16_t *KIi1, const uint16_t *KIi2, const uint16_t *KIi3, unsigned i)
 {
-	uint16_t L = I >> 16, R = I; /* Split 32 bit input into Left and Right parts */
+	/* Split 32 bit input into Left and Right parts, kept in 32 bit
+	 * variables to avoid partial register updates */
+	uint32_t L = I >> 16, R = I & 0xFFFF;
 
 	L ^= KOi1[i];
 	L = kasumi_FI(L, KIi1[i]);
@@ -107,7 +119,7 @@ inline static uint32_t kasumi_FO(uint32_t I, const uint16_t *KOi1, const uint16_
 	L = kasumi_FI(L, KIi3[i]);
 	L ^= R;
 
-	return (((uint32_t)R) << 16) + L;
+	return (R << 16) + L;
 }
 
 inline static uint32_t kasumi_FL(uint32_t I, const uint16_t *KLi1, const uint16_t *KLi2, unsigned i)
@@ -159,39 +171,160 @@ void _kasumi_key_expand(const uint8_t *key, uint16_t *KLi1, uint16_t *KLi2, uint
 	}
 }
 
-/* if cl is not multiple of 8 (a byte), co needs to be sized on the upper bound so the entire byte can be written. */
-void _kasumi_kgcore(uint8_t CA, uint8_t cb, uint32_t cc, uint8_t cd, const uint8_t *ck, uint8_t *co, uint16_t cl)
+void _kasumi_key_expand_ctx(const uint8_t *key, struct osmo_kasumi_key *k)
 {
-	uint16_t KLi1[8], KLi2[8], KOi1[8], KOi2[8], KOi3[8], KIi1[8], KIi2[8], KIi3[8], i;
-	uint64_t A = ((uint64_t)cc) << 32, BLK = 0, _ca = ((uint64_t)CA << 16) ;
-	A |= _ca;
-	_ca = (uint64_t)((cb << 3) | (cd << 2)) << 24;
-	A |= _ca;
-	/* Register loading complete: see TR 55.919 8.2 and TS 55.216 3.2 */
+	_kasumi_key_expand(key, k->KLi1, k->KLi2, k->KOi1, k->KOi2, k->KOi3, k->KIi1, k->KIi2, k->KIi3);
+}
+
+static inline uint64_t kasumi_key(uint64_t P, const struct osmo_kasumi_key *k)
+{
+	return _kasumi(P, k->KLi1, k->KLi2, k->KOi1, k->KOi2, k->KOi3, k->KIi1, k->KIi2, k->KIi3);
+}
+
+/* Number of blocks processed at once by kasumi_key_multi() */
+#define KASUMI_MULTI	4
 
+/* KASUMI on several independent blocks: each round of a single block is a
+ * chain of dependent table lookups, interleaving the rounds of several
+ * blocks lets the CPU work on the others while waiting for a lookup. */
+#define KASUMI_ODD_ROUND(L, R, k, i) \
+	R ^= kasumi_FO(kasumi_FL(L, (k)->KLi1, (k)->KLi2, i), (k)->KOi1, (k)->KOi2, (k)->KOi3, \
+		       (k)->KIi1, (k)->KIi2, (k)->KIi3, i)
+#define KASUMI_EVEN_ROUND(L, R, k, i) \
+	L ^= kasumi_FL(kasumi_FO(R, (k)->KOi1, (k)->KOi2, (k)->KOi3, (k)->KIi1, (k)->KIi2, (k)->KIi3, i), \
+		       (k)->KLi1, (k)->KLi2, i)
+
+static inline void kasumi_key_multi(uint64_t *P, const struct osmo_kasumi_key *k)
+{
+	uint32_t L0 = P[0] >> 32, R0 = P[0];
+	uint32_t L1 = P[1] >> 32, R1 = P[1];
+	uint32_t L2 = P[2] >> 32, R2 = P[2];
+	uint32_t L3 = P[3] >> 32, R3 = P[3];
+	unsigned int i;
+
+	for (i = 0; i < 8; i += 2) {
+		KASUMI_ODD_ROUND(L0, R0, k, i);
+		KASUMI_ODD_ROUND(L1, R1, k, i);
+		KASUMI_ODD_ROUND(L2, R2, k, i);
+		KASUMI_ODD_ROUND(L3, R3, k, i);
+		KASUMI_EVEN_ROUND(L0, R0, k, i + 1);
+		KASUMI_EVEN_ROUND(L1, R1, k, i + 1);
+		KASUMI_EVEN_ROUND(L2, R2, k, i + 1);
+		KASUMI_EVEN_ROUND(L3, R3, k, i + 1);
+	}
+
+	P[0] = (((uint64_t)L0) << 32) + R0;
+	P[1] = (((uint64_t)L1) << 32) + R1;
+	P[2] = (((uint64_t)L2) << 32) + R2;
+	P[3] = (((uint64_t)L3) << 32) + R3;
+}
+
+uint64_t _kasumi_ctx(uint64_t P, const struct osmo_kasumi_key *k)
+{
+	return kasumi_key(P, k);
+}
+
+void _kasumi_kgcore_init(struct osmo_kgcore_key *kk, const uint8_t *ck)
+{
 	uint8_t ck_km[16];
+	int i;
+
 	for (i = 0; i < 16; i++)
 		ck_km[i] = ck[i] ^ 0x55;
 	/* Modified key established */
 
-	/* preliminary round with modified key */
-	_kasumi_key_expand(ck_km, KLi1, KLi2, KOi1, KOi2, KOi3, KIi1, KIi2, KIi3);
-	A = _kasumi(A, KLi1, KLi2, KOi1, KOi2, KOi3, KIi1, KIi2, KIi3);
+	_kasumi_key_expand_ctx(ck_km, &kk->km);
+	_kasumi_key_expand_ctx(ck, &kk->ck);
+}
 
-	/* Run Kasumi in OFB to obtain enough data for gamma. */
-	_kasumi_key_expand(ck, KLi1, KLi2, KOi1, KOi2, KOi3, KIi1, KIi2, KIi3);
+/* Register loading: see TR 55.919 8.2 and TS 55.216 3.2 */
+static inline uint64_t kgcore_load(uint8_t CA, uint8_t cb, uint32_t cc, uint8_t cd)
+{
+	uint64_t A = ((uint64_t)cc) << 32, _ca = ((uint64_t)CA << 16) ;
+	A |= _ca;
+	_ca = (uint64_t)((cb << 3) | (cd << 2)) << 24;
+	A |= _ca;
+	return A;
+}
 
-	/* i is a block counter */
-	for (i = 0; i < cl / 64; i++) {
-		BLK = _kasumi(A ^ i ^ BLK, KLi1, KLi2, KOi1, KOi2, KOi3, KIi1, KIi2, KIi3);
+/* Store block i of the keystream, the last one can be partial */
+static inline void kgcore_store(uint8_t *co, uint16_t cl, uint16_t i, uint64_t BLK)
+{
+	if (i < cl / 64) {
 		osmo_store64be(BLK, co + (i * 8));
+		return;
 	}
 
 	/* Last 64-byte unaligned round. Take also into account last bits non-byte aligned. */
 	uint8_t bytes_remain = cl/8%8 + (cl%8 ? 1 : 0);
-	if (bytes_remain) {
-		BLK = _kasumi(A ^ (cl / 64) ^ BLK, KLi1, KLi2, KOi1, KOi2, KOi3, KIi1, KIi2, KIi3);
-		BLK = BLK >> (8-bytes_remain)*8;
-		osmo_store64be_ext(BLK, co + (cl / 64 * 8), bytes_remain);
+	BLK = BLK >> (8-bytes_remain)*8;
+	osmo_store64be_ext(BLK, co + (cl / 64 * 8), bytes_remain);
+}
+
+/* if cl is not multiple of 8 (a byte), co needs to be sized on the upper bound so the entire byte can be written. */
+void _kasumi_kgcore_run(const struct osmo_kgcore_key *kk, uint8_t CA, uint8_t cb, uint32_t cc, uint8_t cd, uint8_t *co, uint16_t cl)
+{
+	uint64_t A, BLK = 0;
+	uint16_t i;
+
+	A = kgcore_load(CA, cb, cc, cd);
+
+	/* preliminary round with modified key */
+	A = kasumi_key(A, &kk->km);
+
+	/* Run Kasumi in OFB to obtain enough data for gamma. */
+
+	/* i is a block counter */
+	for (i = 0; i < (cl + 63) / 64; i++) {
+		BLK = kasumi_key(A ^ i ^ BLK, &kk->ck);
+		kgcore_store(co, cl, i, BLK);
 	}
 }
+
+void _kasumi_kgcore_run_multi(const struct osmo_kgcore_key *kk, uint8_t CA, uint8_t cb,
+			      const struct osmo_kgcore_req *reqs, unsigned int num)
+{
+	uint64_t A[KASUMI_MULTI], BLK[KASUMI_MULTI];
+	uint16_t blocks[KASUMI_MULTI], max_blocks, i;
+	unsigned int n, j;
+
+	/* The OFB chain of a keystream is sequential, so run the chains of
+	 * up to KASUMI_MULTI requests side by side. Unused lanes just repeat
+	 * the first request without storing anything. */
+	for (; num > 0; num -= n, reqs += n) {
+		n = num < KASUMI_MULTI ? num : KASUMI_MULTI;
+
+		max_blocks = 0;
+		for (j = 0; j < KASUMI_MULTI; j++) {
+			const struct osmo_kgcore_req *r = &reqs[j < n ? j : 0];
+
+			A[j] = kgcore_load(CA, cb, r->cc, r->cd);
+			BLK[j] = 0;
+			blocks[j] = (r->cl + 63) / 64;
+			if (blocks[j] > max_blocks)
+				max_blocks = blocks[j];
+		}
+
+		/* preliminary round with modified key */
+		kasumi_key_multi(A, &kk->km);
+
+		for (i = 0; i < max_blocks; i++) {
+			for (j = 0; j < KASUMI_MULTI; j++)
+				BLK[j] ^= A[j] ^ i;
+			kasumi_key_multi(BLK, &kk->ck);
+
+			for (j = 0; j < n; j++) {
+				if (i < blocks[j])
+					kgcore_store(reqs[j].co, reqs[j].cl, i, BLK[j]);
+			}
+		}
+	}
+}
+
+void _kasumi_kgcore(uint8_t CA, uint8_t cb, uint32_t cc, uint8_t cd, const uint8_t *ck, uint8_t *co, uint16_t cl)
+{
+	struct osmo_kgcore_key kk;
+
+	_kasumi_kgcore_init(&kk, ck);
+	_kasumi_kgcore_run(&kk, CA, cb, cc, cd, co, cl);
+}
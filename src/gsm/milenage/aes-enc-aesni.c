@@ -0,0 +1,75 @@
+/*! \file aes-enc-aesni.c
+ * AES-128 block encryption kernel for x86 CPUs with AES-NI. */
+/*
+ * (C) 2018 by sysmocom - s.f.m.c. GmbH
+ *
+ * All Rights Reserved
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <wmmintrin.h>
+
+#include "common.h"
+
+/* AESENC has a latency of several cycles but a throughput of one per cycle,
+ * so four independent blocks are kept in flight. */
+
+#define AESNI_LOAD(i) \
+	_mm_loadu_si128((const __m128i *) &in[16 * (i)])
+#define AESNI_STORE(i, v) \
+	_mm_storeu_si128((__m128i *) &out[16 * (i)], v)
+
+__attribute__ ((visibility("hidden")))
+void aes_128_aesni_encrypt_blocks(const u8 *rk8, const u8 *in, u8 *out,
+				  unsigned int num)
+{
+	__m128i k[11], b0, b1, b2, b3;
+	unsigned int i;
+	int r;
+
+	for (r = 0; r < 11; r++)
+		k[r] = _mm_loadu_si128((const __m128i *) &rk8[16 * r]);
+
+	for (; num >= 4; num -= 4, in += 64, out += 64) {
+		b0 = _mm_xor_si128(AESNI_LOAD(0), k[0]);
+		b1 = _mm_xor_si128(AESNI_LOAD(1), k[0]);
+		b2 = _mm_xor_si128(AESNI_LOAD(2), k[0]);
+		b3 = _mm_xor_si128(AESNI_LOAD(3), k[0]);
+
+		for (r = 1; r < 10; r++) {
+			b0 = _mm_aesenc_si128(b0, k[r]);
+			b1 = _mm_aesenc_si128(b1, k[r]);
+			b2 = _mm_aesenc_si128(b2, k[r]);
+			b3 = _mm_aesenc_si128(b3, k[r]);
+		}
+
+		AESNI_STORE(0, _mm_aesenclast_si128(b0, k[10]));
+		AESNI_STORE(1, _mm_aesenclast_si128(b1, k[10]));
+		AESNI_STORE(2, _mm_aesenclast_si128(b2, k[10]));
+		AESNI_STORE(3, _mm_aesenclast_si128(b3, k[10]));
+	}
+
+	for (i = 0; i < num; i++) {
+		b0 = _mm_xor_si128(AESNI_LOAD(i), k[0]);
+		for (r = 1; r < 10; r++)
+			b0 = _mm_aesenc_si128(b0, k[r]);
+		AESNI_STORE(i, _mm_aesenclast_si128(b0, k[10]));
+	}
+}
@@ -0,0 +1,72 @@
+/*! \file aes-enc-armv8.c
+ * AES-128 block encryption kernel for ARMv8 CPUs with the Cryptographic
+ * Extension. */
+/*
+ * (C) 2018 by sysmocom - s.f.m.c. GmbH
+ *
+ * All Rights Reserved
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <arm_neon.h>
+
+#include "common.h"
+
+/* Same interface as the AES-NI kernel in aes-enc-aesni.c. AESE includes the
+ * AddRoundKey of the round, so the key schedule is applied one round earlier
+ * than with AESENC and the last round key is XORed on at the end. */
+
+__attribute__ ((visibility("hidden")))
+void aes_128_armv8_encrypt_blocks(const u8 *rk8, const u8 *in, u8 *out,
+				  unsigned int num)
+{
+	uint8x16_t k[11], b0, b1, b2, b3;
+	unsigned int i;
+	int r;
+
+	for (r = 0; r < 11; r++)
+		k[r] = vld1q_u8(&rk8[16 * r]);
+
+	for (; num >= 4; num -= 4, in += 64, out += 64) {
+		b0 = vld1q_u8(&in[0]);
+		b1 = vld1q_u8(&in[16]);
+		b2 = vld1q_u8(&in[32]);
+		b3 = vld1q_u8(&in[48]);
+
+		for (r = 0; r < 9; r++) {
+			b0 = vaesmcq_u8(vaeseq_u8(b0, k[r]));
+			b1 = vaesmcq_u8(vaeseq_u8(b1, k[r]));
+			b2 = vaesmcq_u8(vaeseq_u8(b2, k[r]));
+			b3 = vaesmcq_u8(vaeseq_u8(b3, k[r]));
+		}
+
+		vst1q_u8(&out[0], veorq_u8(vaeseq_u8(b0, k[9]), k[10]));
+		vst1q_u8(&out[16], veorq_u8(vaeseq_u8(b1, k[9]), k[10]));
+		vst1q_u8(&out[32], veorq_u8(vaeseq_u8(b2, k[9]), k[10]));
+		vst1q_u8(&out[48], veorq_u8(vaeseq_u8(b3, k[9]), k[10]));
+	}
+
+	for (i = 0; i < num; i++) {
+		b0 = vld1q_u8(&in[16 * i]);
+		for (r = 0; r < 9; r++)
+			b0 = vaesmcq_u8(vaeseq_u8(b0, k[r]));
+		vst1q_u8(&out[16 * i], veorq_u8(vaeseq_u8(b0, k[9]), k[10]));
+	}
+}
@@ -30,11 +30,9 @@
  */
 int aes_128_encrypt_block(const u8 *key, const u8 *in, u8 *out)
 {
-	void *ctx;
-	ctx = aes_encrypt_init(key, 16);
-	if (ctx == NULL)
-		return -1;
-	aes_encrypt(ctx, in, out);
-	aes_encrypt_deinit(ctx);
+	struct aes_128_enc_key ctx;
+	aes_128_enc_key_setup(&ctx, key);
+	aes_128_encrypt_blocks(&ctx, in, out, 1);
+	aes_128_enc_key_clear(&ctx);
 	return 0;
 }
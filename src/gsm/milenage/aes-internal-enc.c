@@ -24,11 +24,29 @@
  * See README and COPYING for more details.
  */
 
+#include "config.h"
 #include "includes.h"
 
 #include "common.h"
 #include "crypto.h"
 #include "aes_i.h"
+#include "aes.h"
+
+#if defined(HAVE_ARM_AES)
+#include <sys/auxv.h>
+#endif
+
+/* Kernels working on the byte order round keys, in aes-enc-*.c */
+#ifdef HAVE_AESNI
+__attribute__ ((visibility("hidden")))
+void aes_128_aesni_encrypt_blocks(const u8 *rk8, const u8 *in, u8 *out,
+				  unsigned int num);
+#endif
+#ifdef HAVE_ARM_AES
+__attribute__ ((visibility("hidden")))
+void aes_128_armv8_encrypt_blocks(const u8 *rk8, const u8 *in, u8 *out,
+				  unsigned int num);
+#endif
 
 static void rijndaelEncrypt(const u32 rk[/*44*/], const u8 pt[16], u8 ct[16])
 {
@@ -122,3 +140,85 @@ void aes_encrypt_deinit(void *ctx)
 	os_memset(ctx, 0, AES_PRIV_SIZE);
 	os_free(ctx);
 }
+
+
+static void aes_128_table_encrypt_blocks(const struct aes_128_enc_key *key,
+					 const u8 *in, u8 *out,
+					 unsigned int num)
+{
+	unsigned int i;
+
+	for (i = 0; i < num; i++)
+		rijndaelEncrypt(key->rk, in + 16 * i, out + 16 * i);
+}
+
+static void (*aes_128_hw_encrypt_blocks)(const u8 *rk8, const u8 *in,
+					 u8 *out, unsigned int num);
+
+static void aes_128_encrypt_init(void)
+{
+	static int init_complete = 0;
+
+	if (init_complete)
+		return;
+
+#if defined(HAVE_AESNI) && defined(HAVE___BUILTIN_CPU_SUPPORTS)
+	if (__builtin_cpu_supports("aes") && __builtin_cpu_supports("sse2"))
+		aes_128_hw_encrypt_blocks = aes_128_aesni_encrypt_blocks;
+#endif
+#if defined(HAVE_ARM_AES)
+	/* only built with --enable-neon, as it was not verified on hardware */
+	if (getauxval(AT_HWCAP) & HWCAP_AES)
+		aes_128_hw_encrypt_blocks = aes_128_armv8_encrypt_blocks;
+#endif
+
+	init_complete = 1;
+}
+
+
+/**
+ * aes_128_enc_key_setup - Expand an AES-128 key for aes_128_encrypt_blocks()
+ * @key: Buffer for the expanded key
+ * @k: 128-bit key
+ */
+void aes_128_enc_key_setup(struct aes_128_enc_key *key, const u8 *k)
+{
+	int i;
+
+	aes_128_encrypt_init();
+
+	rijndaelKeySetupEnc(key->rk, k);
+	for (i = 0; i < 44; i++)
+		PUTU32(key->rk8 + 4 * i, key->rk[i]);
+}
+
+
+/**
+ * aes_128_enc_key_clear - Wipe an expanded AES-128 key
+ * @key: Expanded key
+ */
+void aes_128_enc_key_clear(struct aes_128_enc_key *key)
+{
+	os_memset(key, 0, sizeof(*key));
+}
+
+
+/**
+ * aes_128_encrypt_blocks - Encrypt a number of blocks (ECB) with one key
+ * @key: Key expanded by aes_128_enc_key_setup()
+ * @in: num 16-byte input blocks
+ * @out: Buffer for num 16-byte output blocks, may be the same as @in
+ * @num: Number of blocks
+ *
+ * Uses the AES instructions of the CPU when available, which pipeline
+ * independent blocks, so callers should pass as many blocks at once as
+ * they can.
+ */
+void aes_128_encrypt_blocks(const struct aes_128_enc_key *key, const u8 *in,
+			    u8 *out, unsigned int num)
+{
+	if (aes_128_hw_encrypt_blocks)
+		aes_128_hw_encrypt_blocks(key->rk8, in, out, num);
+	else
+		aes_128_table_encrypt_blocks(key, in, out, num);
+}
@@ -19,6 +19,19 @@
 
 #define AES_BLOCK_SIZE 16
 
+/* Expanded AES-128 encryption key, set up once and reused for any number of
+ * blocks. rk8 holds the same round keys in byte order, as consumed by the
+ * AES-NI and ARMv8 AES instructions. */
+struct aes_128_enc_key {
+	u32 rk[44];
+	u8 rk8[176];
+};
+
+void aes_128_enc_key_setup(struct aes_128_enc_key *key, const u8 *k);
+void aes_128_enc_key_clear(struct aes_128_enc_key *key);
+void aes_128_encrypt_blocks(const struct aes_128_enc_key *key, const u8 *in,
+			    u8 *out, unsigned int num);
+
 void * aes_encrypt_init(const u8 *key, size_t len);
 void aes_encrypt(void *ctx, const u8 *plain, u8 *crypt);
 void aes_encrypt_deinit(void *ctx);
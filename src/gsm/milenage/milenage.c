@@ -27,6 +27,7 @@
 #include "includes.h"
 
 #include "common.h"
+#include "aes.h"
 #include "aes_wrap.h"
 #include "milenage.h"
 #include <osmocom/crypt/auth.h>
@@ -166,6 +167,97 @@ int milenage_f2345(const u8 *opc, const u8 *k, const u8 *_rand,
 }
 
 
+/**
+ * milenage_generate_multi - Generate a number of AKA AUTN,IK,CK,RES at once
+ * @opc: OPc = 128-bit operator variant algorithm configuration field (encr.)
+ * @amf: AMF = 16-bit authentication management field
+ * @k: K = 128-bit subscriber key, expanded by aes_128_enc_key_setup()
+ * @sqn: num SQN = 48-bit sequence numbers (6 bytes each)
+ * @_rand: num RAND = 128-bit random challenges (16 bytes each)
+ * @autn: Buffer for num AUTN = 128-bit authentication tokens (16 bytes each)
+ * @ik: Buffer for num IK = 128-bit integrity keys (16 bytes each)
+ * @ck: Buffer for num CK = 128-bit confidentiality keys (16 bytes each)
+ * @res: Buffer for num RES = 64-bit signed responses (8 bytes each)
+ * @num: Number of vectors, 1 to MILENAGE_MULTI
+ * Returns: 0 on success, -1 on failure
+ *
+ * Same as calling milenage_generate() num times, but the key schedule is
+ * only set up once by the caller, and f1, f2, f3, f4 and f5 of all vectors
+ * are computed in two passes of independent AES blocks.
+ */
+int milenage_generate_multi(const u8 *opc, const u8 *amf,
+			    const struct aes_128_enc_key *k, const u8 *sqn,
+			    const u8 *_rand, u8 *autn, u8 *ik, u8 *ck, u8 *res,
+			    unsigned int num)
+{
+	/* per vector: the input blocks of f1, f2 || f5, f3 and f4 */
+	u8 temp[MILENAGE_MULTI * 16], tmp[MILENAGE_MULTI][4][16];
+	unsigned int j;
+	int i;
+
+	if (num < 1 || num > MILENAGE_MULTI)
+		return -1;
+
+	/* TEMP = E_K(RAND XOR OP_C) */
+	for (i = 0; i < 16 * num; i++)
+		temp[i] = _rand[i] ^ opc[i % 16];
+	aes_128_encrypt_blocks(k, temp, temp, num);
+
+	for (j = 0; j < num; j++) {
+		u8 in1[16];
+
+		/* IN1 = SQN || AMF || SQN || AMF */
+		os_memcpy(in1, sqn + 6 * j, 6);
+		os_memcpy(in1 + 6, amf, 2);
+		os_memcpy(in1 + 8, in1, 8);
+
+		/* f1: TEMP XOR rot(IN1 XOR OP_C, r1 = 8 bytes) XOR c1 (= 0) */
+		for (i = 0; i < 16; i++)
+			tmp[j][0][(i + 8) % 16] = in1[i] ^ opc[i];
+		for (i = 0; i < 16; i++)
+			tmp[j][0][i] ^= temp[16 * j + i];
+
+		/* f2 and f5: rot(TEMP XOR OP_C, r2 = 0) XOR c2 */
+		for (i = 0; i < 16; i++)
+			tmp[j][1][i] = temp[16 * j + i] ^ opc[i];
+		tmp[j][1][15] ^= 1;
+
+		/* f3: rot(TEMP XOR OP_C, r3 = 4 bytes) XOR c3 */
+		for (i = 0; i < 16; i++)
+			tmp[j][2][(i + 12) % 16] = temp[16 * j + i] ^ opc[i];
+		tmp[j][2][15] ^= 2;
+
+		/* f4: rot(TEMP XOR OP_C, r4 = 8 bytes) XOR c4 */
+		for (i = 0; i < 16; i++)
+			tmp[j][3][(i + 8) % 16] = temp[16 * j + i] ^ opc[i];
+		tmp[j][3][15] ^= 4;
+	}
+	aes_128_encrypt_blocks(k, tmp[0][0], tmp[0][0], 4 * num);
+
+	for (j = 0; j < num; j++) {
+		/* OUTx = E_K(...) XOR OP_C */
+		for (i = 0; i < 16; i++) {
+			tmp[j][0][i] ^= opc[i];
+			tmp[j][1][i] ^= opc[i];
+			ck[16 * j + i] = tmp[j][2][i] ^ opc[i];
+			ik[16 * j + i] = tmp[j][3][i] ^ opc[i];
+		}
+		/* f2 */
+		os_memcpy(res + 8 * j, tmp[j][1] + 8, 8);
+
+		/* AUTN = (SQN ^ AK) || AMF || MAC */
+		for (i = 0; i < 6; i++)
+			autn[16 * j + i] = sqn[6 * j + i] ^ tmp[j][1][i];
+		os_memcpy(autn + 16 * j + 6, amf, 2);
+		os_memcpy(autn + 16 * j + 8, tmp[j][0], 8);
+	}
+
+	os_memset(temp, 0, sizeof(temp));
+	os_memset(tmp, 0, sizeof(tmp));
+	return 0;
+}
+
+
 /**
  * milenage_generate - Generate AKA AUTN,IK,CK,RES
  * @opc: OPc = 128-bit operator variant algorithm configuration field (encr.)
@@ -183,25 +275,26 @@ void milenage_generate(const u8 *opc, const u8 *amf, const u8 *k,
 		       const u8 *sqn, const u8 *_rand, u8 *autn, u8 *ik,
 		       u8 *ck, u8 *res, size_t *res_len)
 {
-	int i;
-	u8 mac_a[8], ak[6];
+	struct aes_128_enc_key key;
+	u8 ik_buf[16], ck_buf[16], res_buf[8];
 
 	if (*res_len < 8) {
 		*res_len = 0;
 		return;
 	}
-	if (milenage_f1(opc, k, _rand, sqn, amf, mac_a, NULL) ||
-	    milenage_f2345(opc, k, _rand, res, ck, ik, ak, NULL)) {
-		*res_len = 0;
-		return;
-	}
+
+	aes_128_enc_key_setup(&key, k);
+	milenage_generate_multi(opc, amf, &key, sqn, _rand, autn, ik_buf,
+				ck_buf, res_buf, 1);
+	aes_128_enc_key_clear(&key);
 	*res_len = 8;
 
-	/* AUTN = (SQN ^ AK) || AMF || MAC */
-	for (i = 0; i < 6; i++)
-		autn[i] = sqn[i] ^ ak[i];
-	os_memcpy(autn + 6, amf, 2);
-	os_memcpy(autn + 8, mac_a, 8);
+	if (ik)
+		os_memcpy(ik, ik_buf, 16);
+	if (ck)
+		os_memcpy(ck, ck_buf, 16);
+	if (res)
+		os_memcpy(res, res_buf, 8);
 }
 
 
@@ -244,11 +337,31 @@ int milenage_auts(const u8 *opc, const u8 *k, const u8 *_rand, const u8 *auts,
 int gsm_milenage(const u8 *opc, const u8 *k, const u8 *_rand, u8 *sres, u8 *kc)
 {
 	u8 res[8], ck[16], ik[16];
-	int i;
 
 	if (milenage_f2345(opc, k, _rand, res, ck, ik, NULL, NULL))
 		return -1;
 
+	gsm_milenage_from_umts(res, ck, ik, sres, kc);
+	return 0;
+}
+
+
+/**
+ * gsm_milenage_from_umts - Derive the GSM-Milenage triplet from a quintuplet
+ * @res: RES = 64-bit signed response (f2)
+ * @ck: CK = 128-bit confidentiality key (f3)
+ * @ik: IK = 128-bit integrity key (f4)
+ * @sres: Buffer for SRES = 32-bit SRES
+ * @kc: Buffer for Kc = 64-bit Kc
+ *
+ * Gives the same result as gsm_milenage() for the same RAND, without
+ * running f2345 a second time.
+ */
+void gsm_milenage_from_umts(const u8 *res, const u8 *ck, const u8 *ik,
+			    u8 *sres, u8 *kc)
+{
+	int i;
+
 	osmo_auth_c3(kc, ck, ik);
 
 #ifdef GSM_MILENAGE_ALT_SRES
@@ -257,7 +370,6 @@ int gsm_milenage(const u8 *opc, const u8 *k, const u8 *_rand, u8 *sres, u8 *kc)
 	for (i = 0; i < 4; i++)
 		sres[i] = res[i] ^ res[i + 4];
 #endif /* GSM_MILENAGE_ALT_SRES */
-	return 0;
 }
 
 
@@ -18,6 +18,15 @@
 
 #pragma once
 
+/* Maximum number of vectors per milenage_generate_multi() call */
+#define MILENAGE_MULTI 16
+
+struct aes_128_enc_key;
+
+int milenage_generate_multi(const u8 *opc, const u8 *amf,
+			    const struct aes_128_enc_key *k, const u8 *sqn,
+			    const u8 *_rand, u8 *autn, u8 *ik, u8 *ck, u8 *res,
+			    unsigned int num);
 void milenage_generate(const u8 *opc, const u8 *amf, const u8 *k,
 		       const u8 *sqn, const u8 *_rand, u8 *autn, u8 *ik,
 		       u8 *ck, u8 *res, size_t *res_len);
@@ -25,6 +34,8 @@ int milenage_auts(const u8 *opc, const u8 *k, const u8 *_rand, const u8 *auts,
 		  u8 *sqn);
 int gsm_milenage(const u8 *opc, const u8 *k, const u8 *_rand, u8 *sres,
 		 u8 *kc);
+void gsm_milenage_from_umts(const u8 *res, const u8 *ck, const u8 *ik,
+			    u8 *sres, u8 *kc);
 int milenage_check(const u8 *opc, const u8 *k, const u8 *sqn, const u8 *_rand,
 		   const u8 *autn, u8 *ik, u8 *ck, u8 *res, size_t *res_len,
 		   u8 *auts);
@@ -334,21 +334,6 @@ int gsmtap_send(struct gsmtap_inst *gti, uint16_t arfcn, uint8_t ts,
 }
 
 /* Callback from select layer if we can write to the socket */
-static int gsmtap_wq_w_cb(struct osmo_fd *ofd, struct msgb *msg)
-{
-	int rc;
-
-	rc = write(ofd->fd, msg->data, msg->len);
-	if (rc < 0) {
-		return rc;
-	}
-	if (rc != msg->len) {
-		return -EIO;
-	}
-
-	return 0;
-}
-
 /* Callback from select layer if we can read from the sink socket */
 static int gsmtap_sink_fd_cb(struct osmo_fd *fd, unsigned int flags)
 {
@@ -436,7 +421,8 @@ struct gsmtap_inst *gsmtap_source_init(const char *host, uint16_t port,
 
 	if (ofd_wq_mode) {
 		osmo_wqueue_init(&gti->wq, 64);
-		gti->wq.write_cb = &gsmtap_wq_w_cb;
+		/* no write_cb, the queue writes the datagrams itself */
+		osmo_wqueue_set_batch(&gti->wq, 16);
 
 		rc = osmo_fd_register(&gti->wq.bfd);
 		if (rc < 0) {
@@ -0,0 +1,304 @@
+/*! \file histogram.c
+ * Histograms of measured values, e.g. latencies. */
+/*
+ * (C) 2018 by sysmocom - s.f.m.c. GmbH
+ *
+ * All Rights Reserved
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+/*! \addtogroup osmo_histogram
+ *  @{
+ *
+ *  An osmo_histogram counts recorded values in log-linear buckets, in
+ *  the fashion of HdrHistogram: values below 2^(SUB_BITS+1) have a
+ *  bucket each, above that every power of two is split into 2^SUB_BITS
+ *  equally sized buckets.  This way the p50/p90/p99/... percentiles of
+ *  any number of values can be given with a relative error below
+ *  2^-SUB_BITS, in a fixed amount of memory (about 4.7 kB per
+ *  histogram) and with O(1) recording.
+ *
+ *  Recording uses relaxed atomic operations only, so values can be
+ *  recorded from several threads without any locking.  Reading a
+ *  histogram while values are recorded gives a consistent enough
+ *  picture for statistics, but not an exact snapshot.
+ *
+ *  Histograms are allocated in groups, like \ref rate_ctr and \ref
+ *  osmo_stat_item, and all groups are shown on the VTY and exported by
+ *  the \ref stats reporters and the CTRL interface ("histogram.*").
+ *
+ *  To time a code section in nanoseconds, use \ref OSMO_HISTOGRAM_TIME()
+ *  or the \ref OSMO_HISTOGRAM_TIMER_START() / \ref
+ *  OSMO_HISTOGRAM_TIMER_STOP() pair, which take the CLOCK_MONOTONIC time
+ *  through \ref osmo_clock_gettime().
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include <osmocom/core/utils.h>
+#include <osmocom/core/linuxlist.h>
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/histogram.h>
+
+#define SUB_BITS	OSMO_HISTOGRAM_SUB_BITS
+#define SUB_COUNT	(1 << SUB_BITS)
+
+/*! global list of histogram groups */
+static LLIST_HEAD(osmo_histogram_groups);
+
+/*! Get the bucket a value is counted in
+ *  \param[in] value Recorded value
+ *  \returns bucket index, below \ref OSMO_HISTOGRAM_NUM_BUCKETS */
+unsigned int osmo_histogram_bucket(uint64_t value)
+{
+	unsigned int shift;
+
+	if (value < 2 * SUB_COUNT)
+		return value;
+	if (value >> OSMO_HISTOGRAM_MAX_BITS)
+		return OSMO_HISTOGRAM_NUM_BUCKETS - 1;
+
+	/* the SUB_BITS+1 most significant bits select the bucket */
+	shift = 63 - __builtin_clzll(value) - SUB_BITS;
+	return (shift << SUB_BITS) + (value >> shift);
+}
+
+/*! Get the largest value counted in a bucket
+ *  \param[in] bucket Bucket index
+ *  \returns largest value mapped to \a bucket */
+uint64_t osmo_histogram_bucket_upper(unsigned int bucket)
+{
+	unsigned int shift;
+
+	if (bucket < 2 * SUB_COUNT)
+		return bucket;
+
+	shift = (bucket >> SUB_BITS) - 1;
+	return ((uint64_t)(bucket - (shift << SUB_BITS) + 1) << shift) - 1;
+}
+
+/*! Allocate a new group of histograms according to description.
+ *  \param[in] ctx \ref talloc context
+ *  \param[in] desc Histogram group description
+ *  \param[in] idx Index of new histogram group
+ *  \returns allocated histogram group; NULL on error */
+struct osmo_histogram_group *osmo_histogram_group_alloc(void *ctx,
+	const struct osmo_histogram_group_desc *desc, unsigned int idx)
+{
+	struct osmo_histogram_group *group;
+	unsigned int i;
+
+	group = talloc_zero_size(ctx, sizeof(*group) +
+				 desc->num_hist * sizeof(struct osmo_histogram));
+	if (!group)
+		return NULL;
+
+	group->desc = desc;
+	group->idx = idx;
+
+	for (i = 0; i < desc->num_hist; i++) {
+		group->hist[i].desc = &desc->hist_desc[i];
+		group->hist[i].min = UINT64_MAX;
+	}
+
+	llist_add(&group->list, &osmo_histogram_groups);
+
+	return group;
+}
+
+/*! Free the memory for the specified group of histograms */
+void osmo_histogram_group_free(struct osmo_histogram_group *histg)
+{
+	llist_del(&histg->list);
+	talloc_free(histg);
+}
+
+/*! Record a value in a histogram
+ *  \param[in] hist Histogram to record \a value in
+ *  \param[in] value Measured value, e.g. nanoseconds */
+void osmo_histogram_record(struct osmo_histogram *hist, uint64_t value)
+{
+	uint64_t old;
+
+	__atomic_fetch_add(&hist->buckets[osmo_histogram_bucket(value)], 1,
+			   __ATOMIC_RELAXED);
+	__atomic_fetch_add(&hist->sum, value, __ATOMIC_RELAXED);
+
+	old = __atomic_load_n(&hist->min, __ATOMIC_RELAXED);
+	while (value < old &&
+	       !__atomic_compare_exchange_n(&hist->min, &old, value, 1,
+					    __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+	old = __atomic_load_n(&hist->max, __ATOMIC_RELAXED);
+	while (value > old &&
+	       !__atomic_compare_exchange_n(&hist->max, &old, value, 1,
+					    __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+	/* count last, so that a reader never sees more values than in the
+	 * buckets */
+	__atomic_fetch_add(&hist->count, 1, __ATOMIC_RELEASE);
+}
+
+/*! Forget all recorded values of a histogram.
+ *  Values recorded concurrently may be lost or partially counted. */
+void osmo_histogram_reset(struct osmo_histogram *hist)
+{
+	__atomic_store_n(&hist->count, 0, __ATOMIC_RELAXED);
+	__atomic_store_n(&hist->previous, 0, __ATOMIC_RELAXED);
+	memset(hist->buckets, 0, sizeof(hist->buckets));
+	__atomic_store_n(&hist->sum, 0, __ATOMIC_RELAXED);
+	__atomic_store_n(&hist->min, UINT64_MAX, __ATOMIC_RELAXED);
+	__atomic_store_n(&hist->max, 0, __ATOMIC_RELAXED);
+}
+
+/*! Get several percentiles of the recorded values in one pass.
+ *  Each result is the largest value of the bucket holding the requested
+ *  rank, limited to the smallest and largest recorded value.
+ *  \param[in] hist Histogram to evaluate
+ *  \param[in] permille Ascending percentiles in 1/1000, e.g. 500 for the
+ *		       median or 999 for p99.9
+ *  \param[out] values Percentile values, 0 if nothing was recorded
+ *  \param[in] num Number of entries in \a permille and \a values */
+void osmo_histogram_percentiles(const struct osmo_histogram *hist,
+	const unsigned int *permille, uint64_t *values, unsigned int num)
+{
+	uint64_t count = __atomic_load_n(&hist->count, __ATOMIC_ACQUIRE);
+	uint64_t min = __atomic_load_n(&hist->min, __ATOMIC_RELAXED);
+	uint64_t max = __atomic_load_n(&hist->max, __ATOMIC_RELAXED);
+	uint64_t rank, seen = 0, value;
+	unsigned int i = 0, n;
+
+	for (n = 0; n < num; n++) {
+		if (count == 0) {
+			values[n] = 0;
+			continue;
+		}
+
+		rank = (count * permille[n] + 999) / 1000;
+		if (rank == 0)
+			rank = 1;
+
+		for (; seen < rank && i < OSMO_HISTOGRAM_NUM_BUCKETS; i++)
+			seen += __atomic_load_n(&hist->buckets[i], __ATOMIC_RELAXED);
+
+		if (seen < rank || permille[n] >= 1000) {
+			values[n] = max;
+			continue;
+		}
+		if (permille[n] == 0) {
+			values[n] = min;
+			continue;
+		}
+
+		/* i is one past the bucket holding the rank */
+		value = osmo_histogram_bucket_upper(i - 1);
+		if (value > max)
+			value = max;
+		if (value < min)
+			value = min;
+		values[n] = value;
+	}
+}
+
+/*! Get a percentile of the recorded values, see \ref
+ *  osmo_histogram_percentiles().
+ *  \param[in] hist Histogram to evaluate
+ *  \param[in] permille Percentile in 1/1000, e.g. 990 for p99
+ *  \returns percentile value; 0 if no value has been recorded */
+uint64_t osmo_histogram_percentile(const struct osmo_histogram *hist,
+	unsigned int permille)
+{
+	uint64_t value;
+
+	osmo_histogram_percentiles(hist, &permille, &value, 1);
+
+	return value;
+}
+
+/*! Return the number of values recorded since the last call
+ *  \param[in] hist Histogram to look at
+ *  \returns number of values recorded since the last call */
+uint64_t osmo_histogram_difference(struct osmo_histogram *hist)
+{
+	uint64_t count = __atomic_load_n(&hist->count, __ATOMIC_RELAXED);
+	uint64_t delta = count - hist->previous;
+
+	hist->previous = count;
+
+	return delta;
+}
+
+/*! Search for histogram group based on group name and index
+ *  \param[in] name Name of the histogram group you're looking for
+ *  \param[in] idx Index inside the histogram group
+ *  \returns pointer to group; NULL if not found */
+struct osmo_histogram_group *osmo_histogram_get_group_by_name_idx(
+	const char *name, const unsigned int idx)
+{
+	struct osmo_histogram_group *histg;
+
+	llist_for_each_entry(histg, &osmo_histogram_groups, list) {
+		if (!histg->desc)
+			continue;
+
+		if (!strcmp(histg->desc->group_name_prefix, name) &&
+				histg->idx == idx)
+			return histg;
+	}
+	return NULL;
+}
+
+/*! Search for histogram based on its name within a group
+ *  \param[in] histg Histogram group in which to search
+ *  \param[in] name Name of the histogram
+ *  \returns pointer to histogram; NULL if not found */
+struct osmo_histogram *osmo_histogram_get_by_name(
+	struct osmo_histogram_group *histg, const char *name)
+{
+	unsigned int i;
+
+	if (!histg)
+		return NULL;
+
+	for (i = 0; i < histg->desc->num_hist; i++) {
+		if (!strcmp(histg->desc->hist_desc[i].name, name))
+			return &histg->hist[i];
+	}
+	return NULL;
+}
+
+/*! Iterate over all histogram groups
+ *  \param[in] handle_group Call-back function, aborts if rc < 0
+ *  \param[in] data Private data handed through to \a handle_group */
+int osmo_histogram_for_each_group(osmo_histogram_group_handler_t handle_group,
+	void *data)
+{
+	struct osmo_histogram_group *histg;
+	int rc = 0;
+
+	llist_for_each_entry(histg, &osmo_histogram_groups, list) {
+		rc = handle_group(histg, data);
+		if (rc < 0)
+			return rc;
+	}
+
+	return rc;
+}
+
+/*! @} */
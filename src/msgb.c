@@ -63,9 +63,118 @@
 #include <osmocom/core/msgb.h>
 #include <osmocom/core/talloc.h>
 #include <osmocom/core/logging.h>
+#include <osmocom/core/rate_ctr.h>
+#include <osmocom/core/stats.h>
+#include <osmocom/core/utils.h>
 
 void *tall_msgb_ctx = NULL;
 
+/* Size classes of the msgb pool, see msgb_pool_init().  Chosen to cover the
+ * typical users: RSL/OML (~200), 04.11 (1024), IPA (1200), NS (3072). */
+static const uint16_t msgb_pool_class_size[] = { 128, 256, 512, 1024, 2048, 4096 };
+#define MSGB_POOL_NUM_CLASSES ARRAY_SIZE(msgb_pool_class_size)
+
+enum msgb_pool_ctr {
+	MSGB_POOL_CTR_ALLOC_HIT,
+	MSGB_POOL_CTR_ALLOC_MISS,
+	MSGB_POOL_CTR_FREE_RECYCLED,
+	MSGB_POOL_CTR_FREE_RELEASED,
+};
+
+static const struct rate_ctr_desc msgb_pool_ctr_description[] = {
+	[MSGB_POOL_CTR_ALLOC_HIT] =	{ "alloc:hit",		"msgb allocations served from the pool" },
+	[MSGB_POOL_CTR_ALLOC_MISS] =	{ "alloc:miss",		"msgb allocations not served from the pool" },
+	[MSGB_POOL_CTR_FREE_RECYCLED] =	{ "free:recycled",	"msgb releases returned to the pool" },
+	[MSGB_POOL_CTR_FREE_RELEASED] =	{ "free:released",	"msgb releases returned to talloc" },
+};
+
+static const struct rate_ctr_group_desc msgb_pool_ctrg_desc = {
+	.group_name_prefix = "msgb:pool",
+	.group_description = "msgb Pool Statistics",
+	.num_ctr = ARRAY_SIZE(msgb_pool_ctr_description),
+	.ctr_desc = msgb_pool_ctr_description,
+	.class_id = OSMO_STATS_CLASS_GLOBAL,
+};
+
+static struct {
+	/* talloc context holding the cached (free) buffers, NULL if disabled */
+	void *ctx;
+	struct rate_ctr_group *ctrg;
+	unsigned int max_cached;
+	/* msgb currently released by msgb_free() */
+	struct msgb *releasing;
+	struct {
+		struct llist_head list;
+		unsigned int count;
+	} cls[MSGB_POOL_NUM_CLASSES];
+} msgb_pool;
+
+/* return the index of the smallest size class holding \a size octets */
+static int msgb_pool_class(uint16_t size)
+{
+	int i;
+
+	for (i = 0; i < MSGB_POOL_NUM_CLASSES; i++) {
+		if (size <= msgb_pool_class_size[i])
+			return i;
+	}
+	return -1;
+}
+
+/* talloc destructor marking a msgb allocated by the pool: when released by
+ * msgb_free(), put it back into its size class instead of freeing it.  If
+ * the user replaced the destructor or attached talloc children, or if the
+ * msgb is freed along with its talloc parent, it is released normally. */
+static int msgb_pool_destructor(struct msgb *msg)
+{
+	int cls;
+
+	if (msg != msgb_pool.releasing || !msgb_pool.ctx)
+		return 0;
+
+	cls = msgb_pool_class(msg->data_len);
+	if (cls < 0 || msg->data_len != msgb_pool_class_size[cls]
+	    || msgb_pool.cls[cls].count >= msgb_pool.max_cached)
+		return 0;
+	if (talloc_total_blocks(msg) > 1)
+		return 0;
+
+	rate_ctr_inc(&msgb_pool.ctrg->ctr[MSGB_POOL_CTR_FREE_RECYCLED]);
+	talloc_steal(msgb_pool.ctx, msg);
+	llist_add(&msg->list, &msgb_pool.cls[cls].list);
+	msgb_pool.cls[cls].count++;
+	/* keep the memory */
+	return -1;
+}
+
+/* recycle or allocate a msgb of size class \a cls */
+static struct msgb *msgb_pool_get(int cls, const char *name)
+{
+	uint16_t size = msgb_pool_class_size[cls];
+	struct msgb *msg;
+
+	if (llist_empty(&msgb_pool.cls[cls].list)) {
+		rate_ctr_inc(&msgb_pool.ctrg->ctr[MSGB_POOL_CTR_ALLOC_MISS]);
+		msg = talloc_named_const(tall_msgb_ctx, sizeof(*msg) + size, name);
+		if (!msg)
+			return NULL;
+		talloc_set_destructor(msg, msgb_pool_destructor);
+	} else {
+		rate_ctr_inc(&msgb_pool.ctrg->ctr[MSGB_POOL_CTR_ALLOC_HIT]);
+		msg = llist_entry(msgb_pool.cls[cls].list.next, struct msgb, list);
+		llist_del(&msg->list);
+		msgb_pool.cls[cls].count--;
+		talloc_steal(tall_msgb_ctx, msg);
+		talloc_set_name_const(msg, name);
+	}
+
+	/* Only the header is reset, zeroing the whole data area would cost
+	 * most of what recycling saves; msgb_reserve() zeroes the headroom */
+	memset(msg, 0x00, sizeof(*msg));
+	msg->data_len = size;
+	return msg;
+}
+
 /*! Allocate a new message buffer
  * \param[in] size Length in octets, including headroom
  * \param[in] name Human-readable name to be associated with msgb
@@ -78,17 +187,27 @@ void *tall_msgb_ctx = NULL;
 struct msgb *msgb_alloc(uint16_t size, const char *name)
 {
 	struct msgb *msg;
-
-	msg = talloc_named_const(tall_msgb_ctx, sizeof(*msg) + size, name);
+	int cls;
+
+	if (msgb_pool.ctx && (cls = msgb_pool_class(size)) >= 0) {
+		msg = msgb_pool_get(cls, name);
+		/* the pooled buffer may be larger than requested */
+		if (msg)
+			size = msg->data_len;
+	} else {
+		if (msgb_pool.ctx)
+			rate_ctr_inc(&msgb_pool.ctrg->ctr[MSGB_POOL_CTR_ALLOC_MISS]);
+		msg = talloc_named_const(tall_msgb_ctx, sizeof(*msg) + size, name);
+		/* Manually zero-initialize allocated memory */
+		if (msg)
+			memset(msg, 0x00, sizeof(*msg) + size);
+	}
 	if (!msg) {
 		LOGP(DLGLOBAL, LOGL_FATAL, "Unable to allocate a msgb: "
 			"name='%s', size=%u\n", name, size);
 		return NULL;
 	}
 
-	/* Manually zero-initialize allocated memory */
-	memset(msg, 0x00, sizeof(*msg) + size);
-
 	msg->data_len = size;
 	msg->len = 0;
 	msg->data = msg->_data;
@@ -103,6 +222,15 @@ struct msgb *msgb_alloc(uint16_t size, const char *name)
  */
 void msgb_free(struct msgb *m)
 {
+	if (msgb_pool.ctx) {
+		/* pooled msgbs are recycled by msgb_pool_destructor() */
+		msgb_pool.releasing = m;
+		if (talloc_free(m) == 0)
+			rate_ctr_inc(&msgb_pool.ctrg->ctr[MSGB_POOL_CTR_FREE_RELEASED]);
+		msgb_pool.releasing = NULL;
+		return;
+	}
+
 	talloc_free(m);
 }
 
@@ -301,6 +429,64 @@ void *msgb_talloc_ctx_init(void *root_ctx, unsigned int pool_size)
 	return tall_msgb_ctx;
 }
 
+/*! Enable recycling of message buffers in size classes.
+ * Once enabled, \ref msgb_alloc rounds the requested size up to the next
+ * size class (128, 256, 512, 1024, 2048 or 4096 octets) and hands out a
+ * previously released buffer of that class if available.  The header and
+ * any headroom reserved with \ref msgb_reserve of a recycled buffer are
+ * zero-initialized, the rest of its data area is not.  Larger allocations
+ * are not pooled.
+ *
+ * \ref msgb_free keeps up to \a max_cached buffers per size class in a
+ * talloc context called "msgb_pool" below \a root_ctx, so that the "msgb"
+ * context only accounts for buffers actually in use.  Only buffers allocated
+ * by the pool are recycled, and only if they have no talloc children and
+ * their talloc destructor was not replaced; all others are released to
+ * talloc.  Hit/miss counters are available in the "msgb:pool" rate counter
+ * group.
+ *  \param[in] root_ctx talloc context used as parent for the pool.
+ *  \param[in] max_cached maximum number of free buffers kept per size class.
+ *  \returns 0 on success; negative on error
+ */
+int msgb_pool_init(void *root_ctx, unsigned int max_cached)
+{
+	int i;
+
+	if (msgb_pool.ctx)
+		return -EALREADY;
+
+	msgb_pool.ctx = talloc_named_const(root_ctx, 0, "msgb_pool");
+	if (!msgb_pool.ctx)
+		return -ENOMEM;
+	msgb_pool.ctrg = rate_ctr_group_alloc(msgb_pool.ctx, &msgb_pool_ctrg_desc, 0);
+	if (!msgb_pool.ctrg) {
+		talloc_free(msgb_pool.ctx);
+		msgb_pool.ctx = NULL;
+		return -ENOMEM;
+	}
+
+	msgb_pool.max_cached = max_cached;
+	for (i = 0; i < MSGB_POOL_NUM_CLASSES; i++) {
+		INIT_LLIST_HEAD(&msgb_pool.cls[i].list);
+		msgb_pool.cls[i].count = 0;
+	}
+	return 0;
+}
+
+/*! Disable msgb pooling and release all cached buffers.
+ * Buffers that are still in use remain valid and are released to talloc
+ * by \ref msgb_free. */
+void msgb_pool_exit(void)
+{
+	if (!msgb_pool.ctx)
+		return;
+
+	rate_ctr_group_free(msgb_pool.ctrg);
+	talloc_free(msgb_pool.ctx);
+	msgb_pool.ctrg = NULL;
+	msgb_pool.ctx = NULL;
+}
+
 /*! Copy an msgb.
  *
  *  This function allocates a new msgb, copies the data buffer of msg,
@@ -46,20 +46,29 @@
  *  rate_ctr_inc to increment the value as certain events (e.g. location
  *  update) happens.
  *
- *  The library internally keeps a timer once per second which iterates
- *  over all registered counters and which updates the per-second,
- *  per-minute, per-hour and per-day averages based on the current
- *  value.
+ *  The per-second, per-minute, per-hour and per-day rates are not
+ *  updated by a timer, but computed when they are read with \ref
+ *  rate_ctr_get_rate(): each \ref rate_ctr.intv entry keeps a snapshot
+ *  of the counter value and its time, and once the interval has passed,
+ *  the next read turns the difference into the rate and starts a new
+ *  interval.  Counters which are never looked at cost nothing but the
+ *  increment.  If an interval was not read for a while, its rate is the
+ *  average over the whole time since the snapshot.
+ *
+ *  The length of each interval can be changed per group with \ref
+ *  rate_ctr_group_set_intv(), e.g. to 100 ms for user plane counters.
  *
  *  The counters can be reported using \ref stats or by VTY
- *  introspection, as well as by any application-specific code accessing
- *  the \ref rate_ctr.intv array directly.
+ *  introspection, as well as by any application-specific code calling
+ *  \ref rate_ctr_get_rate().
  *
  * \file rate_ctr.c */
 
 #include <stdbool.h>
 #include <stdint.h>
 #include <string.h>
+#include <errno.h>
+#include <time.h>
 
 #include <osmocom/core/utils.h>
 #include <osmocom/core/linuxlist.h>
@@ -67,9 +76,29 @@
 #include <osmocom/core/timer.h>
 #include <osmocom/core/rate_ctr.h>
 #include <osmocom/core/logging.h>
+#include <osmocom/core/stats_internal.h>
 
 static LLIST_HEAD(rate_ctr_groups);
 
+/* default length of each rate_ctr_intv in ms */
+static const uint32_t rate_ctr_default_intv_ms[RATE_CTR_INTV_NUM] = {
+	[RATE_CTR_INTV_SEC]	= 1000,
+	[RATE_CTR_INTV_MIN]	= 60 * 1000,
+	[RATE_CTR_INTV_HOUR]	= 60 * 60 * 1000,
+	[RATE_CTR_INTV_DAY]	= 24 * 60 * 60 * 1000,
+};
+
+static uint64_t rate_ctr_now_ms(void)
+{
+	struct timespec ts;
+
+	osmo_clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/* groups with counters changed since the last rate_ctr_for_each_dirty() */
+static LLIST_HEAD(rate_ctr_dirty_groups);
+
 static void *tall_rate_ctr_ctx;
 
 
@@ -135,6 +164,27 @@ static char *mangle_identifier_ifneeded(const void *ctx, const char *in)
 	return out;
 }
 
+/* Return \a in if it doesn't contain any ':'; otherwise a copy allocated
+ * from \a ctx with all ':' replaced by '.'.  statsd uses ':' as separator,
+ * so this is how rate_ctr and stat_item groups report their names.  Kept
+ * here and not in stats.c, which is not built with --enable-embedded. */
+__attribute__ ((visibility("hidden")))
+const char *stats_name_ifneeded(const void *ctx, const char *in)
+{
+	char *out, *c;
+
+	if (!strchr(in, ':'))
+		return in;
+
+	out = talloc_strdup(ctx, in);
+	OSMO_ASSERT(out);
+
+	for (c = out; (c = strchr(c, ':')); c++)
+		*c = '.';
+
+	return out;
+}
+
 /* "mangle" a rate counter group descriptor, i.e. replace any '.' with ':' */
 static struct rate_ctr_group_desc *
 rate_ctr_group_desc_mangle(void *ctx, const struct rate_ctr_group_desc *desc)
@@ -214,8 +264,9 @@ struct rate_ctr_group *rate_ctr_group_alloc(void *ctx,
 					    const struct rate_ctr_group_desc *desc,
 					    unsigned int idx)
 {
-	unsigned int size;
+	unsigned int size, i, j;
 	struct rate_ctr_group *group;
+	uint64_t now_ms;
 
 	if (rate_ctr_get_group_by_name_idx(desc->group_name_prefix, idx)) {
 		unsigned int new_idx = rate_ctr_get_unused_name_idx(desc->group_name_prefix);
@@ -235,6 +286,16 @@ struct rate_ctr_group *rate_ctr_group_alloc(void *ctx,
 	if (!group)
 		return NULL;
 
+	group->dirty_idx = talloc_array(group, unsigned int, desc->num_ctr);
+	if (!group->dirty_idx) {
+		talloc_free(group);
+		return NULL;
+	}
+	for (i = 0; i < desc->num_ctr; i++) {
+		group->ctr[i].self = &group->ctr[i];
+		group->ctr[i].group_idx = i + 1;
+	}
+
 	/* attempt to mangle all '.' in identifiers to ':' for backwards compat */
 	if (!rate_ctrl_group_desc_validate(desc)) {
 		desc = rate_ctr_group_desc_mangle(group, desc);
@@ -247,6 +308,24 @@ struct rate_ctr_group *rate_ctr_group_alloc(void *ctx,
 	group->desc = desc;
 	group->idx = idx;
 
+	memcpy(group->intv_ms, rate_ctr_default_intv_ms, sizeof(group->intv_ms));
+	now_ms = rate_ctr_now_ms();
+	for (i = 0; i < desc->num_ctr; i++) {
+		for (j = 0; j < RATE_CTR_INTV_NUM; j++)
+			group->ctr[i].intv[j].last_ms = now_ms;
+	}
+
+	/* statsd names are sanitized once here instead of on every report */
+	group->stats_names = talloc_array(group, const char *, desc->num_ctr);
+	if (!group->stats_names) {
+		talloc_free(group);
+		return NULL;
+	}
+	group->stats_prefix = stats_name_ifneeded(group, desc->group_name_prefix);
+	for (i = 0; i < desc->num_ctr; i++)
+		group->stats_names[i] = stats_name_ifneeded(group->stats_names,
+							    desc->ctr_desc[i].name);
+
 	llist_add(&group->list, &rate_ctr_groups);
 
 	return group;
@@ -256,13 +335,47 @@ struct rate_ctr_group *rate_ctr_group_alloc(void *ctx,
 void rate_ctr_group_free(struct rate_ctr_group *grp)
 {
 	llist_del(&grp->list);
+	if (grp->num_dirty)
+		llist_del(&grp->dirty_list);
 	talloc_free(grp);
 }
 
-/*! Add a number to the counter */
+/* Get the group of a counter allocated by rate_ctr_group_alloc(), NULL for
+ * counters outside of groups and copies of counters in groups */
+static struct rate_ctr_group *rate_ctr_group_of(struct rate_ctr *ctr)
+{
+	struct rate_ctr *first;
+
+	if (ctr->self != ctr || !ctr->group_idx)
+		return NULL;
+
+	first = ctr - (ctr->group_idx - 1);
+	return container_of(first, struct rate_ctr_group, ctr[0]);
+}
+
+/* Remember a counter as changed, so that the next report visits it */
+static void rate_ctr_mark_dirty(struct rate_ctr *ctr)
+{
+	struct rate_ctr_group *grp = rate_ctr_group_of(ctr);
+
+	if (!grp)
+		return;
+
+	ctr->dirty = 1;
+	if (grp->num_dirty++ == 0)
+		llist_add_tail(&grp->dirty_list, &rate_ctr_dirty_groups);
+	grp->dirty_idx[grp->num_dirty - 1] = ctr->group_idx - 1;
+}
+
+/*! Add a number to the counter
+ *
+ *  Only counters in their group are reported as changed to
+ *  \ref rate_ctr_for_each_dirty; a copy of a counter is not. */
 void rate_ctr_add(struct rate_ctr *ctr, int inc)
 {
 	ctr->current += inc;
+	if (!ctr->dirty)
+		rate_ctr_mark_dirty(ctr);
 }
 
 /*! Return the counter difference since the last call to this function */
@@ -274,55 +387,83 @@ int64_t rate_ctr_difference(struct rate_ctr *ctr)
 	return result;
 }
 
-/* TODO: support update intervals > 1s */
-/* TODO: implement this as a special stats reporter */
-
-static void interval_expired(struct rate_ctr *ctr, enum rate_ctr_intv intv)
-{
-	/* calculate rate over last interval */
-	ctr->intv[intv].rate = ctr->current - ctr->intv[intv].last;
-	/* save current counter for next interval */
-	ctr->intv[intv].last = ctr->current;
-
-	/* update the rate of the next bigger interval.  This will
-	 * be overwritten when that next larger interval expires */
-	if (intv + 1 < ARRAY_SIZE(ctr->intv))
-		ctr->intv[intv+1].rate += ctr->intv[intv].rate;
-}
-
-static struct osmo_timer_list rate_ctr_timer;
-static uint64_t timer_ticks;
-
-/* The one-second interval has expired */
-static void rate_ctr_group_intv(struct rate_ctr_group *grp)
+/*! Set the length of a rate counter interval of a group.
+ *  The rates of this interval start over with the next read.
+ *  \param[in] grp Rate counter group
+ *  \param[in] intv Interval to change, e.g. RATE_CTR_INTV_SEC
+ *  \param[in] ms Length of the interval in milliseconds
+ *  \returns 0 on success; negative on error */
+int rate_ctr_group_set_intv(struct rate_ctr_group *grp, enum rate_ctr_intv intv,
+			    uint32_t ms)
 {
+	uint64_t now_ms = rate_ctr_now_ms();
 	unsigned int i;
 
+	if (intv >= RATE_CTR_INTV_NUM || ms == 0)
+		return -EINVAL;
+
+	grp->intv_ms[intv] = ms;
 	for (i = 0; i < grp->desc->num_ctr; i++) {
-		struct rate_ctr *ctr = &grp->ctr[i];
-
-		interval_expired(ctr, RATE_CTR_INTV_SEC);
-		if ((timer_ticks % 60) == 0)
-			interval_expired(ctr, RATE_CTR_INTV_MIN);
-		if ((timer_ticks % (60*60)) == 0)
-			interval_expired(ctr, RATE_CTR_INTV_HOUR);
-		if ((timer_ticks % (24*60*60)) == 0)
-			interval_expired(ctr, RATE_CTR_INTV_DAY);
+		grp->ctr[i].intv[intv].last = grp->ctr[i].current;
+		grp->ctr[i].intv[intv].last_ms = now_ms;
+		grp->ctr[i].intv[intv].rate = 0;
 	}
+
+	return 0;
 }
 
-static void rate_ctr_timer_cb(void *data)
+/*! Check whether a rate counter interval of a group has its default length.
+ *  \param[in] grp Rate counter group
+ *  \param[in] intv Interval, e.g. RATE_CTR_INTV_SEC
+ *  \returns false if the length was changed by rate_ctr_group_set_intv() */
+bool rate_ctr_group_intv_is_default(const struct rate_ctr_group *grp,
+				    enum rate_ctr_intv intv)
 {
-	struct rate_ctr_group *ctrg;
+	if (intv >= RATE_CTR_INTV_NUM)
+		return false;
+	return grp->intv_ms[intv] == rate_ctr_default_intv_ms[intv];
+}
+
+/*! Get the rate of a counter in the last complete interval.
+ *  If the interval has passed since it was started, the rate is
+ *  computed from the snapshot in \a ctr->intv and a new interval is
+ *  started.  If more than one interval has passed, the average over the
+ *  whole time is returned.
+ *  \param[in] ctr Rate counter, its snapshot is updated
+ *  \param[in] intv Interval, e.g. RATE_CTR_INTV_SEC
+ *  \returns number of increments per interval */
+uint64_t rate_ctr_get_rate(struct rate_ctr *ctr, enum rate_ctr_intv intv)
+{
+	struct rate_ctr_per_intv *per_intv;
+	struct rate_ctr_group *grp;
+	uint64_t now_ms, elapsed, delta, len;
+
+	if (intv >= RATE_CTR_INTV_NUM)
+		return 0;
+
+	per_intv = &ctr->intv[intv];
+
+	grp = rate_ctr_group_of(ctr);
+	len = grp ? grp->intv_ms[intv] : rate_ctr_default_intv_ms[intv];
+	now_ms = rate_ctr_now_ms();
+
+	/* a counter outside of a group starts its intervals on the first read */
+	if (per_intv->last_ms == 0) {
+		per_intv->last = ctr->current;
+		per_intv->last_ms = now_ms;
+		return 0;
+	}
 
-	/* Increment number of ticks before we calculate intervals,
-	 * as a counter value of 0 would already wrap all counters */
-	timer_ticks++;
+	elapsed = now_ms - per_intv->last_ms;
+	if (elapsed < len)
+		return per_intv->rate;
 
-	llist_for_each_entry(ctrg, &rate_ctr_groups, list)
-		rate_ctr_group_intv(ctrg);
+	delta = ctr->current - per_intv->last;
+	per_intv->rate = delta / elapsed * len + delta % elapsed * len / elapsed;
+	per_intv->last = ctr->current;
+	per_intv->last_ms = now_ms;
 
-	osmo_timer_schedule(&rate_ctr_timer, 1, 0);
+	return per_intv->rate;
 }
 
 /*! Initialize the counter module. Call this once from your application.
@@ -331,8 +472,6 @@ static void rate_ctr_timer_cb(void *data)
 int rate_ctr_init(void *tall_ctx)
 {
 	tall_rate_ctr_ctx = tall_ctx;
-	osmo_timer_setup(&rate_ctr_timer, rate_ctr_timer_cb, NULL);
-	osmo_timer_schedule(&rate_ctr_timer, 1, 0);
 
 	return 0;
 }
@@ -422,4 +561,48 @@ int rate_ctr_for_each_group(rate_ctr_group_handler_t handle_group, void *data)
 	return rc;
 }
 
+/*! Iterate over the counters changed since the last call
+ *  Only the counters changed via rate_ctr_add() or rate_ctr_inc() since
+ *  the last call of this function or \ref rate_ctr_clear_dirty() are
+ *  visited, in the order in which their groups were first changed.
+ *  \param[in] handle_counter function pointer
+ *  \param[in] data Data to hand transparently to \ref handle_counter
+ *  \returns 0 on success; negative otherwise
+ */
+int rate_ctr_for_each_dirty(rate_ctr_handler_t handle_counter, void *data)
+{
+	struct rate_ctr_group *ctrg, *tmp;
+	struct rate_ctr *ctr;
+	unsigned int i;
+	int rc = 0;
+
+	llist_for_each_entry_safe(ctrg, tmp, &rate_ctr_dirty_groups, dirty_list) {
+		for (i = 0; i < ctrg->num_dirty; i++) {
+			ctr = &ctrg->ctr[ctrg->dirty_idx[i]];
+			ctr->dirty = 0;
+			if (rc >= 0)
+				rc = handle_counter(ctrg, ctr,
+					&ctrg->desc->ctr_desc[ctrg->dirty_idx[i]], data);
+		}
+		ctrg->num_dirty = 0;
+		llist_del(&ctrg->dirty_list);
+	}
+
+	return rc < 0 ? rc : 0;
+}
+
+/*! Forget which counters have changed, e.g. after visiting all of them */
+void rate_ctr_clear_dirty(void)
+{
+	struct rate_ctr_group *ctrg, *tmp;
+	unsigned int i;
+
+	llist_for_each_entry_safe(ctrg, tmp, &rate_ctr_dirty_groups, dirty_list) {
+		for (i = 0; i < ctrg->num_dirty; i++)
+			ctrg->ctr[ctrg->dirty_idx[i]].dirty = 0;
+		ctrg->num_dirty = 0;
+		llist_del(&ctrg->dirty_list);
+	}
+}
+
 /*! @} */
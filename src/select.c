@@ -27,6 +27,7 @@
 
 #include <fcntl.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
 #include <stdbool.h>
@@ -35,12 +36,17 @@
 #include <osmocom/core/select.h>
 #include <osmocom/core/linuxlist.h>
 #include <osmocom/core/timer.h>
+#include <osmocom/core/utils.h>
 
 #include "../config.h"
 
 #ifdef HAVE_SYS_SELECT_H
 #include <sys/select.h>
 
+#ifdef HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#endif
+
 /*! \addtogroup select
  *  @{
  *  select() loop abstraction
@@ -50,6 +56,269 @@
 static int maxfd = 0;
 static LLIST_HEAD(osmo_fds);
 static int unregistered_count;
+static enum osmo_select_backend select_backend = OSMO_SELECT_BACKEND_SELECT;
+
+#ifdef HAVE_SYS_EPOLL_H
+/*! maximum number of events fetched by one epoll_wait() call */
+#define EPOLL_BATCH_SIZE 256
+
+#define OSMO_FD_MASK (BSC_FD_READ | BSC_FD_WRITE | BSC_FD_EXCEPT)
+
+/* per-fd state of the epoll back-end */
+struct epoll_fd_state {
+	/* osmo_fd this state belongs to */
+	struct osmo_fd *ofd;
+	/* OS-level fd number the state is indexed by in epoll_fds */
+	int fd;
+	/* 'when' flags currently programmed into the epoll set */
+	unsigned int armed;
+	/* fd cannot be handled by epoll (e.g. regular file), which select()
+	 * would always report as ready */
+	bool always_ready;
+	/* entry in epoll_ofd_hash */
+	struct llist_head hash;
+};
+
+#define EPOLL_OFD_HASH_BITS 8
+
+static int epoll_fd = -1;
+/* states indexed by the OS-level fd number */
+static struct epoll_fd_state **epoll_fds;
+static unsigned int epoll_fds_size;
+/* states hashed by osmo_fd, as the fd number may already be changed when
+ * an osmo_fd gets unregistered */
+static struct llist_head epoll_ofd_hash[1 << EPOLL_OFD_HASH_BITS];
+static struct epoll_event epoll_events[EPOLL_BATCH_SIZE];
+/* index of the event currently being dispatched and number of events */
+static int epoll_events_cur;
+static int epoll_events_num;
+
+static struct llist_head *epoll_ofd_bucket(const struct osmo_fd *ofd)
+{
+	uint32_t h = (uint32_t)((uintptr_t)ofd >> 4) * 2654435761u;
+
+	return &epoll_ofd_hash[h >> (32 - EPOLL_OFD_HASH_BITS)];
+}
+
+static struct epoll_fd_state *epoll_state_get(const struct osmo_fd *ofd)
+{
+	if (ofd->fd < 0 || ofd->fd >= epoll_fds_size)
+		return NULL;
+	if (!epoll_fds[ofd->fd] || epoll_fds[ofd->fd]->ofd != ofd)
+		return NULL;
+	return epoll_fds[ofd->fd];
+}
+
+/* bring the epoll set in line with the current 'when' flags of an osmo_fd */
+static int epoll_state_sync(struct epoll_fd_state *st)
+{
+	struct osmo_fd *ofd = st->ofd;
+	unsigned int want = ofd->when & OSMO_FD_MASK;
+	struct epoll_event ev = {
+		.data.ptr = ofd,
+	};
+	int op, rc;
+
+	if (want == st->armed)
+		return 0;
+
+	if (st->always_ready) {
+		st->armed = want;
+		return 0;
+	}
+
+	/* epoll reports EPOLLERR/EPOLLHUP even for an empty event mask, so
+	 * remove fds without any 'when' flags from the set entirely */
+	if (!want)
+		op = EPOLL_CTL_DEL;
+	else if (!st->armed)
+		op = EPOLL_CTL_ADD;
+	else
+		op = EPOLL_CTL_MOD;
+
+	if (want & BSC_FD_READ)
+		ev.events |= EPOLLIN;
+	if (want & BSC_FD_WRITE)
+		ev.events |= EPOLLOUT;
+	if (want & BSC_FD_EXCEPT)
+		ev.events |= EPOLLPRI;
+
+	rc = epoll_ctl(epoll_fd, op, st->fd, &ev);
+	if (rc < 0) {
+		if (op == EPOLL_CTL_ADD && errno == EPERM) {
+			st->always_ready = true;
+			st->armed = want;
+			return 0;
+		}
+		if (op != EPOLL_CTL_DEL)
+			return -errno;
+	}
+
+	st->armed = want;
+	return 0;
+}
+
+/* release a state; the kernel drops closed fds from the epoll set itself */
+static void epoll_state_free(struct epoll_fd_state *st, bool closed)
+{
+	if (st->armed && !st->always_ready && !closed)
+		epoll_ctl(epoll_fd, EPOLL_CTL_DEL, st->fd, NULL);
+	epoll_fds[st->fd] = NULL;
+	llist_del(&st->hash);
+	free(st);
+}
+
+static int epoll_state_add(struct osmo_fd *ofd)
+{
+	struct epoll_fd_state *st, **fds;
+	int rc;
+
+	if (ofd->fd >= epoll_fds_size) {
+		unsigned int new_size = epoll_fds_size ? epoll_fds_size : 64;
+
+		while (new_size <= ofd->fd)
+			new_size *= 2;
+		fds = realloc(epoll_fds, new_size * sizeof(*fds));
+		if (!fds)
+			return -ENOMEM;
+		memset(fds + epoll_fds_size, 0, (new_size - epoll_fds_size) * sizeof(*fds));
+		epoll_fds = fds;
+		epoll_fds_size = new_size;
+	}
+
+	/* a stale entry left behind by an osmo_fd whose fd was closed without
+	 * unregistering it: the kernel already dropped it from the set */
+	if (epoll_fds[ofd->fd])
+		epoll_state_free(epoll_fds[ofd->fd], true);
+
+	st = calloc(1, sizeof(*st));
+	if (!st)
+		return -ENOMEM;
+	st->ofd = ofd;
+	st->fd = ofd->fd;
+
+	rc = epoll_state_sync(st);
+	if (rc < 0) {
+		free(st);
+		return rc;
+	}
+
+	epoll_fds[st->fd] = st;
+	llist_add(&st->hash, epoll_ofd_bucket(ofd));
+	return 0;
+}
+
+static void epoll_state_del(struct osmo_fd *ofd)
+{
+	struct epoll_fd_state *st = epoll_state_get(ofd);
+	int i;
+
+	if (!st) {
+		/* fd number was changed (typically closed and set to -1)
+		 * before unregistering */
+		struct epoll_fd_state *h;
+
+		llist_for_each_entry(h, epoll_ofd_bucket(ofd), hash) {
+			if (h->ofd == ofd) {
+				st = h;
+				break;
+			}
+		}
+	}
+
+	if (st)
+		epoll_state_free(st, ofd->fd != st->fd);
+
+	/* make sure not to dispatch pending events to an osmo_fd that was
+	 * unregistered (and possibly freed) from within a call-back */
+	for (i = epoll_events_cur + 1; i < epoll_events_num; i++) {
+		if (epoll_events[i].data.ptr == ofd)
+			epoll_events[i].data.ptr = NULL;
+	}
+}
+
+static void epoll_backend_exit(void)
+{
+	int i;
+
+	for (i = 0; i < epoll_fds_size; i++) {
+		if (epoll_fds[i])
+			epoll_state_free(epoll_fds[i], true);
+	}
+	if (epoll_fd >= 0)
+		close(epoll_fd);
+	epoll_fd = -1;
+	free(epoll_fds);
+	epoll_fds = NULL;
+	epoll_fds_size = 0;
+	epoll_events_cur = epoll_events_num = 0;
+}
+
+static int epoll_backend_init(void)
+{
+	struct osmo_fd *ofd;
+	int i, rc;
+
+	epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if (epoll_fd < 0)
+		return -errno;
+
+	for (i = 0; i < ARRAY_SIZE(epoll_ofd_hash); i++)
+		INIT_LLIST_HEAD(&epoll_ofd_hash[i]);
+
+	llist_for_each_entry(ofd, &osmo_fds, list) {
+		rc = epoll_state_add(ofd);
+		if (rc < 0) {
+			epoll_backend_exit();
+			return rc;
+		}
+	}
+
+	return 0;
+}
+#endif /* HAVE_SYS_EPOLL_H */
+
+/*! Select the back-end used by osmo_select_main() to wait for events
+ *  \param[in] backend the back-end to use from now on
+ *  \returns 0 on success; -ENOTSUP if \a backend is not available; negative on error
+ *
+ *  This is typically called once during program initialization, but
+ *  switching back-ends while file descriptors are registered is
+ *  supported as well.  The epoll back-end is not limited to FD_SETSIZE
+ *  and only dispatches file descriptors that actually became ready. */
+int osmo_select_set_backend(enum osmo_select_backend backend)
+{
+	if (backend == select_backend)
+		return 0;
+
+	switch (backend) {
+	case OSMO_SELECT_BACKEND_SELECT:
+#ifdef HAVE_SYS_EPOLL_H
+		epoll_backend_exit();
+#endif
+		break;
+#ifdef HAVE_SYS_EPOLL_H
+	case OSMO_SELECT_BACKEND_EPOLL: {
+		int rc = epoll_backend_init();
+		if (rc < 0)
+			return rc;
+		break;
+	}
+#endif
+	default:
+		return -ENOTSUP;
+	}
+
+	select_backend = backend;
+	return 0;
+}
+
+/*! Get the back-end currently used by osmo_select_main()
+ *  \returns back-end in use */
+enum osmo_select_backend osmo_select_get_backend(void)
+{
+	return select_backend;
+}
 
 /*! Set up an osmo-fd. Will not register it.
  *  \param[inout] ofd Osmo FD to be set-up
@@ -70,6 +339,15 @@ void osmo_fd_setup(struct osmo_fd *ofd, int fd, unsigned int when,
 	ofd->priv_nr = priv_nr;
 }
 
+/*! Update the 'when' flags of an osmo-fd
+ *  \param[inout] ofd Osmo FD to be updated
+ *  \param[in] and_mask bit-mask of BSC_FD_{READ,WRITE,EXECEPT} to keep
+ *  \param[in] or_mask bit-mask of BSC_FD_{READ,WRITE,EXECEPT} to set */
+void osmo_fd_update_when(struct osmo_fd *ofd, unsigned int and_mask, unsigned int or_mask)
+{
+	ofd->when = (ofd->when & and_mask) | or_mask;
+}
+
 /*! Check if a file descriptor is already registered
  *  \param[in] fd osmocom file descriptor to be checked
  *  \returns true if registered; otherwise false
@@ -77,6 +355,12 @@ void osmo_fd_setup(struct osmo_fd *ofd, int fd, unsigned int when,
 bool osmo_fd_is_registered(struct osmo_fd *fd)
 {
 	struct osmo_fd *entry;
+
+#ifdef HAVE_SYS_EPOLL_H
+	if (select_backend == OSMO_SELECT_BACKEND_EPOLL && fd->fd >= 0)
+		return epoll_state_get(fd) != NULL;
+#endif
+
 	llist_for_each_entry(entry, &osmo_fds, list) {
 		if (entry == fd) {
 			return true;
@@ -123,6 +407,14 @@ int osmo_fd_register(struct osmo_fd *fd)
 	}
 #endif
 
+#ifdef HAVE_SYS_EPOLL_H
+	if (select_backend == OSMO_SELECT_BACKEND_EPOLL) {
+		int rc = epoll_state_add(fd);
+		if (rc < 0)
+			return rc;
+	}
+#endif
+
 	llist_add_tail(&fd->list, &osmo_fds);
 
 	return 0;
@@ -138,6 +430,10 @@ void osmo_fd_unregister(struct osmo_fd *fd)
 	 * osmo_fd_is_registered() */
 	unregistered_count++;
 	llist_del(&fd->list);
+#ifdef HAVE_SYS_EPOLL_H
+	if (select_backend == OSMO_SELECT_BACKEND_EPOLL)
+		epoll_state_del(fd);
+#endif
 }
 
 /*! Close a file descriptor, mark it as closed + unregister from select loop abstraction
@@ -227,16 +523,102 @@ restart:
 	return work;
 }
 
+#ifdef HAVE_SYS_EPOLL_H
+static int osmo_epoll_main(int polling)
+{
+	struct epoll_fd_state *st;
+	struct osmo_fd *ufd;
+	struct timeval *tv;
+	int num_ready = 0;
+	int timeout = 0;
+	int work = 0;
+	int rc;
+
+	/* pick up 'when' changes made since the last iteration, wherever they
+	 * were made; only changed fds cost an epoll_ctl().  fds that epoll
+	 * cannot handle are reported as ready right away, like select() does */
+	llist_for_each_entry(ufd, &osmo_fds, list) {
+		st = epoll_state_get(ufd);
+		if (!st)
+			continue;
+		if ((ufd->when & OSMO_FD_MASK) != st->armed &&
+		    epoll_state_sync(st) < 0)
+			continue;
+		if (st->always_ready && st->armed && num_ready < EPOLL_BATCH_SIZE) {
+			epoll_events[num_ready].events = EPOLLIN | EPOLLOUT;
+			epoll_events[num_ready].data.ptr = ufd;
+			num_ready++;
+		}
+	}
+
+	if (!polling && !num_ready) {
+		osmo_timers_prepare();
+		tv = osmo_timers_nearest();
+		if (!tv)
+			timeout = -1;
+		else
+			timeout = tv->tv_sec * 1000 + (tv->tv_usec + 999) / 1000;
+	}
+
+	rc = epoll_wait(epoll_fd, epoll_events + num_ready,
+			EPOLL_BATCH_SIZE - num_ready, timeout);
+	if (rc < 0)
+		return 0;
+	epoll_events_num = num_ready + rc;
+
+	/* read the clock once for all timers (re-)armed in this iteration */
+	osmo_timers_cache_now(true);
+
+	/* fire timers */
+	osmo_timers_update();
+
+	/* call registered callback functions */
+	for (epoll_events_cur = 0; epoll_events_cur < epoll_events_num; epoll_events_cur++) {
+		struct epoll_event *ev = &epoll_events[epoll_events_cur];
+		unsigned int flags = 0;
+
+		ufd = ev->data.ptr;
+		if (!ufd)
+			continue;
+
+		if (ev->events & (EPOLLIN | EPOLLERR | EPOLLHUP))
+			flags |= BSC_FD_READ;
+		if (ev->events & (EPOLLOUT | EPOLLERR))
+			flags |= BSC_FD_WRITE;
+		if (ev->events & EPOLLPRI)
+			flags |= BSC_FD_EXCEPT;
+		flags &= ufd->when;
+
+		if (flags) {
+			work = 1;
+			ufd->cb(ufd, flags);
+		}
+	}
+	epoll_events_cur = epoll_events_num = 0;
+
+	osmo_timers_cache_now(false);
+
+	return work;
+}
+#endif /* HAVE_SYS_EPOLL_H */
+
 /*! select main loop integration
  *  \param[in] polling should we pollonly (1) or block on select (0)
  *  \returns 0 if no fd handled; 1 if fd handled; negative in case of error
- */
+ *
+ *  Depending on osmo_select_set_backend(), this waits for events using
+ *  either select() or epoll. */
 int osmo_select_main(int polling)
 {
 	fd_set readset, writeset, exceptset;
 	int rc;
 	struct timeval no_time = {0, 0};
 
+#ifdef HAVE_SYS_EPOLL_H
+	if (select_backend == OSMO_SELECT_BACKEND_EPOLL)
+		return osmo_epoll_main(polling);
+#endif
+
 	FD_ZERO(&readset);
 	FD_ZERO(&writeset);
 	FD_ZERO(&exceptset);
@@ -250,11 +632,18 @@ int osmo_select_main(int polling)
 	if (rc < 0)
 		return 0;
 
+	/* read the clock once for all timers (re-)armed in this iteration */
+	osmo_timers_cache_now(true);
+
 	/* fire timers */
 	osmo_timers_update();
 
 	/* call registered callback functions */
-	return osmo_fd_disp_fds(&readset, &writeset, &exceptset);
+	rc = osmo_fd_disp_fds(&readset, &writeset, &exceptset);
+
+	osmo_timers_cache_now(false);
+
+	return rc;
 }
 
 /*! find an osmo_fd based on the integer fd
@@ -264,6 +653,11 @@ struct osmo_fd *osmo_fd_get_by_fd(int fd)
 {
 	struct osmo_fd *ofd;
 
+#ifdef HAVE_SYS_EPOLL_H
+	if (select_backend == OSMO_SELECT_BACKEND_EPOLL)
+		return (fd >= 0 && fd < epoll_fds_size && epoll_fds[fd]) ? epoll_fds[fd]->ofd : NULL;
+#endif
+
 	llist_for_each_entry(ofd, &osmo_fds, list) {
 		if (ofd->fd == fd)
 			return ofd;
@@ -60,9 +60,12 @@
 #include <osmocom/core/talloc.h>
 #include <osmocom/core/timer.h>
 #include <osmocom/core/stat_item.h>
+#include <osmocom/core/stats_internal.h>
 
 /*! global list of stat_item groups */
 static LLIST_HEAD(osmo_stat_item_groups);
+/*! list of groups with items set since the last osmo_stat_item_for_each_dirty() */
+static LLIST_HEAD(osmo_stat_item_dirty_groups);
 /*! counter for assigning globally unique value identifiers */
 static int32_t global_value_id = 0;
 
@@ -100,6 +103,14 @@ struct osmo_stat_item_group *osmo_stat_item_group_alloc(void *ctx,
 	group->desc = desc;
 	group->idx = idx;
 
+	group->dirty_idx = talloc_array(group, unsigned int, desc->num_items);
+	group->stats_names = talloc_array(group, const char *, desc->num_items);
+	if (!group->dirty_idx || !group->stats_names) {
+		talloc_free(group);
+		return NULL;
+	}
+	group->stats_prefix = stats_name_ifneeded(group, desc->group_name_prefix);
+
 	/* Get combined size of all items */
 	for (item_idx = 0; item_idx < desc->num_items; item_idx++) {
 		unsigned int size;
@@ -131,6 +142,10 @@ struct osmo_stat_item_group *osmo_stat_item_group_alloc(void *ctx,
 		item->last_offs = desc->item_desc[item_idx].num_values - 1;
 		item->last_value_index = -1;
 		item->desc = &desc->item_desc[item_idx];
+		item->idx = item_idx;
+		item->group = group;
+		group->stats_names[item_idx] = stats_name_ifneeded(group->stats_names,
+								   item->desc->name);
 
 		for (i = 0; i <= item->last_offs; i++) {
 			item->values[i].value = desc->item_desc[item_idx].default_value;
@@ -147,6 +162,8 @@ struct osmo_stat_item_group *osmo_stat_item_group_alloc(void *ctx,
 void osmo_stat_item_group_free(struct osmo_stat_item_group *grp)
 {
 	llist_del(&grp->list);
+	if (grp->num_dirty)
+		llist_del(&grp->dirty_list);
 	talloc_free(grp);
 }
 
@@ -168,6 +185,16 @@ void osmo_stat_item_set(struct osmo_stat_item *item, int32_t value)
 
 	item->values[item->last_offs].value = value;
 	item->values[item->last_offs].id    = global_value_id;
+
+	/* a copy of an item is not tracked */
+	if (!item->dirty && item->group && item->group->items[item->idx] == item) {
+		struct osmo_stat_item_group *grp = item->group;
+
+		item->dirty = 1;
+		if (grp->num_dirty++ == 0)
+			llist_add_tail(&grp->dirty_list, &osmo_stat_item_dirty_groups);
+		grp->dirty_idx[grp->num_dirty - 1] = item->idx;
+	}
 }
 
 /*! Retrieve the next value from the osmo_stat_item object.
@@ -332,4 +359,47 @@ int osmo_stat_item_for_each_group(osmo_stat_item_group_handler_t handle_group, v
 	return rc;
 }
 
+/*! Iterate over the items set since the last call
+ *  Only the items set via osmo_stat_item_set() since the last call of
+ *  this function or \ref osmo_stat_item_clear_dirty() are visited, in
+ *  the order in which their groups were first set.
+ *  \param[in] handle_item Call-back function, aborts if rc < 0
+ *  \param[in] data Private data handed through to \a handle_item
+ *  \returns 0 on success; negative otherwise
+ */
+int osmo_stat_item_for_each_dirty(osmo_stat_item_handler_t handle_item, void *data)
+{
+	struct osmo_stat_item_group *statg, *tmp;
+	struct osmo_stat_item *item;
+	unsigned int i;
+	int rc = 0;
+
+	llist_for_each_entry_safe(statg, tmp, &osmo_stat_item_dirty_groups, dirty_list) {
+		for (i = 0; i < statg->num_dirty; i++) {
+			item = statg->items[statg->dirty_idx[i]];
+			item->dirty = 0;
+			if (rc >= 0)
+				rc = handle_item(statg, item, data);
+		}
+		statg->num_dirty = 0;
+		llist_del(&statg->dirty_list);
+	}
+
+	return rc < 0 ? rc : 0;
+}
+
+/*! Forget which items have been set, e.g. after visiting all of them */
+void osmo_stat_item_clear_dirty(void)
+{
+	struct osmo_stat_item_group *statg, *tmp;
+	unsigned int i;
+
+	llist_for_each_entry_safe(statg, tmp, &osmo_stat_item_dirty_groups, dirty_list) {
+		for (i = 0; i < statg->num_dirty; i++)
+			statg->items[statg->dirty_idx[i]]->dirty = 0;
+		statg->num_dirty = 0;
+		llist_del(&statg->dirty_list);
+	}
+}
+
 /*! @} */
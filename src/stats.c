@@ -44,6 +44,11 @@
  *   \ref osmo_stats_reporter_create_statsd() creates a new stats_reporter
  *   which reports via UDP to statsd.
  *
+ * - being scraped by Prometheus (or any other OpenMetrics consumer)
+ *   \ref osmo_stats_reporter_create_prometheus() creates a new
+ *   stats_reporter which answers HTTP requests for /metrics on a local
+ *   TCP port.
+ *
  * You can either use the above API functions directly to create \ref
  * osmo_stats_reporter instances, or you can use the VTY support
  * contained in libosmovty.  See the "stats" configuration node
@@ -54,14 +59,21 @@
  * - \ref osmo_counter
  * - \ref rate_ctr
  * - \ref osmo_stat_item
+ * - \ref osmo_histogram (as count, mean, max and percentile gauges)
  *
  * You do not need to do anything in particular to expose a given
  * counter or stat_item, they are all exported automatically via any
  * \ref osmo_stats_reporter.  If you have multiple \ref
  * osmo_stats_reporter, they will each report all counters/stat_items.
  *
+ * rate_ctr_add() and osmo_stat_item_set() remember which counters and
+ * items have changed, so a report only visits those instead of every
+ * counter in the system.  All of them are visited once when a reporter
+ * has just been enabled and has to send a full set of values.
+ *
  * \file stats.c */
 
+#define _GNU_SOURCE	/* sendmmsg() */
 #include "config.h"
 #if !defined(EMBEDDED)
 
@@ -85,6 +97,7 @@
 #include <osmocom/core/logging.h>
 #include <osmocom/core/rate_ctr.h>
 #include <osmocom/core/stat_item.h>
+#include <osmocom/core/histogram.h>
 #include <osmocom/core/timer.h>
 #include <osmocom/core/counter.h>
 #include <osmocom/core/msgb.h>
@@ -297,6 +310,26 @@ int osmo_stats_reporter_set_local_addr(struct osmo_stats_reporter *srep, const c
 	return update_srep_config(srep);
 }
 
+/*! Set the local (TCP) port of a given stats_reporter.
+ *  \param[in] srep stats_reporter whose local port is to be set
+ *  \param[in] port TCP port to listen on, 0 for an ephemeral port
+ *  \returns 0 on success; negative on error */
+int osmo_stats_reporter_set_local_port(struct osmo_stats_reporter *srep, int port)
+{
+	struct sockaddr_in *sock_addr = (struct sockaddr_in *)&srep->bind_addr;
+
+	if (!srep->have_net_config)
+		return -ENOTSUP;
+
+	if (port < 0 || port > 65535)
+		return -EINVAL;
+
+	srep->bind_port = port;
+	sock_addr->sin_port = osmo_htons(port);
+
+	return update_srep_config(srep);
+}
+
 /*! Set the maximum transmission unit of a given stats_reporter.
  *  \param[in] srep stats_reporter whose remote address is to be set
  *  \param[in] mtu Maximum Transmission Unit of \a srep
@@ -412,11 +445,16 @@ int osmo_stats_reporter_udp_open(struct osmo_stats_reporter *srep)
 
 	srep->fd = sock;
 
+	srep->dgram_size = buffer_size;
 	if (srep->mtu > 0) {
-		buffer_size = srep->mtu - 20 /* IP */ - 8 /* UDP */;
+		srep->dgram_size = srep->mtu - 20 /* IP */ - 8 /* UDP */;
+		/* room for several datagrams, sent with one system call */
+		buffer_size = OSMO_MIN(srep->dgram_size * OSMO_STATS_MAX_DGRAMS,
+				       UINT16_MAX);
 		srep->agg_enabled = 1;
 	}
 
+	srep->num_dgrams = 0;
 	srep->buffer = msgb_alloc(buffer_size, "stats buffer");
 
 	return 0;
@@ -469,7 +507,60 @@ int osmo_stats_reporter_send(struct osmo_stats_reporter *srep, const char *data,
 	return rc;
 }
 
+#ifdef HAVE_SENDMMSG
+static int send_dgrams(struct osmo_stats_reporter *srep)
+{
+	struct mmsghdr mmsg[OSMO_STATS_MAX_DGRAMS];
+	struct iovec iov[OSMO_STATS_MAX_DGRAMS];
+	unsigned int i, start = 0, sent = 0;
+	int rc;
+
+	for (i = 0; i < srep->num_dgrams; i++) {
+		iov[i].iov_base = msgb_data(srep->buffer) + start;
+		iov[i].iov_len = srep->dgram_end[i] - start;
+		memset(&mmsg[i], 0, sizeof(mmsg[i]));
+		mmsg[i].msg_hdr.msg_name = &srep->dest_addr;
+		mmsg[i].msg_hdr.msg_namelen = srep->dest_addr_len;
+		mmsg[i].msg_hdr.msg_iov = &iov[i];
+		mmsg[i].msg_hdr.msg_iovlen = 1;
+		start = srep->dgram_end[i];
+	}
+
+	while (sent < srep->num_dgrams) {
+		rc = sendmmsg(srep->fd, &mmsg[sent], srep->num_dgrams - sent,
+#ifdef MSG_NOSIGNAL
+			MSG_NOSIGNAL |
+#endif
+			MSG_DONTWAIT);
+		if (rc <= 0)
+			return rc < 0 ? -errno : -EAGAIN;
+		sent += rc;
+	}
+
+	return start;
+}
+#else
+static int send_dgrams(struct osmo_stats_reporter *srep)
+{
+	unsigned int i, start = 0;
+	int rc;
+
+	for (i = 0; i < srep->num_dgrams; i++) {
+		rc = osmo_stats_reporter_send(srep,
+			(const char *)msgb_data(srep->buffer) + start,
+			srep->dgram_end[i] - start);
+		if (rc < 0)
+			return rc;
+		start = srep->dgram_end[i];
+	}
+
+	return start;
+}
+#endif
+
 /*! Send current accumulated buffer to given stats_reporter.
+ *  All datagrams completed by \ref osmo_stats_reporter_end_dgram() and
+ *  the one being filled are sent at once.
  *  \param[in] srep stats_reporter whose UDP socket is to be opened
  *  \returns number of bytes on success; negative otherwise */
 int osmo_stats_reporter_send_buffer(struct osmo_stats_reporter *srep)
@@ -479,13 +570,41 @@ int osmo_stats_reporter_send_buffer(struct osmo_stats_reporter *srep)
 	if (!srep->buffer || msgb_length(srep->buffer) == 0)
 		return 0;
 
-	rc = osmo_stats_reporter_send(srep,
-		(const char *)msgb_data(srep->buffer), msgb_length(srep->buffer));
+	if (srep->num_dgrams == 0 ||
+	    srep->dgram_end[srep->num_dgrams - 1] < msgb_length(srep->buffer))
+		srep->dgram_end[srep->num_dgrams++] = msgb_length(srep->buffer);
+
+	rc = send_dgrams(srep);
 
 	msgb_trim(srep->buffer, 0);
+	srep->num_dgrams = 0;
 
 	return rc;
 }
+
+/*! Complete the datagram being filled in the buffer of a stats_reporter.
+ *  Following data goes to a new datagram. When the buffer has no room
+ *  for another one of \a dgram_size, all of them are sent.
+ *  \param[in] srep stats_reporter whose buffer is to be used
+ *  \returns number of bytes sent, 0 if none; negative otherwise */
+int osmo_stats_reporter_end_dgram(struct osmo_stats_reporter *srep)
+{
+	unsigned int len = msgb_length(srep->buffer);
+	unsigned int max_dgrams;
+
+	if (len == 0 ||
+	    (srep->num_dgrams > 0 && srep->dgram_end[srep->num_dgrams - 1] == len))
+		return 0;
+
+	srep->dgram_end[srep->num_dgrams++] = len;
+
+	max_dgrams = OSMO_MIN(OSMO_STATS_MAX_DGRAMS,
+			      srep->buffer->data_len / srep->dgram_size);
+	if (srep->num_dgrams < max_dgrams)
+		return 0;
+
+	return osmo_stats_reporter_send_buffer(srep);
+}
 #endif /* HAVE_SYS_SOCKET_H */
 
 /*** log reporter ***/
@@ -580,7 +699,11 @@ static int rate_ctr_handler(
 	const struct rate_ctr_desc *desc, void *sctx_)
 {
 	struct osmo_stats_reporter *srep;
-	int64_t delta = rate_ctr_difference(ctr);
+	int64_t delta = ctr->current - ctr->reported;
+
+	/* The snapshot belongs to the reporters, so rate_ctr_difference()
+	 * users elsewhere do not take away the delta */
+	ctr->reported = ctr->current;
 
 	llist_for_each_entry(srep, &osmo_stats_reporter_list, list) {
 		if (!srep->running)
@@ -696,6 +819,92 @@ static int handle_counter(struct osmo_counter *counter, void *sctx_)
 }
 
 
+/*** histogram support ***/
+
+/* Summary values reported for each histogram */
+enum {
+	HIST_COUNT,
+	HIST_MEAN,
+	HIST_MAX,
+	HIST_P50,
+	HIST_P90,
+	HIST_P99,
+	HIST_P999,
+	_NUM_HIST_VALUES
+};
+
+static const char *hist_value_names[_NUM_HIST_VALUES] = {
+	[HIST_COUNT]	= "count",
+	[HIST_MEAN]	= "mean",
+	[HIST_MAX]	= "max",
+	[HIST_P50]	= "p50",
+	[HIST_P90]	= "p90",
+	[HIST_P99]	= "p99",
+	[HIST_P999]	= "p999",
+};
+
+static const unsigned int hist_permille[] = { 500, 900, 990, 999 };
+
+static int osmo_histogram_group_handler(struct osmo_histogram_group *histg, void *sctx_)
+{
+	/* Fake a stat item group, the summary of each histogram is reported
+	 * as a set of gauges named <histogram>.<value> */
+	struct osmo_stat_item_group_desc statg_desc = {
+		.group_name_prefix = histg->desc->group_name_prefix,
+		.group_description = histg->desc->group_description,
+		.class_id = histg->desc->class_id,
+	};
+	struct osmo_stat_item_group statg = {
+		.desc = &statg_desc,
+		.idx = histg->idx,
+	};
+	struct osmo_stat_item_desc desc = {0};
+	struct osmo_stats_reporter *srep;
+	struct osmo_histogram *hist;
+	int64_t values[_NUM_HIST_VALUES];
+	uint64_t pct[ARRAY_SIZE(hist_permille)];
+	char name[128];
+	uint64_t delta;
+	unsigned int i, v;
+
+	for (i = 0; i < histg->desc->num_hist; i++) {
+		hist = &histg->hist[i];
+		delta = osmo_histogram_difference(hist);
+
+		values[HIST_COUNT] = hist->count;
+		values[HIST_MEAN] = hist->count ? hist->sum / hist->count : 0;
+		values[HIST_MAX] = hist->max;
+		osmo_histogram_percentiles(hist, hist_permille, pct, ARRAY_SIZE(pct));
+		for (v = 0; v < ARRAY_SIZE(pct); v++)
+			values[HIST_P50 + v] = pct[v];
+
+		for (v = 0; v < _NUM_HIST_VALUES; v++) {
+			snprintf(name, sizeof(name), "%s.%s", hist->desc->name,
+				 hist_value_names[v]);
+			desc.name = name;
+			desc.description = hist->desc->description;
+			desc.unit = v == HIST_COUNT ? OSMO_STAT_ITEM_NO_UNIT :
+				hist->desc->unit;
+
+			llist_for_each_entry(srep, &osmo_stats_reporter_list, list) {
+				if (!srep->running || !srep->send_item)
+					continue;
+
+				if (delta == 0 && !srep->force_single_flush)
+					continue;
+
+				if (!osmo_stats_reporter_check_config(srep,
+						histg->idx, histg->desc->class_id))
+					continue;
+
+				srep->send_item(srep, &statg, &desc, values[v]);
+			}
+		}
+	}
+
+	return 0;
+}
+
 /*** main reporting function ***/
 
 static void flush_all_reporters()
@@ -711,12 +920,36 @@ static void flush_all_reporters()
 	}
 }
 
+static int need_full_report()
+{
+	struct osmo_stats_reporter *srep;
+
+	llist_for_each_entry(srep, &osmo_stats_reporter_list, list) {
+		if (srep->running && srep->force_single_flush)
+			return 1;
+	}
+
+	return 0;
+}
+
 int osmo_stats_report()
 {
 	/* per group actions */
 	osmo_counters_for_each(handle_counter, NULL);
-	rate_ctr_for_each_group(rate_ctr_group_handler, NULL);
-	osmo_stat_item_for_each_group(osmo_stat_item_group_handler, NULL);
+
+	if (need_full_report()) {
+		/* A reporter wants every value once, e.g. after being enabled */
+		rate_ctr_for_each_group(rate_ctr_group_handler, NULL);
+		rate_ctr_clear_dirty();
+		osmo_stat_item_for_each_group(osmo_stat_item_group_handler, NULL);
+		osmo_stat_item_clear_dirty();
+	} else {
+		/* Unchanged counters and items would not be sent anyway */
+		rate_ctr_for_each_dirty(rate_ctr_handler, NULL);
+		osmo_stat_item_for_each_dirty(osmo_stat_item_handler, NULL);
+	}
+
+	osmo_histogram_for_each_group(osmo_histogram_group_handler, NULL);
 
 	/* global actions */
 	osmo_stat_item_discard_all(&current_stat_item_index);
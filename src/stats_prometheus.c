@@ -0,0 +1,1082 @@
+/*
+ * (C) 2018 by sysmocom - s.f.m.c. GmbH
+ * All Rights Reserved
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+/*! \addtogroup stats
+ *  @{
+ *
+ * The Prometheus reporter is a pull exporter: instead of sending the
+ * values on every reporting interval, it listens on a TCP port and
+ * answers HTTP/1.1 "GET /metrics" requests (as done by a Prometheus
+ * server scraping this process) with the current value of every \ref
+ * rate_ctr, \ref osmo_stat_item and \ref osmo_counter, and with a
+ * summary (quantiles, sum and count) of every \ref osmo_histogram.
+ *
+ * The metrics are rendered straight from the counter groups into one
+ * response buffer per connection, which is kept across requests of a
+ * keep-alive connection.  Nothing is done between scrapes.
+ *
+ * Metric names are formed from the reporter's name prefix, the group
+ * name prefix and the counter name, with all characters not allowed in
+ * Prometheus metric names replaced by '_'.  The group name and index
+ * are given as "group" and "idx" labels, e.g.
+ *
+ *	# HELP bssgp_bss_ctx_packets_in_total Packets at BSSGP Level ( In)
+ *	# TYPE bssgp_bss_ctx_packets_in_total counter
+ *	bssgp_bss_ctx_packets_in_total{group="bssgp:bss_ctx",idx="1"} 1234
+ *
+ * The Prometheus text format (version 0.0.4) is used, unless the
+ * client asks for application/openmetrics-text.
+ *
+ *  \file stats_prometheus.c */
+
+#include "config.h"
+#if !defined(EMBEDDED)
+
+#include <osmocom/core/stats.h>
+
+#include <unistd.h>
+#include <string.h>
+#include <strings.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <errno.h>
+
+#ifdef HAVE_SYS_SOCKET_H
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#include <osmocom/core/utils.h>
+#include <osmocom/core/logging.h>
+#include <osmocom/core/rate_ctr.h>
+#include <osmocom/core/stat_item.h>
+#include <osmocom/core/histogram.h>
+#include <osmocom/core/counter.h>
+#include <osmocom/core/select.h>
+#include <osmocom/core/socket.h>
+#include <osmocom/core/timer.h>
+#include <osmocom/core/talloc.h>
+
+#define PROM_MAX_CONN		8
+#define PROM_RX_BUF		2048
+#define PROM_IDLE_TIMEOUT	60 /* secs */
+/* room kept in front of the body for the response header */
+#define PROM_HDR_ROOM		256
+#define PROM_MIN_BUF		4096
+
+/* growing output buffer, data[start..len) is to be sent */
+struct prom_buf {
+	char *data;
+	size_t start;
+	size_t len;
+	size_t size;
+	/* an allocation failed, the content is incomplete */
+	int oom;
+};
+
+struct prom_srv {
+	struct osmo_stats_reporter *srep;
+	struct osmo_fd listen_ofd;
+	struct llist_head conns;
+	unsigned int num_conns;
+	/* groups of one kind sorted by description, reused between scrapes */
+	const void **groups;
+	size_t groups_size;
+	size_t groups_num;
+	/* size of the last response, to pre-allocate the next one */
+	size_t last_len;
+};
+
+struct prom_conn {
+	struct llist_head list;
+	struct prom_srv *srv;
+	struct osmo_fd ofd;
+	struct osmo_timer_list timer;
+	char rx[PROM_RX_BUF];
+	size_t rx_len;
+	struct prom_buf tx;
+	int keep_alive;
+};
+
+/*** output buffer ***/
+
+static int prom_reserve(struct prom_srv *srv, struct prom_buf *b, size_t n)
+{
+	size_t size;
+	char *data;
+
+	if (b->len + n <= b->size)
+		return 0;
+
+	size = b->size ? b->size : PROM_MIN_BUF;
+	while (size < b->len + n)
+		size *= 2;
+
+	data = talloc_realloc_size(srv, b->data, size);
+	if (!data) {
+		b->oom = 1;
+		return -ENOMEM;
+	}
+
+	b->data = data;
+	b->size = size;
+	return 0;
+}
+
+static void prom_put(struct prom_srv *srv, struct prom_buf *b, const char *s, size_t n)
+{
+	if (prom_reserve(srv, b, n) < 0)
+		return;
+	memcpy(b->data + b->len, s, n);
+	b->len += n;
+}
+
+static void prom_put_str(struct prom_srv *srv, struct prom_buf *b, const char *s)
+{
+	prom_put(srv, b, s, strlen(s));
+}
+
+/* Map everything but [a-zA-Z0-9_] (and the terminating NUL) to '_' */
+static char prom_name_char(char c)
+{
+	if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+	    (c >= '0' && c <= '9') || c == '\0')
+		return c;
+	return '_';
+}
+
+/* Compare two parts of metric names the way prom_put_name() writes them */
+static int prom_name_cmp(const char *a, const char *b)
+{
+	for (; *a && prom_name_char(*a) == prom_name_char(*b); a++, b++);
+	return (unsigned char)prom_name_char(*a) - (unsigned char)prom_name_char(*b);
+}
+
+/* Append part of a metric name, mapping everything but [a-zA-Z0-9_] to '_' */
+static void prom_put_name(struct prom_srv *srv, struct prom_buf *b, const char *s)
+{
+	size_t n = strlen(s);
+	char *p;
+
+	if (prom_reserve(srv, b, n + 1) < 0)
+		return;
+
+	p = b->data + b->len;
+	/* a name must not start with a digit */
+	if (b->len == 0 || p[-1] == '\n' || p[-1] == ' ') {
+		if (*s >= '0' && *s <= '9')
+			*p++ = '_';
+	}
+	for (; *s; s++)
+		*p++ = prom_name_char(*s);
+	b->len = p - b->data;
+}
+
+/* Append a HELP text (escape \ and newline) or a label value (also ") */
+static void prom_put_escaped(struct prom_srv *srv, struct prom_buf *b, const char *s,
+			     int quote)
+{
+	size_t n = strlen(s);
+	char *p;
+
+	if (prom_reserve(srv, b, 2 * n) < 0)
+		return;
+
+	p = b->data + b->len;
+	for (; *s; s++) {
+		switch (*s) {
+		case '\\':
+			*p++ = '\\';
+			*p++ = '\\';
+			break;
+		case '\n':
+			*p++ = '\\';
+			*p++ = 'n';
+			break;
+		case '"':
+			if (quote)
+				*p++ = '\\';
+			/* fall through */
+		default:
+			*p++ = *s;
+		}
+	}
+	b->len = p - b->data;
+}
+
+/* Format an integer without going through snprintf() */
+static void prom_put_int(struct prom_srv *srv, struct prom_buf *b, int64_t v)
+{
+	char tmp[20];
+	uint64_t u = v < 0 ? -(uint64_t)v : v;
+	int n = 0;
+	char *p;
+
+	do {
+		tmp[n++] = '0' + u % 10;
+		u /= 10;
+	} while (u);
+
+	if (prom_reserve(srv, b, n + 1) < 0)
+		return;
+
+	p = b->data + b->len;
+	if (v < 0)
+		*p++ = '-';
+	while (n)
+		*p++ = tmp[--n];
+	b->len = p - b->data;
+}
+
+/*** rendering ***/
+
+static int prom_check_class(struct osmo_stats_reporter *srep, unsigned int index,
+			    int class_id)
+{
+	if (class_id == OSMO_STATS_CLASS_UNKNOWN)
+		class_id = index != 0 ?
+			OSMO_STATS_CLASS_SUBSCRIBER : OSMO_STATS_CLASS_GLOBAL;
+
+	return class_id <= srep->max_class;
+}
+
+/* Append prefix_group_name with suffix, as metric name */
+static void prom_put_metric_name(struct prom_srv *srv, struct prom_buf *b,
+				 const char *group, const char *name,
+				 const char *suffix)
+{
+	const char *prefix = srv->srep->name_prefix;
+
+	if (prefix) {
+		prom_put_name(srv, b, prefix);
+		prom_put(srv, b, "_", 1);
+	}
+	if (group) {
+		prom_put_name(srv, b, group);
+		prom_put(srv, b, "_", 1);
+	}
+	prom_put_name(srv, b, name);
+	prom_put_str(srv, b, suffix);
+}
+
+/* Write the HELP and TYPE lines of a metric family */
+static void prom_put_meta(struct prom_srv *srv, struct prom_buf *b,
+			  const char *group, const char *name, const char *sfx,
+			  const char *help, const char *type)
+{
+	prom_put_str(srv, b, "# HELP ");
+	prom_put_metric_name(srv, b, group, name, sfx);
+	prom_put(srv, b, " ", 1);
+	prom_put_escaped(srv, b, help ? help : "", 0);
+	prom_put_str(srv, b, "\n# TYPE ");
+	prom_put_metric_name(srv, b, group, name, sfx);
+	prom_put(srv, b, " ", 1);
+	prom_put_str(srv, b, type);
+	prom_put(srv, b, "\n", 1);
+}
+
+/* Append the group label and the start of the idx label */
+static void prom_put_group_label(struct prom_srv *srv, struct prom_buf *b,
+				 const char *group)
+{
+	prom_put_str(srv, b, "{group=\"");
+	prom_put_escaped(srv, b, group, 1);
+	prom_put_str(srv, b, "\",idx=\"");
+}
+
+/* Write the name and constant labels of a sample. Returns their offset,
+ * prom_put_sample() copies them for the following samples. */
+static size_t prom_put_sample_prefix(struct prom_srv *srv, struct prom_buf *b,
+				     const char *group, const char *name,
+				     const char *type)
+{
+	const char *sfx = strcmp(type, "counter") ? "" : "_total";
+	size_t ofs = b->len;
+
+	prom_put_metric_name(srv, b, group, name, sfx);
+	if (group)
+		prom_put_group_label(srv, b, group);
+
+	return ofs;
+}
+
+/* Write the HELP and TYPE lines of a metric family, followed by the name
+ * and constant labels of its first sample, see prom_put_sample_prefix() */
+static size_t prom_put_family(struct prom_srv *srv, struct prom_buf *b, int om,
+			      const char *group, const char *name,
+			      const char *help, const char *type)
+{
+	/* OpenMetrics names the family of a counter without _total */
+	const char *sfx = strcmp(type, "counter") || om ? "" : "_total";
+
+	prom_put_meta(srv, b, group, name, sfx, help, type);
+
+	return prom_put_sample_prefix(srv, b, group, name, type);
+}
+
+/* Append one sample, the name and labels are at pfx_ofs..pfx_end unless
+ * this is the first sample directly following prom_put_family() */
+static void prom_put_sample(struct prom_srv *srv, struct prom_buf *b,
+			    size_t pfx_ofs, size_t pfx_end, int first,
+			    int has_idx, unsigned int idx, int64_t value)
+{
+	size_t n = pfx_end - pfx_ofs;
+
+	if (!first) {
+		if (prom_reserve(srv, b, n) < 0)
+			return;
+		memcpy(b->data + b->len, b->data + pfx_ofs, n);
+		b->len += n;
+	}
+
+	if (has_idx) {
+		prom_put_int(srv, b, idx);
+		prom_put_str(srv, b, "\"} ");
+	} else {
+		prom_put(srv, b, " ", 1);
+	}
+	prom_put_int(srv, b, value);
+	prom_put(srv, b, "\n", 1);
+}
+
+/* Collect the groups to report, sorted by metric name prefix, description
+ * and index so that all samples of a metric family end up next to each
+ * other.  Groups with different descriptions may share a prefix, their
+ * metrics of the same name then form one family. */
+static int prom_add_group(struct prom_srv *srv, const void *grp)
+{
+	const void **groups;
+	size_t size;
+
+	if (srv->groups_num == srv->groups_size) {
+		size = srv->groups_size ? 2 * srv->groups_size : 64;
+		groups = talloc_realloc(srv, srv->groups, const void *, size);
+		if (!groups)
+			return -ENOMEM;
+		srv->groups = groups;
+		srv->groups_size = size;
+	}
+
+	srv->groups[srv->groups_num++] = grp;
+	return 0;
+}
+
+static int prom_add_ctr_group(struct rate_ctr_group *ctrg, void *data)
+{
+	struct prom_srv *srv = data;
+
+	if (!prom_check_class(srv->srep, ctrg->idx, ctrg->desc->class_id))
+		return 0;
+
+	return prom_add_group(srv, ctrg);
+}
+
+static int prom_add_stat_group(struct osmo_stat_item_group *statg, void *data)
+{
+	struct prom_srv *srv = data;
+
+	if (!prom_check_class(srv->srep, statg->idx, statg->desc->class_id))
+		return 0;
+
+	return prom_add_group(srv, statg);
+}
+
+static int prom_cmp_ctr_group(const void *a, const void *b)
+{
+	const struct rate_ctr_group *ga = *(const struct rate_ctr_group **)a;
+	const struct rate_ctr_group *gb = *(const struct rate_ctr_group **)b;
+	int rc;
+
+	rc = prom_name_cmp(ga->desc->group_name_prefix, gb->desc->group_name_prefix);
+	if (!rc)
+		rc = strcmp(ga->desc->group_name_prefix, gb->desc->group_name_prefix);
+	if (rc)
+		return rc;
+	if (ga->desc != gb->desc)
+		return (uintptr_t)ga->desc < (uintptr_t)gb->desc ? -1 : 1;
+	return ga->idx < gb->idx ? -1 : ga->idx > gb->idx;
+}
+
+static int prom_cmp_stat_group(const void *a, const void *b)
+{
+	const struct osmo_stat_item_group *ga = *(const struct osmo_stat_item_group **)a;
+	const struct osmo_stat_item_group *gb = *(const struct osmo_stat_item_group **)b;
+	int rc;
+
+	rc = prom_name_cmp(ga->desc->group_name_prefix, gb->desc->group_name_prefix);
+	if (!rc)
+		rc = strcmp(ga->desc->group_name_prefix, gb->desc->group_name_prefix);
+	if (rc)
+		return rc;
+	if (ga->desc != gb->desc)
+		return (uintptr_t)ga->desc < (uintptr_t)gb->desc ? -1 : 1;
+	return ga->idx < gb->idx ? -1 : ga->idx > gb->idx;
+}
+
+/* Index of the counter called name in desc, -1 if it has none */
+static int prom_ctr_idx(const struct rate_ctr_group_desc *desc, const char *name)
+{
+	unsigned int c;
+
+	for (c = 0; c < desc->num_ctr; c++) {
+		if (!prom_name_cmp(desc->ctr_desc[c].name, name))
+			return c;
+	}
+	return -1;
+}
+
+static void prom_render_ctr_groups(struct prom_srv *srv, struct prom_buf *b, int om)
+{
+	const struct rate_ctr_group **groups;
+	const struct rate_ctr_group_desc *desc;
+	const char *name, *group;
+	size_t i, j, k, l, ofs, end;
+	unsigned int c;
+	int idx, first;
+
+	srv->groups_num = 0;
+	rate_ctr_for_each_group(prom_add_ctr_group, srv);
+	groups = (const struct rate_ctr_group **)srv->groups;
+	if (srv->groups_num > 1)
+		qsort(groups, srv->groups_num, sizeof(*groups), prom_cmp_ctr_group);
+
+	for (i = 0; i < srv->groups_num; i = j) {
+		for (j = i; j < srv->groups_num &&
+			    !prom_name_cmp(groups[j]->desc->group_name_prefix,
+					   groups[i]->desc->group_name_prefix); j++);
+
+		for (k = i; k < j; k++) {
+			desc = groups[k]->desc;
+			if (k > i && desc == groups[k - 1]->desc)
+				continue;
+			for (c = 0; c < desc->num_ctr; c++) {
+				name = desc->ctr_desc[c].name;
+				/* already written with an earlier description */
+				for (l = i; l < k && prom_ctr_idx(groups[l]->desc, name) < 0; l++);
+				if (l < k)
+					continue;
+
+				ofs = prom_put_family(srv, b, om, desc->group_name_prefix,
+						      name, desc->ctr_desc[c].description,
+						      "counter");
+				end = b->len;
+				group = desc->group_name_prefix;
+				for (l = k, first = 1; l < j; l++) {
+					idx = groups[l]->desc == desc ? c :
+						prom_ctr_idx(groups[l]->desc, name);
+					if (idx < 0)
+						continue;
+					/* same metric name, but a different group label */
+					if (groups[l]->desc->group_name_prefix != group &&
+					    strcmp(groups[l]->desc->group_name_prefix, group)) {
+						group = groups[l]->desc->group_name_prefix;
+						ofs = prom_put_sample_prefix(srv, b, group, name, "counter");
+						end = b->len;
+						first = 1;
+					}
+					prom_put_sample(srv, b, ofs, end, first, 1,
+							groups[l]->idx,
+							groups[l]->ctr[idx].current);
+					first = 0;
+				}
+			}
+		}
+	}
+}
+
+/* Index of the item called name in desc, -1 if it has none */
+static int prom_stat_idx(const struct osmo_stat_item_group_desc *desc, const char *name)
+{
+	unsigned int c;
+
+	for (c = 0; c < desc->num_items; c++) {
+		if (!prom_name_cmp(desc->item_desc[c].name, name))
+			return c;
+	}
+	return -1;
+}
+
+static void prom_render_stat_groups(struct prom_srv *srv, struct prom_buf *b, int om)
+{
+	const struct osmo_stat_item_group **groups;
+	const struct osmo_stat_item_group_desc *desc;
+	const char *name, *group;
+	size_t i, j, k, l, ofs, end;
+	unsigned int c;
+	int idx, first;
+
+	srv->groups_num = 0;
+	osmo_stat_item_for_each_group(prom_add_stat_group, srv);
+	groups = (const struct osmo_stat_item_group **)srv->groups;
+	if (srv->groups_num > 1)
+		qsort(groups, srv->groups_num, sizeof(*groups), prom_cmp_stat_group);
+
+	for (i = 0; i < srv->groups_num; i = j) {
+		for (j = i; j < srv->groups_num &&
+			    !prom_name_cmp(groups[j]->desc->group_name_prefix,
+					   groups[i]->desc->group_name_prefix); j++);
+
+		for (k = i; k < j; k++) {
+			desc = groups[k]->desc;
+			if (k > i && desc == groups[k - 1]->desc)
+				continue;
+			for (c = 0; c < desc->num_items; c++) {
+				name = desc->item_desc[c].name;
+				/* already written with an earlier description */
+				for (l = i; l < k && prom_stat_idx(groups[l]->desc, name) < 0; l++);
+				if (l < k)
+					continue;
+
+				ofs = prom_put_family(srv, b, om, desc->group_name_prefix,
+						      name, desc->item_desc[c].description,
+						      "gauge");
+				end = b->len;
+				group = desc->group_name_prefix;
+				for (l = k, first = 1; l < j; l++) {
+					idx = groups[l]->desc == desc ? c :
+						prom_stat_idx(groups[l]->desc, name);
+					if (idx < 0)
+						continue;
+					/* same metric name, but a different group label */
+					if (groups[l]->desc->group_name_prefix != group &&
+					    strcmp(groups[l]->desc->group_name_prefix, group)) {
+						group = groups[l]->desc->group_name_prefix;
+						ofs = prom_put_sample_prefix(srv, b, group, name, "gauge");
+						end = b->len;
+						first = 1;
+					}
+					prom_put_sample(srv, b, ofs, end, first, 1,
+							groups[l]->idx,
+							osmo_stat_item_get_last(groups[l]->items[idx]));
+					first = 0;
+				}
+			}
+		}
+	}
+}
+
+static int prom_add_hist_group(struct osmo_histogram_group *histg, void *data)
+{
+	struct prom_srv *srv = data;
+
+	if (!prom_check_class(srv->srep, histg->idx, histg->desc->class_id))
+		return 0;
+
+	return prom_add_group(srv, histg);
+}
+
+static int prom_cmp_hist_group(const void *a, const void *b)
+{
+	const struct osmo_histogram_group *ga = *(const struct osmo_histogram_group **)a;
+	const struct osmo_histogram_group *gb = *(const struct osmo_histogram_group **)b;
+	int rc;
+
+	rc = prom_name_cmp(ga->desc->group_name_prefix, gb->desc->group_name_prefix);
+	if (!rc)
+		rc = strcmp(ga->desc->group_name_prefix, gb->desc->group_name_prefix);
+	if (rc)
+		return rc;
+	if (ga->desc != gb->desc)
+		return (uintptr_t)ga->desc < (uintptr_t)gb->desc ? -1 : 1;
+	return ga->idx < gb->idx ? -1 : ga->idx > gb->idx;
+}
+
+/* Histograms are exported as summaries with a few fixed quantiles */
+static const unsigned int prom_permille[] = { 500, 900, 990, 999 };
+static const char *prom_quantiles[] = { "0.5", "0.9", "0.99", "0.999" };
+
+static void prom_put_hist_sample(struct prom_srv *srv, struct prom_buf *b,
+				 const struct osmo_histogram_group *histg,
+				 const char *name, const char *sfx,
+				 const char *quantile, uint64_t value)
+{
+	prom_put_metric_name(srv, b, histg->desc->group_name_prefix, name, sfx);
+	prom_put_group_label(srv, b, histg->desc->group_name_prefix);
+	prom_put_int(srv, b, histg->idx);
+	if (quantile) {
+		prom_put_str(srv, b, "\",quantile=\"");
+		prom_put_str(srv, b, quantile);
+	}
+	prom_put_str(srv, b, "\"} ");
+	prom_put_int(srv, b, value);
+	prom_put(srv, b, "\n", 1);
+}
+
+/* Index of the histogram called name in desc, -1 if it has none */
+static int prom_hist_idx(const struct osmo_histogram_group_desc *desc, const char *name)
+{
+	unsigned int c;
+
+	for (c = 0; c < desc->num_hist; c++) {
+		if (!prom_name_cmp(desc->hist_desc[c].name, name))
+			return c;
+	}
+	return -1;
+}
+
+static void prom_render_hist_groups(struct prom_srv *srv, struct prom_buf *b)
+{
+	const struct osmo_histogram_group **groups;
+	const struct osmo_histogram_group_desc *desc;
+	const struct osmo_histogram *hist;
+	uint64_t pct[ARRAY_SIZE(prom_permille)];
+	const char *name;
+	size_t i, j, k, l, q;
+	unsigned int c;
+	int idx;
+
+	srv->groups_num = 0;
+	osmo_histogram_for_each_group(prom_add_hist_group, srv);
+	groups = (const struct osmo_histogram_group **)srv->groups;
+	if (srv->groups_num > 1)
+		qsort(groups, srv->groups_num, sizeof(*groups), prom_cmp_hist_group);
+
+	for (i = 0; i < srv->groups_num; i = j) {
+		for (j = i; j < srv->groups_num &&
+			    !prom_name_cmp(groups[j]->desc->group_name_prefix,
+					   groups[i]->desc->group_name_prefix); j++);
+
+		for (k = i; k < j; k++) {
+			desc = groups[k]->desc;
+			if (k > i && desc == groups[k - 1]->desc)
+				continue;
+			for (c = 0; c < desc->num_hist; c++) {
+				name = desc->hist_desc[c].name;
+				/* already written with an earlier description */
+				for (l = i; l < k && prom_hist_idx(groups[l]->desc, name) < 0; l++);
+				if (l < k)
+					continue;
+
+				prom_put_meta(srv, b, desc->group_name_prefix, name, "",
+					      desc->hist_desc[c].description, "summary");
+				for (l = k; l < j; l++) {
+					idx = groups[l]->desc == desc ? c :
+						prom_hist_idx(groups[l]->desc, name);
+					if (idx < 0)
+						continue;
+					hist = &groups[l]->hist[idx];
+					osmo_histogram_percentiles(hist, prom_permille, pct,
+								   ARRAY_SIZE(pct));
+					for (q = 0; q < ARRAY_SIZE(pct); q++)
+						prom_put_hist_sample(srv, b, groups[l], name, "",
+								     prom_quantiles[q], pct[q]);
+					prom_put_hist_sample(srv, b, groups[l], name, "_sum",
+							     NULL, hist->sum);
+					prom_put_hist_sample(srv, b, groups[l], name, "_count",
+							     NULL, hist->count);
+				}
+			}
+		}
+	}
+}
+
+struct prom_render_ctx {
+	struct prom_srv *srv;
+	struct prom_buf *b;
+	int om;
+};
+
+static int prom_render_counter(struct osmo_counter *counter, void *data)
+{
+	struct prom_render_ctx *ctx = data;
+	size_t ofs;
+
+	/* osmo_counter can be decremented, so it is exported as a gauge */
+	ofs = prom_put_family(ctx->srv, ctx->b, ctx->om, NULL, counter->name,
+			      counter->description, "gauge");
+	prom_put_sample(ctx->srv, ctx->b, ofs, ctx->b->len, 1, 0, 0,
+			counter->value);
+
+	return 0;
+}
+
+/* Render all metrics into b, after the header room */
+static void prom_render(struct prom_srv *srv, struct prom_buf *b, int om)
+{
+	struct prom_render_ctx ctx = { .srv = srv, .b = b, .om = om };
+
+	prom_reserve(srv, b, srv->last_len);
+
+	prom_render_ctr_groups(srv, b, om);
+	prom_render_stat_groups(srv, b, om);
+	prom_render_hist_groups(srv, b);
+	osmo_counters_for_each(prom_render_counter, &ctx);
+
+	if (om)
+		prom_put_str(srv, b, "# EOF\n");
+
+	srv->last_len = b->len;
+}
+
+/*** HTTP ***/
+
+static void prom_conn_close(struct prom_conn *conn)
+{
+	struct prom_srv *srv = conn->srv;
+
+	osmo_timer_del(&conn->timer);
+	osmo_fd_unregister(&conn->ofd);
+	close(conn->ofd.fd);
+	llist_del(&conn->list);
+	srv->num_conns--;
+	talloc_free(conn->tx.data);
+	talloc_free(conn);
+}
+
+static void prom_conn_timer_cb(void *data)
+{
+	struct prom_conn *conn = data;
+
+	LOGP(DLSTATS, LOGL_DEBUG, "Closing idle Prometheus connection\n");
+	prom_conn_close(conn);
+}
+
+/* Case insensitive check if the header "name" contains "value" */
+static int prom_header_has(const char *hdrs, const char *name, const char *value)
+{
+	size_t name_len = strlen(name), value_len = strlen(value);
+	const char *line, *end;
+
+	for (line = hdrs; line && *line; line = end ? end + 1 : NULL) {
+		end = strchr(line, '\n');
+		if (strncasecmp(line, name, name_len) || line[name_len] != ':')
+			continue;
+		for (line += name_len + 1; *line && line != end; line++) {
+			if (!strncasecmp(line, value, value_len))
+				return 1;
+		}
+	}
+
+	return 0;
+}
+
+/* Put the response header in front of the body, which starts at
+ * PROM_HDR_ROOM in the buffer (if there is a body) */
+static void prom_put_header(struct prom_conn *conn, const char *status,
+			    const char *content_type)
+{
+	struct prom_buf *b = &conn->tx;
+	size_t body_len = b->len - PROM_HDR_ROOM;
+	char hdr[PROM_HDR_ROOM];
+	int n;
+
+	n = snprintf(hdr, sizeof(hdr), "HTTP/1.1 %s\r\n"
+		     "Content-Type: %s\r\n"
+		     "Content-Length: %zu\r\n"
+		     "Connection: %s\r\n\r\n",
+		     status, content_type, body_len,
+		     conn->keep_alive ? "keep-alive" : "close");
+	OSMO_ASSERT(n > 0 && n < sizeof(hdr));
+
+	b->start = PROM_HDR_ROOM - n;
+	memcpy(b->data + b->start, hdr, n);
+}
+
+static void prom_respond_error(struct prom_conn *conn, const char *status)
+{
+	struct prom_buf *b = &conn->tx;
+
+	b->len = 0;
+	b->oom = 0;
+	if (prom_reserve(conn->srv, b, PROM_HDR_ROOM + 64) < 0)
+		return;
+	b->len = PROM_HDR_ROOM;
+	prom_put_str(conn->srv, b, status);
+	prom_put(conn->srv, b, "\n", 1);
+	prom_put_header(conn, status, "text/plain; charset=utf-8");
+}
+
+/* Handle one complete request, prepare the response in conn->tx */
+static void prom_handle_request(struct prom_conn *conn, char *req)
+{
+	struct prom_srv *srv = conn->srv;
+	struct prom_buf *b = &conn->tx;
+	char *path, *version, *hdrs;
+	int om;
+
+	hdrs = strchr(req, '\n');
+	if (hdrs) {
+		*hdrs++ = '\0';
+		if (hdrs - req >= 2 && hdrs[-2] == '\r')
+			hdrs[-2] = '\0';
+	}
+
+	path = strchr(req, ' ');
+	version = path ? strchr(path + 1, ' ') : NULL;
+	if (!path || !version || strncmp(version + 1, "HTTP/1.", 7)) {
+		conn->keep_alive = 0;
+		prom_respond_error(conn, "400 Bad Request");
+		return;
+	}
+	*path++ = '\0';
+	*version++ = '\0';
+
+	if (!strcmp(version, "HTTP/1.0"))
+		conn->keep_alive = hdrs && prom_header_has(hdrs, "Connection", "keep-alive");
+	else
+		conn->keep_alive = !(hdrs && prom_header_has(hdrs, "Connection", "close"));
+
+	if (strcmp(req, "GET")) {
+		prom_respond_error(conn, "405 Method Not Allowed");
+		return;
+	}
+
+	/* ignore any query, Prometheus may append e.g. ?name[]=... */
+	path[strcspn(path, "?")] = '\0';
+	if (strcmp(path, "/metrics") && strcmp(path, "/")) {
+		prom_respond_error(conn, "404 Not Found");
+		return;
+	}
+
+	om = hdrs && prom_header_has(hdrs, "Accept", "application/openmetrics-text");
+
+	b->len = 0;
+	b->oom = 0;
+	if (prom_reserve(srv, b, PROM_HDR_ROOM) < 0) {
+		conn->keep_alive = 0;
+		return;
+	}
+	b->len = PROM_HDR_ROOM;
+	prom_render(srv, b, om);
+	if (b->oom) {
+		/* don't pass off a truncated body as complete */
+		LOGP(DLSTATS, LOGL_ERROR, "Out of memory rendering Prometheus metrics\n");
+		prom_respond_error(conn, "500 Internal Server Error");
+		return;
+	}
+
+	prom_put_header(conn, "200 OK", om ?
+			"application/openmetrics-text; version=1.0.0; charset=utf-8" :
+			"text/plain; version=0.0.4; charset=utf-8");
+}
+
+/* Look for a complete request in rx and start sending the response */
+static int prom_conn_process(struct prom_conn *conn)
+{
+	char *end;
+	size_t req_len;
+
+	conn->rx[conn->rx_len] = '\0';
+	end = strstr(conn->rx, "\r\n\r\n");
+	if (!end) {
+		if (conn->rx_len < sizeof(conn->rx) - 1)
+			return 0;
+		/* header does not fit into the receive buffer */
+		conn->keep_alive = 0;
+		prom_respond_error(conn, "431 Request Header Fields Too Large");
+		conn->rx_len = 0;
+	} else {
+		end[2] = '\0';
+		req_len = end + 4 - conn->rx;
+		prom_handle_request(conn, conn->rx);
+		/* keep any pipelined request */
+		memmove(conn->rx, conn->rx + req_len, conn->rx_len - req_len);
+		conn->rx_len -= req_len;
+	}
+
+	if (conn->tx.len == 0)
+		return -ENOMEM;
+
+	osmo_fd_update_when(&conn->ofd, 0, BSC_FD_WRITE);
+	return 1;
+}
+
+static int prom_conn_read(struct prom_conn *conn)
+{
+	ssize_t rc;
+
+	rc = recv(conn->ofd.fd, conn->rx + conn->rx_len,
+		  sizeof(conn->rx) - 1 - conn->rx_len, MSG_DONTWAIT);
+	if (rc < 0 && (errno == EAGAIN || errno == EINTR))
+		return 0;
+	if (rc <= 0)
+		return -EIO;
+
+	conn->rx_len += rc;
+	return prom_conn_process(conn) < 0 ? -ENOMEM : 0;
+}
+
+static int prom_conn_write(struct prom_conn *conn)
+{
+	struct prom_buf *b = &conn->tx;
+	ssize_t rc;
+
+	rc = send(conn->ofd.fd, b->data + b->start, b->len - b->start,
+#ifdef MSG_NOSIGNAL
+		  MSG_NOSIGNAL |
+#endif
+		  MSG_DONTWAIT);
+	if (rc < 0 && (errno == EAGAIN || errno == EINTR))
+		return 0;
+	if (rc < 0)
+		return -EIO;
+
+	b->start += rc;
+	if (b->start < b->len)
+		return 0;
+
+	/* response complete */
+	b->start = b->len = 0;
+	if (!conn->keep_alive)
+		return -ESHUTDOWN;
+
+	osmo_fd_update_when(&conn->ofd, 0, BSC_FD_READ);
+	return prom_conn_process(conn) < 0 ? -ENOMEM : 0;
+}
+
+static int prom_conn_cb(struct osmo_fd *ofd, unsigned int what)
+{
+	struct prom_conn *conn = ofd->data;
+	int rc = 0;
+
+	if (what & BSC_FD_READ)
+		rc = prom_conn_read(conn);
+	else if (what & BSC_FD_WRITE)
+		rc = prom_conn_write(conn);
+
+	if (rc < 0) {
+		prom_conn_close(conn);
+		return 0;
+	}
+
+	osmo_timer_schedule(&conn->timer, PROM_IDLE_TIMEOUT, 0);
+	return 0;
+}
+
+static int prom_listen_cb(struct osmo_fd *ofd, unsigned int what)
+{
+	struct prom_srv *srv = ofd->data;
+	struct prom_conn *conn;
+	int fd;
+
+	if (!(what & BSC_FD_READ))
+		return 0;
+
+	fd = accept(ofd->fd, NULL, NULL);
+	if (fd < 0)
+		return 0;
+
+	if (srv->num_conns >= PROM_MAX_CONN) {
+		LOGP(DLSTATS, LOGL_NOTICE, "Too many Prometheus connections, "
+		     "rejecting\n");
+		close(fd);
+		return 0;
+	}
+
+	conn = talloc_zero(srv, struct prom_conn);
+	if (!conn) {
+		close(fd);
+		return 0;
+	}
+	conn->srv = srv;
+
+	osmo_fd_setup(&conn->ofd, fd, BSC_FD_READ, prom_conn_cb, conn, 0);
+	if (osmo_fd_register(&conn->ofd) < 0) {
+		close(fd);
+		talloc_free(conn);
+		return 0;
+	}
+
+	osmo_timer_setup(&conn->timer, prom_conn_timer_cb, conn);
+	osmo_timer_schedule(&conn->timer, PROM_IDLE_TIMEOUT, 0);
+
+	llist_add_tail(&conn->list, &srv->conns);
+	srv->num_conns++;
+
+	return 0;
+}
+
+/*** reporter ***/
+
+static int osmo_stats_reporter_prometheus_open(struct osmo_stats_reporter *srep)
+{
+	struct prom_srv *srv;
+	int rc;
+
+	srv = talloc_zero(srep, struct prom_srv);
+	if (!srv)
+		return -ENOMEM;
+	srv->srep = srep;
+	INIT_LLIST_HEAD(&srv->conns);
+
+	osmo_fd_setup(&srv->listen_ofd, -1, 0, prom_listen_cb, srv, 0);
+	rc = osmo_sock_init_ofd(&srv->listen_ofd, AF_INET, SOCK_STREAM,
+				IPPROTO_TCP, srep->bind_addr_str,
+				srep->bind_port, OSMO_SOCK_F_BIND);
+	if (rc < 0) {
+		LOGP(DLSTATS, LOGL_ERROR, "Unable to listen for Prometheus "
+		     "on %s:%d\n", srep->bind_addr_str ? : "*",
+		     srep->bind_port);
+		talloc_free(srv);
+		return rc;
+	}
+
+	srep->fd = srv->listen_ofd.fd;
+	srep->priv = srv;
+
+	return 0;
+}
+
+static int osmo_stats_reporter_prometheus_close(struct osmo_stats_reporter *srep)
+{
+	struct prom_srv *srv = srep->priv;
+	struct prom_conn *conn, *conn2;
+
+	if (!srv)
+		return -EBADF;
+
+	llist_for_each_entry_safe(conn, conn2, &srv->conns, list)
+		prom_conn_close(conn);
+
+	osmo_fd_unregister(&srv->listen_ofd);
+	close(srv->listen_ofd.fd);
+	talloc_free(srv);
+
+	srep->priv = NULL;
+	srep->fd = -1;
+
+	return 0;
+}
+
+/*! Create a stats_reporter to be scraped by Prometheus.  This creates a
+ *  stats_reporter that answers HTTP requests for /metrics on the port set
+ *  with \ref osmo_stats_reporter_set_local_port() (and optionally the
+ *  address set with \ref osmo_stats_reporter_set_local_addr()) once it
+ *  is enabled.  It does not report on the stats interval.
+ *  \param[in] name Name of the to-be-created stats_reporter
+ *  \returns stats_reporter on success; NULL on error */
+struct osmo_stats_reporter *osmo_stats_reporter_create_prometheus(const char *name)
+{
+	struct osmo_stats_reporter *srep;
+	srep = osmo_stats_reporter_alloc(OSMO_STATS_REPORTER_PROMETHEUS, name);
+
+	srep->have_net_config = 1;
+
+	srep->open = osmo_stats_reporter_prometheus_open;
+	srep->close = osmo_stats_reporter_prometheus_close;
+
+	return srep;
+}
+
+#endif /* HAVE_SYS_SOCKET_H */
+#endif /* !EMBEDDED */
+
+/*! @} */
@@ -32,6 +32,7 @@
 
 #include <string.h>
 #include <stdint.h>
+#include <stdbool.h>
 #include <errno.h>
 
 #include <osmocom/core/utils.h>
@@ -68,95 +69,103 @@ struct osmo_stats_reporter *osmo_stats_reporter_create_statsd(const char *name)
 	return srep;
 }
 
-/*! Replace all illegal ':' in the stats name, but not when used as value seperator.
- *  ':' is used as seperator between the name and the value in the statsd protocol.
- *  \param[inout] buf is a null terminated string containing name, value, unit. */
-static void osmo_stats_reporter_sanitize_name(char *buf)
+/* Number of decimal digits of v */
+static unsigned int dec_len(uint64_t v)
 {
-	/* e.g. msc.loc_update_type:normal:1|c -> msc.loc_update_type.normal:1|c
-	 * last is the seperator between name and value */
-	char *last = strrchr(buf, ':');
-	char *tmp = strchr(buf, ':');
+	unsigned int n = 1;
 
-	if (!last)
-		return;
-
-	while (tmp < last) {
-		*tmp = '.';
-		tmp = strchr(buf, ':');
+	while (v >= 10) {
+		v /= 10;
+		n++;
 	}
+	return n;
 }
 
-static int osmo_stats_reporter_statsd_send(struct osmo_stats_reporter *srep,
-	const char *name1, unsigned int index1, const char *name2, int64_t value,
-	const char *unit)
+/* Write v as decimal of exactly len digits (see dec_len()) */
+static char *put_dec(char *p, uint64_t v, unsigned int len)
 {
-	char *buf;
-	int buf_size;
-	int nchars, rc = 0;
-	char *fmt = NULL;
-	char *prefix = srep->name_prefix;
-	int old_len = msgb_length(srep->buffer);
-
-	if (prefix) {
-		if (name1) {
-			if (index1 != 0)
-				fmt = "%1$s.%2$s.%6$u.%3$s:%4$d|%5$s";
-			else
-				fmt = "%1$s.%2$s.%3$s:%4$d|%5$s";
-		} else {
-			fmt = "%1$s.%2$0.0s%3$s:%4$d|%5$s";
-		}
-	} else {
-		prefix = "";
-		if (name1) {
-			if (index1 != 0)
-				fmt = "%1$s%2$s.%6$u.%3$s:%4$d|%5$s";
-			else
-				fmt = "%1$s%2$s.%3$s:%4$d|%5$s";
-		} else {
-			fmt = "%1$s%2$0.0s%3$s:%4$d|%5$s";
-		}
-	}
+	char *end = p + len;
 
-	if (srep->agg_enabled) {
-		if (msgb_length(srep->buffer) > 0 &&
-			msgb_tailroom(srep->buffer) > 0)
-		{
-			msgb_put_u8(srep->buffer, '\n');
-		}
-	}
+	do {
+		*--end = '0' + v % 10;
+		v /= 10;
+	} while (end > p);
 
-	buf = (char *)msgb_put(srep->buffer, 0);
-	buf_size = msgb_tailroom(srep->buffer);
-
-	nchars = snprintf(buf, buf_size, fmt,
-		prefix, name1, name2,
-		value, unit, index1);
+	return p + len;
+}
 
-	if (nchars >= buf_size) {
-		/* Truncated */
-		/* Restore original buffer (without trailing LF) */
-		msgb_trim(srep->buffer, old_len);
-		/* Send it */
-		rc = osmo_stats_reporter_send_buffer(srep);
+/* Write name, replacing ':' (the statsd value separator) by '.' unless it
+ * has been sanitized already */
+static char *put_name(char *p, const char *name, unsigned int len, bool sanitized)
+{
+	unsigned int i;
 
-		/* Try again */
-		buf = (char *)msgb_put(srep->buffer, 0);
-		buf_size = msgb_tailroom(srep->buffer);
+	if (sanitized) {
+		memcpy(p, name, len);
+		return p + len;
+	}
 
-		nchars = snprintf(buf, buf_size, fmt,
-			prefix, name1, name2,
-			value, unit, index1);
+	for (i = 0; i < len; i++)
+		*p++ = name[i] == ':' ? '.' : name[i];
+	return p;
+}
 
-		if (nchars >= buf_size)
-			return -EMSGSIZE;
+/* Append "[prefix.][group.[index.]]name:value|unit" to the datagram being
+ * filled, starting a new one if it does not fit anymore. */
+static int osmo_stats_reporter_statsd_send(struct osmo_stats_reporter *srep,
+	const char *name1, unsigned int index1, const char *name2, bool sanitized,
+	int64_t value, const char *unit)
+{
+	const char *prefix = srep->name_prefix;
+	unsigned int prefix_len = prefix ? strlen(prefix) : 0;
+	unsigned int name1_len = name1 ? strlen(name1) : 0;
+	unsigned int name2_len = strlen(name2);
+	unsigned int unit_len = strlen(unit);
+	unsigned int index_len = index1 ? dec_len(index1) : 0;
+	uint64_t abs_value = value < 0 ? -(uint64_t)value : value;
+	unsigned int value_len = dec_len(abs_value) + (value < 0);
+	unsigned int len, dgram_len, sep;
+	char *p;
+	int rc = 0;
+
+	len = (prefix ? prefix_len + 1 : 0) +
+		(name1 ? name1_len + 1 + (index1 ? index_len + 1 : 0) : 0) +
+		name2_len + 1 + value_len + 1 + unit_len;
+	if (len > srep->dgram_size)
+		return -EMSGSIZE;
+
+	dgram_len = msgb_length(srep->buffer);
+	if (srep->num_dgrams)
+		dgram_len -= srep->dgram_end[srep->num_dgrams - 1];
+	sep = dgram_len > 0;
+
+	if (dgram_len + sep + len > srep->dgram_size) {
+		rc = osmo_stats_reporter_end_dgram(srep);
+		sep = 0;
 	}
 
-	if (nchars > 0) {
-		osmo_stats_reporter_sanitize_name(buf);
-		msgb_trim(srep->buffer, msgb_length(srep->buffer) + nchars);
+	p = (char *)msgb_put(srep->buffer, sep + len);
+	if (sep)
+		*p++ = '\n';
+	if (prefix) {
+		p = put_name(p, prefix, prefix_len, false);
+		*p++ = '.';
 	}
+	if (name1) {
+		p = put_name(p, name1, name1_len, sanitized);
+		*p++ = '.';
+		if (index1) {
+			p = put_dec(p, index1, index_len);
+			*p++ = '.';
+		}
+	}
+	p = put_name(p, name2, name2_len, sanitized);
+	*p++ = ':';
+	if (value < 0)
+		*p++ = '-';
+	p = put_dec(p, abs_value, value_len - (value < 0));
+	*p++ = '|';
+	memcpy(p, unit, unit_len);
 
 	if (!srep->agg_enabled)
 		rc = osmo_stats_reporter_send_buffer(srep);
@@ -169,32 +178,50 @@ static int osmo_stats_reporter_statsd_send_counter(struct osmo_stats_reporter *s
 	const struct rate_ctr_desc *desc,
 	int64_t value, int64_t delta)
 {
-	if (ctrg)
-		return osmo_stats_reporter_statsd_send(srep,
-			ctrg->desc->group_name_prefix,
-			ctrg->idx,
-			desc->name, delta, "c");
-	else
+	unsigned int i;
+
+	if (!ctrg)
 		return osmo_stats_reporter_statsd_send(srep,
 			NULL, 0,
-			desc->name, delta, "c");
+			desc->name, false, delta, "c");
+
+	/* use the names sanitized by rate_ctr_group_alloc(); only groups
+	 * that have them are guaranteed to have a ctr_desc array */
+	if (ctrg->stats_names) {
+		i = desc - ctrg->desc->ctr_desc;
+		if (i < ctrg->desc->num_ctr)
+			return osmo_stats_reporter_statsd_send(srep,
+				ctrg->stats_prefix, ctrg->idx,
+				ctrg->stats_names[i], true, delta, "c");
+	}
+
+	return osmo_stats_reporter_statsd_send(srep,
+		ctrg->desc->group_name_prefix, ctrg->idx,
+		desc->name, false, delta, "c");
 }
 
 static int osmo_stats_reporter_statsd_send_item(struct osmo_stats_reporter *srep,
 	const struct osmo_stat_item_group *statg,
 	const struct osmo_stat_item_desc *desc, int64_t value)
 {
-	if (value < 0) {
-		return osmo_stats_reporter_statsd_send(srep,
-				statg->desc->group_name_prefix,
-				statg->idx,
-				desc->name, 0, "g");
-	} else {
-		return osmo_stats_reporter_statsd_send(srep,
-			statg->desc->group_name_prefix,
-			statg->idx,
-			desc->name, value, "g");
+	unsigned int i;
+
+	if (value < 0)
+		value = 0;
+
+	/* the item_desc array may be NULL (e.g. the group used to report
+	 * histograms), so only look at it when there are sanitized names */
+	if (statg->stats_names) {
+		i = desc - statg->desc->item_desc;
+		if (i < statg->desc->num_items)
+			return osmo_stats_reporter_statsd_send(srep,
+				statg->stats_prefix, statg->idx,
+				statg->stats_names[i], true, value, "g");
 	}
+
+	return osmo_stats_reporter_statsd_send(srep,
+		statg->desc->group_name_prefix, statg->idx,
+		desc->name, false, value, "g");
 }
 #endif /* !EMBEDDED */
 
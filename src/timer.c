@@ -35,6 +35,8 @@
 #include <assert.h>
 #include <string.h>
 #include <limits.h>
+#include <stdint.h>
+#include <errno.h>
 #include <osmocom/core/timer.h>
 #include <osmocom/core/timer_compat.h>
 #include <osmocom/core/linuxlist.h>
@@ -45,6 +47,277 @@ static struct timeval *nearest_p;
 
 static struct rb_root timer_root = RB_ROOT;
 
+static enum osmo_timer_backend timer_backend = OSMO_TIMER_BACKEND_RBTREE;
+
+/* current time as read once by osmo_timers_cache_now() */
+static struct timeval now_cache;
+static bool now_cache_valid;
+
+/* Get the current time in the time base of the timer core, which is
+ * CLOCK_MONOTONIC.  Unit tests that still fake the time through
+ * osmo_gettimeofday_override keep working, as that takes precedence. */
+static void timer_now(struct timeval *now)
+{
+	struct timespec ts;
+
+	if (now_cache_valid) {
+		*now = now_cache;
+		return;
+	}
+
+	if (osmo_gettimeofday_override) {
+		osmo_gettimeofday(now, NULL);
+		return;
+	}
+
+	osmo_clock_gettime(CLOCK_MONOTONIC, &ts);
+	now->tv_sec = ts.tv_sec;
+	now->tv_usec = ts.tv_nsec / 1000;
+}
+
+/*! Read the clock once and use that time for all timer operations
+ *  \param[in] enable true to read and cache the time; false to drop the cache
+ *  \returns previous state, to be passed back when nesting
+ *
+ *  osmo_select_main() caches the time after waking up, for the duration
+ *  of the dispatch of one iteration, so that timers (re-)scheduled from
+ *  timer and fd call-backs don't need to read the clock each.  Users of
+ *  foreign event loops can do the same around their own dispatch code.
+ *  Never keep the cache enabled while waiting for events. */
+bool osmo_timers_cache_now(bool enable)
+{
+	bool was_valid = now_cache_valid;
+
+	now_cache_valid = false;
+	if (enable)
+		timer_now(&now_cache);
+	now_cache_valid = enable;
+
+	return was_valid;
+}
+
+static void __add_timer(struct osmo_timer_list *timer);
+
+/* Hierarchical timing wheel with millisecond resolution, modelled after the
+ * classic Linux kernel timer wheel: level 0 has one slot per millisecond,
+ * each of the upper levels covers 64 times the range of the level below.
+ * Timers of an upper level slot are cascaded down into the lower levels
+ * once the lower level wraps around. */
+#define TW_L0_BITS	8
+#define TW_LN_BITS	6
+#define TW_L0_SIZE	(1 << TW_L0_BITS)
+#define TW_LN_SIZE	(1 << TW_LN_BITS)
+#define TW_L0_MASK	(TW_L0_SIZE - 1)
+#define TW_LN_MASK	(TW_LN_SIZE - 1)
+#define TW_LEVELS	4
+#define TW_SHIFT(level)	(TW_L0_BITS + (level) * TW_LN_BITS)
+/* largest offset that fits into the wheel (~49 days) */
+#define TW_MAX_OFFSET	((1ULL << TW_SHIFT(TW_LEVELS)) - 1)
+
+static struct {
+	/* next millisecond tick that has not been processed yet */
+	uint64_t jiffies;
+	/* number of active timers */
+	unsigned int count;
+	struct llist_head l0[TW_L0_SIZE];
+	struct llist_head ln[TW_LEVELS][TW_LN_SIZE];
+} wheel;
+
+static uint64_t timeval2ms(const struct timeval *tv)
+{
+	return (uint64_t)tv->tv_sec * 1000 + tv->tv_usec / 1000;
+}
+
+static void wheel_add(struct osmo_timer_list *timer)
+{
+	uint64_t expires = timeval2ms(&timer->timeout);
+	int64_t idx = expires - wheel.jiffies;
+	struct llist_head *vec;
+	int level;
+
+	if (idx < 0) {
+		/* already expired: fire on the next tick */
+		vec = &wheel.l0[wheel.jiffies & TW_L0_MASK];
+	} else if (idx < TW_L0_SIZE) {
+		vec = &wheel.l0[expires & TW_L0_MASK];
+	} else {
+		if (idx > TW_MAX_OFFSET)
+			expires = wheel.jiffies + TW_MAX_OFFSET;
+		for (level = 0; level < TW_LEVELS - 1; level++) {
+			if (idx < (1LL << TW_SHIFT(level + 1)))
+				break;
+		}
+		vec = &wheel.ln[level][(expires >> TW_SHIFT(level)) & TW_LN_MASK];
+	}
+
+	llist_add_tail(&timer->list, vec);
+}
+
+/* re-distribute all timers of an upper level slot into the lower levels */
+static unsigned int wheel_cascade(int level, unsigned int index)
+{
+	struct osmo_timer_list *this, *tmp;
+	LLIST_HEAD(cascade_list);
+
+	llist_splice_init(&wheel.ln[level][index], &cascade_list);
+	llist_for_each_entry_safe(this, tmp, &cascade_list, list)
+		wheel_add(this);
+
+	return index;
+}
+
+/* re-insert all timers relative to 'now'; used if the clock jumped */
+static void wheel_rebase(uint64_t now)
+{
+	struct osmo_timer_list *this, *tmp;
+	LLIST_HEAD(rebase_list);
+	int i, level;
+
+	for (i = 0; i < TW_L0_SIZE; i++)
+		llist_splice_init(&wheel.l0[i], &rebase_list);
+	for (level = 0; level < TW_LEVELS; level++) {
+		for (i = 0; i < TW_LN_SIZE; i++)
+			llist_splice_init(&wheel.ln[level][i], &rebase_list);
+	}
+
+	wheel.jiffies = now;
+	llist_for_each_entry_safe(this, tmp, &rebase_list, list)
+		wheel_add(this);
+}
+
+/* The wheel is walked one millisecond at a time.  If the clock went
+ * backwards, or forward by more than the range of the first upper level,
+ * re-insert all timers: for a backwards step this is needed so that new
+ * timers don't end up behind the wheel position, for a large forward step
+ * it is cheaper than walking all slots in between. */
+static void wheel_catch_up(uint64_t now)
+{
+	int64_t diff = now - wheel.jiffies;
+
+	if (diff < 0 || diff > (1LL << TW_SHIFT(1)))
+		wheel_rebase(now);
+}
+
+/* move all timers that expired at 'current' into 'expired' */
+static void wheel_collect(const struct timeval *current, struct llist_head *expired)
+{
+	uint64_t now = timeval2ms(current);
+	struct osmo_timer_list *this, *tmp;
+	unsigned int num_expired = 0;
+	unsigned int index;
+	int level;
+
+	wheel_catch_up(now);
+
+	while (wheel.jiffies <= now) {
+		if (num_expired == wheel.count) {
+			/* nothing left in the wheel, no need to walk it */
+			wheel.jiffies = now;
+			break;
+		}
+
+		index = wheel.jiffies & TW_L0_MASK;
+		if (!index) {
+			for (level = 0; level < TW_LEVELS; level++) {
+				if (wheel_cascade(level, (wheel.jiffies >> TW_SHIFT(level)) & TW_LN_MASK))
+					break;
+			}
+		}
+
+		/* prepend, so that the resulting order is the same as the one
+		 * of the rbtree implementation in osmo_timers_update().  The
+		 * slot of the current millisecond is only partially due. */
+		llist_for_each_entry_safe(this, tmp, &wheel.l0[index], list) {
+			if (wheel.jiffies == now && timercmp(&this->timeout, current, >))
+				continue;
+			llist_del(&this->list);
+			llist_add(&this->list, expired);
+			num_expired++;
+		}
+
+		if (wheel.jiffies == now)
+			break;
+		wheel.jiffies++;
+	}
+}
+
+/* earliest time at which the wheel needs to be processed again: the exact
+ * timeout for timers on level 0, the time their slot gets cascaded for
+ * timers on upper levels */
+static bool wheel_next_expiry(struct timeval *next)
+{
+	uint64_t next_ms = UINT64_MAX;
+	unsigned int index = wheel.jiffies & TW_L0_MASK;
+	struct osmo_timer_list *this;
+	unsigned int i;
+	int level;
+
+	for (i = 0; i < TW_L0_SIZE; i++) {
+		if (!llist_empty(&wheel.l0[(index + i) & TW_L0_MASK])) {
+			next_ms = wheel.jiffies + i;
+			break;
+		}
+	}
+
+	/* found before level 0 wraps, i.e. before anything gets cascaded */
+	if (i < TW_L0_SIZE - index) {
+		this = llist_entry(wheel.l0[next_ms & TW_L0_MASK].next, struct osmo_timer_list, list);
+		*next = this->timeout;
+		llist_for_each_entry(this, &wheel.l0[next_ms & TW_L0_MASK], list) {
+			if (timercmp(&this->timeout, next, <))
+				*next = this->timeout;
+		}
+		return true;
+	}
+
+	for (level = 0; level < TW_LEVELS; level++) {
+		uint64_t period = 1ULL << TW_SHIFT(level);
+		uint64_t t = (wheel.jiffies + period - 1) & ~(period - 1);
+
+		for (i = 0; i < TW_LN_SIZE && t < next_ms; i++, t += period) {
+			if (!llist_empty(&wheel.ln[level][(t >> TW_SHIFT(level)) & TW_LN_MASK])) {
+				next_ms = t;
+				break;
+			}
+		}
+	}
+
+	if (next_ms == UINT64_MAX)
+		return false;
+
+	next->tv_sec = next_ms / 1000;
+	next->tv_usec = (next_ms % 1000) * 1000;
+	return true;
+}
+
+static void wheel_init(void)
+{
+	struct timeval current;
+	int i, level;
+
+	timer_now(&current);
+	wheel.jiffies = timeval2ms(&current);
+	wheel.count = 0;
+
+	for (i = 0; i < TW_L0_SIZE; i++)
+		INIT_LLIST_HEAD(&wheel.l0[i]);
+	for (level = 0; level < TW_LEVELS; level++) {
+		for (i = 0; i < TW_LN_SIZE; i++)
+			INIT_LLIST_HEAD(&wheel.ln[level][i]);
+	}
+}
+
+static void wheel_move_to_rbtree(struct llist_head *vec)
+{
+	while (!llist_empty(vec)) {
+		struct osmo_timer_list *this;
+
+		this = llist_entry(vec->next, struct osmo_timer_list, list);
+		llist_del_init(&this->list);
+		__add_timer(this);
+	}
+}
+
 static void __add_timer(struct osmo_timer_list *timer)
 {
 	struct rb_node **new = &(timer_root.rb_node);
@@ -66,6 +339,59 @@ static void __add_timer(struct osmo_timer_list *timer)
 	rb_insert_color(&timer->node, &timer_root);
 }
 
+/*! Select the data structure used to manage timers
+ *  \param[in] backend the back-end to use from now on
+ *  \returns 0 on success; -EINVAL for an unknown \a backend
+ *
+ *  The rbtree back-end keeps timers sorted with microsecond precision
+ *  and O(log n) add/delete.  The timing wheel sorts timers into
+ *  millisecond slots and adds/deletes them in O(1), which pays off for
+ *  large numbers of timers that are mostly re-armed or cancelled before
+ *  they expire.  Both back-ends expire a timer at its exact timeout.  Pending timers are migrated; this must not be called
+ *  from within a timer call-back. */
+int osmo_timers_set_backend(enum osmo_timer_backend backend)
+{
+	struct rb_node *node;
+	int i, level;
+
+	if (backend == timer_backend)
+		return 0;
+
+	switch (backend) {
+	case OSMO_TIMER_BACKEND_RBTREE:
+		for (i = 0; i < TW_L0_SIZE; i++)
+			wheel_move_to_rbtree(&wheel.l0[i]);
+		for (level = 0; level < TW_LEVELS; level++) {
+			for (i = 0; i < TW_LN_SIZE; i++)
+				wheel_move_to_rbtree(&wheel.ln[level][i]);
+		}
+		break;
+	case OSMO_TIMER_BACKEND_WHEEL:
+		wheel_init();
+		while ((node = rb_first(&timer_root))) {
+			struct osmo_timer_list *this;
+
+			this = container_of(node, struct osmo_timer_list, node);
+			rb_erase(node, &timer_root);
+			wheel_add(this);
+			wheel.count++;
+		}
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	timer_backend = backend;
+	return 0;
+}
+
+/*! Get the data structure currently used to manage timers
+ *  \returns back-end in use */
+enum osmo_timer_backend osmo_timers_get_backend(void)
+{
+	return timer_backend;
+}
+
 /*! set up timer callback and data
  *  \param[in] timer the timer that should be added
  *  \param[in] callback function to be called when timer expires
@@ -80,11 +406,18 @@ void osmo_timer_setup(struct osmo_timer_list *timer, void (*cb)(void *data),
 
 /*! add a new timer to the timer management
  *  \param[in] timer the timer that should be added
+ *
+ *  The timer fires at timer->timeout, an absolute CLOCK_MONOTONIC time.
  */
 void osmo_timer_add(struct osmo_timer_list *timer)
 {
 	osmo_timer_del(timer);
 	timer->active = 1;
+	if (timer_backend == OSMO_TIMER_BACKEND_WHEEL) {
+		wheel_add(timer);
+		wheel.count++;
+		return;
+	}
 	INIT_LLIST_HEAD(&timer->list);
 	__add_timer(timer);
 }
@@ -104,7 +437,7 @@ osmo_timer_schedule(struct osmo_timer_list *timer, int seconds, int microseconds
 {
 	struct timeval current_time;
 
-	osmo_gettimeofday(&current_time, NULL);
+	timer_now(&current_time);
 	timer->timeout.tv_sec = seconds;
 	timer->timeout.tv_usec = microseconds;
 	timeradd(&timer->timeout, &current_time, &timer->timeout);
@@ -119,7 +452,12 @@ osmo_timer_schedule(struct osmo_timer_list *timer, int seconds, int microseconds
  */
 void osmo_timer_del(struct osmo_timer_list *timer)
 {
-	if (timer->active) {
+	if (timer->active && timer_backend == OSMO_TIMER_BACKEND_WHEEL) {
+		timer->active = 0;
+		/* removes it from its wheel slot or from the expired list */
+		llist_del_init(&timer->list);
+		wheel.count--;
+	} else if (timer->active) {
 		timer->active = 0;
 		rb_erase(&timer->node, &timer_root);
 		/* make sure this is not already scheduled for removal. */
@@ -142,7 +480,7 @@ int osmo_timer_pending(struct osmo_timer_list *timer)
 
 /*! compute the remaining time of a timer
  *  \param[in] timer the to-be-checked timer
- *  \param[in] now the current time (NULL if not known)
+ *  \param[in] now the current CLOCK_MONOTONIC time (NULL if not known)
  *  \param[out] remaining remaining time until timer fires
  *  \return 0 if timer has not expired yet, -1 if it has
  *
@@ -156,7 +494,7 @@ int osmo_timer_remaining(const struct osmo_timer_list *timer,
 	struct timeval current_time;
 
 	if (!now)
-		osmo_gettimeofday(&current_time, NULL);
+		timer_now(&current_time);
 	else
 		current_time = *now;
 
@@ -203,9 +541,18 @@ static void update_nearest(struct timeval *cand, struct timeval *current)
 void osmo_timers_prepare(void)
 {
 	struct rb_node *node;
-	struct timeval current;
+	struct timeval current, cand;
 
-	osmo_gettimeofday(&current, NULL);
+	timer_now(&current);
+
+	if (timer_backend == OSMO_TIMER_BACKEND_WHEEL) {
+		wheel_catch_up(timeval2ms(&current));
+		if (wheel.count && wheel_next_expiry(&cand))
+			update_nearest(&cand, &current);
+		else
+			nearest_p = NULL;
+		return;
+	}
 
 	node = rb_first(&timer_root);
 	if (node) {
@@ -217,26 +564,42 @@ void osmo_timers_prepare(void)
 	}
 }
 
+/* move all timers that expired at 'current_time' into 'expired' */
+static void rbtree_collect(const struct timeval *current_time, struct llist_head *expired)
+{
+	struct osmo_timer_list *this;
+	struct rb_node *node;
+
+	for (node = rb_first(&timer_root); node; node = rb_next(node)) {
+		this = container_of(node, struct osmo_timer_list, node);
+
+		if (timercmp(&this->timeout, current_time, >))
+			break;
+
+		llist_add(&this->list, expired);
+	}
+}
+
 /*! fire all timers... and remove them */
 int osmo_timers_update(void)
 {
 	struct timeval current_time;
-	struct rb_node *node;
 	struct llist_head timer_eviction_list;
 	struct osmo_timer_list *this;
+	bool was_cached;
 	int work = 0;
 
-	osmo_gettimeofday(&current_time, NULL);
+	/* re-use the time of this update for timers re-armed by call-backs */
+	was_cached = now_cache_valid;
+	if (!was_cached)
+		osmo_timers_cache_now(true);
+	timer_now(&current_time);
 
 	INIT_LLIST_HEAD(&timer_eviction_list);
-	for (node = rb_first(&timer_root); node; node = rb_next(node)) {
-		this = container_of(node, struct osmo_timer_list, node);
-
-		if (timercmp(&this->timeout, &current_time, >))
-			break;
-
-		llist_add(&this->list, &timer_eviction_list);
-	}
+	if (timer_backend == OSMO_TIMER_BACKEND_WHEEL)
+		wheel_collect(&current_time, &timer_eviction_list);
+	else
+		rbtree_collect(&current_time, &timer_eviction_list);
 
 	/*
 	 * The callbacks might mess with our list and in this case
@@ -259,6 +622,9 @@ restart:
 		goto restart;
 	}
 
+	if (!was_cached)
+		osmo_timers_cache_now(false);
+
 	return work;
 }
 
@@ -269,6 +635,9 @@ int osmo_timers_check(void)
 	struct rb_node *node;
 	int i = 0;
 
+	if (timer_backend == OSMO_TIMER_BACKEND_WHEEL)
+		return wheel.count;
+
 	for (node = rb_first(&timer_root); node; node = rb_next(node)) {
 		i++;
 	}
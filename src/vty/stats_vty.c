@@ -134,6 +134,15 @@ DEFUN(cfg_no_stats_reporter_local_ip, cfg_no_stats_reporter_local_ip_cmd,
 		NULL, "local address");
 }
 
+DEFUN(cfg_stats_reporter_local_port, cfg_stats_reporter_local_port_cmd,
+	"local-port <1-65535>",
+	"Set the port on which we listen for requests (prometheus)\n"
+	"Local port number\n")
+{
+	return set_srep_parameter_int(vty, osmo_stats_reporter_set_local_port,
+		argv[0], "local port");
+}
+
 DEFUN(cfg_stats_reporter_remote_ip, cfg_stats_reporter_remote_ip_cmd,
 	"remote-ip ADDR",
 	"Set the remote IP address to which we connect\n"
@@ -305,6 +314,47 @@ DEFUN(cfg_no_stats_reporter_statsd, cfg_no_stats_reporter_statsd_cmd,
 	return CMD_SUCCESS;
 }
 
+DEFUN(cfg_stats_reporter_prometheus, cfg_stats_reporter_prometheus_cmd,
+	"stats reporter prometheus",
+	CFG_STATS_STR CFG_REPORTER_STR "Answer Prometheus/OpenMetrics scrapes\n")
+{
+	struct osmo_stats_reporter *srep;
+
+	srep = osmo_stats_reporter_find(OSMO_STATS_REPORTER_PROMETHEUS, NULL);
+	if (!srep) {
+		srep = osmo_stats_reporter_create_prometheus(NULL);
+		if (!srep) {
+			vty_out(vty, "%% Unable to create prometheus reporter%s",
+				VTY_NEWLINE);
+			return CMD_WARNING;
+		}
+		srep->max_class = OSMO_STATS_CLASS_GLOBAL;
+	}
+
+	vty->index = srep;
+	vty->node = CFG_STATS_NODE;
+
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_no_stats_reporter_prometheus, cfg_no_stats_reporter_prometheus_cmd,
+	"no stats reporter prometheus",
+	NO_STR CFG_STATS_STR CFG_REPORTER_STR "Answer Prometheus/OpenMetrics scrapes\n")
+{
+	struct osmo_stats_reporter *srep;
+
+	srep = osmo_stats_reporter_find(OSMO_STATS_REPORTER_PROMETHEUS, NULL);
+	if (!srep) {
+		vty_out(vty, "%% No prometheus reporting active%s",
+			VTY_NEWLINE);
+		return CMD_WARNING;
+	}
+
+	osmo_stats_reporter_free(srep);
+
+	return CMD_SUCCESS;
+}
+
 DEFUN(cfg_stats_reporter_log, cfg_stats_reporter_log_cmd,
 	"stats reporter log",
 	CFG_STATS_STR CFG_REPORTER_STR "Report to the logger\n")
@@ -559,6 +609,9 @@ static int config_write_stats_reporter(struct vty *vty, struct osmo_stats_report
 	case OSMO_STATS_REPORTER_LOG:
 		vty_out(vty, "stats reporter log%s", VTY_NEWLINE);
 		break;
+	case OSMO_STATS_REPORTER_PROMETHEUS:
+		vty_out(vty, "stats reporter prometheus%s", VTY_NEWLINE);
+		break;
 	}
 
 	vty_out(vty, "  disable%s", VTY_NEWLINE);
@@ -573,6 +626,9 @@ static int config_write_stats_reporter(struct vty *vty, struct osmo_stats_report
 		if (srep->bind_addr_str)
 			vty_out(vty, "  local-ip %s%s",
 				srep->bind_addr_str, VTY_NEWLINE);
+		if (srep->bind_port)
+			vty_out(vty, "  local-port %d%s",
+				srep->bind_port, VTY_NEWLINE);
 		if (srep->mtu)
 			vty_out(vty, "  mtu %d%s",
 				srep->mtu, VTY_NEWLINE);
@@ -604,6 +660,8 @@ static int config_write_stats(struct vty *vty)
 	config_write_stats_reporter(vty, srep);
 	srep = osmo_stats_reporter_find(OSMO_STATS_REPORTER_LOG, NULL);
 	config_write_stats_reporter(vty, srep);
+	srep = osmo_stats_reporter_find(OSMO_STATS_REPORTER_PROMETHEUS, NULL);
+	config_write_stats_reporter(vty, srep);
 
 	vty_out(vty, "stats interval %d%s", osmo_stats_config->interval, VTY_NEWLINE);
 
@@ -623,12 +681,15 @@ void osmo_stats_vty_add_cmds()
 	install_element(CONFIG_NODE, &cfg_no_stats_reporter_statsd_cmd);
 	install_element(CONFIG_NODE, &cfg_stats_reporter_log_cmd);
 	install_element(CONFIG_NODE, &cfg_no_stats_reporter_log_cmd);
+	install_element(CONFIG_NODE, &cfg_stats_reporter_prometheus_cmd);
+	install_element(CONFIG_NODE, &cfg_no_stats_reporter_prometheus_cmd);
 	install_element(CONFIG_NODE, &cfg_stats_interval_cmd);
 
 	install_node(&cfg_stats_node, config_write_stats);
 
 	install_element(CFG_STATS_NODE, &cfg_stats_reporter_local_ip_cmd);
 	install_element(CFG_STATS_NODE, &cfg_no_stats_reporter_local_ip_cmd);
+	install_element(CFG_STATS_NODE, &cfg_stats_reporter_local_port_cmd);
 	install_element(CFG_STATS_NODE, &cfg_stats_reporter_remote_ip_cmd);
 	install_element(CFG_STATS_NODE, &cfg_stats_reporter_remote_port_cmd);
 	install_element(CFG_STATS_NODE, &cfg_stats_reporter_mtu_cmd);
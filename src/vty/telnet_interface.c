@@ -143,7 +143,7 @@ static int client_data(struct osmo_fd *fd, unsigned int what)
 	int rc = 0;
 
 	if (what & BSC_FD_READ) {
-		conn->fd.when &= ~BSC_FD_READ;
+		osmo_fd_update_when(&conn->fd, ~BSC_FD_READ, 0);
 		rc = vty_read(conn->vty);
 	}
 
@@ -154,7 +154,7 @@ static int client_data(struct osmo_fd *fd, unsigned int what)
 	if (what & BSC_FD_WRITE) {
 		rc = buffer_flush_all(conn->vty->obuf, fd->fd);
 		if (rc == BUFFER_EMPTY)
-			conn->fd.when &= ~BSC_FD_WRITE;
+			osmo_fd_update_when(&conn->fd, ~BSC_FD_WRITE, 0);
 	}
 
 	return rc;
@@ -219,10 +219,10 @@ void vty_event(enum event event, int sock, struct vty *vty)
 
 	switch (event) {
 	case VTY_READ:
-		bfd->when |= BSC_FD_READ;
+		osmo_fd_update_when(bfd, ~0, BSC_FD_READ);
 		break;
 	case VTY_WRITE:
-		bfd->when |= BSC_FD_WRITE;
+		osmo_fd_update_when(bfd, ~0, BSC_FD_WRITE);
 		break;
 	case VTY_CLOSED:
 		/* vty layer is about to free() vty */
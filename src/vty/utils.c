@@ -35,6 +35,7 @@
 #include <osmocom/core/timer.h>
 #include <osmocom/core/rate_ctr.h>
 #include <osmocom/core/stat_item.h>
+#include <osmocom/core/histogram.h>
 #include <osmocom/core/utils.h>
 #include <osmocom/core/counter.h>
 
@@ -57,14 +58,25 @@ static int rate_ctr_handler(
 	struct vty_out_context *vctx = vctx_;
 	struct vty *vty = vctx->vty;
 
-	vty_out(vty, " %s%s: %8" PRIu64 " "
-		"(%" PRIu64 "/s %" PRIu64 "/m %" PRIu64 "/h %" PRIu64 "/d)%s",
-		vctx->prefix, desc->description, ctr->current,
-		ctr->intv[RATE_CTR_INTV_SEC].rate,
-		ctr->intv[RATE_CTR_INTV_MIN].rate,
-		ctr->intv[RATE_CTR_INTV_HOUR].rate,
-		ctr->intv[RATE_CTR_INTV_DAY].rate,
-		VTY_NEWLINE);
+	static const char *intv_units[RATE_CTR_INTV_NUM] = { "s", "m", "h", "d" };
+	unsigned int i;
+
+	vty_out(vty, " %s%s: %8" PRIu64 " (",
+		vctx->prefix, desc->description, ctr->current);
+
+	for (i = 0; i < RATE_CTR_INTV_NUM; i++) {
+		vty_out(vty, "%s%" PRIu64 "/", i ? " " : "",
+			rate_ctr_get_rate(ctr, i));
+		/* intervals changed by rate_ctr_group_set_intv() */
+		if (rate_ctr_group_intv_is_default(ctrg, i))
+			vty_out(vty, "%s", intv_units[i]);
+		else if (ctrg->intv_ms[i] % 1000 == 0)
+			vty_out(vty, "%us", ctrg->intv_ms[i] / 1000);
+		else
+			vty_out(vty, "%ums", ctrg->intv_ms[i]);
+	}
+
+	vty_out(vty, ")%s", VTY_NEWLINE);
 
 	return 0;
 }
@@ -164,16 +176,16 @@ static int rate_ctr_handler_fmt(
 			s = pad_append_ctr(s, ctr->previous, minwidth);
 			break;
 		case 'S':
-			s = pad_append_ctr(s, ctr->intv[RATE_CTR_INTV_SEC].rate, minwidth);
+			s = pad_append_ctr(s, rate_ctr_get_rate(ctr, RATE_CTR_INTV_SEC), minwidth);
 			break;
 		case 'M':
-			s = pad_append_ctr(s, ctr->intv[RATE_CTR_INTV_MIN].rate, minwidth);
+			s = pad_append_ctr(s, rate_ctr_get_rate(ctr, RATE_CTR_INTV_MIN), minwidth);
 			break;
 		case 'H':
-			s = pad_append_ctr(s, ctr->intv[RATE_CTR_INTV_HOUR].rate, minwidth);
+			s = pad_append_ctr(s, rate_ctr_get_rate(ctr, RATE_CTR_INTV_HOUR), minwidth);
 			break;
 		case 'D':
-			s = pad_append_ctr(s, ctr->intv[RATE_CTR_INTV_DAY].rate, minwidth);
+			s = pad_append_ctr(s, rate_ctr_get_rate(ctr, RATE_CTR_INTV_DAY), minwidth);
 			break;
 		default:
 			break;
@@ -299,6 +311,67 @@ static int osmo_stat_item_group_handler(struct osmo_stat_item_group *statg, void
 
 /*! @} */
 
+/*! \addtogroup osmo_histogram
+ *  @{
+ */
+
+static void vty_out_histogram(struct vty *vty, const char *prefix,
+			      const struct osmo_histogram *hist)
+{
+	static const unsigned int permille[] = { 500, 900, 990, 999 };
+	uint64_t pct[ARRAY_SIZE(permille)];
+	const char *unit = hist->desc->unit ? hist->desc->unit : "";
+
+	osmo_histogram_percentiles(hist, permille, pct, ARRAY_SIZE(pct));
+
+	vty_out(vty, " %s%s: %8" PRIu64 " values, p50 %" PRIu64
+		", p90 %" PRIu64 ", p99 %" PRIu64 ", p99.9 %" PRIu64
+		", max %" PRIu64 " %s%s",
+		prefix, hist->desc->description, hist->count,
+		pct[0], pct[1], pct[2], pct[3], hist->max, unit, VTY_NEWLINE);
+}
+
+/*! print a histogram group to given VTY
+ *  \param[in] vty The VTY to which it should be printed
+ *  \param[in] prefix Any additional log prefix ahead of each line
+ *  \param[in] histg Histogram group to be printed
+ */
+void vty_out_histogram_group(struct vty *vty, const char *prefix,
+			     struct osmo_histogram_group *histg)
+{
+	unsigned int i;
+
+	vty_out(vty, "%s%s:%s", prefix, histg->desc->group_description,
+		VTY_NEWLINE);
+	for (i = 0; i < histg->desc->num_hist; i++)
+		vty_out_histogram(vty, prefix, &histg->hist[i]);
+}
+
+static int osmo_histogram_group_handler(struct osmo_histogram_group *histg, void *vctx_)
+{
+	struct vty_out_context *vctx = vctx_;
+	struct vty *vty = vctx->vty;
+	unsigned int i;
+
+	if (histg->desc->class_id > vctx->max_level)
+		return 0;
+
+	if (histg->idx)
+		vty_out(vty, "%s%s (%d):%s", vctx->prefix,
+			histg->desc->group_description, histg->idx,
+			VTY_NEWLINE);
+	else
+		vty_out(vty, "%s%s:%s", vctx->prefix,
+			histg->desc->group_description, VTY_NEWLINE);
+
+	for (i = 0; i < histg->desc->num_hist; i++)
+		vty_out_histogram(vty, vctx->prefix, &histg->hist[i]);
+
+	return 0;
+}
+
+/*! @} */
+
 /*! \addtogroup vty
  *  @{
  */
@@ -328,6 +401,7 @@ void vty_out_statistics_partial(struct vty *vty, const char *prefix,
 	osmo_counters_for_each(handle_counter, &vctx);
 	rate_ctr_for_each_group(rate_ctr_group_handler, &vctx);
 	osmo_stat_item_for_each_group(osmo_stat_item_group_handler, &vctx);
+	osmo_histogram_for_each_group(osmo_histogram_group_handler, &vctx);
 }
 
 void vty_out_statistics_full(struct vty *vty, const char *prefix)
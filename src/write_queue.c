@@ -22,9 +22,21 @@
  *
  */
 
+#define _GNU_SOURCE	/* sendmmsg() */
 #include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <osmocom/core/utils.h>
 #include <osmocom/core/write_queue.h>
 #include <osmocom/core/logging.h>
+#include <osmocom/core/rate_ctr.h>
+#include <osmocom/core/stat_item.h>
+#include <osmocom/core/stats.h>
+
+#include "../config.h"
 
 /*! \addtogroup write_queue
  *  @{
@@ -32,6 +44,214 @@
  *
  * \file write_queue.c */
 
+static const struct rate_ctr_desc wqueue_ctr_description[] = {
+	[OSMO_WQUEUE_CTR_BATCH_WRITES] =	{ "batch:writes",	"Batched system calls" },
+	[OSMO_WQUEUE_CTR_BATCH_MSGS] =		{ "batch:msgs",		"msgbs written by batched system calls" },
+	[OSMO_WQUEUE_CTR_WRITE_ERRORS] =	{ "write:errors",	"msgbs dropped by failed batched writes" },
+};
+
+static const struct rate_ctr_group_desc wqueue_ctrg_desc = {
+	.group_name_prefix = "wqueue",
+	.group_description = "Write Queue Statistics",
+	.num_ctr = ARRAY_SIZE(wqueue_ctr_description),
+	.ctr_desc = wqueue_ctr_description,
+	.class_id = OSMO_STATS_CLASS_GLOBAL,
+};
+
+static const struct osmo_stat_item_desc wqueue_stat_description[] = {
+	[OSMO_WQUEUE_STAT_LENGTH] =	{ "length",	"Number of queued msgbs", OSMO_STAT_ITEM_NO_UNIT, 16, 0 },
+	[OSMO_WQUEUE_STAT_BATCH_LEN] =	{ "batch.length", "msgbs written by a batched system call", OSMO_STAT_ITEM_NO_UNIT, 16, 0 },
+};
+
+static const struct osmo_stat_item_group_desc wqueue_statg_desc = {
+	.group_name_prefix = "wqueue",
+	.group_description = "Write Queue Statistics",
+	.class_id = OSMO_STATS_CLASS_GLOBAL,
+	.num_items = ARRAY_SIZE(wqueue_stat_description),
+	.item_desc = wqueue_stat_description,
+};
+
+static inline void wqueue_ctr_add(struct osmo_wqueue *queue, enum osmo_wqueue_ctr ctr, int inc)
+{
+	if (queue->ctrg)
+		rate_ctr_add(&queue->ctrg->ctr[ctr], inc);
+}
+
+static inline void wqueue_stat_set(struct osmo_wqueue *queue, enum osmo_wqueue_stat item, int32_t value)
+{
+	if (queue->statg)
+		osmo_stat_item_set(queue->statg->items[item], value);
+}
+
+/* determine (and cache) whether we write to a stream or a datagram socket */
+static int wqueue_sock_type(struct osmo_wqueue *queue)
+{
+	socklen_t len = sizeof(queue->sock_type);
+
+	if (queue->sock_type)
+		return queue->sock_type;
+
+	/* pipes, terminals and files are byte streams as well */
+	if (getsockopt(queue->bfd.fd, SOL_SOCKET, SO_TYPE, &queue->sock_type, &len) < 0
+	    || queue->sock_type != SOCK_DGRAM)
+		queue->sock_type = SOCK_STREAM;
+
+	return queue->sock_type;
+}
+
+/* release the first msgb of the queue */
+static void wqueue_drop_first(struct osmo_wqueue *queue)
+{
+	--queue->current_length;
+	msgb_free(msgb_dequeue(&queue->msg_queue));
+}
+
+static void wqueue_account_batch(struct osmo_wqueue *queue, unsigned int n)
+{
+	wqueue_ctr_add(queue, OSMO_WQUEUE_CTR_BATCH_WRITES, 1);
+	wqueue_ctr_add(queue, OSMO_WQUEUE_CTR_BATCH_MSGS, n);
+	wqueue_stat_set(queue, OSMO_WQUEUE_STAT_BATCH_LEN, n);
+	wqueue_stat_set(queue, OSMO_WQUEUE_STAT_LENGTH, queue->current_length);
+}
+
+/* write as many msgbs as possible with one writev(); the first msgb not
+ * written completely is trimmed and remains at the head of the queue */
+static int wqueue_write_stream(struct osmo_wqueue *queue, unsigned int max_batch)
+{
+	struct iovec iov[OSMO_WQUEUE_MAX_BATCH];
+	unsigned int i, n = 0;
+	struct msgb *msg;
+	ssize_t rc;
+
+	llist_for_each_entry(msg, &queue->msg_queue, list) {
+		if (n == max_batch)
+			break;
+		iov[n].iov_base = msgb_data(msg);
+		iov[n].iov_len = msgb_length(msg);
+		n++;
+	}
+
+	rc = writev(queue->bfd.fd, iov, n);
+	if (rc < 0)
+		return -errno;
+
+	for (i = 0; i < n; i++) {
+		msg = llist_entry(queue->msg_queue.next, struct msgb, list);
+		if (rc < msgb_length(msg)) {
+			msgb_pull(msg, rc);
+			break;
+		}
+		rc -= msgb_length(msg);
+		wqueue_drop_first(queue);
+	}
+	wqueue_account_batch(queue, i);
+
+	return 0;
+}
+
+#ifdef HAVE_SENDMMSG
+/* send up to max_batch msgbs as individual datagrams */
+static int wqueue_write_dgram(struct osmo_wqueue *queue, unsigned int max_batch)
+{
+	struct mmsghdr mmsg[OSMO_WQUEUE_MAX_BATCH];
+	struct iovec iov[OSMO_WQUEUE_MAX_BATCH];
+	unsigned int n = 0;
+	struct msgb *msg;
+	int i, rc;
+
+	llist_for_each_entry(msg, &queue->msg_queue, list) {
+		if (n == max_batch)
+			break;
+		iov[n].iov_base = msgb_data(msg);
+		iov[n].iov_len = msgb_length(msg);
+		memset(&mmsg[n], 0, sizeof(mmsg[n]));
+		mmsg[n].msg_hdr.msg_iov = &iov[n];
+		mmsg[n].msg_hdr.msg_iovlen = 1;
+		n++;
+	}
+
+	rc = sendmmsg(queue->bfd.fd, mmsg, n, 0);
+	if (rc < 0)
+		return -errno;
+
+	for (i = 0; i < rc; i++)
+		wqueue_drop_first(queue);
+	wqueue_account_batch(queue, rc);
+
+	return 0;
+}
+#else
+/* no sendmmsg(): one write() per datagram, which still saves the
+ * select() round-trip per msgb */
+static int wqueue_write_dgram(struct osmo_wqueue *queue, unsigned int max_batch)
+{
+	struct msgb *msg;
+	unsigned int n;
+
+	for (n = 0; n < max_batch && !llist_empty(&queue->msg_queue); n++) {
+		msg = llist_entry(queue->msg_queue.next, struct msgb, list);
+		if (write(queue->bfd.fd, msgb_data(msg), msgb_length(msg)) < 0) {
+			if (n == 0)
+				return -errno;
+			break;
+		}
+		wqueue_drop_first(queue);
+	}
+	wqueue_account_batch(queue, n);
+
+	return 0;
+}
+#endif
+
+#define WQUEUE_ERR_LOG_INTV	1000
+
+/* failed batched writes of all queues without write_err_cb */
+static unsigned long wqueue_num_unhandled_errors;
+
+/* write a batch of msgbs; returns -EBADF if write_err_cb freed the fd */
+static int wqueue_write_batch(struct osmo_wqueue *queue)
+{
+	unsigned int max_batch = OSMO_MIN(queue->max_batch, OSMO_WQUEUE_MAX_BATCH);
+	struct msgb *msg;
+	int rc;
+
+	if (wqueue_sock_type(queue) == SOCK_DGRAM)
+		rc = wqueue_write_dgram(queue, max_batch);
+	else
+		rc = wqueue_write_stream(queue, max_batch);
+
+	switch (rc) {
+	case 0:
+	case -EAGAIN:
+	case -EINTR:
+		return 0;
+	}
+
+	/* like with write_cb, a msgb that could not be written is lost */
+	wqueue_ctr_add(queue, OSMO_WQUEUE_CTR_WRITE_ERRORS, 1);
+	--queue->current_length;
+	wqueue_stat_set(queue, OSMO_WQUEUE_STAT_LENGTH, queue->current_length);
+	msg = msgb_dequeue(&queue->msg_queue);
+
+	if (queue->write_err_cb) {
+		rc = queue->write_err_cb(&queue->bfd, msg, rc);
+		msgb_free(msg);
+		return rc == -EBADF ? -EBADF : 0;
+	}
+	msgb_free(msg);
+
+	/* a connected datagram socket whose peer is not listening, e.g.
+	 * GSMTAP without a receiver, is nothing to log about; of the other
+	 * failures, log only every WQUEUE_ERR_LOG_INTV-th */
+	if (rc == -ECONNREFUSED && wqueue_sock_type(queue) == SOCK_DGRAM)
+		return 0;
+	if (wqueue_num_unhandled_errors++ % WQUEUE_ERR_LOG_INTV == 0)
+		LOGP(DLGLOBAL, LOGL_ERROR, "wqueue(%p) write failed: %s "
+		     "(%lu failures)\n", queue, strerror(-rc),
+		     wqueue_num_unhandled_errors);
+	return 0;
+}
+
 /*! Select loop function for write queue handling
  *  \param[in] fd osmocom file descriptor
  *  \param[in] what bit-mask of events that have happened
@@ -62,11 +282,18 @@ int osmo_wqueue_bfd_cb(struct osmo_fd *fd, unsigned int what)
 	if (what & BSC_FD_WRITE) {
 		struct msgb *msg;
 
-		fd->when &= ~BSC_FD_WRITE;
+		osmo_fd_update_when(fd, ~BSC_FD_WRITE, 0);
 
-		/* the queue might have been emptied */
-		if (!llist_empty(&queue->msg_queue)) {
+		if (queue->max_batch > 1 && !queue->write_cb) {
+			/* the queue might have been emptied */
+			if (!llist_empty(&queue->msg_queue) &&
+			    wqueue_write_batch(queue) == -EBADF)
+				goto err_badfd;
+			if (!llist_empty(&queue->msg_queue))
+				osmo_fd_update_when(fd, ~0, BSC_FD_WRITE);
+		} else if (!llist_empty(&queue->msg_queue)) {
 			--queue->current_length;
+			wqueue_stat_set(queue, OSMO_WQUEUE_STAT_LENGTH, queue->current_length);
 
 			msg = msgb_dequeue(&queue->msg_queue);
 			rc = queue->write_cb(fd, msg);
@@ -76,7 +303,7 @@ int osmo_wqueue_bfd_cb(struct osmo_fd *fd, unsigned int what)
 				goto err_badfd;
 
 			if (!llist_empty(&queue->msg_queue))
-				fd->when |= BSC_FD_WRITE;
+				osmo_fd_update_when(fd, ~0, BSC_FD_WRITE);
 		}
 	}
 
@@ -96,10 +323,39 @@ void osmo_wqueue_init(struct osmo_wqueue *queue, int max_length)
 	queue->read_cb = NULL;
 	queue->write_cb = NULL;
 	queue->except_cb = NULL;
+	queue->max_batch = 0;
+	queue->write_err_cb = NULL;
+	queue->ctrg = NULL;
+	queue->statg = NULL;
+	queue->sock_type = 0;
 	queue->bfd.cb = osmo_wqueue_bfd_cb;
 	INIT_LLIST_HEAD(&queue->msg_queue);
 }
 
+/*! Write several queued \ref msgb at once
+ *  \param[in] queue Write queue to operate on
+ *  \param[in] max_batch Maximum number of msgbs written per write event
+ *  \returns 0 on success; negative on error
+ *
+ * With \a max_batch > 1, \ref osmo_wqueue_bfd_cb writes up to \a max_batch
+ * queued msgbs to the file descriptor with a single writev() (stream
+ * sockets, pipes) or sendmmsg() (datagram sockets, which need to be
+ * connected).  This only applies to queues without a write_cb, as it
+ * could not be called for each msgb; a queue with write_cb keeps writing
+ * one msgb per write event.  A msgb written only partially to a stream is
+ * trimmed and completed on the next write event.  If a write fails, the
+ * first queued msgb is handed to write_err_cb, if set, and dropped.
+ */
+int osmo_wqueue_set_batch(struct osmo_wqueue *queue, unsigned int max_batch)
+{
+	if (max_batch > OSMO_WQUEUE_MAX_BATCH)
+		return -EINVAL;
+	if (max_batch > 1)
+		queue->sock_type = 0;
+	queue->max_batch = max_batch;
+	return 0;
+}
+
 /*! Enqueue a new \ref msgb into a write queue
  *  \param[in] queue Write queue to be used
  *  \param[in] data to-be-enqueued message buffer
@@ -114,8 +370,9 @@ int osmo_wqueue_enqueue(struct osmo_wqueue *queue, struct msgb *data)
 	}
 
 	++queue->current_length;
+	wqueue_stat_set(queue, OSMO_WQUEUE_STAT_LENGTH, queue->current_length);
 	msgb_enqueue(&queue->msg_queue, data);
-	queue->bfd.when |= BSC_FD_WRITE;
+	osmo_fd_update_when(&queue->bfd, ~0, BSC_FD_WRITE);
 
 	return 0;
 }
@@ -133,7 +390,48 @@ void osmo_wqueue_clear(struct osmo_wqueue *queue)
 	}
 
 	queue->current_length = 0;
-	queue->bfd.when &= ~BSC_FD_WRITE;
+	wqueue_stat_set(queue, OSMO_WQUEUE_STAT_LENGTH, 0);
+	osmo_fd_update_when(&queue->bfd, ~BSC_FD_WRITE, 0);
+}
+
+/*! Allocate rate counters and stat items for a write queue
+ *  \param[in] queue Write queue, initialized by \ref osmo_wqueue_init
+ *  \param[in] ctx talloc context to allocate the groups from
+ *  \param[in] idx Index of the "wqueue" rate counter and stat item groups
+ *  \returns 0 on success; negative on error
+ *
+ * The groups count batched writes and failures and sample the queue
+ * length, see \ref osmo_wqueue_ctr and \ref osmo_wqueue_stat.  They need
+ * to be released with \ref osmo_wqueue_stats_free.
+ */
+int osmo_wqueue_stats_alloc(struct osmo_wqueue *queue, void *ctx, unsigned int idx)
+{
+	if (queue->ctrg)
+		return -EALREADY;
+
+	queue->ctrg = rate_ctr_group_alloc(ctx, &wqueue_ctrg_desc, idx);
+	if (!queue->ctrg)
+		return -ENOMEM;
+	queue->statg = osmo_stat_item_group_alloc(ctx, &wqueue_statg_desc, idx);
+	if (!queue->statg) {
+		rate_ctr_group_free(queue->ctrg);
+		queue->ctrg = NULL;
+		return -ENOMEM;
+	}
+	return 0;
+}
+
+/*! Release the groups allocated by \ref osmo_wqueue_stats_alloc
+ *  \param[in] queue Write queue, may have no groups allocated
+ */
+void osmo_wqueue_stats_free(struct osmo_wqueue *queue)
+{
+	if (queue->ctrg)
+		rate_ctr_group_free(queue->ctrg);
+	if (queue->statg)
+		osmo_stat_item_group_free(queue->statg);
+	queue->ctrg = NULL;
+	queue->statg = NULL;
 }
 
 /*! @} */
@@ -0,0 +1,120 @@
+/* Benchmark of the A5/x cipher stream generation, one stream at a time
+ * (osmo_a5, osmo_a5_pbits) and batched (osmo_a5_batch) */
+/*
+ * (C) 2018 by sysmocom - s.f.m.c. GmbH
+ * All Rights Reserved
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <getopt.h>
+#include <time.h>
+
+#include <osmocom/core/bits.h>
+#include <osmocom/core/utils.h>
+#include <osmocom/gsm/a5.h>
+
+#define BATCH_NUM	256
+
+static uint8_t keys[BATCH_NUM][16];
+static uint32_t fns[BATCH_NUM];
+static pbit_t dl_p[BATCH_NUM][15], ul_p[BATCH_NUM][15];
+static ubit_t dl_u[114], ul_u[114];
+
+static const uint8_t *key_ptrs[BATCH_NUM];
+static pbit_t *dl_ptrs[BATCH_NUM], *ul_ptrs[BATCH_NUM];
+
+enum mode {
+	MODE_UBITS,
+	MODE_PBITS,
+	MODE_BATCH,
+	_NUM_MODE
+};
+
+static double elapsed(const struct timespec *start, const struct timespec *stop)
+{
+	return (stop->tv_sec - start->tv_sec) + (stop->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/* generate num DL+UL stream pairs, returns pairs per second */
+static double run(int n, enum mode mode, unsigned int num)
+{
+	struct timespec start, stop;
+	unsigned int i, j;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < num; i += BATCH_NUM) {
+		switch (mode) {
+		case MODE_UBITS:
+			for (j = 0; j < BATCH_NUM; j++)
+				osmo_a5(n, keys[j], fns[j], dl_u, ul_u);
+			break;
+		case MODE_PBITS:
+			for (j = 0; j < BATCH_NUM; j++)
+				osmo_a5_pbits(n, keys[j], fns[j], dl_p[j], ul_p[j]);
+			break;
+		case MODE_BATCH:
+			osmo_a5_batch(n, BATCH_NUM, key_ptrs, fns, dl_ptrs, ul_ptrs);
+			break;
+		default:
+			break;
+		}
+	}
+	clock_gettime(CLOCK_MONOTONIC, &stop);
+
+	return i / elapsed(&start, &stop);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int num = 100000;
+	double r[_NUM_MODE];
+	int c, i, n;
+
+	while ((c = getopt(argc, argv, "n:")) != -1) {
+		switch (c) {
+		case 'n':
+			num = atoi(optarg);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-n streams]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	srandom(1);
+	for (i = 0; i < BATCH_NUM; i++) {
+		for (c = 0; c < sizeof(keys[i]); c++)
+			keys[i][c] = random();
+		fns[i] = random() % (26 * 51 * 2048);
+		key_ptrs[i] = keys[i];
+		dl_ptrs[i] = dl_p[i];
+		ul_ptrs[i] = ul_p[i];
+	}
+
+	printf("%u DL+UL stream pairs each, kstreams/s on one core\n", num);
+	printf("%-6s %10s %10s %10s %8s\n", "algo", "osmo_a5", "pbits",
+	       "batch", "speed-up");
+
+	for (n = 1; n <= 4; n++) {
+		for (i = 0; i < _NUM_MODE; i++)
+			r[i] = run(n, i, num);
+		printf("A5/%-3d %10.1f %10.1f %10.1f %7.2fx\n", n, r[MODE_UBITS] / 1e3,
+		       r[MODE_PBITS] / 1e3, r[MODE_BATCH] / 1e3,
+		       r[MODE_BATCH] / r[MODE_UBITS]);
+	}
+
+	return 0;
+}
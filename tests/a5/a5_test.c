@@ -3,6 +3,7 @@
 #include <stdint.h>
 #include <string.h>
 #include <stdbool.h>
+#include <errno.h>
 
 #include <osmocom/core/bits.h>
 #include <osmocom/core/utils.h>
@@ -82,6 +83,71 @@ static inline bool test_a54(const char * kc, uint32_t count, const char * block1
 }
 
 
+#define BATCH_NUM	150
+
+/* Check the packed and batched variants against osmo_a5(), with a batch
+ * that spans several partially filled groups of bitsliced instances */
+static void test_pbits_batch(int n)
+{
+	static uint8_t keys[BATCH_NUM][16];
+	static uint32_t fns[BATCH_NUM];
+	static pbit_t dl_p[BATCH_NUM][15], ul_p[BATCH_NUM][15];
+	const uint8_t *key_ptrs[BATCH_NUM];
+	pbit_t *dl_ptrs[BATCH_NUM], *ul_ptrs[BATCH_NUM];
+	ubit_t dl_u[114], ul_u[114];
+	pbit_t dl_exp[15], ul_exp[15], out[15];
+	unsigned int i, j;
+
+	for (i = 0; i < BATCH_NUM; i++) {
+		for (j = 0; j < sizeof(keys[i]); j++)
+			keys[i][j] = random();
+		fns[i] = random() % (26 * 51 * 2048);
+		key_ptrs[i] = keys[i];
+		/* Leave out some of the downlink streams */
+		dl_ptrs[i] = (i % 7 == 3) ? NULL : dl_p[i];
+		ul_ptrs[i] = ul_p[i];
+	}
+
+	memset(dl_p, 0x55, sizeof(dl_p));
+	memset(ul_p, 0x55, sizeof(ul_p));
+	OSMO_ASSERT(osmo_a5_batch(n, BATCH_NUM, key_ptrs, fns, dl_ptrs, ul_ptrs) == 0);
+
+	for (i = 0; i < BATCH_NUM; i++) {
+		OSMO_ASSERT(osmo_a5(n, keys[i], fns[i], dl_u, ul_u) == 0);
+		memset(dl_exp, 0, sizeof(dl_exp));
+		memset(ul_exp, 0, sizeof(ul_exp));
+		osmo_ubit2pbit(dl_exp, dl_u, 114);
+		osmo_ubit2pbit(ul_exp, ul_u, 114);
+
+		if (dl_ptrs[i]) {
+			OSMO_ASSERT(!memcmp(dl_p[i], dl_exp, 15));
+		} else
+			OSMO_ASSERT(dl_p[i][0] == 0x55);
+		OSMO_ASSERT(!memcmp(ul_p[i], ul_exp, 15));
+
+		OSMO_ASSERT(osmo_a5_pbits(n, keys[i], fns[i], out, NULL) == 0);
+		OSMO_ASSERT(!memcmp(out, dl_exp, 15));
+		OSMO_ASSERT(osmo_a5_pbits(n, keys[i], fns[i], NULL, out) == 0);
+		OSMO_ASSERT(!memcmp(out, ul_exp, 15));
+	}
+
+	/* Downlink only */
+	memset(dl_p, 0x55, sizeof(dl_p));
+	memset(ul_p, 0x55, sizeof(ul_p));
+	OSMO_ASSERT(osmo_a5_batch(n, 65, key_ptrs, fns, ul_ptrs, NULL) == 0);
+	for (i = 0; i < BATCH_NUM; i++) {
+		OSMO_ASSERT(osmo_a5(n, keys[i], fns[i], dl_u, NULL) == 0);
+		memset(dl_exp, 0, sizeof(dl_exp));
+		osmo_ubit2pbit(dl_exp, dl_u, 114);
+		if (i < 65) {
+			OSMO_ASSERT(!memcmp(ul_p[i], dl_exp, 15));
+		} else
+			OSMO_ASSERT(ul_p[i][0] == 0x55);
+	}
+
+	printf("A5/%d - packed and batch: OK\n", n);
+}
+
 int main(int argc, char **argv)
 {
 	ubit_t exp[114], out[114];
@@ -139,5 +205,10 @@ int main(int argc, char **argv)
 	test_a54("3D43C388C9581E337FF1F97EB5C1F85E", 0x35D2CF, "A2FE3034B6B22CC4E33C7090BEC340", "170D7497432FF897B91BE8AECBA880");
 	test_a54("A4496A64DF4F399F3B4506814A3E07A1", 0x212777, "89CDEE360DF9110281BCF57755A040", "33822C0C779598C9CBFC49183AF7C0");
 
+	srandom(1);
+	for (n = 0; n <= 4; n++)
+		test_pbits_batch(n);
+	OSMO_ASSERT(osmo_a5_batch(5, 0, NULL, NULL, NULL, NULL) == -ENOTSUP);
+
 	return 0;
 }
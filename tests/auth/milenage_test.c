@@ -7,6 +7,7 @@
 
 #include <osmocom/crypt/auth.h>
 #include <osmocom/core/utils.h>
+#include <osmocom/core/bit64gen.h>
 
 int milenage_opc_gen(uint8_t *opc, const uint8_t *k, const uint8_t *op);
 
@@ -75,6 +76,109 @@ extern int milenage_f1(const u8 *opc, const u8 *k, const u8 *_rand,
 		       const u8 *sqn, const u8 *amf, u8 *mac_a, u8 *mac_s);
 #endif
 
+int milenage_f1(const uint8_t *opc, const uint8_t *k, const uint8_t *_rand,
+		const uint8_t *sqn, const uint8_t *amf, uint8_t *mac_a,
+		uint8_t *mac_s);
+int milenage_f2345(const uint8_t *opc, const uint8_t *k, const uint8_t *_rand,
+		   uint8_t *res, uint8_t *ck, uint8_t *ik, uint8_t *ak,
+		   uint8_t *akstar);
+int gsm_milenage(const uint8_t *opc, const uint8_t *k, const uint8_t *_rand,
+		 uint8_t *sres, uint8_t *kc);
+
+#define BATCH_NUM 37
+
+/* Check vec against the separate f1, f2345 and GSM-MILENAGE functions */
+static void check_vec(const struct osmo_auth_vector *vec,
+		      const struct osmo_sub_auth_data *aud, uint64_t sqn)
+{
+	const uint8_t *amf = aud->u.umts.amf;
+	uint8_t sqn_b[6], mac_a[8], res[8], ck[16], ik[16], ak[6];
+	uint8_t sres[4], kc[8];
+	int i;
+
+	osmo_store64be_ext(sqn, sqn_b, 6);
+	OSMO_ASSERT(!milenage_f1(aud->u.umts.opc, aud->u.umts.k, vec->rand,
+				 sqn_b, amf, mac_a, NULL));
+	OSMO_ASSERT(!milenage_f2345(aud->u.umts.opc, aud->u.umts.k, vec->rand,
+				    res, ck, ik, ak, NULL));
+	OSMO_ASSERT(!gsm_milenage(aud->u.umts.opc, aud->u.umts.k, vec->rand,
+				  sres, kc));
+
+	for (i = 0; i < 6; i++)
+		OSMO_ASSERT(vec->autn[i] == (sqn_b[i] ^ ak[i]));
+	OSMO_ASSERT(!memcmp(vec->autn + 6, amf, 2));
+	OSMO_ASSERT(!memcmp(vec->autn + 8, mac_a, 8));
+	OSMO_ASSERT(vec->res_len == 8 && !memcmp(vec->res, res, 8));
+	OSMO_ASSERT(!memcmp(vec->ck, ck, 16));
+	OSMO_ASSERT(!memcmp(vec->ik, ik, 16));
+	OSMO_ASSERT(!memcmp(vec->sres, sres, 4));
+	OSMO_ASSERT(!memcmp(vec->kc, kc, 8));
+	OSMO_ASSERT(vec->auth_types == (OSMO_AUTH_TYPE_UMTS | OSMO_AUTH_TYPE_GSM));
+}
+
+static void test_batch(void)
+{
+	struct osmo_auth_vector vec[BATCH_NUM], ref;
+	struct osmo_sub_auth_data aud[2], *auds[BATCH_NUM];
+	uint8_t _rand[BATCH_NUM * 16];
+	uint64_t sqn[2];
+	unsigned int i, j;
+
+	for (i = 0; i < sizeof(_rand); i++)
+		_rand[i] = random();
+
+	for (j = 0; j < 2; j++) {
+		aud[j] = test_aud;
+		for (i = 0; i < 16; i++) {
+			aud[j].u.umts.k[i] = random();
+			aud[j].u.umts.opc[i] = random();
+		}
+		aud[j].u.umts.amf[0] = j;
+		aud[j].u.umts.sqn = 0x1234 + j;
+		aud[j].u.umts.ind_bitlen = 5;
+		aud[j].u.umts.ind = 3 + j;
+	}
+
+	/* One subscriber: same SQN progression as single vectors */
+	sqn[0] = aud[0].u.umts.sqn;
+	OSMO_ASSERT(osmo_auth_gen_vec_batch(vec, &aud[0], _rand, BATCH_NUM) == 0);
+	for (i = 0; i < BATCH_NUM; i++) {
+		sqn[0] = ((sqn[0] + 32) & ~31ULL) + 3;
+		OSMO_ASSERT(!memcmp(vec[i].rand, &_rand[16 * i], 16));
+		check_vec(&vec[i], &aud[0], sqn[0]);
+	}
+	OSMO_ASSERT(aud[0].u.umts.sqn == sqn[0]);
+
+	aud[1].u.umts.sqn = sqn[1] = 0x1234;
+	for (i = 0; i < BATCH_NUM; i++) {
+		OSMO_ASSERT(osmo_auth_gen_vec(&ref, &aud[1], &_rand[16 * i]) == 0);
+		sqn[1] = ((sqn[1] + 32) & ~31ULL) + 4;
+		OSMO_ASSERT(aud[1].u.umts.sqn == sqn[1]);
+		check_vec(&ref, &aud[1], sqn[1]);
+	}
+
+	/* Several subscribers, in runs of different lengths */
+	sqn[0] = aud[0].u.umts.sqn;
+	sqn[1] = aud[1].u.umts.sqn;
+	for (i = 0; i < BATCH_NUM; i++)
+		auds[i] = &aud[(i / 3 + i / 7) & 1];
+	OSMO_ASSERT(osmo_auth_gen_vecs(vec, auds, _rand, BATCH_NUM) == 0);
+	for (i = 0; i < BATCH_NUM; i++) {
+		j = auds[i] - aud;
+		sqn[j] = ((sqn[j] + 32) & ~31ULL) + 3 + j;
+		check_vec(&vec[i], auds[i], sqn[j]);
+	}
+	OSMO_ASSERT(aud[0].u.umts.sqn == sqn[0]);
+	OSMO_ASSERT(aud[1].u.umts.sqn == sqn[1]);
+
+	/* Errors are passed on, without touching SQN */
+	aud[0].u.umts.ind = 32;
+	OSMO_ASSERT(osmo_auth_gen_vec_batch(vec, &aud[0], _rand, BATCH_NUM) == -3);
+	OSMO_ASSERT(aud[0].u.umts.sqn == sqn[0]);
+
+	printf("batch of %u vectors: OK\n", BATCH_NUM);
+}
+
 int main(int argc, char **argv)
 {
 	struct osmo_auth_vector _vec;
@@ -193,6 +297,8 @@ int main(int argc, char **argv)
 
 	opc_test(&test_aud);
 
+	test_batch();
+
 	exit(0);
 
 }
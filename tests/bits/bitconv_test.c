@@ -0,0 +1,121 @@
+/* Check the bit conversion functions against the bit at a time reference,
+ * for all lengths and offsets that exercise the vector kernels, the SWAR
+ * code and the bit by bit tails */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <osmocom/core/bits.h>
+#include <osmocom/core/utils.h>
+
+#include "bits_ref.h"
+
+#define MAX_BITS	1300
+#define MAX_OFS		17
+
+static ubit_t ubits[MAX_BITS + MAX_OFS];
+static sbit_t sbits[MAX_BITS];
+static pbit_t pbits[(MAX_BITS + MAX_OFS) / 8 + 1];
+
+static void test_ubit2pbit(void)
+{
+	pbit_t out[MAX_BITS / 8 + 1], ref[MAX_BITS / 8 + 1];
+	unsigned int len;
+
+	for (len = 0; len <= MAX_BITS; len++) {
+		memset(out, 0xaa, sizeof(out));
+		memset(ref, 0xaa, sizeof(ref));
+		OSMO_ASSERT(osmo_ubit2pbit(out, ubits, len) ==
+			    ref_ubit2pbit(ref, ubits, len));
+		OSMO_ASSERT(!memcmp(out, ref, sizeof(out)));
+	}
+
+	printf("%s: OK\n", __func__);
+}
+
+static void test_pbit2ubit(void)
+{
+	ubit_t out[MAX_BITS + 8], ref[MAX_BITS + 8];
+	unsigned int len;
+
+	for (len = 1; len <= MAX_BITS; len++) {
+		memset(out, 0xaa, sizeof(out));
+		memset(ref, 0xaa, sizeof(ref));
+		OSMO_ASSERT(osmo_pbit2ubit(out, pbits, len) ==
+			    ref_pbit2ubit(ref, pbits, len));
+		OSMO_ASSERT(!memcmp(out, ref, sizeof(out)));
+	}
+
+	printf("%s: OK\n", __func__);
+}
+
+static void test_soft(void)
+{
+	sbit_t sout[MAX_BITS + 1], sref[MAX_BITS + 1];
+	ubit_t uout[MAX_BITS + 1], uref[MAX_BITS + 1];
+	unsigned int len;
+
+	for (len = 0; len <= MAX_BITS; len++) {
+		memset(sout, 0x55, sizeof(sout));
+		memset(sref, 0x55, sizeof(sref));
+		osmo_ubit2sbit(sout, ubits, len);
+		ref_ubit2sbit(sref, ubits, len);
+		OSMO_ASSERT(!memcmp(sout, sref, sizeof(sout)));
+
+		memset(uout, 0x55, sizeof(uout));
+		memset(uref, 0x55, sizeof(uref));
+		osmo_sbit2ubit(uout, sbits, len);
+		ref_sbit2ubit(uref, sbits, len);
+		OSMO_ASSERT(!memcmp(uout, uref, sizeof(uout)));
+	}
+
+	printf("%s: OK\n", __func__);
+}
+
+static void test_ext(int lsb_mode)
+{
+	pbit_t pout[sizeof(pbits)], pref[sizeof(pbits)];
+	ubit_t uout[sizeof(ubits)], uref[sizeof(ubits)];
+	unsigned int len, in_ofs, out_ofs;
+
+	for (len = 1; len <= 300; len++) {
+		for (in_ofs = 0; in_ofs < MAX_OFS; in_ofs++) {
+			for (out_ofs = 0; out_ofs < MAX_OFS; out_ofs++) {
+				memset(pout, 0x5a, sizeof(pout));
+				memset(pref, 0x5a, sizeof(pref));
+				OSMO_ASSERT(osmo_ubit2pbit_ext(pout, out_ofs, ubits, in_ofs, len, lsb_mode) ==
+					    ref_ubit2pbit_ext(pref, out_ofs, ubits, in_ofs, len, lsb_mode));
+				OSMO_ASSERT(!memcmp(pout, pref, sizeof(pout)));
+
+				memset(uout, 0x5a, sizeof(uout));
+				memset(uref, 0x5a, sizeof(uref));
+				OSMO_ASSERT(osmo_pbit2ubit_ext(uout, out_ofs, pbits, in_ofs, len, lsb_mode) ==
+					    ref_pbit2ubit_ext(uref, out_ofs, pbits, in_ofs, len, lsb_mode));
+				OSMO_ASSERT(!memcmp(uout, uref, sizeof(uout)));
+			}
+		}
+	}
+
+	printf("%s(lsb_mode=%d): OK\n", __func__, lsb_mode);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int i;
+
+	srandom(1);
+	for (i = 0; i < ARRAY_SIZE(ubits); i++)
+		ubits[i] = random() & 1;
+	for (i = 0; i < ARRAY_SIZE(sbits); i++)
+		sbits[i] = (random() % 255) - 127;
+	for (i = 0; i < ARRAY_SIZE(pbits); i++)
+		pbits[i] = random();
+
+	test_ubit2pbit();
+	test_pbit2ubit();
+	test_soft();
+	test_ext(0);
+	test_ext(1);
+
+	return 0;
+}
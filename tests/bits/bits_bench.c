@@ -0,0 +1,160 @@
+/* Benchmark of the bit conversion functions against the bit at a time
+ * reference, for the burst and block sizes used by src/coding */
+/*
+ * (C) 2018 by sysmocom - s.f.m.c. GmbH
+ * All Rights Reserved
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <getopt.h>
+#include <time.h>
+
+#include <osmocom/core/bits.h>
+#include <osmocom/core/utils.h>
+
+#include "bits_ref.h"
+
+#define MAX_BITS	1248
+
+/* Normal burst payload, coded block, EDGE MCS-9 coded block */
+static const unsigned int sizes[] = { 114, 456, 1248 };
+
+static ubit_t ubits[MAX_BITS];
+static sbit_t sbits[MAX_BITS];
+static pbit_t pbits[MAX_BITS / 8];
+
+static ubit_t uout[MAX_BITS];
+static sbit_t sout[MAX_BITS];
+static pbit_t pout[MAX_BITS / 8];
+
+enum conv {
+	CONV_UBIT2PBIT,
+	CONV_PBIT2UBIT,
+	CONV_UBIT2SBIT,
+	CONV_SBIT2UBIT,
+	CONV_UBIT2PBIT_EXT,
+	CONV_PBIT2UBIT_EXT,
+	_NUM_CONV
+};
+
+static const char *conv_names[_NUM_CONV] = {
+	[CONV_UBIT2PBIT]	= "ubit2pbit",
+	[CONV_PBIT2UBIT]	= "pbit2ubit",
+	[CONV_UBIT2SBIT]	= "ubit2sbit",
+	[CONV_SBIT2UBIT]	= "sbit2ubit",
+	[CONV_UBIT2PBIT_EXT]	= "ubit2pbit_ext",
+	[CONV_PBIT2UBIT_EXT]	= "pbit2ubit_ext",
+};
+
+static double elapsed(const struct timespec *start, const struct timespec *stop)
+{
+	return (stop->tv_sec - start->tv_sec) + (stop->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/* convert num times, returns conversions per second */
+static double run(enum conv conv, unsigned int len, unsigned int num, int ref)
+{
+	struct timespec start, stop;
+	unsigned int i;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < num; i++) {
+		switch (conv) {
+		case CONV_UBIT2PBIT:
+			if (ref)
+				ref_ubit2pbit(pout, ubits, len);
+			else
+				osmo_ubit2pbit(pout, ubits, len);
+			break;
+		case CONV_PBIT2UBIT:
+			if (ref)
+				ref_pbit2ubit(uout, pbits, len);
+			else
+				osmo_pbit2ubit(uout, pbits, len);
+			break;
+		case CONV_UBIT2SBIT:
+			if (ref)
+				ref_ubit2sbit(sout, ubits, len);
+			else
+				osmo_ubit2sbit(sout, ubits, len);
+			break;
+		case CONV_SBIT2UBIT:
+			if (ref)
+				ref_sbit2ubit(uout, sbits, len);
+			else
+				osmo_sbit2ubit(uout, sbits, len);
+			break;
+		case CONV_UBIT2PBIT_EXT:
+			if (ref)
+				ref_ubit2pbit_ext(pout, 0, ubits, 0, len, 1);
+			else
+				osmo_ubit2pbit_ext(pout, 0, ubits, 0, len, 1);
+			break;
+		case CONV_PBIT2UBIT_EXT:
+			if (ref)
+				ref_pbit2ubit_ext(uout, 0, pbits, 0, len, 1);
+			else
+				osmo_pbit2ubit_ext(uout, 0, pbits, 0, len, 1);
+			break;
+		default:
+			break;
+		}
+	}
+	clock_gettime(CLOCK_MONOTONIC, &stop);
+
+	return num / elapsed(&start, &stop);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int num = 1000000;
+	double ref, acc;
+	int c, i, j;
+
+	while ((c = getopt(argc, argv, "n:")) != -1) {
+		switch (c) {
+		case 'n':
+			num = atoi(optarg);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-n conversions]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	srandom(1);
+	for (i = 0; i < MAX_BITS; i++) {
+		ubits[i] = random() & 1;
+		sbits[i] = (random() % 255) - 127;
+	}
+	for (i = 0; i < ARRAY_SIZE(pbits); i++)
+		pbits[i] = random();
+
+	printf("%u conversions each, Mconversions/s on one core\n", num);
+	printf("%-14s %6s %10s %10s %8s\n", "function", "bits", "bitwise",
+	       "current", "speed-up");
+
+	for (i = 0; i < _NUM_CONV; i++) {
+		for (j = 0; j < ARRAY_SIZE(sizes); j++) {
+			ref = run(i, sizes[j], num, 1);
+			acc = run(i, sizes[j], num, 0);
+			printf("%-14s %6u %10.2f %10.2f %7.2fx\n", conv_names[i],
+			       sizes[j], ref / 1e6, acc / 1e6, acc / ref);
+		}
+	}
+
+	return 0;
+}
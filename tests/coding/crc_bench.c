@@ -0,0 +1,146 @@
+/* Benchmark of the table-driven CRC computation over the GSM 05.03 parity
+ * codes, against the bit by bit reference */
+/*
+ * (C) 2018 by sysmocom - s.f.m.c. GmbH
+ * All Rights Reserved
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <getopt.h>
+#include <time.h>
+
+#include <osmocom/core/bits.h>
+#include <osmocom/core/crcgen.h>
+#include <osmocom/core/utils.h>
+#include <osmocom/coding/gsm0503_parity.h>
+
+#define MAX_LEN_BITS	2048
+
+/* Bit by bit reference, as osmo_crcXXgen_compute_bits() used to be */
+#define CRC_REF(XX) \
+static uint##XX##_t crc##XX##_ref(const struct osmo_crc##XX##gen_code *code, \
+				  const ubit_t *in, int len) \
+{ \
+	uint##XX##_t crc = code->init; \
+	int i, n = code->bits - 1; \
+	for (i = 0; i < len; i++) { \
+		crc ^= (uint##XX##_t)(in[i] & 1) << n; \
+		if (crc & ((uint##XX##_t)1 << n)) \
+			crc = (crc << 1) ^ code->poly; \
+		else \
+			crc <<= 1; \
+		crc &= ((uint##XX##_t)1 << code->bits) - 1; \
+	} \
+	return crc ^ code->remainder; \
+}
+
+CRC_REF(8)
+CRC_REF(16)
+CRC_REF(64)
+
+static double elapsed(const struct timespec *start, const struct timespec *stop)
+{
+	return (stop->tv_sec - start->tv_sec) + (stop->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/* Check and time one code: reference, unpacked and packed bits.
+ * Results are in Mbit/s, the check is done for every length up to len. */
+#define CRC_BENCH(XX) \
+static void bench_crc##XX(const char *name, \
+			  const struct osmo_crc##XX##gen_code *code, \
+			  const ubit_t *in, const pbit_t *pin, int len, \
+			  unsigned int num) \
+{ \
+	struct timespec start, stop; \
+	volatile uint##XX##_t sink; \
+	double t_ref, t_bits, t_pbits; \
+	unsigned int i; \
+	int l; \
+	for (l = 0; l <= len; l++) { \
+		pbit_t p[MAX_LEN_BITS / 8 + 1]; \
+		osmo_ubit2pbit(p, in, l); \
+		OSMO_ASSERT(osmo_crc##XX##gen_compute_bits(code, in, l) == \
+			    crc##XX##_ref(code, in, l)); \
+		OSMO_ASSERT(osmo_crc##XX##gen_compute_pbits(code, p, l) == \
+			    crc##XX##_ref(code, in, l)); \
+	} \
+	clock_gettime(CLOCK_MONOTONIC, &start); \
+	for (i = 0; i < num; i++) \
+		sink = crc##XX##_ref(code, in, len); \
+	clock_gettime(CLOCK_MONOTONIC, &stop); \
+	t_ref = elapsed(&start, &stop); \
+	clock_gettime(CLOCK_MONOTONIC, &start); \
+	for (i = 0; i < num; i++) \
+		sink = osmo_crc##XX##gen_compute_bits(code, in, len); \
+	clock_gettime(CLOCK_MONOTONIC, &stop); \
+	t_bits = elapsed(&start, &stop); \
+	clock_gettime(CLOCK_MONOTONIC, &start); \
+	for (i = 0; i < num; i++) \
+		sink = osmo_crc##XX##gen_compute_pbits(code, pin, len); \
+	clock_gettime(CLOCK_MONOTONIC, &stop); \
+	t_pbits = elapsed(&start, &stop); \
+	(void) sink; \
+	printf("%-12s %6d %10.1f %10.1f %10.1f %7.2fx %7.2fx\n", name, len, \
+	       num * len / t_ref / 1e6, num * len / t_bits / 1e6, \
+	       num * len / t_pbits / 1e6, t_ref / t_bits, t_ref / t_pbits); \
+}
+
+CRC_BENCH(8)
+CRC_BENCH(16)
+CRC_BENCH(64)
+
+int main(int argc, char **argv)
+{
+	unsigned int num = 200000;
+	ubit_t data[MAX_LEN_BITS];
+	pbit_t pdata[MAX_LEN_BITS / 8];
+	int c, i;
+
+	while ((c = getopt(argc, argv, "n:")) != -1) {
+		switch (c) {
+		case 'n':
+			num = atoi(optarg);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-n blocks]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	srandom(1);
+	for (i = 0; i < MAX_LEN_BITS; i++)
+		data[i] = random() & 1;
+	osmo_ubit2pbit(pdata, data, MAX_LEN_BITS);
+
+	printf("%u blocks per code, Mbit/s on one core\n", num);
+	printf("%-12s %6s %10s %10s %10s %8s %8s\n", "code", "bits", "bitwise",
+	       "ubits", "pbits", "ubits", "pbits");
+
+	/* Block lengths of the GSM 05.03 channels using the codes */
+	bench_crc64("FIRE CRC40", &gsm0503_fire_crc40, data, pdata, 184, num);
+	bench_crc16("CS2 CRC16", &gsm0503_cs234_crc16, data, pdata, 271, num);
+	bench_crc16("CS4 CRC16", &gsm0503_cs234_crc16, data, pdata, 431, num);
+	bench_crc16("MCS9 CRC12", &gsm0503_mcs_crc12, data, pdata, 612, num);
+	bench_crc16("SCH CRC10", &gsm0503_sch_crc10, data, pdata, 25, num);
+	bench_crc8("MCS hdr CRC8", &gsm0503_mcs_crc8_hdr, data, pdata, 36, num);
+	bench_crc8("EFR CRC8", &gsm0503_tch_efr_crc8, data, pdata, 65, num);
+	bench_crc8("RACH CRC6", &gsm0503_rach_crc6, data, pdata, 8, num);
+	bench_crc8("AMR CRC6", &gsm0503_amr_crc6, data, pdata, 81, num);
+	bench_crc8("FR CRC3", &gsm0503_tch_fr_crc3, data, pdata, 50, num);
+	bench_crc64("FIRE CRC40", &gsm0503_fire_crc40, data, pdata, MAX_LEN_BITS, num / 10);
+
+	return 0;
+}
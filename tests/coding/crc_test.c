@@ -0,0 +1,119 @@
+/* Check the table-driven CRC computation of the GSM 05.03 parity codes
+ * against a bit by bit reference */
+/*
+ * (C) 2018 by sysmocom - s.f.m.c. GmbH
+ * All Rights Reserved
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <stdio.h>
+#include <inttypes.h>
+
+#include <osmocom/core/bits.h>
+#include <osmocom/core/crcgen.h>
+#include <osmocom/core/utils.h>
+#include <osmocom/coding/gsm0503_parity.h>
+
+#define MAX_LEN_BITS	2048
+
+/* Bit by bit reference, as osmo_crcXXgen_compute_bits() used to be */
+#define CRC_REF(XX) \
+static uint##XX##_t crc##XX##_ref(const struct osmo_crc##XX##gen_code *code, \
+				  const ubit_t *in, int len) \
+{ \
+	uint##XX##_t crc = code->init; \
+	int i, n = code->bits - 1; \
+	for (i = 0; i < len; i++) { \
+		crc ^= (uint##XX##_t)(in[i] & 1) << n; \
+		if (crc & ((uint##XX##_t)1 << n)) \
+			crc = (crc << 1) ^ code->poly; \
+		else \
+			crc <<= 1; \
+		crc &= ((uint##XX##_t)1 << code->bits) - 1; \
+	} \
+	return crc ^ code->remainder; \
+}
+
+CRC_REF(8)
+CRC_REF(16)
+CRC_REF(64)
+
+/* Compare unpacked and packed computation, check and set with the reference
+ * for every length from 0 to len bits, print the CRC of the full block */
+#define CRC_TEST(XX) \
+static void test_crc##XX(const char *name, \
+			 const struct osmo_crc##XX##gen_code *code, \
+			 const ubit_t *in, int len) \
+{ \
+	pbit_t p[MAX_LEN_BITS / 8 + 1]; \
+	ubit_t crc_bits[XX]; \
+	uint##XX##_t ref = 0; \
+	int l, errors = 0; \
+	for (l = 0; l <= len; l++) { \
+		ref = crc##XX##_ref(code, in, l); \
+		osmo_ubit2pbit(p, in, l); \
+		if (osmo_crc##XX##gen_compute_bits(code, in, l) != ref) { \
+			printf("%s: compute_bits mismatch at %d bits\n", name, l); \
+			errors++; \
+		} \
+		if (osmo_crc##XX##gen_compute_pbits(code, p, l) != ref) { \
+			printf("%s: compute_pbits mismatch at %d bits\n", name, l); \
+			errors++; \
+		} \
+		osmo_crc##XX##gen_set_bits(code, in, l, crc_bits); \
+		if (osmo_crc##XX##gen_check_bits(code, in, l, crc_bits) != 0) { \
+			printf("%s: set/check_bits mismatch at %d bits\n", name, l); \
+			errors++; \
+		} \
+	} \
+	printf("%-12s %4d bits: crc 0x%0*" PRIx64 ", %s\n", name, len, \
+	       (code->bits + 3) / 4, (uint64_t)ref, errors ? "FAILED" : "ok"); \
+}
+
+CRC_TEST(8)
+CRC_TEST(16)
+CRC_TEST(64)
+
+int main(int argc, char **argv)
+{
+	ubit_t data[MAX_LEN_BITS];
+	uint32_t lfsr = 0xdeadbeef;
+	int i;
+
+	/* reproducible pseudo random input, independent of the C library */
+	for (i = 0; i < MAX_LEN_BITS; i++) {
+		lfsr = lfsr * 1103515245 + 12345;
+		data[i] = (lfsr >> 16) & 1;
+	}
+
+	/* Block lengths of the GSM 05.03 channels using the codes */
+	test_crc64("FIRE CRC40", &gsm0503_fire_crc40, data, 184);
+	test_crc16("CS2 CRC16", &gsm0503_cs234_crc16, data, 271);
+	test_crc16("CS3 CRC16", &gsm0503_cs234_crc16, data, 315);
+	test_crc16("CS4 CRC16", &gsm0503_cs234_crc16, data, 431);
+	test_crc16("MCS9 CRC12", &gsm0503_mcs_crc12, data, 612);
+	test_crc16("SCH CRC10", &gsm0503_sch_crc10, data, 25);
+	test_crc8("MCS hdr CRC8", &gsm0503_mcs_crc8_hdr, data, 36);
+	test_crc8("EFR CRC8", &gsm0503_tch_efr_crc8, data, 65);
+	test_crc8("RACH CRC6", &gsm0503_rach_crc6, data, 8);
+	test_crc8("AMR CRC6", &gsm0503_amr_crc6, data, 81);
+	test_crc8("FR CRC3", &gsm0503_tch_fr_crc3, data, 50);
+
+	/* Longer than any block, crosses many table slices */
+	test_crc64("FIRE CRC40", &gsm0503_fire_crc40, data, MAX_LEN_BITS);
+	test_crc16("CS4 CRC16", &gsm0503_cs234_crc16, data, MAX_LEN_BITS);
+	test_crc8("AMR CRC6", &gsm0503_amr_crc6, data, MAX_LEN_BITS);
+
+	return 0;
+}
@@ -17,6 +17,144 @@ static void fill_random(ubit_t *b, int n)
 		b[i] = random() & 1;
 }
 
+#define BATCH_SIZE	5
+
+/* reference bit error count by encoding the decoded bits again */
+static int count_errors(const struct conv_test_vector *test,
+			const sbit_t *in, const ubit_t *out)
+{
+	ubit_t recoded[MAX_LEN_BITS];
+	int i, len, n_errors = 0;
+
+	len = osmo_conv_encode(test->code, out, recoded);
+	for (i = 0; i < len; i++) {
+		if (!((recoded[i] && in[i] < 0) || (!recoded[i] && in[i] > 0)))
+			n_errors++;
+	}
+
+	return n_errors;
+}
+
+static int do_check_batch(const struct conv_test_vector *test)
+{
+	ubit_t data[MAX_LEN_BITS], coded[MAX_LEN_BITS], ref[MAX_LEN_BITS];
+	sbit_t bs[BATCH_SIZE][MAX_LEN_BITS];
+	ubit_t bu[BATCH_SIZE][MAX_LEN_BITS];
+	const sbit_t *in[BATCH_SIZE];
+	ubit_t *out[BATCH_SIZE];
+	int n_errors[BATCH_SIZE], n_bits_total[BATCH_SIZE];
+	int i, j, len;
+
+	for (i = 0; i < BATCH_SIZE; i++) {
+		fill_random(data, test->in_len);
+		len = osmo_conv_encode(test->code, data, coded);
+
+		/* soft bits of random confidence, with some of them wrong */
+		for (j = 0; j < len; j++) {
+			bs[i][j] = (random() % 127) + 1;
+			if (coded[j] ^ !(random() % 16))
+				bs[i][j] = -bs[i][j];
+		}
+
+		in[i] = bs[i];
+		out[i] = bu[i];
+	}
+
+	if (osmo_conv_decode_batch(test->code, BATCH_SIZE, in, out,
+				   n_errors, n_bits_total) < 0) {
+		printf("ERROR !\n");
+		fprintf(stderr, "[!] Failed batch decoding\n");
+		return -1;
+	}
+
+	for (i = 0; i < BATCH_SIZE; i++) {
+		int ref_errors, ref_bits, metric;
+
+		osmo_conv_decode(test->code, bs[i], ref);
+		if (memcmp(ref, bu[i], test->in_len) ||
+		    n_bits_total[i] != test->out_len ||
+		    n_errors[i] != count_errors(test, bs[i], ref)) {
+			printf("ERROR !\n");
+			fprintf(stderr, "[!] Failed batch decoding: Results don't match\n");
+			return -1;
+		}
+
+		/* the bit errors from the traceback must be those of the
+		 * re-encoded output */
+		osmo_conv_decode_cached_ber(test->code, bs[i], ref, NULL,
+					    &ref_errors, &ref_bits, &metric);
+		if (ref_errors != n_errors[i] || ref_bits != n_bits_total[i] ||
+		    metric <= 0 || metric > 127 * ref_bits) {
+			printf("ERROR !\n");
+			fprintf(stderr, "[!] Failed bit error count: %d/%d, expected %d/%d\n",
+				ref_errors, ref_bits, n_errors[i], n_bits_total[i]);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/* Every SIMD back-end that the CPU supports must decode noisy blocks and
+ * count the bit errors exactly like the generic one */
+static int do_check_backends(const struct conv_test_vector *test)
+{
+	enum osmo_conv_acc_backend def = osmo_conv_acc_get_backend();
+	struct osmo_conv_acc_decoder *dec[_NUM_OSMO_CONV_ACC_BACKEND];
+	ubit_t data[MAX_LEN_BITS], coded[MAX_LEN_BITS];
+	ubit_t ref[MAX_LEN_BITS], bu[MAX_LEN_BITS];
+	sbit_t bs[MAX_LEN_BITS];
+	int ref_rc, ref_errors, ref_bits, ref_metric;
+	int rc, n_errors, n_bits, metric;
+	int b, i, j, len, res = 0;
+
+	for (b = 0; b < _NUM_OSMO_CONV_ACC_BACKEND; b++) {
+		dec[b] = NULL;
+		if (osmo_conv_acc_set_backend(b) == 0)
+			dec[b] = osmo_conv_acc_decoder_alloc(test->code);
+	}
+	osmo_conv_acc_set_backend(def);
+
+	/* codes that the accelerated decoder doesn't handle */
+	if (!dec[OSMO_CONV_ACC_BACKEND_GEN])
+		return 0;
+
+	for (i = 0; i < 16 && !res; i++) {
+		fill_random(data, test->in_len);
+		len = osmo_conv_encode(test->code, data, coded);
+
+		for (j = 0; j < len; j++) {
+			bs[j] = (random() % 127) + 1;
+			if (coded[j] ^ !(random() % 8))
+				bs[j] = -bs[j];
+		}
+
+		ref_rc = osmo_conv_acc_decode_ber(dec[OSMO_CONV_ACC_BACKEND_GEN],
+			bs, ref, NULL, &ref_errors, &ref_bits, &ref_metric);
+
+		for (b = OSMO_CONV_ACC_BACKEND_GEN + 1; b < _NUM_OSMO_CONV_ACC_BACKEND; b++) {
+			if (!dec[b])
+				continue;
+
+			rc = osmo_conv_acc_decode_ber(dec[b], bs, bu, NULL,
+				&n_errors, &n_bits, &metric);
+			if (rc != ref_rc || memcmp(ref, bu, test->in_len) ||
+			    n_errors != ref_errors || n_bits != ref_bits ||
+			    metric != ref_metric) {
+				printf("ERROR !\n");
+				fprintf(stderr, "[!] Failed back-end %d: Results don't match\n", b);
+				res = -1;
+				break;
+			}
+		}
+	}
+
+	for (b = 0; b < _NUM_OSMO_CONV_ACC_BACKEND; b++)
+		osmo_conv_acc_decoder_free(dec[b]);
+
+	return res;
+}
+
 int do_check(const struct conv_test_vector *test)
 {
 	ubit_t *bu0, *bu1;
@@ -129,9 +267,38 @@ int do_check(const struct conv_test_vector *test)
 			return -1;
 		}
 
+		/* The cached decoder context must give the same result */
+		len = osmo_conv_decode_cached(test->code, bs, bu1);
+		if (len != 0 || memcmp(bu0, bu1, test->in_len)) {
+			printf("ERROR !\n");
+			fprintf(stderr, "[!] Failed cached decoding: Results don't match\n");
+			return -1;
+		}
+
+		/* ... also once the cached contexts have been released */
+		osmo_conv_decode_cached_free();
+		len = osmo_conv_decode_cached(test->code, bs, bu1);
+		if (len != 0 || memcmp(bu0, bu1, test->in_len)) {
+			printf("ERROR !\n");
+			fprintf(stderr, "[!] Failed cached decoding after free: Results don't match\n");
+			return -1;
+		}
+
 		printf("OK\n");
 	}
 
+	/* Check batch decoding of noisy blocks against single decoding */
+	printf("[..] Batch decoding: ");
+	if (do_check_batch(test) < 0)
+		return -1;
+	printf("OK\n");
+
+	/* Check the SIMD back-ends against the generic one */
+	printf("[..] SIMD back-ends: ");
+	if (do_check_backends(test) < 0)
+		return -1;
+	printf("OK\n");
+
 	/* Spacing */
 	printf("\n");
 
@@ -0,0 +1,216 @@
+/* Benchmark of the Viterbi decoder over the GSM 05.03 codes and a few
+ * codes of other systems */
+/*
+ * (C) 2018 by sysmocom - s.f.m.c. GmbH
+ * All Rights Reserved
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <time.h>
+
+#include <osmocom/core/bits.h>
+#include <osmocom/core/conv.h>
+#include <osmocom/core/utils.h>
+#include <osmocom/gsm/gsm0503.h>
+
+#define MAX_LEN_BITS	2048
+
+/* Codes of other systems, see utils/conv_codes_misc.py */
+extern const struct osmo_conv_code misc_umts_bch;
+extern const struct osmo_conv_code misc_umts_r3;
+extern const struct osmo_conv_code misc_ble_coded;
+
+static const struct {
+	const char *name;
+	const struct osmo_conv_code *code;
+} codes[] = {
+	{ "xCCH",	&gsm0503_xcch },
+	{ "CS2",	&gsm0503_cs2_np },
+	{ "CS3",	&gsm0503_cs3_np },
+	{ "TCH/FS",	&gsm0503_tch_fr },
+	{ "TCH/HS",	&gsm0503_tch_hr },
+	{ "TCH/AFS12.2", &gsm0503_tch_afs_12_2 },
+	{ "TCH/AFS10.2", &gsm0503_tch_afs_10_2 },
+	{ "TCH/AFS7.95", &gsm0503_tch_afs_7_95 },
+	{ "TCH/AFS7.4",	&gsm0503_tch_afs_7_4 },
+	{ "TCH/AFS6.7",	&gsm0503_tch_afs_6_7 },
+	{ "TCH/AFS5.9",	&gsm0503_tch_afs_5_9 },
+	{ "TCH/AFS5.15", &gsm0503_tch_afs_5_15 },
+	{ "TCH/AFS4.75", &gsm0503_tch_afs_4_75 },
+	{ "TCH/AHS7.95", &gsm0503_tch_ahs_7_95 },
+	{ "MCS1 DL hdr", &gsm0503_mcs1_dl_hdr },
+	{ "MCS1 UL hdr", &gsm0503_mcs1_ul_hdr },
+	{ "MCS5 DL hdr", &gsm0503_mcs5_dl_hdr },
+	{ "MCS5 UL hdr", &gsm0503_mcs5_ul_hdr },
+	{ "MCS7 DL hdr", &gsm0503_mcs7_dl_hdr },
+	{ "MCS7 UL hdr", &gsm0503_mcs7_ul_hdr },
+	{ "MCS9",	&gsm0503_mcs9 },
+	{ "UMTS BCH",	&misc_umts_bch },
+	{ "UMTS r1/3",	&misc_umts_r3 },
+	{ "BLE Coded",	&misc_ble_coded },
+};
+
+static const char *backend_names[_NUM_OSMO_CONV_ACC_BACKEND] = {
+	[OSMO_CONV_ACC_BACKEND_GEN]	= "gen",
+	[OSMO_CONV_ACC_BACKEND_SSE]	= "sse",
+	[OSMO_CONV_ACC_BACKEND_SSE_AVX]	= "sse+avx2",
+	[OSMO_CONV_ACC_BACKEND_AVX512]	= "avx512",
+};
+
+enum mode {
+	MODE_SINGLE,	/* osmo_conv_decode(), set up per call */
+	MODE_CACHED,	/* osmo_conv_decode_cached() */
+	MODE_BATCH,	/* osmo_conv_decode_batch() */
+};
+
+#define BATCH_SIZE	32
+
+static double elapsed(const struct timespec *start, const struct timespec *stop)
+{
+	return (stop->tv_sec - start->tv_sec) + (stop->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static ubit_t out_buf[BATCH_SIZE][MAX_LEN_BITS];
+
+/* decode the same block num_blocks times, returns blocks per second */
+static double run(const struct osmo_conv_code *code, const sbit_t *in,
+		  unsigned int num_blocks, enum mode mode)
+{
+	const sbit_t *batch_in[BATCH_SIZE];
+	ubit_t *batch_out[BATCH_SIZE];
+	struct timespec start, stop;
+	unsigned int i;
+
+	for (i = 0; i < BATCH_SIZE; i++) {
+		batch_in[i] = in;
+		batch_out[i] = out_buf[i];
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	switch (mode) {
+	case MODE_SINGLE:
+		for (i = 0; i < num_blocks; i++)
+			osmo_conv_decode(code, in, out_buf[0]);
+		break;
+	case MODE_CACHED:
+		for (i = 0; i < num_blocks; i++)
+			osmo_conv_decode_cached(code, in, out_buf[0]);
+		break;
+	case MODE_BATCH:
+		for (i = 0; i < num_blocks; i += BATCH_SIZE)
+			osmo_conv_decode_batch(code, BATCH_SIZE, batch_in,
+					       batch_out, NULL, NULL);
+		num_blocks = i;
+		break;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &stop);
+
+	return num_blocks / elapsed(&start, &stop);
+}
+
+/* decode the same block num_blocks times with a decoder context of the
+ * given back-end, returns blocks per second or 0 if not supported */
+static double run_backend(const struct osmo_conv_code *code, const sbit_t *in,
+			  unsigned int num_blocks, enum osmo_conv_acc_backend backend)
+{
+	enum osmo_conv_acc_backend def = osmo_conv_acc_get_backend();
+	struct osmo_conv_acc_decoder *dec = NULL;
+	struct timespec start, stop;
+	unsigned int i;
+
+	if (osmo_conv_acc_set_backend(backend) == 0)
+		dec = osmo_conv_acc_decoder_alloc(code);
+	osmo_conv_acc_set_backend(def);
+	if (!dec)
+		return 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < num_blocks; i++)
+		osmo_conv_acc_decode(dec, in, out_buf[0]);
+	clock_gettime(CLOCK_MONOTONIC, &stop);
+
+	osmo_conv_acc_decoder_free(dec);
+
+	return num_blocks / elapsed(&start, &stop);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int num_blocks = 20000;
+	ubit_t data[MAX_LEN_BITS], coded[MAX_LEN_BITS];
+	sbit_t soft[MAX_LEN_BITS];
+	sbit_t soft_all[ARRAY_SIZE(codes)][MAX_LEN_BITS];
+	double bps_single, bps_cached, bps_batch, bps;
+	int c, i, j, b, len;
+
+	while ((c = getopt(argc, argv, "n:")) != -1) {
+		switch (c) {
+		case 'n':
+			num_blocks = atoi(optarg);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-n blocks]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	srandom(1);
+
+	printf("%u blocks per code, blocks/s on one core\n", num_blocks);
+	printf("%-12s %12s %12s %12s %8s\n", "code", "setup/call", "cached",
+	       "batch", "speed-up");
+
+	for (i = 0; i < ARRAY_SIZE(codes); i++) {
+		const struct osmo_conv_code *code = codes[i].code;
+
+		for (j = 0; j < code->len; j++)
+			data[j] = random() & 1;
+		len = osmo_conv_encode(code, data, coded);
+		OSMO_ASSERT(len > 0 && len <= MAX_LEN_BITS);
+		osmo_ubit2sbit(soft, coded, len);
+		memcpy(soft_all[i], soft, len);
+
+		bps_single = run(code, soft, num_blocks, MODE_SINGLE);
+		bps_cached = run(code, soft, num_blocks, MODE_CACHED);
+		bps_batch = run(code, soft, num_blocks, MODE_BATCH);
+
+		printf("%-12s %12.0f %12.0f %12.0f %7.2fx\n", codes[i].name,
+		       bps_single, bps_cached, bps_batch, bps_batch / bps_single);
+	}
+
+	/* Decoder context per SIMD back-end, '-' if not supported */
+	printf("\nblocks/s per back-end (default: %s)\n%-12s",
+	       backend_names[osmo_conv_acc_get_backend()], "code");
+	for (b = 0; b < _NUM_OSMO_CONV_ACC_BACKEND; b++)
+		printf(" %10s", backend_names[b]);
+	printf("\n");
+
+	for (i = 0; i < ARRAY_SIZE(codes); i++) {
+		printf("%-12s", codes[i].name);
+		for (b = 0; b < _NUM_OSMO_CONV_ACC_BACKEND; b++) {
+			bps = run_backend(codes[i].code, soft_all[i], num_blocks, b);
+			if (bps > 0)
+				printf(" %10.0f", bps);
+			else
+				printf(" %10s", "-");
+		}
+		printf("\n");
+	}
+
+	return 0;
+}
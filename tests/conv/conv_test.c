@@ -6,6 +6,10 @@
 
 #include "conv.h"
 
+/* Forward declaration of the test vectors of other systems */
+extern const struct conv_test_vector misc_vectors[];
+extern const int misc_vectors_len;
+
 /* ------------------------------------------------------------------------ */
 /* Test codes                                                               */
 /* ------------------------------------------------------------------------ */
@@ -172,7 +176,7 @@ const struct osmo_conv_code conv_lte_pbch = {
 int main(int argc, char *argv[])
 {
 	const struct conv_test_vector *test;
-	int rc;
+	int rc, i;
 
 	/* Random code -> Non recursive code, direct truncation, non-punctured */
 	const struct osmo_conv_code conv_trunc = {
@@ -277,5 +281,11 @@ int main(int argc, char *argv[])
 			return rc;
 	}
 
+	for (i = 0; i < misc_vectors_len; i++) {
+		rc = do_check(&misc_vectors[i]);
+		if (rc)
+			return rc;
+	}
+
 	return 0;
 }
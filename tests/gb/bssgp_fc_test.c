@@ -109,6 +109,63 @@ static void test_fc(uint32_t bucket_size_max, uint32_t bucket_leak_rate,
 	talloc_free(fc);
 }
 
+static unsigned long out_pdus, out_octets;
+
+static int fc_count_cb(struct bssgp_flow_control *fc, struct msgb *msg,
+		       uint32_t llc_pdu_len, void *priv)
+{
+	out_pdus++;
+	out_octets += llc_pdu_len;
+	msgb_free(msg);
+	return 0;
+}
+
+/* Keep the queue filled for a number of seconds while the time advances in
+ * steps of one TDMA frame, and check that the achieved throughput matches
+ * the configured leak rate of the bucket */
+static void test_fc_throughput(uint32_t bucket_size_max, uint32_t bucket_leak_rate,
+			       uint32_t max_queue_depth, uint32_t pdu_len,
+			       unsigned int secs)
+{
+	struct bssgp_flow_control *fc = talloc_zero(ctx, struct bssgp_flow_control);
+	unsigned long expected;
+	struct msgb *msg;
+
+	osmo_gettimeofday_override_time = (struct timeval){
+		.tv_sec = 1486385000,
+		.tv_usec = 423423,
+	};
+	osmo_gettimeofday_override = true;
+
+	bssgp_fc_init(fc, bucket_size_max, bucket_leak_rate, max_queue_depth,
+		      fc_count_cb);
+	osmo_gettimeofday(&tv_start, NULL);
+	out_pdus = out_octets = 0;
+
+	while (get_centisec_diff() < secs * 100) {
+		while (fc->queue_depth < fc->max_queue_depth) {
+			msg = msgb_alloc(1, "fc test");
+			OSMO_ASSERT(bssgp_fc_in(fc, msg, pdu_len, NULL) == 0);
+		}
+
+		osmo_gettimeofday_override_add(0, 4615);
+		osmo_timers_check();
+		osmo_timers_prepare();
+		osmo_timers_update();
+	}
+
+	/* the full bucket at the start, plus what leaked since then */
+	expected = bucket_size_max + (unsigned long)bucket_leak_rate * secs;
+	printf("%u s: %lu PDUs, %lu oct out, %lu oct expected\n",
+	       secs, out_pdus, out_octets, expected);
+	OSMO_ASSERT(out_octets <= expected);
+	OSMO_ASSERT(out_octets + pdu_len > expected);
+
+	bssgp_fc_flush_queue(fc);
+	OSMO_ASSERT(fc->queue_depth == 0);
+	talloc_free(fc);
+}
+
 static void help(void)
 {
 	printf(" -h --help                This help message\n");
@@ -116,6 +173,7 @@ static void help(void)
 	printf(" -r --bucket-leak-rate N  Bucket leak rate in octets/sec\n");
 	printf(" -d --max-queue-depth N   Maximum length of pending PDU queue (msgs)\n");
 	printf(" -l --pdu-length N        Length of each PDU in octets\n");
+	printf(" -t --throughput N        Measure the throughput over N seconds\n");
 }
 
 int bssgp_prim_cb(struct osmo_prim_hdr *oph, void *ctx)
@@ -132,6 +190,7 @@ int main(int argc, char **argv)
 	uint32_t max_queue_depth = 5; /* messages */
 	uint32_t pdu_length = 10; /* octets */
 	uint32_t pdu_count = 20; /* messages */
+	unsigned int throughput_secs = 0;
 	int c;
 	void *tall_msgb_ctx;
 	ctx = talloc_named_const(NULL, 0, "bssgp_fc_test");
@@ -142,6 +201,7 @@ int main(int argc, char **argv)
 		{ "max-queue-depth", 1, 0, 'd' },
 		{ "pdu-length", 1, 0, 'l' },
 		{ "pdu-count", 1, 0, 'c' },
+		{ "throughput", 1, 0, 't' },
 		{ "help", 0, 0, 'h' },
 		{ 0, 0, 0, 0 }
 	};
@@ -152,7 +212,7 @@ int main(int argc, char **argv)
 
 	tall_msgb_ctx = msgb_talloc_ctx_init(ctx, 0);
 
-	while ((c = getopt_long(argc, argv, "s:r:d:l:c:",
+	while ((c = getopt_long(argc, argv, "s:r:d:l:c:t:",
 				long_options, NULL)) != -1) {
 		switch (c) {
 		case 's':
@@ -170,6 +230,9 @@ int main(int argc, char **argv)
 		case 'c':
 			pdu_count = atoi(optarg);
 			break;
+		case 't':
+			throughput_secs = atoi(optarg);
+			break;
 		case 'h':
 			help();
 			exit(EXIT_SUCCESS);
@@ -189,8 +252,12 @@ int main(int argc, char **argv)
 	printf("size-max=%u oct, leak-rate=%u oct/s, "
 		"queue-len=%u msgs, pdu_len=%u oct, pdu_cnt=%u\n\n", bucket_size_max,
 		bucket_leak_rate, max_queue_depth, pdu_length, pdu_count);
-	test_fc(bucket_size_max, bucket_leak_rate, max_queue_depth,
-		pdu_length, pdu_count);
+	if (throughput_secs)
+		test_fc_throughput(bucket_size_max, bucket_leak_rate, max_queue_depth,
+				   pdu_length, throughput_secs);
+	else
+		test_fc(bucket_size_max, bucket_leak_rate, max_queue_depth,
+			pdu_length, pdu_count);
 	printf("msgb ctx: %zu b in %zu blocks (0 b in 1 block == just the context)\n",
 	       talloc_total_size(tall_msgb_ctx),
 	       talloc_total_blocks(tall_msgb_ctx));
@@ -13,3 +13,6 @@ $T -l 1000
 # test with 100 byte PDUs (10 second)
 $T -s 100
 
+
+# throughput with a PDU length that doesn't divide the leak rate (10 seconds)
+$T -s 1500 -r 12345 -d 20 -l 333 -t 10
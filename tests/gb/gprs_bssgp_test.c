@@ -289,6 +289,156 @@ static void test_bssgp_msgb_copy()
 	printf("----- %s END\n", __func__);
 }
 
+static void test_bssgp_bvc_lookup(void)
+{
+	struct bssgp_bvc_ctx *bctx[300], *ctx;
+	struct gprs_ra_id raid = { .mcc = 901, .mnc = 70, .lac = 1000, .rac = 1 };
+	int i;
+
+	printf("----- %s START\n", __func__);
+
+	for (i = 0; i < ARRAY_SIZE(bctx); i++) {
+		bctx[i] = btsctx_alloc(100 + i, 3000 + i / 10);
+		OSMO_ASSERT(bctx[i]);
+		/* like it is done for a BVC-RESET of a PTP BVC */
+		bctx[i]->ra_id = raid;
+		bctx[i]->cell_id = i;
+		btsctx_rehash(bctx[i]);
+	}
+
+	for (i = 0; i < ARRAY_SIZE(bctx); i++) {
+		OSMO_ASSERT(btsctx_by_bvci_nsei(100 + i, 3000 + i / 10) == bctx[i]);
+		OSMO_ASSERT(btsctx_by_raid_cid(&raid, i) == bctx[i]);
+	}
+	OSMO_ASSERT(!btsctx_by_bvci_nsei(100, 3001));
+	OSMO_ASSERT(!btsctx_by_raid_cid(&raid, ARRAY_SIZE(bctx)));
+
+	/* contexts can not be found after they were released */
+	btsctx_free(bctx[7]);
+	OSMO_ASSERT(!btsctx_by_bvci_nsei(107, 3000));
+	OSMO_ASSERT(!btsctx_by_raid_cid(&raid, 7));
+	llist_del(&bctx[8]->list);
+	talloc_free(bctx[8]);
+	OSMO_ASSERT(!btsctx_by_bvci_nsei(108, 3000));
+	OSMO_ASSERT(!btsctx_by_raid_cid(&raid, 8));
+
+	ctx = btsctx_by_bvci_nsei(109, 3000);
+	OSMO_ASSERT(ctx == bctx[9]);
+
+	/* contexts are found by their new keys after a change */
+	ctx->cell_id = 1000;
+	ctx->bvci = 1000;
+	btsctx_rehash(ctx);
+	OSMO_ASSERT(btsctx_by_raid_cid(&raid, 1000) == ctx);
+	OSMO_ASSERT(btsctx_by_bvci_nsei(1000, 3000) == ctx);
+	OSMO_ASSERT(!btsctx_by_raid_cid(&raid, 9));
+	OSMO_ASSERT(!btsctx_by_bvci_nsei(109, 3000));
+
+	/* and also without re-indexing, like osmo-pcu does after
+	 * btsctx_alloc() */
+	bctx[10]->ra_id.lac = 2000;
+	bctx[10]->cell_id = 2000;
+	bctx[10]->nsei = 4000;
+	OSMO_ASSERT(!btsctx_by_raid_cid(&raid, 10));
+	raid.lac = 2000;
+	OSMO_ASSERT(btsctx_by_raid_cid(&raid, 2000) == bctx[10]);
+	OSMO_ASSERT(btsctx_by_bvci_nsei(110, 4000) == bctx[10]);
+	OSMO_ASSERT(!btsctx_by_bvci_nsei(110, 3001));
+
+	for (i = 0; i < ARRAY_SIZE(bctx); i++) {
+		if (i != 7 && i != 8)
+			btsctx_free(bctx[i]);
+	}
+	OSMO_ASSERT(!btsctx_by_bvci_nsei(1000, 3000));
+
+	printf("----- %s END\n", __func__);
+}
+
+static void *msgb_ctx;
+
+static int fc_discard_cb(struct bssgp_flow_control *fc, struct msgb *msg,
+			 uint32_t llc_pdu_len, void *priv)
+{
+	msgb_free(msg);
+	return 0;
+}
+
+static void test_bssgp_free_queued(void)
+{
+	struct bssgp_bvc_ctx *ctx;
+	size_t blocks;
+	int i, timers;
+
+	printf("----- %s START\n", __func__);
+
+	blocks = talloc_total_blocks(msgb_ctx);
+	timers = osmo_timers_check();
+	ctx = btsctx_alloc(4000, 4001);
+	OSMO_ASSERT(ctx);
+	/* room for one PDU, the others are queued and the timer is armed */
+	bssgp_fc_init(ctx->fc, 100, 1, 10, fc_discard_cb);
+	for (i = 0; i < 3; i++)
+		OSMO_ASSERT(bssgp_fc_in(ctx->fc, bssgp_msgb_alloc(), 100, NULL) == 0);
+	OSMO_ASSERT(ctx->fc->queue_depth == 2);
+	OSMO_ASSERT(osmo_timer_pending(&ctx->fc->timer));
+
+	btsctx_free(ctx);
+	OSMO_ASSERT(talloc_total_blocks(msgb_ctx) == blocks);
+	/* the timer of the freed context is no longer scheduled */
+	OSMO_ASSERT(osmo_timers_check() == timers);
+
+	printf("----- %s END\n", __func__);
+}
+
+static unsigned int fc_num_out;
+
+static int fc_count_cb(struct bssgp_flow_control *fc, struct msgb *msg,
+		       uint32_t llc_pdu_len, void *priv)
+{
+	fc_num_out++;
+	msgb_free(msg);
+	return 0;
+}
+
+static void test_bssgp_fc_reinit(void)
+{
+	struct bssgp_flow_control *fc = talloc_zero(NULL, struct bssgp_flow_control);
+	int i;
+
+	printf("----- %s START\n", __func__);
+
+	osmo_gettimeofday_override_time = (struct timeval){ .tv_sec = 1000 };
+	osmo_gettimeofday_override = true;
+	fc_num_out = 0;
+
+	/* the PCU stops the MS, PDUs are queued without a timer */
+	bssgp_fc_init(fc, 100, 0, 10, fc_count_cb);
+	for (i = 0; i < 3; i++)
+		OSMO_ASSERT(bssgp_fc_in(fc, bssgp_msgb_alloc(), 100, NULL) == 0);
+	OSMO_ASSERT(fc_num_out == 1 && fc->queue_depth == 2);
+	OSMO_ASSERT(!osmo_timer_pending(&fc->timer));
+
+	/* a new FLOW-CONTROL-MS keeps the queued PDUs and gets them going */
+	bssgp_fc_init(fc, 100, 100, 10, fc_count_cb);
+	OSMO_ASSERT(fc->queue_depth == 2);
+	OSMO_ASSERT(osmo_timer_pending(&fc->timer));
+
+	osmo_gettimeofday_override_add(1, 0);
+	osmo_timers_prepare();
+	osmo_timers_update();
+	OSMO_ASSERT(fc_num_out == 2 && fc->queue_depth == 1);
+	osmo_gettimeofday_override_add(1, 0);
+	osmo_timers_prepare();
+	osmo_timers_update();
+	OSMO_ASSERT(fc_num_out == 3 && fc->queue_depth == 0);
+	OSMO_ASSERT(!osmo_timer_pending(&fc->timer));
+
+	osmo_gettimeofday_override = false;
+	talloc_free(fc);
+
+	printf("----- %s END\n", __func__);
+}
+
 static struct log_info info = {};
 
 int main(int argc, char **argv)
@@ -300,7 +450,7 @@ int main(int argc, char **argv)
 	log_set_use_color(osmo_stderr_target, 0);
 	log_set_print_filename(osmo_stderr_target, 0);
 
-	msgb_talloc_ctx_init(ctx, 0);
+	msgb_ctx = msgb_talloc_ctx_init(ctx, 0);
 
 	bssgp_nsi = gprs_ns_instantiate(gprs_ns_callback, NULL);
 
@@ -317,6 +467,9 @@ int main(int argc, char **argv)
 	test_bssgp_bad_reset();
 	test_bssgp_flow_control_bvc();
 	test_bssgp_msgb_copy();
+	test_bssgp_bvc_lookup();
+	test_bssgp_free_queued();
+	test_bssgp_fc_reinit();
 	printf("===== BSSGP test END\n\n");
 
 	exit(EXIT_SUCCESS);
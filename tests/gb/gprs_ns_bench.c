@@ -0,0 +1,163 @@
+/* Loopback benchmark of the NS/UDP receive path */
+/*
+ * (C) 2018 by sysmocom - s.f.m.c. GmbH
+ * All Rights Reserved
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <getopt.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#include <osmocom/core/application.h>
+#include <osmocom/core/logging.h>
+#include <osmocom/core/select.h>
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/utils.h>
+#include <osmocom/gprs/gprs_ns.h>
+#include <osmocom/gprs/gprs_bssgp.h>
+#include <osmocom/gprs/protocol/gsm_08_16.h>
+
+static unsigned long received;
+
+static int ns_cb(enum gprs_ns_evt event, struct gprs_nsvc *nsvc,
+		 struct msgb *msg, uint16_t bvci)
+{
+	if (event == GPRS_NS_EVT_UNIT_DATA)
+		received++;
+	return 0;
+}
+
+static double elapsed(const struct timespec *start, const struct timespec *stop)
+{
+	return (stop->tv_sec - start->tv_sec) + (stop->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/* send num_pkts NS-UNITDATA from a peer socket in bursts, returns the
+ * time spent in the select loop to receive them */
+static double run(void *ctx, unsigned int rx_batch, unsigned int num_pkts,
+		  unsigned int burst, unsigned int pkt_len)
+{
+	struct gprs_ns_inst *nsi;
+	struct gprs_nsvc *nsvc;
+	struct sockaddr_in sin;
+	socklen_t sin_len = sizeof(sin);
+	struct timespec start, stop;
+	double t = 0;
+	uint8_t *pkt;
+	unsigned int sent = 0, i;
+	int sk;
+
+	nsi = gprs_ns_instantiate(ns_cb, ctx);
+	nsi->nsip.local_ip = INADDR_LOOPBACK;
+	nsi->nsip.rx_batch = rx_batch;
+	OSMO_ASSERT(gprs_ns_nsip_listen(nsi) >= 0);
+	OSMO_ASSERT(getsockname(nsi->nsip.fd.fd, (struct sockaddr *)&sin, &sin_len) == 0);
+
+	/* the peer */
+	sk = socket(AF_INET, SOCK_DGRAM, 0);
+	OSMO_ASSERT(sk >= 0);
+	OSMO_ASSERT(connect(sk, (struct sockaddr *)&sin, sizeof(sin)) == 0);
+	sin_len = sizeof(sin);
+	OSMO_ASSERT(getsockname(sk, (struct sockaddr *)&sin, &sin_len) == 0);
+
+	/* an NS-VC that is alive and unblocked */
+	nsvc = gprs_nsvc_create(nsi, 1);
+	nsvc->nsei = 1;
+	nsvc->ll = GPRS_NS_LL_UDP;
+	nsvc->ip.bts_addr = sin;
+	nsvc->state = NSE_S_ALIVE;
+	nsvc->remote_state = NSE_S_ALIVE;
+
+	pkt = calloc(1, pkt_len);
+	OSMO_ASSERT(pkt);
+	pkt[0] = NS_PDUT_UNITDATA;
+	pkt[3] = 2;	/* BVCI */
+
+	received = 0;
+	while (sent < num_pkts) {
+		for (i = 0; i < burst && sent < num_pkts; i++, sent++)
+			OSMO_ASSERT(send(sk, pkt, pkt_len, 0) == pkt_len);
+
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		while (received < sent)
+			osmo_select_main(0);
+		clock_gettime(CLOCK_MONOTONIC, &stop);
+		t += elapsed(&start, &stop);
+	}
+
+	free(pkt);
+	close(sk);
+	gprs_ns_destroy(nsi);
+
+	return t;
+}
+
+/* libosmogb needs this call-back of the BSSGP user */
+int bssgp_prim_cb(struct osmo_prim_hdr *oph, void *ctx)
+{
+	return -1;
+}
+
+static const struct log_info info = {};
+
+int main(int argc, char **argv)
+{
+	void *ctx = talloc_named_const(NULL, 0, "gprs_ns_bench");
+	unsigned int num_pkts = 1000000;
+	unsigned int burst = 32;
+	unsigned int pkt_len = 100;
+	double t_single, t_batch;
+	int c;
+
+	while ((c = getopt(argc, argv, "n:b:l:")) != -1) {
+		switch (c) {
+		case 'n':
+			num_pkts = atoi(optarg);
+			break;
+		case 'b':
+			burst = atoi(optarg);
+			break;
+		case 'l':
+			pkt_len = atoi(optarg);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-n packets] [-b burst] [-l length]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (pkt_len < 4)
+		pkt_len = 4;
+
+	osmo_init_logging2(ctx, &info);
+	log_set_log_level(osmo_stderr_target, LOGL_FATAL);
+
+	printf("%u NS-UNITDATA of %u bytes, sent in bursts of %u\n", num_pkts, pkt_len, burst);
+
+	t_single = run(ctx, 0, num_pkts, burst, pkt_len);
+	printf("recvfrom: %.3f s, %.0f packets/s\n", t_single, num_pkts / t_single);
+
+	t_batch = run(ctx, NS_RX_MAX_BATCH, num_pkts, burst, pkt_len);
+	printf("recvmmsg: %.3f s, %.0f packets/s\n", t_batch, num_pkts / t_batch);
+
+	printf("speed-up: %.2fx\n", t_single / t_batch);
+
+	return 0;
+}
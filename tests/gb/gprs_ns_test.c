@@ -891,6 +891,107 @@ static void test_sgsn_output()
 	nsi = NULL;
 }
 
+/* number of NSEs that have a NS-VC selected for sending */
+static unsigned int count_active_nses(struct gprs_ns_inst *nsi)
+{
+	unsigned int i, count = 0;
+
+	/* NSVC_HASH_SIZE in gprs_ns.c */
+	for (i = 0; i < 256; i++)
+		count += llist_count(&nsi->active_nsvc_by_nsei[i]);
+	return count;
+}
+
+static void test_nsvc_lookup()
+{
+	struct gprs_ns_inst *nsi = gprs_ns_instantiate(gprs_ns_callback, NULL);
+	struct gprs_nsvc *nsvc, *nsvcs[1000];
+	static const unsigned char payload[] = { 0x01, 0x02, 0x03, 0x04 };
+	int i;
+
+	printf("--- NS-VC lookup ---\n\n");
+
+	log_set_log_level(osmo_stderr_target, LOGL_NOTICE);
+	for (i = 0; i < ARRAY_SIZE(nsvcs); i++) {
+		nsvcs[i] = gprs_nsvc_create(nsi, 1000 + i);
+		nsvcs[i]->nsei = 2000 + i / 2;
+		gprs_nsvc_rehash(nsvcs[i]);
+	}
+
+	for (i = 0; i < ARRAY_SIZE(nsvcs); i++) {
+		OSMO_ASSERT(gprs_nsvc_by_nsvci(nsi, 1000 + i) == nsvcs[i]);
+		nsvc = gprs_nsvc_by_nsei(nsi, 2000 + i / 2);
+		OSMO_ASSERT(nsvc && nsvc->nsei == 2000 + i / 2);
+	}
+	OSMO_ASSERT(!gprs_nsvc_by_nsvci(nsi, 999));
+	OSMO_ASSERT(!gprs_nsvc_by_nsei(nsi, 1999));
+
+	/* found by the new keys after a change */
+	nsvcs[10]->nsvci = 3000;
+	nsvcs[10]->nsei = 4000;
+	gprs_nsvc_rehash(nsvcs[10]);
+	OSMO_ASSERT(gprs_nsvc_by_nsvci(nsi, 3000) == nsvcs[10]);
+	OSMO_ASSERT(gprs_nsvc_by_nsei(nsi, 4000) == nsvcs[10]);
+	OSMO_ASSERT(!gprs_nsvc_by_nsvci(nsi, 1010));
+	OSMO_ASSERT(gprs_nsvc_by_nsei(nsi, 2005) == nsvcs[11]);
+
+	/* and also without re-indexing */
+	nsvcs[20]->nsvci = 3001;
+	nsvcs[20]->nsei = 4001;
+	OSMO_ASSERT(gprs_nsvc_by_nsvci(nsi, 3001) == nsvcs[20]);
+	OSMO_ASSERT(gprs_nsvc_by_nsei(nsi, 4001) == nsvcs[20]);
+	OSMO_ASSERT(!gprs_nsvc_by_nsvci(nsi, 1020));
+	OSMO_ASSERT(gprs_nsvc_by_nsei(nsi, 2010) == nsvcs[21]);
+
+	/* the NS-VC used to send is remembered per NSE, also for NSEs
+	 * whose NSEIs (2006 and 2265) share a hash bucket */
+	for (i = 12; i < ARRAY_SIZE(nsvcs); i++) {
+		nsvcs[i]->ip.bts_addr.sin_family = AF_INET;
+		nsvcs[i]->ip.bts_addr.sin_addr.s_addr = htonl(REMOTE_BSS_ADDR);
+		nsvcs[i]->ip.bts_addr.sin_port = htons(1000 + i);
+		gprs_nsvc_rehash(nsvcs[i]);
+	}
+	nsvcs[13]->state = NSE_S_ALIVE;
+	nsvcs[531]->state = NSE_S_ALIVE;
+	OSMO_ASSERT(gprs_send_message(nsi, "first NSE", 2006, 0x1234, payload, sizeof(payload)) >= 0);
+	OSMO_ASSERT(gprs_send_message(nsi, "second NSE", 2265, 0x1234, payload, sizeof(payload)) >= 0);
+	OSMO_ASSERT(nsvcs[13]->active && nsvcs[531]->active);
+	OSMO_ASSERT(!nsvcs[12]->active && !nsvcs[530]->active);
+	OSMO_ASSERT(count_active_nses(nsi) == 2);
+
+	/* another NS-VC of the NSE is used once the first one is blocked */
+	nsvcs[12]->state = NSE_S_ALIVE;
+	nsvcs[13]->state = NSE_S_ALIVE | NSE_S_BLOCKED;
+	OSMO_ASSERT(gprs_send_message(nsi, "first NSE", 2006, 0x1234, payload, sizeof(payload)) >= 0);
+	OSMO_ASSERT(nsvcs[12]->active && !nsvcs[13]->active);
+	OSMO_ASSERT(nsvcs[531]->active);
+
+	/* or deleted */
+	nsvcs[13]->state = NSE_S_ALIVE;
+	gprs_nsvc_delete(nsvcs[12]);
+	OSMO_ASSERT(gprs_send_message(nsi, "first NSE", 2006, 0x1234, payload, sizeof(payload)) >= 0);
+	OSMO_ASSERT(nsvcs[13]->active);
+
+	/* the NSE is forgotten with its last NS-VC */
+	gprs_nsvc_delete(nsvcs[13]);
+	OSMO_ASSERT(count_active_nses(nsi) == 1);
+	OSMO_ASSERT(gprs_send_message(nsi, "first NSE", 2006, 0x1234, payload, sizeof(payload)) < 0);
+	OSMO_ASSERT(count_active_nses(nsi) == 1);
+
+	/* deleted NS-VCs can not be found anymore */
+	gprs_nsvc_delete(nsvcs[11]);
+	gprs_nsvc_delete(nsvcs[10]);
+	OSMO_ASSERT(!gprs_nsvc_by_nsvci(nsi, 1011));
+	OSMO_ASSERT(!gprs_nsvc_by_nsvci(nsi, 3000));
+	OSMO_ASSERT(!gprs_nsvc_by_nsei(nsi, 2005));
+	OSMO_ASSERT(!gprs_nsvc_by_nsei(nsi, 4000));
+	OSMO_ASSERT(!gprs_nsvc_by_nsvci(nsi, 1013));
+	OSMO_ASSERT(gprs_nsvc_by_nsvci(nsi, 1014) == nsvcs[14]);
+
+	gprs_ns_destroy(nsi);
+	log_set_log_level(osmo_stderr_target, LOGL_INFO);
+	printf("--- NS-VC lookup done ---\n\n");
+}
 
 int bssgp_prim_cb(struct osmo_prim_hdr *oph, void *ctx)
 {
@@ -920,6 +1021,7 @@ int main(int argc, char **argv)
 	test_sgsn_reset();
 	test_sgsn_reset_invalid_state();
 	test_sgsn_output();
+	test_nsvc_lookup();
 	printf("===== NS protocol test END\n\n");
 
 	exit(EXIT_SUCCESS);
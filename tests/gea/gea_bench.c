@@ -0,0 +1,129 @@
+/* Benchmark of the GEA3/GEA4 keystream generation, with the key expanded
+ * for every keystream (gea3, gea4) and once per key (osmo_gea_ctx_run) */
+/*
+ * (C) 2018 by sysmocom - s.f.m.c. GmbH
+ * All Rights Reserved
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <getopt.h>
+#include <time.h>
+
+#include <osmocom/core/utils.h>
+#include <osmocom/crypt/gprs_cipher.h>
+#include <osmocom/gsm/gea.h>
+
+#define BATCH_NUM	16
+
+/* Short LLC frame, typical IP packet, maximum LLC frame */
+static const unsigned int sizes[] = { 40, 576, GSM0464_CIPH_MAX_BLOCK };
+
+static uint8_t kc[16];
+static uint8_t out[BATCH_NUM][GSM0464_CIPH_MAX_BLOCK];
+
+enum mode {
+	MODE_PLAIN,
+	MODE_CTX,
+	MODE_BATCH,
+	_NUM_MODE
+};
+
+static double elapsed(const struct timespec *start, const struct timespec *stop)
+{
+	return (stop->tv_sec - start->tv_sec) + (stop->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/* generate num keystreams of len bytes, returns bytes per second */
+static double run(enum gprs_ciph_algo algo, enum mode mode, uint16_t len,
+		  unsigned int num)
+{
+	struct osmo_gea_req reqs[BATCH_NUM];
+	struct osmo_gea_ctx ctx;
+	struct timespec start, stop;
+	unsigned int i, j;
+
+	for (j = 0; j < BATCH_NUM; j++) {
+		reqs[j].out = out[j];
+		reqs[j].len = len;
+		reqs[j].iv = j;
+		reqs[j].direction = GPRS_CIPH_SGSN2MS;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	osmo_gea_ctx_init(&ctx, algo, kc);
+	for (i = 0; i < num; i += BATCH_NUM) {
+		switch (mode) {
+		case MODE_PLAIN:
+			for (j = 0; j < BATCH_NUM; j++) {
+				if (algo == GPRS_ALGO_GEA3)
+					gea3(out[j], len, kc, j, GPRS_CIPH_SGSN2MS);
+				else
+					gea4(out[j], len, kc, j, GPRS_CIPH_SGSN2MS);
+			}
+			break;
+		case MODE_CTX:
+			for (j = 0; j < BATCH_NUM; j++)
+				osmo_gea_ctx_run(&ctx, out[j], len, j, GPRS_CIPH_SGSN2MS);
+			break;
+		case MODE_BATCH:
+			osmo_gea_ctx_run_batch(&ctx, reqs, BATCH_NUM);
+			break;
+		default:
+			break;
+		}
+	}
+	clock_gettime(CLOCK_MONOTONIC, &stop);
+
+	return (double) i * len / elapsed(&start, &stop);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int num = 20000;
+	double r[_NUM_MODE];
+	int c, i, j, algo;
+
+	while ((c = getopt(argc, argv, "n:")) != -1) {
+		switch (c) {
+		case 'n':
+			num = atoi(optarg);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-n keystreams]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	srandom(1);
+	for (i = 0; i < sizeof(kc); i++)
+		kc[i] = random();
+
+	printf("%u keystreams each, MB/s on one core\n", num);
+	printf("%-5s %6s %10s %10s %10s %8s\n", "algo", "bytes", "gea3/4",
+	       "ctx", "batch", "speed-up");
+
+	for (algo = GPRS_ALGO_GEA3; algo <= GPRS_ALGO_GEA4; algo++) {
+		for (j = 0; j < ARRAY_SIZE(sizes); j++) {
+			for (i = 0; i < _NUM_MODE; i++)
+				r[i] = run(algo, i, sizes[j], num);
+			printf("GEA%d  %6u %10.2f %10.2f %10.2f %7.2fx\n", algo, sizes[j],
+			       r[MODE_PLAIN] / 1e6, r[MODE_CTX] / 1e6,
+			       r[MODE_BATCH] / 1e6, r[MODE_BATCH] / r[MODE_PLAIN]);
+		}
+	}
+
+	return 0;
+}
@@ -1,12 +1,14 @@
 #include <osmocom/core/bits.h>
 #include <osmocom/core/utils.h>
 #include <osmocom/crypt/gprs_cipher.h>
+#include <osmocom/gsm/gea.h>
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
 #include <stdbool.h>
+#include <errno.h>
 
 static inline void print_check(char *res, uint8_t *out, uint16_t len)
 {
@@ -40,6 +42,52 @@ static inline void real_gea(uint32_t iov_ui, uint8_t sapi, uint32_t lfn,
 		 len, res);
 }
 
+#define CTX_NUM	11
+
+/* Keystreams from a context, one at a time and batched, must be the same
+ * as the ones of the plain cipher, for any mix of lengths in a batch */
+static void test_ctx(enum gprs_ciph_algo algo)
+{
+    static uint8_t exp[CTX_NUM][GSM0464_CIPH_MAX_BLOCK + 1], out[CTX_NUM][GSM0464_CIPH_MAX_BLOCK + 1];
+    static const uint16_t lens[CTX_NUM] = { 1, 7, 8, 9, 40, 576, GSM0464_CIPH_MAX_BLOCK, 16, 0, 3, 199 };
+    struct osmo_gea_req reqs[CTX_NUM];
+    struct osmo_gea_ctx ctx;
+    uint8_t kc[16];
+    int i, j;
+
+    for (i = 0; i < sizeof(kc); i++)
+	kc[i] = random();
+    OSMO_ASSERT(osmo_gea_ctx_init(&ctx, algo, kc) == 0);
+
+    for (i = 0; i < CTX_NUM; i++) {
+	reqs[i].out = out[i];
+	reqs[i].len = lens[i];
+	reqs[i].iv = random();
+	reqs[i].direction = i & 1;
+	gprs_cipher_run(exp[i], lens[i], algo, kc, reqs[i].iv, reqs[i].direction);
+    }
+
+    memset(out, 0x55, sizeof(out));
+    for (i = 0; i < CTX_NUM; i++) {
+	osmo_gea_ctx_run(&ctx, out[i], lens[i], reqs[i].iv, reqs[i].direction);
+	OSMO_ASSERT(!memcmp(out[i], exp[i], lens[i]));
+	OSMO_ASSERT(out[i][lens[i]] == 0x55);
+    }
+
+    /* All at once and split up into smaller batches */
+    for (j = CTX_NUM; j > 0; j -= 5) {
+	memset(out, 0x55, sizeof(out));
+	for (i = 0; i < CTX_NUM; i += j)
+	    osmo_gea_ctx_run_batch(&ctx, &reqs[i], i + j < CTX_NUM ? j : CTX_NUM - i);
+	for (i = 0; i < CTX_NUM; i++) {
+	    OSMO_ASSERT(!memcmp(out[i], exp[i], lens[i]));
+	    OSMO_ASSERT(out[i][lens[i]] == 0x55);
+	}
+    }
+
+    printf("%s context and batch: OK\n", get_value_string(gprs_cipher_names, algo));
+}
+
 int main(int argc, char **argv)
 {
     printf("GEA3 support: %d\n", gprs_cipher_supported(GPRS_ALGO_GEA3));
@@ -64,5 +112,10 @@ int main(int argc, char **argv)
     real_gea(0, 3, 20, 0, GPRS_CIPH_MS2SGSN, "bf4575e165fec400", 134, "c43845418e7fc4b3651bc9c3cc9af0163373126c0b31f85d192280e20c981f426dc4a0514a377f76da3d1672c6a0f463513608b3291bacd5d17bb44c8cc5383c3cc85de94e9c594e0fd61d4f2b74b452c1edf07eb04e0e67f352337cc0fd932936841fa41ee5ff0d8f3fad9625a9dec1f12726b74595a1c40d429926ba7e8461f3fa2ae2c0d3");
     real_gea(0, 3, 21, 0, GPRS_CIPH_MS2SGSN, "bf4575e165fec400", 65, "7b4fc1922c183e6f61e8d2317216ed1d2497477d6f84947f8318df42621ad9affc0c42ba2fd63e06bce4720598d5ae919ca2996f2f1feaea2aa79827692471fd0a");
 
+    srandom(1);
+    test_ctx(GPRS_ALGO_GEA3);
+    test_ctx(GPRS_ALGO_GEA4);
+    OSMO_ASSERT(osmo_gea_ctx_init(NULL, GPRS_ALGO_GEA1, NULL) == -ENOTSUP);
+
     return 0;
 }
@@ -19,10 +19,12 @@
  */
 
 #include <stdlib.h>
+#include <inttypes.h>
 #include <osmocom/core/application.h>
 #include <osmocom/core/logging.h>
 #include <osmocom/core/utils.h>
 #include <osmocom/core/msgb.h>
+#include <osmocom/core/rate_ctr.h>
 #include <setjmp.h>
 
 #include <errno.h>
@@ -118,6 +120,13 @@ static void test_msgb_api()
 	msg->l3h = msg->head - 1;
 	printf("Buffer: %s\n", msgb_hexdump(msg));
 
+	/* msgb_reset() must also clear the control buffer */
+	msg->cb[0] = 0x23;
+	msg->cb[4] = 0x42;
+	msgb_reset(msg);
+	OSMO_ASSERT(msg->cb[0] == 0 && msg->cb[4] == 0);
+	OSMO_ASSERT(msgb_length(msg) == 0);
+
 	msgb_free(msg);
 }
 
@@ -381,6 +390,100 @@ static void test_msgb_printf()
 	msgb_free(msg_ref);
 }
 
+extern void *tall_msgb_ctx;
+
+static int pool_destructor_called;
+
+static int pool_test_destructor(struct msgb *msg)
+{
+	pool_destructor_called++;
+	return 0;
+}
+
+static void test_msgb_pool(void *ctx)
+{
+	struct rate_ctr_group *ctrg;
+	struct msgb *msg1, *msg2, *msg3, *msg;
+	struct msgb *msg_plain;
+	size_t blocks;
+	int i;
+
+	printf("Testing msgb pool\n");
+
+	blocks = talloc_total_blocks(tall_msgb_ctx);
+	/* allocated before the pool, never recycled */
+	msg_plain = msgb_alloc(256, "plain1");
+	OSMO_ASSERT(msgb_pool_init(ctx, 2) == 0);
+	OSMO_ASSERT(msgb_pool_init(ctx, 2) == -EALREADY);
+	ctrg = rate_ctr_get_group_by_name_idx("msgb:pool", 0);
+	OSMO_ASSERT(ctrg);
+
+	/* sizes are rounded up to the size class */
+	msg1 = msgb_alloc_headroom(100, 20, "pool1");
+	msg2 = msgb_alloc(128, "pool2");
+	msg3 = msgb_alloc(1, "pool3");
+	printf("tailroom: %d %d %d\n", msgb_tailroom(msg1), msgb_tailroom(msg2), msgb_tailroom(msg3));
+	memset(msgb_put(msg1, 10), 0x23, 10);
+	msg1->l2h = msg1->data;
+	memset(msgb_put(msg2, 128), 0x42, 128);
+
+	/* only two buffers are kept in the pool */
+	msgb_free(msg1);
+	msgb_free(msg2);
+	msgb_free(msg3);
+	OSMO_ASSERT(talloc_total_blocks(tall_msgb_ctx) == blocks + 1);
+
+	/* the header of a recycled buffer is reset */
+	msg = msgb_alloc_headroom(50, 16, "pool4");
+	OSMO_ASSERT(msg == msg2);
+	OSMO_ASSERT(!strcmp(talloc_get_name(msg), "pool4"));
+	OSMO_ASSERT(msgb_length(msg) == 0 && msgb_headroom(msg) == 16);
+	/* and so is its headroom */
+	for (i = 0; i < 16; i++)
+		OSMO_ASSERT(msg->head[i] == 0);
+	msg->l2h = msg->data;
+	OSMO_ASSERT(msgb_l2len(msg) == 0);
+	msg->l2h = NULL;
+	msg2 = msgb_alloc(128, "pool5");
+	OSMO_ASSERT(msg2 == msg1);
+	OSMO_ASSERT(msg2->l2h == NULL && msgb_tailroom(msg2) == 128);
+	msgb_free(msg);
+	msgb_free(msg2);
+
+	/* too large for any size class */
+	msg = msgb_alloc(5000, "pool6");
+	printf("tailroom: %d\n", msgb_tailroom(msg));
+	msgb_free(msg);
+
+	/* msgbs not allocated by the pool are released */
+	msgb_free(msg_plain);
+
+	/* msgbs with talloc children are released, with their children */
+	msg = msgb_alloc(256, "pool7");
+	OSMO_ASSERT(talloc_named_const(msg, 10, "child"));
+	msgb_free(msg);
+	OSMO_ASSERT(talloc_total_blocks(tall_msgb_ctx) == blocks);
+
+	/* msgbs with a user destructor are released, calling it */
+	msg = msgb_alloc(256, "pool8");
+	talloc_set_destructor(msg, pool_test_destructor);
+	msgb_free(msg);
+	OSMO_ASSERT(pool_destructor_called == 1);
+
+	printf("alloc: hit=%"PRIu64" miss=%"PRIu64", free: recycled=%"PRIu64" released=%"PRIu64"\n",
+	       ctrg->ctr[0].current, ctrg->ctr[1].current,
+	       ctrg->ctr[2].current, ctrg->ctr[3].current);
+
+	msgb_pool_exit();
+	OSMO_ASSERT(rate_ctr_get_group_by_name_idx("msgb:pool", 0) == NULL);
+	OSMO_ASSERT(talloc_total_blocks(tall_msgb_ctx) == blocks);
+
+	/* back to plain, zero-initialized allocations */
+	msg = msgb_alloc(100, "plain");
+	OSMO_ASSERT(msgb_tailroom(msg) == 100);
+	msgb_free(msg);
+}
+
 static struct log_info info = {};
 
 int main(int argc, char **argv)
@@ -394,6 +497,7 @@ int main(int argc, char **argv)
 	test_msgb_copy();
 	test_msgb_resize_area();
 	test_msgb_printf();
+	test_msgb_pool(ctx);
 
 	printf("Success.\n");
 
@@ -0,0 +1,157 @@
+/*
+ * (C) 2018 by sysmocom - s.f.m.c. GmbH
+ * All Rights Reserved
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <stdio.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include <osmocom/core/select.h>
+#include <osmocom/core/utils.h>
+
+static struct osmo_fd ofd_a, ofd_b;
+static int pipe_a[2], pipe_b[2];
+static unsigned int calls_a, calls_b;
+
+static int read_cb(struct osmo_fd *ofd, unsigned int what)
+{
+	char buf[16];
+	int rc;
+
+	if (what & BSC_FD_READ) {
+		rc = read(ofd->fd, buf, sizeof(buf));
+		OSMO_ASSERT(rc > 0);
+	}
+
+	if (ofd == &ofd_a) {
+		calls_a++;
+		/* unregister the other fd while its event may be pending */
+		if (osmo_fd_is_registered(&ofd_b))
+			osmo_fd_unregister(&ofd_b);
+	} else {
+		calls_b++;
+		/* change 'when' directly from within the own call-back */
+		if (ofd->priv_nr == 1)
+			ofd->when = 0;
+	}
+
+	return 0;
+}
+
+static void run_loop(void)
+{
+	int i;
+
+	/* a few non-blocking iterations are plenty for pipes */
+	for (i = 0; i < 4; i++)
+		osmo_select_main(1);
+}
+
+static void test_backend(enum osmo_select_backend backend, const char *name)
+{
+	int rc;
+
+	printf("Testing %s back-end\n", name);
+
+	rc = osmo_select_set_backend(backend);
+	if (rc == -ENOTSUP) {
+		printf(" not supported, skipping\n");
+		return;
+	}
+	OSMO_ASSERT(rc == 0);
+	OSMO_ASSERT(osmo_select_get_backend() == backend);
+
+	OSMO_ASSERT(pipe(pipe_a) == 0);
+	OSMO_ASSERT(pipe(pipe_b) == 0);
+	calls_a = calls_b = 0;
+
+	osmo_fd_setup(&ofd_a, pipe_a[0], BSC_FD_READ, read_cb, NULL, 0);
+	osmo_fd_setup(&ofd_b, pipe_b[0], 0, read_cb, NULL, 0);
+	OSMO_ASSERT(osmo_fd_register(&ofd_a) == 0);
+	OSMO_ASSERT(osmo_fd_register(&ofd_b) == 0);
+	OSMO_ASSERT(osmo_fd_is_registered(&ofd_a));
+	OSMO_ASSERT(osmo_fd_get_by_fd(pipe_b[0]) == &ofd_b);
+
+	/* no data, nothing must be dispatched */
+	run_loop();
+	printf(" idle: a=%u b=%u\n", calls_a, calls_b);
+
+	/* b has no 'when' flags yet: only a must fire */
+	OSMO_ASSERT(write(pipe_b[1], "x", 1) == 1);
+	run_loop();
+	printf(" b without flags: a=%u b=%u\n", calls_a, calls_b);
+
+	/* 'when' changes must be picked up by the loop */
+	osmo_fd_update_when(&ofd_b, ~0, BSC_FD_READ);
+	run_loop();
+	printf(" b with flags: a=%u b=%u\n", calls_a, calls_b);
+
+	/* a's call-back unregisters b, whose event is pending as well */
+	OSMO_ASSERT(write(pipe_a[1], "x", 1) == 1);
+	OSMO_ASSERT(write(pipe_b[1], "x", 1) == 1);
+	run_loop();
+	printf(" unregister from call-back: a=%u b=%u\n", calls_a, calls_b);
+	OSMO_ASSERT(!osmo_fd_is_registered(&ofd_b));
+	OSMO_ASSERT(osmo_fd_get_by_fd(pipe_b[0]) == NULL);
+
+	/* b is closed and its fd set to -1 before unregistering it */
+	OSMO_ASSERT(osmo_fd_register(&ofd_b) == 0);
+	close(pipe_b[0]);
+	close(pipe_b[1]);
+	ofd_b.fd = -1;
+	osmo_fd_unregister(&ofd_b);
+	OSMO_ASSERT(!osmo_fd_is_registered(&ofd_b));
+
+	/* the fd numbers are reused, b must not appear registered */
+	OSMO_ASSERT(pipe(pipe_b) == 0);
+	ofd_b.fd = pipe_b[0];
+	OSMO_ASSERT(!osmo_fd_is_registered(&ofd_b));
+	OSMO_ASSERT(osmo_fd_register(&ofd_b) == 0);
+	OSMO_ASSERT(write(pipe_b[1], "x", 1) == 1);
+	run_loop();
+	printf(" re-registered after close: a=%u b=%u\n", calls_a, calls_b);
+
+	/* b's call-back clears its 'when' flags directly */
+	ofd_b.priv_nr = 1;
+	OSMO_ASSERT(write(pipe_b[1], "x", 1) == 1);
+	run_loop();
+	OSMO_ASSERT(write(pipe_b[1], "x", 1) == 1);
+	run_loop();
+	printf(" 'when' cleared in call-back: a=%u b=%u\n", calls_a, calls_b);
+
+	/* 'when' set directly outside of any call-back, as many users do */
+	ofd_b.priv_nr = 0;
+	ofd_b.when |= BSC_FD_READ;
+	run_loop();
+	printf(" 'when' set directly: a=%u b=%u\n", calls_a, calls_b);
+
+	osmo_fd_close(&ofd_a);
+	OSMO_ASSERT(!osmo_fd_is_registered(&ofd_a));
+	osmo_fd_close(&ofd_b);
+	OSMO_ASSERT(!osmo_fd_is_registered(&ofd_b));
+	close(pipe_a[1]);
+	close(pipe_b[1]);
+}
+
+int main(int argc, char **argv)
+{
+	test_backend(OSMO_SELECT_BACKEND_SELECT, "select");
+	test_backend(OSMO_SELECT_BACKEND_EPOLL, "epoll");
+	osmo_select_set_backend(OSMO_SELECT_BACKEND_SELECT);
+
+	printf("Done\n");
+	return 0;
+}
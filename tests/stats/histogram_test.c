@@ -0,0 +1,231 @@
+/* tests for histograms */
+/*
+ * (C) 2018 by sysmocom - s.f.m.c. GmbH
+ *
+ * All Rights Reserved
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <stdio.h>
+#include <inttypes.h>
+
+#include <osmocom/core/utils.h>
+#include <osmocom/core/logging.h>
+#include <osmocom/core/timer.h>
+#include <osmocom/core/stat_item.h>
+#include <osmocom/core/stats.h>
+#include <osmocom/core/histogram.h>
+
+enum test_hist {
+	TEST_LATENCY,
+	TEST_SIZE,
+};
+
+static const struct osmo_histogram_desc hist_description[] = {
+	[TEST_LATENCY] = { "latency", "Processing time", "ns" },
+	[TEST_SIZE] = { "size", "Message size", "B" },
+};
+
+static const struct osmo_histogram_group_desc histg_desc = {
+	.group_name_prefix = "hist-test",
+	.group_description = "Histogram test",
+	.class_id = OSMO_STATS_CLASS_GLOBAL,
+	.num_hist = ARRAY_SIZE(hist_description),
+	.hist_desc = hist_description,
+};
+
+static void test_buckets(void)
+{
+	uint64_t v, upper, prev_upper = 0;
+	unsigned int b, prev = 0;
+
+	printf("Start test: %s\n", __func__);
+
+	/* Every bucket directly follows the previous one */
+	for (b = 0; b < OSMO_HISTOGRAM_NUM_BUCKETS; b++) {
+		upper = osmo_histogram_bucket_upper(b);
+		OSMO_ASSERT(osmo_histogram_bucket(upper) == b);
+		if (b > 0) {
+			OSMO_ASSERT(upper > prev_upper);
+			OSMO_ASSERT(osmo_histogram_bucket(prev_upper + 1) == b);
+		}
+		prev_upper = upper;
+	}
+	OSMO_ASSERT(prev_upper == (1ULL << OSMO_HISTOGRAM_MAX_BITS) - 1);
+	OSMO_ASSERT(osmo_histogram_bucket(UINT64_MAX) == OSMO_HISTOGRAM_NUM_BUCKETS - 1);
+
+	/* The relative width of a bucket is below 2^-SUB_BITS */
+	for (v = 1; v < (1ULL << OSMO_HISTOGRAM_MAX_BITS); v = v * 3 + 1) {
+		b = osmo_histogram_bucket(v);
+		OSMO_ASSERT(b >= prev);
+		upper = osmo_histogram_bucket_upper(b);
+		OSMO_ASSERT(upper >= v);
+		OSMO_ASSERT((upper - v) << OSMO_HISTOGRAM_SUB_BITS <= v);
+		prev = b;
+	}
+
+	printf("%u buckets of %u bytes: OK\n", OSMO_HISTOGRAM_NUM_BUCKETS,
+	       (unsigned int)sizeof(((struct osmo_histogram *)0)->buckets[0]));
+	printf("End test: %s\n", __func__);
+}
+
+static void test_percentiles(void)
+{
+	static const unsigned int permille[] = { 0, 500, 900, 990, 999, 1000 };
+	struct osmo_histogram_group *histg;
+	struct osmo_histogram *hist;
+	uint64_t pct[ARRAY_SIZE(permille)];
+	unsigned int i;
+
+	printf("Start test: %s\n", __func__);
+
+	histg = osmo_histogram_group_alloc(NULL, &histg_desc, 0);
+	OSMO_ASSERT(histg != NULL);
+	hist = &histg->hist[TEST_LATENCY];
+
+	OSMO_ASSERT(osmo_histogram_get_group_by_name_idx("hist-test", 0) == histg);
+	OSMO_ASSERT(osmo_histogram_get_group_by_name_idx("hist-test", 1) == NULL);
+	OSMO_ASSERT(osmo_histogram_get_by_name(histg, "latency") == hist);
+	OSMO_ASSERT(osmo_histogram_get_by_name(histg, "foo") == NULL);
+
+	OSMO_ASSERT(osmo_histogram_percentile(hist, 500) == 0);
+
+	/* 1000 .. 100999 */
+	for (i = 0; i < 100000; i++)
+		osmo_histogram_record(hist, 1000 + i);
+
+	osmo_histogram_percentiles(hist, permille, pct, ARRAY_SIZE(pct));
+	printf("count %" PRIu64 " sum %" PRIu64 " min %" PRIu64 " max %" PRIu64 "\n",
+	       hist->count, hist->sum, hist->min, hist->max);
+	for (i = 0; i < ARRAY_SIZE(permille); i++) {
+		uint64_t exact = 1000 + (100000 * permille[i] + 999) / 1000 - 1;
+		if (permille[i] == 0)
+			exact = 1000;
+		printf("p%u.%u: %" PRIu64 " (exact %" PRIu64 ")\n",
+		       permille[i] / 10, permille[i] % 10, pct[i], exact);
+		OSMO_ASSERT(pct[i] == osmo_histogram_percentile(hist, permille[i]));
+		OSMO_ASSERT(pct[i] >= exact);
+		OSMO_ASSERT((pct[i] - exact) << OSMO_HISTOGRAM_SUB_BITS <= exact);
+	}
+
+	OSMO_ASSERT(osmo_histogram_difference(hist) == 100000);
+	OSMO_ASSERT(osmo_histogram_difference(hist) == 0);
+
+	/* a bucket counts beyond 2^32 values without wrapping around */
+	osmo_histogram_reset(hist);
+	hist->buckets[osmo_histogram_bucket(5)] = UINT32_MAX;
+	hist->count = UINT32_MAX;
+	hist->min = hist->max = 5;
+	osmo_histogram_record(hist, 5);
+	osmo_histogram_record(hist, 9);
+	OSMO_ASSERT(hist->buckets[osmo_histogram_bucket(5)] == (uint64_t)UINT32_MAX + 1);
+	OSMO_ASSERT(osmo_histogram_percentile(hist, 500) == 5);
+	OSMO_ASSERT(osmo_histogram_percentile(hist, 1000) == 9);
+
+	osmo_histogram_reset(hist);
+	OSMO_ASSERT(hist->count == 0 && hist->sum == 0 && hist->max == 0);
+	osmo_histogram_record(hist, 7);
+	OSMO_ASSERT(osmo_histogram_percentile(hist, 990) == 7);
+
+	osmo_histogram_group_free(histg);
+
+	printf("End test: %s\n", __func__);
+}
+
+static void test_timing(void)
+{
+	struct osmo_histogram_group *histg;
+	struct osmo_histogram *hist;
+	struct timespec *now;
+
+	printf("Start test: %s\n", __func__);
+
+	histg = osmo_histogram_group_alloc(NULL, &histg_desc, 0);
+	hist = &histg->hist[TEST_LATENCY];
+
+	osmo_clock_override_enable(CLOCK_MONOTONIC, true);
+	now = osmo_clock_override_gettimespec(CLOCK_MONOTONIC);
+	now->tv_sec = 100;
+	now->tv_nsec = 999999000;
+
+	OSMO_HISTOGRAM_TIME(hist, osmo_clock_override_add(CLOCK_MONOTONIC, 0, 1500));
+	OSMO_HISTOGRAM_TIME(hist, {
+		osmo_clock_override_add(CLOCK_MONOTONIC, 1, 0);
+	});
+
+	printf("count %" PRIu64 " min %" PRIu64 " max %" PRIu64 "\n",
+	       hist->count, hist->min, hist->max);
+	OSMO_ASSERT(hist->min == 1500 && hist->max == 1000000000);
+
+	osmo_clock_override_enable(CLOCK_MONOTONIC, false);
+	osmo_histogram_group_free(histg);
+
+	printf("End test: %s\n", __func__);
+}
+
+static int test_send_item(struct osmo_stats_reporter *srep,
+	const struct osmo_stat_item_group *statg,
+	const struct osmo_stat_item_desc *desc, int64_t value)
+{
+	printf("  %s: item g=%s i=%u n=%s v=%" PRId64 " u=%s\n", srep->name,
+	       statg->desc->group_name_prefix, statg->idx, desc->name, value,
+	       desc->unit ? desc->unit : "");
+	return 0;
+}
+
+static void test_report(void)
+{
+	struct osmo_stats_reporter *srep;
+	struct osmo_histogram_group *histg;
+	unsigned int i;
+
+	printf("Start test: %s\n", __func__);
+
+	histg = osmo_histogram_group_alloc(NULL, &histg_desc, 3);
+	for (i = 1; i <= 10; i++)
+		osmo_histogram_record(&histg->hist[TEST_LATENCY], i * 1000);
+
+	srep = osmo_stats_reporter_alloc(OSMO_STATS_REPORTER_LOG, "test");
+	srep->send_item = test_send_item;
+	osmo_stats_reporter_set_max_class(srep, OSMO_STATS_CLASS_SUBSCRIBER);
+	osmo_stats_reporter_enable(srep);
+
+	printf("report (initial):\n");
+	osmo_stats_report();
+
+	printf("report (latency changed):\n");
+	osmo_histogram_record(&histg->hist[TEST_LATENCY], 100000);
+	osmo_stats_report();
+
+	printf("report (nothing changed):\n");
+	osmo_stats_report();
+
+	osmo_stats_reporter_free(srep);
+	osmo_histogram_group_free(histg);
+
+	printf("End test: %s\n", __func__);
+}
+
+int main(int argc, char **argv)
+{
+	static const struct log_info log_info = {};
+	log_init(&log_info, NULL);
+
+	test_buckets();
+	test_percentiles();
+	test_timing();
+	test_report();
+
+	return 0;
+}
@@ -27,9 +27,18 @@
 #include <osmocom/core/stat_item.h>
 #include <osmocom/core/rate_ctr.h>
 #include <osmocom/core/stats.h>
+#include <osmocom/core/select.h>
+#include <osmocom/core/timer.h>
+#include <osmocom/core/histogram.h>
 
 #include <stdio.h>
+#include <string.h>
+#include <errno.h>
 #include <inttypes.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
 
 enum test_ctr {
 	TEST_A_CTR,
@@ -310,7 +319,7 @@ static struct osmo_stats_reporter *stats_reporter_create_test(const char *name)
 static void test_reporting()
 {
 	struct osmo_stats_reporter *srep1, *srep2, *srep;
-	struct osmo_stat_item_group *statg1, *statg2;
+	struct osmo_stat_item_group *statg1, *statg2, *statg;
 	struct rate_ctr_group *ctrg1, *ctrg2, *ctrg3, *ctrg_dup;
 	void *stats_ctx = talloc_named_const(NULL, 1, "stats test context");
 
@@ -424,6 +433,27 @@ static void test_reporting()
 	osmo_stats_report();
 	OSMO_ASSERT(send_count == 2);
 
+	printf("report (group 2, counter 2 update, difference taken):\n");
+	rate_ctr_add(&ctrg2->ctr[TEST_B_CTR], 5);
+	rate_ctr_inc(&ctrg2->ctr[TEST_B_CTR]);
+	OSMO_ASSERT(rate_ctr_difference(&ctrg2->ctr[TEST_B_CTR]) == 6);
+	send_count = 0;
+	osmo_stats_report();
+	OSMO_ASSERT(send_count == 2);
+
+	printf("report (changed groups freed, should be empty):\n");
+	ctrg_dup = rate_ctr_group_alloc(stats_ctx, &ctrg_desc, 4);
+	OSMO_ASSERT(ctrg_dup != NULL);
+	rate_ctr_inc(&ctrg_dup->ctr[TEST_A_CTR]);
+	rate_ctr_group_free(ctrg_dup);
+	statg = osmo_stat_item_group_alloc(stats_ctx, &statg_desc, 4);
+	OSMO_ASSERT(statg != NULL);
+	osmo_stat_item_set(statg->items[TEST_B_ITEM], 1);
+	osmo_stat_item_group_free(statg);
+	send_count = 0;
+	osmo_stats_report();
+	OSMO_ASSERT(send_count == 0);
+
 	printf("report (remove statg1, ctrg1):\n");
 	/* force single flush */
 	srep1->force_single_flush = 1;
@@ -474,6 +504,316 @@ static void test_reporting()
 	printf("End test: %s\n", __func__);
 }
 
+/* Send req to the prometheus reporter, return the response without \r */
+static const char *prometheus_get(int port, const char *req)
+{
+	static char resp[4096];
+	struct sockaddr_in sin = {
+		.sin_family = AF_INET,
+		.sin_port = htons(port),
+	};
+	char *body;
+	int fd, rc, len = 0, i, j, clen;
+
+	sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	fd = socket(AF_INET, SOCK_STREAM, 0);
+	OSMO_ASSERT(fd >= 0);
+	OSMO_ASSERT(connect(fd, (struct sockaddr *)&sin, sizeof(sin)) == 0);
+	OSMO_ASSERT(write(fd, req, strlen(req)) == strlen(req));
+
+	/* wait for the complete response, the connection is kept open */
+	while (1) {
+		osmo_select_main(1);
+		rc = recv(fd, resp + len, sizeof(resp) - 1 - len, MSG_DONTWAIT);
+		if (rc == 0)
+			break;
+		if (rc > 0)
+			len += rc;
+		resp[len] = '\0';
+		body = strstr(resp, "\r\n\r\n");
+		if (body && sscanf(strstr(resp, "Content-Length:"),
+				   "Content-Length: %d", &clen) == 1 &&
+		    body + 4 + clen == resp + len)
+			break;
+	}
+	close(fd);
+
+	for (i = j = 0; i < len; i++) {
+		if (resp[i] != '\r')
+			resp[j++] = resp[i];
+	}
+	resp[j] = '\0';
+
+	return resp;
+}
+
+static const struct osmo_histogram_desc hist_description[] = {
+	{ "latency", "The latency", "ns" },
+};
+
+static const struct osmo_histogram_group_desc histg_desc = {
+	.group_name_prefix = "hist-test",
+	.group_description = "Histogram test",
+	.class_id = OSMO_STATS_CLASS_GLOBAL,
+	.num_hist = ARRAY_SIZE(hist_description),
+	.hist_desc = hist_description,
+};
+
+/* same metric name prefix as ctrg_desc, but a different group label */
+static const struct rate_ctr_desc ctr_description_other[] = {
+	{ "ctr.a", "The A counter value" },
+	{ "ctr:c", "The C counter value" },
+};
+
+static const struct rate_ctr_group_desc ctrg_desc_other = {
+	.group_name_prefix = "ctr_test.one",
+	.group_description = "Counter test number 1, other description",
+	.num_ctr = ARRAY_SIZE(ctr_description_other),
+	.ctr_desc = ctr_description_other,
+	.class_id = OSMO_STATS_CLASS_SUBSCRIBER,
+};
+
+static void test_prometheus()
+{
+	struct osmo_stats_reporter *srep;
+	struct osmo_stat_item_group *statg;
+	struct rate_ctr_group *ctrg1, *ctrg2, *ctrg3;
+	struct osmo_histogram_group *histg;
+	struct sockaddr_in sin;
+	socklen_t sin_len = sizeof(sin);
+	int rc;
+
+	printf("Start test: %s\n", __func__);
+
+	statg = osmo_stat_item_group_alloc(NULL, &statg_desc, 1);
+	ctrg1 = rate_ctr_group_alloc(NULL, &ctrg_desc, 1);
+	ctrg2 = rate_ctr_group_alloc(NULL, &ctrg_desc, 2);
+	ctrg3 = rate_ctr_group_alloc(NULL, &ctrg_desc_other, 3);
+	histg = osmo_histogram_group_alloc(NULL, &histg_desc, 0);
+	OSMO_ASSERT(statg && ctrg1 && ctrg2 && ctrg3 && histg);
+
+	rate_ctr_add(&ctrg1->ctr[TEST_A_CTR], 5);
+	rate_ctr_add(&ctrg2->ctr[TEST_B_CTR], 42);
+	rate_ctr_add(&ctrg3->ctr[0], 7);
+	osmo_stat_item_set(statg->items[TEST_A_ITEM], -3);
+	osmo_histogram_record(&histg->hist[0], 20);
+	osmo_histogram_record(&histg->hist[0], 3000);
+
+	srep = osmo_stats_reporter_create_prometheus("test");
+	OSMO_ASSERT(srep != NULL);
+	osmo_stats_reporter_set_max_class(srep, OSMO_STATS_CLASS_SUBSCRIBER);
+	rc = osmo_stats_reporter_set_name_prefix(srep, "osmo");
+	OSMO_ASSERT(rc == 0);
+	rc = osmo_stats_reporter_set_local_addr(srep, "127.0.0.1");
+	OSMO_ASSERT(rc == 0);
+	rc = osmo_stats_reporter_set_local_port(srep, 0);
+	OSMO_ASSERT(rc == 0);
+	rc = osmo_stats_reporter_enable(srep);
+	OSMO_ASSERT(rc == 0);
+
+	OSMO_ASSERT(srep->fd >= 0);
+	rc = getsockname(srep->fd, (struct sockaddr *)&sin, &sin_len);
+	OSMO_ASSERT(rc == 0);
+
+	printf("text format:\n%s", prometheus_get(ntohs(sin.sin_port),
+		"GET /metrics HTTP/1.1\r\nHost: localhost\r\n\r\n"));
+	printf("openmetrics format:\n%s", prometheus_get(ntohs(sin.sin_port),
+		"GET /metrics HTTP/1.1\r\n"
+		"Accept: application/openmetrics-text; version=1.0.0\r\n\r\n"));
+	printf("unknown path:\n%s", prometheus_get(ntohs(sin.sin_port),
+		"GET /foo HTTP/1.0\r\n\r\n"));
+
+	osmo_stats_reporter_free(srep);
+	osmo_histogram_group_free(histg);
+	rate_ctr_group_free(ctrg3);
+	rate_ctr_group_free(ctrg2);
+	rate_ctr_group_free(ctrg1);
+	osmo_stat_item_group_free(statg);
+
+	printf("End test: %s\n", __func__);
+}
+
+static void test_rate_ctr_intv()
+{
+	struct rate_ctr_group *ctrg;
+	struct rate_ctr *ctr;
+	struct rate_ctr single = {0};
+	struct timespec *now;
+
+	printf("Start test: %s\n", __func__);
+
+	osmo_clock_override_enable(CLOCK_MONOTONIC, true);
+	now = osmo_clock_override_gettimespec(CLOCK_MONOTONIC);
+	now->tv_sec = 10;
+	now->tv_nsec = 0;
+
+	ctrg = rate_ctr_group_alloc(NULL, &ctrg_desc, 5);
+	OSMO_ASSERT(ctrg != NULL);
+	ctr = &ctrg->ctr[TEST_A_CTR];
+
+	OSMO_ASSERT(rate_ctr_group_set_intv(ctrg, RATE_CTR_INTV_NUM, 100) == -EINVAL);
+	OSMO_ASSERT(rate_ctr_group_set_intv(ctrg, RATE_CTR_INTV_SEC, 0) == -EINVAL);
+	OSMO_ASSERT(rate_ctr_group_intv_is_default(ctrg, RATE_CTR_INTV_SEC));
+	OSMO_ASSERT(rate_ctr_group_set_intv(ctrg, RATE_CTR_INTV_SEC, 100) == 0);
+	OSMO_ASSERT(!rate_ctr_group_intv_is_default(ctrg, RATE_CTR_INTV_SEC));
+	OSMO_ASSERT(rate_ctr_group_intv_is_default(ctrg, RATE_CTR_INTV_MIN));
+
+	rate_ctr_add(ctr, 50);
+	printf("0 ms: %" PRIu64 "/100ms\n", rate_ctr_get_rate(ctr, RATE_CTR_INTV_SEC));
+	osmo_clock_override_add(CLOCK_MONOTONIC, 0, 100000000);
+	printf("100 ms: %" PRIu64 "/100ms\n", rate_ctr_get_rate(ctr, RATE_CTR_INTV_SEC));
+	rate_ctr_add(ctr, 20);
+	osmo_clock_override_add(CLOCK_MONOTONIC, 0, 50000000);
+	printf("150 ms: %" PRIu64 "/100ms\n", rate_ctr_get_rate(ctr, RATE_CTR_INTV_SEC));
+	osmo_clock_override_add(CLOCK_MONOTONIC, 0, 50000000);
+	printf("200 ms: %" PRIu64 "/100ms\n", rate_ctr_get_rate(ctr, RATE_CTR_INTV_SEC));
+	osmo_clock_override_add(CLOCK_MONOTONIC, 1, 0);
+	printf("1200 ms: %" PRIu64 "/100ms\n", rate_ctr_get_rate(ctr, RATE_CTR_INTV_SEC));
+	/* not read for three intervals: the average */
+	rate_ctr_add(ctr, 30);
+	osmo_clock_override_add(CLOCK_MONOTONIC, 0, 300000000);
+	printf("1500 ms: %" PRIu64 "/100ms\n", rate_ctr_get_rate(ctr, RATE_CTR_INTV_SEC));
+
+	printf("1500 ms: %" PRIu64 "/m\n", rate_ctr_get_rate(ctr, RATE_CTR_INTV_MIN));
+	osmo_clock_override_add(CLOCK_MONOTONIC, 58, 500000000);
+	printf("60 s: %" PRIu64 "/m\n", rate_ctr_get_rate(ctr, RATE_CTR_INTV_MIN));
+
+	/* a counter outside of a group starts on the first read */
+	rate_ctr_add(&single, 7);
+	printf("single: %" PRIu64 "/s\n", rate_ctr_get_rate(&single, RATE_CTR_INTV_SEC));
+	rate_ctr_add(&single, 3);
+	osmo_clock_override_add(CLOCK_MONOTONIC, 1, 0);
+	printf("single 1 s later: %" PRIu64 "/s\n",
+	       rate_ctr_get_rate(&single, RATE_CTR_INTV_SEC));
+
+	rate_ctr_group_free(ctrg);
+	osmo_clock_override_enable(CLOCK_MONOTONIC, false);
+
+	printf("End test: %s\n", __func__);
+}
+
+static int dirty_ctr_handler(struct rate_ctr_group *ctrg, struct rate_ctr *ctr,
+			     const struct rate_ctr_desc *desc, void *data)
+{
+	printf("  dirty: %s.%u.%s = %" PRIu64 "\n", ctrg->desc->group_name_prefix,
+	       ctrg->idx, desc->name, ctr->current);
+	return 0;
+}
+
+static void test_rate_ctr_copy()
+{
+	struct rate_ctr_group *ctrg;
+	struct rate_ctr copy;
+	int i;
+
+	printf("Start test: %s\n", __func__);
+
+	ctrg = rate_ctr_group_alloc(NULL, &ctrg_desc, 6);
+	OSMO_ASSERT(ctrg != NULL);
+	rate_ctr_clear_dirty();
+
+	/* a copy of a counter in a group is not tracked as changed */
+	copy = ctrg->ctr[TEST_A_CTR];
+	for (i = 0; i < 10; i++)
+		rate_ctr_inc(&copy);
+	rate_ctr_inc(&ctrg->ctr[TEST_A_CTR]);
+	rate_ctr_inc(&ctrg->ctr[TEST_A_CTR]);
+	rate_ctr_for_each_dirty(dirty_ctr_handler, NULL);
+
+	/* nor once its group is gone */
+	rate_ctr_group_free(ctrg);
+	rate_ctr_inc(&copy);
+	printf("  copy: %" PRIu64 ", %" PRIu64 "/s\n", copy.current,
+	       rate_ctr_get_rate(&copy, RATE_CTR_INTV_SEC));
+	rate_ctr_for_each_dirty(dirty_ctr_handler, NULL);
+
+	printf("End test: %s\n", __func__);
+}
+
+/* Print all datagrams received by the statsd test server */
+static int statsd_recv_all(int fd, int max_len)
+{
+	char buf[1500];
+	int rc, n = 0;
+
+	while ((rc = recv(fd, buf, sizeof(buf) - 1, MSG_DONTWAIT)) > 0) {
+		OSMO_ASSERT(rc <= max_len);
+		buf[rc] = '\0';
+		printf("  datagram %d (%d bytes):\n%s\n", n++, rc, buf);
+	}
+
+	return n;
+}
+
+static void test_statsd()
+{
+	struct osmo_stats_reporter *srep;
+	struct osmo_stat_item_group *statg;
+	struct rate_ctr_group *ctrg[10];
+	struct sockaddr_in sin = {
+		.sin_family = AF_INET,
+	};
+	socklen_t sin_len = sizeof(sin);
+	int fd, rc, i;
+
+	printf("Start test: %s\n", __func__);
+
+	sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	fd = socket(AF_INET, SOCK_DGRAM, 0);
+	OSMO_ASSERT(fd >= 0);
+	OSMO_ASSERT(bind(fd, (struct sockaddr *)&sin, sizeof(sin)) == 0);
+	OSMO_ASSERT(getsockname(fd, (struct sockaddr *)&sin, &sin_len) == 0);
+
+	statg = osmo_stat_item_group_alloc(NULL, &statg_desc, 0);
+	OSMO_ASSERT(statg != NULL);
+	osmo_stat_item_set(statg->items[TEST_A_ITEM], -3);
+	osmo_stat_item_set(statg->items[TEST_B_ITEM], 1234567);
+	for (i = 0; i < ARRAY_SIZE(ctrg); i++) {
+		/* ':' in the mangled names is reported as '.' */
+		ctrg[i] = rate_ctr_group_alloc(NULL, &ctrg_desc_dot, i + 1);
+		OSMO_ASSERT(ctrg[i] != NULL);
+		rate_ctr_add(&ctrg[i]->ctr[TEST_A_CTR], i * 100);
+	}
+
+	srep = osmo_stats_reporter_create_statsd("test");
+	OSMO_ASSERT(srep != NULL);
+	osmo_stats_reporter_set_max_class(srep, OSMO_STATS_CLASS_SUBSCRIBER);
+	OSMO_ASSERT(osmo_stats_reporter_set_name_prefix(srep, "osmo:x") == 0);
+	OSMO_ASSERT(osmo_stats_reporter_set_remote_addr(srep, "127.0.0.1") == 0);
+	OSMO_ASSERT(osmo_stats_reporter_set_remote_port(srep, ntohs(sin.sin_port)) == 0);
+	/* 52 bytes of payload, one line per datagram */
+	OSMO_ASSERT(osmo_stats_reporter_set_mtu(srep, 80) == 0);
+	rc = osmo_stats_reporter_enable(srep);
+	OSMO_ASSERT(rc == 0);
+
+	printf("report (initial, more datagrams than sent at once):\n");
+	osmo_stats_report();
+	rc = statsd_recv_all(fd, 52);
+	OSMO_ASSERT(rc == 22);
+
+	printf("report (two counters changed):\n");
+	rate_ctr_inc(&ctrg[3]->ctr[TEST_B_CTR]);
+	rate_ctr_add(&ctrg[3]->ctr[TEST_B_CTR], 9);
+	rate_ctr_inc(&ctrg[0]->ctr[TEST_A_CTR]);
+	osmo_stats_report();
+	rc = statsd_recv_all(fd, 52);
+	OSMO_ASSERT(rc == 2);
+
+	printf("report (larger MTU, lines aggregated):\n");
+	OSMO_ASSERT(osmo_stats_reporter_set_mtu(srep, 200) == 0);
+	osmo_stats_report();
+	rc = statsd_recv_all(fd, 172);
+	OSMO_ASSERT(rc == 6);
+
+	osmo_stats_reporter_free(srep);
+	for (i = 0; i < ARRAY_SIZE(ctrg); i++)
+		rate_ctr_group_free(ctrg[i]);
+	osmo_stat_item_group_free(statg);
+	close(fd);
+
+	printf("End test: %s\n", __func__);
+}
+
 int main(int argc, char **argv)
 {
 	static const struct log_info log_info = {};
@@ -483,5 +823,9 @@ int main(int argc, char **argv)
 
 	stat_test();
 	test_reporting();
+	test_prometheus();
+	test_statsd();
+	test_rate_ctr_intv();
+	test_rate_ctr_copy();
 	return 0;
 }
@@ -33,8 +33,16 @@
 #include <osmocom/core/linuxlist.h>
 #include <osmocom/core/timer_compat.h>
 
+static int timer_fired;
+
+static void timer_cb(void *data)
+{
+	timer_fired++;
+}
+
 int main(int argc, char *argv[])
 {
+	struct osmo_timer_list timer;
 
 	struct timespec ts1 = { 123, 456 }, ts2 = {1, 200};
 	struct timespec read1, read2, res;
@@ -75,6 +83,31 @@ int main(int argc, char *argv[])
 		return EXIT_FAILURE;
 	printf("osmo_clock_override_add works fine.\n");
 
+	osmo_timer_setup(&timer, timer_cb, NULL);
+	osmo_timer_schedule(&timer, 1, 0);
+	osmo_clock_override_add(CLOCK_MONOTONIC, 0, 999000000);
+	osmo_timers_prepare();
+	osmo_timers_update();
+	if (timer_fired)
+		return EXIT_FAILURE;
+	osmo_clock_override_add(CLOCK_MONOTONIC, 0, 1000000);
+	osmo_timers_prepare();
+	osmo_timers_update();
+	if (timer_fired != 1)
+		return EXIT_FAILURE;
+	printf("Timers follow the monotonic clock\n");
+
+	/* a cached time is used for scheduling until the cache is dropped */
+	osmo_timers_cache_now(true);
+	osmo_clock_override_add(CLOCK_MONOTONIC, 5, 0);
+	osmo_timer_schedule(&timer, 1, 0);
+	osmo_timers_cache_now(false);
+	osmo_timers_prepare();
+	osmo_timers_update();
+	if (timer_fired != 2)
+		return EXIT_FAILURE;
+	printf("Cached time is used while enabled\n");
+
 	osmo_clock_override_enable(CLOCK_MONOTONIC, false);
 	printf("Monotonic clock override disabled\n");
 
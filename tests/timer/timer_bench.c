@@ -0,0 +1,125 @@
+/* Benchmark of the timer back-ends under a LAPD-like re-arm pattern */
+/*
+ * (C) 2018 by sysmocom - s.f.m.c. GmbH
+ * All Rights Reserved
+ *
+ * SPDX-License-Identifier: GPL-2.0+
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <getopt.h>
+#include <time.h>
+
+#include <osmocom/core/timer.h>
+#include <osmocom/core/utils.h>
+
+/* Every datalink has a T200 (retransmission, 1s) and a T203 (idle, 10s)
+ * timer, like in lapd_core.c.  For every I frame sent, T200 is started;
+ * for every acknowledgement, T200 is stopped and T203 is re-started.
+ * Hence nearly all timers get cancelled before they expire. */
+struct datalink {
+	struct osmo_timer_list t200;
+	struct osmo_timer_list t203;
+};
+
+static unsigned long expired;
+
+static void timer_cb(void *data)
+{
+	expired++;
+}
+
+static double run(enum osmo_timer_backend backend, unsigned int num_links,
+		  unsigned int num_frames)
+{
+	struct datalink *links = calloc(num_links, sizeof(*links));
+	struct timespec start, stop;
+	unsigned int i;
+
+	OSMO_ASSERT(links);
+	osmo_timers_set_backend(backend);
+	osmo_gettimeofday_override_time = (struct timeval){ 1500000000, 0 };
+	expired = 0;
+	srand(1);
+
+	for (i = 0; i < num_links; i++) {
+		osmo_timer_setup(&links[i].t200, timer_cb, &links[i]);
+		osmo_timer_setup(&links[i].t203, timer_cb, &links[i]);
+		osmo_timer_schedule(&links[i].t203, 10, 0);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < num_frames; i++) {
+		struct datalink *dl = &links[rand() % num_links];
+
+		/* I frame sent, then acknowledged */
+		osmo_timer_del(&dl->t203);
+		osmo_timer_schedule(&dl->t200, 1, 0);
+		osmo_timer_del(&dl->t200);
+		osmo_timer_schedule(&dl->t203, 10, 0);
+
+		/* advance time by one TDMA frame every 50 I frames */
+		if (i % 50 == 0) {
+			osmo_gettimeofday_override_add(0, 4615);
+			osmo_timers_prepare();
+			osmo_timers_update();
+		}
+	}
+	clock_gettime(CLOCK_MONOTONIC, &stop);
+
+	for (i = 0; i < num_links; i++) {
+		osmo_timer_del(&links[i].t200);
+		osmo_timer_del(&links[i].t203);
+	}
+	free(links);
+
+	return (stop.tv_sec - start.tv_sec) + (stop.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int num_links = 10000;
+	unsigned int num_frames = 2000000;
+	double t_rb, t_wheel;
+	int c;
+
+	while ((c = getopt(argc, argv, "l:f:")) != -1) {
+		switch (c) {
+		case 'l':
+			num_links = atoi(optarg);
+			break;
+		case 'f':
+			num_frames = atoi(optarg);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-l links] [-f frames]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	osmo_gettimeofday_override = true;
+
+	printf("%u datalinks, %u frames (4 timer operations each)\n", num_links, num_frames);
+
+	t_rb = run(OSMO_TIMER_BACKEND_RBTREE, num_links, num_frames);
+	printf("rbtree: %.3f s, %.0f ops/s, %lu expired\n", t_rb, num_frames * 4 / t_rb, expired);
+
+	t_wheel = run(OSMO_TIMER_BACKEND_WHEEL, num_links, num_frames);
+	printf("wheel:  %.3f s, %.0f ops/s, %lu expired\n", t_wheel, num_frames * 4 / t_wheel, expired);
+
+	printf("speed-up: %.2fx\n", t_rb / t_wheel);
+
+	osmo_timers_set_backend(OSMO_TIMER_BACKEND_RBTREE);
+	return 0;
+}
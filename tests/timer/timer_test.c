@@ -169,7 +169,7 @@ int main(int argc, char *argv[])
 
 	osmo_gettimeofday_override = true;
 
-	while ((c = getopt_long(argc, argv, "s:", NULL, NULL)) != -1) {
+	while ((c = getopt_long(argc, argv, "s:w", NULL, NULL)) != -1) {
 	switch(c) {
 		case 's':
 			timer_nsteps = atoi(optarg);
@@ -179,6 +179,9 @@ int main(int argc, char *argv[])
 				exit(EXIT_FAILURE);
 			}
 			break;
+		case 'w':
+			osmo_timers_set_backend(OSMO_TIMER_BACKEND_WHEEL);
+			break;
 		default:
 			exit(EXIT_FAILURE);
 		}
@@ -1,5 +1,16 @@
+#include <errno.h>
+#include <inttypes.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
 #include <osmocom/core/logging.h>
 #include <osmocom/core/utils.h>
+#include <osmocom/core/rate_ctr.h>
+#include <osmocom/core/stat_item.h>
 #include <osmocom/core/write_queue.h>
 
 static const struct log_info_cat default_categories[] = {
@@ -65,6 +76,184 @@ static void test_wqueue_limit(void)
 	osmo_wqueue_clear(&wqueue);
 }
 
+static struct msgb *fill_msgb(unsigned int len, uint8_t val)
+{
+	struct msgb *msg = msgb_alloc(len, "batch");
+	memset(msgb_put(msg, len), val, len);
+	return msg;
+}
+
+static void test_wqueue_batch_dgram(void)
+{
+	struct osmo_wqueue wqueue;
+	uint8_t buf[64];
+	int sk[2], i, rc;
+
+	printf("Testing batched datagram writes\n");
+	OSMO_ASSERT(socketpair(AF_UNIX, SOCK_DGRAM, 0, sk) == 0);
+
+	osmo_wqueue_init(&wqueue, 10);
+	OSMO_ASSERT(osmo_wqueue_stats_alloc(&wqueue, NULL, 0) == 0);
+	OSMO_ASSERT(osmo_wqueue_stats_alloc(&wqueue, NULL, 0) == -EALREADY);
+	OSMO_ASSERT(osmo_wqueue_set_batch(&wqueue, OSMO_WQUEUE_MAX_BATCH + 1) == -EINVAL);
+	OSMO_ASSERT(osmo_wqueue_set_batch(&wqueue, 4) == 0);
+	wqueue.bfd.fd = sk[0];
+	for (i = 0; i < 6; i++)
+		OSMO_ASSERT(osmo_wqueue_enqueue(&wqueue, fill_msgb(10 + i, i)) == 0);
+
+	/* two write events send all six datagrams, four at a time */
+	osmo_wqueue_bfd_cb(&wqueue.bfd, BSC_FD_WRITE);
+	printf(" queue length %u, more to write: %d\n", wqueue.current_length,
+	       !!(wqueue.bfd.when & BSC_FD_WRITE));
+	osmo_wqueue_bfd_cb(&wqueue.bfd, BSC_FD_WRITE);
+	printf(" queue length %u, more to write: %d\n", wqueue.current_length,
+	       !!(wqueue.bfd.when & BSC_FD_WRITE));
+	printf(" batches %" PRIu64 ", msgs %" PRIu64 ", last batch %d, length %d\n",
+	       wqueue.ctrg->ctr[OSMO_WQUEUE_CTR_BATCH_WRITES].current,
+	       wqueue.ctrg->ctr[OSMO_WQUEUE_CTR_BATCH_MSGS].current,
+	       osmo_stat_item_get_last(wqueue.statg->items[OSMO_WQUEUE_STAT_BATCH_LEN]),
+	       osmo_stat_item_get_last(wqueue.statg->items[OSMO_WQUEUE_STAT_LENGTH]));
+
+	/* datagram boundaries are kept */
+	for (i = 0; i < 6; i++) {
+		rc = recv(sk[1], buf, sizeof(buf), MSG_DONTWAIT);
+		OSMO_ASSERT(rc == 10 + i);
+		OSMO_ASSERT(buf[0] == i && buf[rc - 1] == i);
+	}
+	OSMO_ASSERT(recv(sk[1], buf, sizeof(buf), MSG_DONTWAIT) < 0);
+
+	osmo_wqueue_stats_free(&wqueue);
+	OSMO_ASSERT(!wqueue.ctrg && !wqueue.statg);
+	close(sk[0]);
+	close(sk[1]);
+}
+
+static void test_wqueue_batch_stream(void)
+{
+	struct osmo_wqueue wqueue;
+	static uint8_t buf[4 * 30000];
+	unsigned int total = 0;
+	int p[2], i, rc;
+
+	printf("Testing batched stream writes\n");
+	OSMO_ASSERT(pipe(p) == 0);
+	OSMO_ASSERT(fcntl(p[0], F_SETFL, O_NONBLOCK) == 0);
+	OSMO_ASSERT(fcntl(p[1], F_SETFL, O_NONBLOCK) == 0);
+
+	osmo_wqueue_init(&wqueue, 10);
+	osmo_wqueue_stats_alloc(&wqueue, NULL, 1);
+	osmo_wqueue_set_batch(&wqueue, 10);
+	wqueue.bfd.fd = p[1];
+	/* more than a pipe holds, so the writes end up partial */
+	for (i = 0; i < 4; i++)
+		OSMO_ASSERT(osmo_wqueue_enqueue(&wqueue, fill_msgb(30000, i + 1)) == 0);
+
+	while (wqueue.current_length) {
+		osmo_wqueue_bfd_cb(&wqueue.bfd, BSC_FD_WRITE);
+		OSMO_ASSERT(!!wqueue.current_length == !!(wqueue.bfd.when & BSC_FD_WRITE));
+		rc = read(p[0], buf + total, sizeof(buf) - total);
+		OSMO_ASSERT(rc > 0);
+		total += rc;
+	}
+	while (total < sizeof(buf) && (rc = read(p[0], buf + total, sizeof(buf) - total)) > 0)
+		total += rc;
+
+	/* everything arrives once and in order */
+	OSMO_ASSERT(total == sizeof(buf));
+	for (i = 0; i < sizeof(buf); i++)
+		OSMO_ASSERT(buf[i] == i / 30000 + 1);
+	printf(" all data written, msgs %" PRIu64 "\n",
+	       wqueue.ctrg->ctr[OSMO_WQUEUE_CTR_BATCH_MSGS].current);
+	OSMO_ASSERT(wqueue.ctrg->ctr[OSMO_WQUEUE_CTR_BATCH_MSGS].current == 4);
+
+	osmo_wqueue_stats_free(&wqueue);
+	close(p[0]);
+	close(p[1]);
+}
+
+static unsigned int num_written;
+
+static int count_write_cb(struct osmo_fd *fd, struct msgb *msg)
+{
+	num_written++;
+	return 0;
+}
+
+static void test_wqueue_batch_write_cb(void)
+{
+	struct osmo_wqueue wqueue;
+	int i;
+
+	printf("Testing batching with a write_cb\n");
+	osmo_wqueue_init(&wqueue, 10);
+	wqueue.write_cb = count_write_cb;
+	osmo_wqueue_set_batch(&wqueue, 4);
+	wqueue.bfd.fd = -1;
+	for (i = 0; i < 3; i++)
+		OSMO_ASSERT(osmo_wqueue_enqueue(&wqueue, fill_msgb(10, i)) == 0);
+
+	/* the write_cb still gets to write every msgb */
+	osmo_wqueue_bfd_cb(&wqueue.bfd, BSC_FD_WRITE);
+	printf(" written %u, queue length %u\n", num_written, wqueue.current_length);
+	osmo_wqueue_clear(&wqueue);
+}
+
+static unsigned int num_refused;
+
+static int count_write_err_cb(struct osmo_fd *fd, struct msgb *msg, int err)
+{
+	OSMO_ASSERT(msgb_length(msg) == 10);
+	if (err == -ECONNREFUSED)
+		num_refused++;
+	return 0;
+}
+
+static void test_wqueue_batch_refused(void)
+{
+	struct osmo_wqueue wqueue;
+	struct sockaddr_in sin;
+	socklen_t len = sizeof(sin);
+	int sk, i;
+
+	printf("Testing batched writes to a refusing peer\n");
+	/* bind and close a UDP socket to find a local port nobody listens on */
+	memset(&sin, 0, sizeof(sin));
+	sin.sin_family = AF_INET;
+	sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	sk = socket(AF_INET, SOCK_DGRAM, 0);
+	OSMO_ASSERT(sk >= 0);
+	OSMO_ASSERT(bind(sk, (struct sockaddr *)&sin, sizeof(sin)) == 0);
+	OSMO_ASSERT(getsockname(sk, (struct sockaddr *)&sin, &len) == 0);
+	close(sk);
+
+	sk = socket(AF_INET, SOCK_DGRAM, 0);
+	OSMO_ASSERT(sk >= 0);
+	OSMO_ASSERT(connect(sk, (struct sockaddr *)&sin, sizeof(sin)) == 0);
+	/* the ICMP port unreachable for this one makes the next send fail */
+	OSMO_ASSERT(send(sk, "x", 1, 0) == 1);
+	usleep(10000);
+
+	osmo_wqueue_init(&wqueue, 10);
+	osmo_wqueue_stats_alloc(&wqueue, NULL, 2);
+	osmo_wqueue_set_batch(&wqueue, 2);
+	wqueue.write_err_cb = count_write_err_cb;
+	wqueue.bfd.fd = sk;
+	for (i = 0; i < 6; i++)
+		OSMO_ASSERT(osmo_wqueue_enqueue(&wqueue, fill_msgb(10, i)) == 0);
+
+	/* refused datagrams are dropped, the queue still drains */
+	for (i = 0; i < 6 && wqueue.current_length; i++)
+		osmo_wqueue_bfd_cb(&wqueue.bfd, BSC_FD_WRITE);
+	printf(" queue length %u, more to write: %d, dropped some: %d\n",
+	       wqueue.current_length, !!(wqueue.bfd.when & BSC_FD_WRITE),
+	       wqueue.ctrg->ctr[OSMO_WQUEUE_CTR_WRITE_ERRORS].current > 0);
+	/* and reported */
+	OSMO_ASSERT(num_refused == wqueue.ctrg->ctr[OSMO_WQUEUE_CTR_WRITE_ERRORS].current);
+
+	osmo_wqueue_stats_free(&wqueue);
+	close(sk);
+}
+
 int main(int argc, char **argv)
 {
 	struct log_target *stderr_target;
@@ -75,6 +264,10 @@ int main(int argc, char **argv)
 	log_set_print_filename(stderr_target, 0);
 
 	test_wqueue_limit();
+	test_wqueue_batch_dgram();
+	test_wqueue_batch_stream();
+	test_wqueue_batch_write_cb();
+	test_wqueue_batch_refused();
 
 	printf("Done\n");
 	return 0;
@@ -0,0 +1,211 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+
+from conv_gen import ConvolutionalCode
+from conv_gen import poly
+
+# Convolutional codes of other systems, and a few made up ones, which
+# cover the constraint lengths and rates of the Viterbi decoder beyond
+# the ones used by GSM. They are only used for testing.
+
+# Polynomials according to 3GPP TS 25.212, section 4.2.3.1
+U0 = poly(0, 2, 3, 4, 8)
+U1 = poly(0, 1, 2, 3, 5, 7, 8)
+U2 = poly(0, 2, 3, 5, 6, 7, 8)
+U3 = poly(0, 1, 3, 4, 7, 8)
+U4 = poly(0, 1, 2, 5, 8)
+
+# Convolutional code definitions
+conv_codes = [
+	# UMTS BCH definition
+	ConvolutionalCode(
+		262,
+		[
+			( U0, 1 ),
+			( U1, 1 ),
+		],
+		name = "umts_bch",
+		description = [
+			"UMTS BCH convolutional code:",
+			"262 bits blocks, rate 1/2, k = 9",
+			"G0 = 1 + D2 + D3 + D4 + D8",
+			"G1 = 1 + D + D2 + D3 + D5 + D7 + D8",
+		]
+	),
+
+	# UMTS rate 1/3 definition
+	ConvolutionalCode(
+		100,
+		[
+			( U2, 1 ),
+			( U3, 1 ),
+			( U4, 1 ),
+		],
+		name = "umts_r3",
+		description = [
+			"UMTS rate 1/3 convolutional code:",
+			"100 bits blocks, rate 1/3, k = 9",
+			"G0 = 1 + D2 + D3 + D5 + D6 + D7 + D8",
+			"G1 = 1 + D + D3 + D4 + D7 + D8",
+			"G2 = 1 + D + D2 + D5 + D8",
+		]
+	),
+
+	# Bluetooth LE Coded PHY definition
+	ConvolutionalCode(
+		80,
+		[
+			( poly(0, 1, 2, 3), 1 ),
+			( poly(0, 2, 3), 1 ),
+		],
+		name = "ble_coded",
+		description = [
+			"Bluetooth LE Coded PHY convolutional code:",
+			"80 bits blocks, rate 1/2, k = 4",
+			"G0 = 1 + D + D2 + D3",
+			"G1 = 1 + D2 + D3",
+		]
+	),
+
+	# LTE turbo constituent code definition
+	ConvolutionalCode(
+		104,
+		[
+			( 1, 1 ),
+			( poly(0, 1, 3), poly(0, 2, 3) ),
+		],
+		name = "lte_rsc",
+		description = [
+			"LTE turbo constituent (recursive) convolutional code:",
+			"104 bits blocks, rate 1/2, k = 4",
+			"G0/G0 = 1",
+			"G1/G0 = 1 + D + D3 / 1 + D2 + D3",
+		]
+	),
+
+	# Rate 1/2, k = 3 tail-biting test definition
+	ConvolutionalCode(
+		64,
+		[
+			( poly(0, 1, 2), 1 ),
+			( poly(0, 2), 1 ),
+		],
+		name = "k3_r2",
+		term_type = "CONV_TERM_TAIL_BITING",
+		description = [
+			"Test convolutional code:",
+			"64 bits blocks, rate 1/2, k = 3, tail-biting",
+			"G0 = 1 + D + D2",
+			"G1 = 1 + D2",
+		]
+	),
+
+	# Rate 1/2, k = 6 test definition
+	ConvolutionalCode(
+		120,
+		[
+			( poly(0, 1, 3, 5), 1 ),
+			( poly(0, 2, 4, 5), 1 ),
+		],
+		name = "k6_r2",
+		description = [
+			"Test convolutional code:",
+			"120 bits blocks, rate 1/2, k = 6",
+			"G0 = 1 + D + D3 + D5",
+			"G1 = 1 + D2 + D4 + D5",
+		]
+	),
+
+	# Rate 1/3, k = 8 test definition
+	ConvolutionalCode(
+		96,
+		[
+			( poly(0, 1, 2, 4, 7), 1 ),
+			( poly(0, 3, 5, 7), 1 ),
+			( poly(0, 1, 5, 6, 7), 1 ),
+		],
+		name = "k8_r3",
+		term_type = "CONV_TERM_TAIL_BITING",
+		description = [
+			"Test convolutional code:",
+			"96 bits blocks, rate 1/3, k = 8, tail-biting",
+			"G0 = 1 + D + D2 + D4 + D7",
+			"G1 = 1 + D3 + D5 + D7",
+			"G2 = 1 + D + D5 + D6 + D7",
+		]
+	),
+
+	# Rate 1/6, k = 5 punctured test definition
+	ConvolutionalCode(
+		60,
+		[
+			( poly(0, 3, 4), 1 ),
+			( poly(0, 1, 3, 4), 1 ),
+			( poly(0, 2, 4), 1 ),
+			( poly(0, 1, 2, 3, 4), 1 ),
+			( poly(0, 1, 4), 1 ),
+			( poly(0, 2, 3, 4), 1 ),
+		],
+		puncture = [
+			  5,  17,  29,  41,  53,  65,  77,  89, 101, 113, 125, 137,
+			149, 161, 173, 185, 197, 209, 221, 233, 245, 257, 269, 281,
+			293, 305, 317, 329, 341, 353, 365, 377, -1,
+		],
+		name = "k5_r6",
+		description = [
+			"Test convolutional code:",
+			"60 bits blocks, rate 1/6, k = 5, punctured",
+			"G0 = 1 + D3 + D4",
+			"G1 = 1 + D + D3 + D4",
+			"G2 = 1 + D2 + D4",
+			"G3 = 1 + D + D2 + D3 + D4",
+			"G4 = 1 + D + D4",
+			"G5 = 1 + D2 + D3 + D4",
+		]
+	),
+
+	# Rate 1/8, k = 9 test definition
+	ConvolutionalCode(
+		64,
+		[
+			( poly(0, 2, 3, 4, 8), 1 ),
+			( poly(0, 1, 2, 3, 5, 7, 8), 1 ),
+			( poly(0, 2, 3, 5, 6, 7, 8), 1 ),
+			( poly(0, 1, 3, 4, 7, 8), 1 ),
+			( poly(0, 1, 2, 5, 8), 1 ),
+			( poly(0, 1, 4, 6, 8), 1 ),
+			( poly(0, 3, 5, 8), 1 ),
+			( poly(0, 1, 2, 3, 4, 6, 7, 8), 1 ),
+		],
+		name = "k9_r8",
+		description = [
+			"Test convolutional code:",
+			"64 bits blocks, rate 1/8, k = 9",
+			"G0 = 1 + D2 + D3 + D4 + D8",
+			"G1 = 1 + D + D2 + D3 + D5 + D7 + D8",
+			"G2 = 1 + D2 + D3 + D5 + D6 + D7 + D8",
+			"G3 = 1 + D + D3 + D4 + D7 + D8",
+			"G4 = 1 + D + D2 + D5 + D8",
+			"G5 = 1 + D + D4 + D6 + D8",
+			"G6 = 1 + D3 + D5 + D8",
+			"G7 = 1 + D + D2 + D3 + D4 + D6 + D7 + D8",
+		]
+	),
+
+	# Rate 1/2, k = 5 test definition, G1 not using the oldest bit, so
+	# that there is no butterfly symmetry in the trellis
+	ConvolutionalCode(
+		100,
+		[
+			( poly(0, 3, 4), 1 ),
+			( poly(0, 1, 2), 1 ),
+		],
+		name = "k5_r2_asym",
+		description = [
+			"Test convolutional code:",
+			"100 bits blocks, rate 1/2, k = 5, asymmetric",
+			"G0 = 1 + D3 + D4",
+			"G1 = 1 + D + D2",
+		]
+	),
+]
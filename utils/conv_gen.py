@@ -67,6 +67,11 @@ class ConvolutionalCode(object):
 
 			self.poly_divider = rp[0]
 
+		# States and outputs are stored as uint8_t in the tables
+		if self.k > 9 or self.rate_inv > 8:
+			raise ValueError("Bad polynomials: "
+				"Can't have more than 8 memory bits or outputs!")
+
 	@property
 	def recursive(self):
 		return self.poly_divider != 1
@@ -151,6 +156,10 @@ class ConvolutionalCode(object):
 	def _print_x(self, fi, num_states, pack = False):
 		items = []
 
+		# Align the columns to the widest state or output value
+		width = len(str(max(num_states, 1 << self.rate_inv) - 1))
+		fmt = "{ %%%dd, %%%dd }, " % (max(width, 2), max(width, 2))
+
 		for state in range(num_states):
 			if pack:
 				x0 = pack(self.next_output(state, 0))
@@ -162,7 +171,7 @@ class ConvolutionalCode(object):
 			items.append((x0, x1))
 
 		# Up to 4 blocks should be placed per line
-		print_formatted(items, "{ %2d, %2d }, ", 4, fi)
+		print_formatted(items, fmt, 4, fi)
 
 	def _print_puncture(self, fi):
 		# Up to 12 numbers should be placed per line
@@ -338,7 +347,8 @@ def generate_codes(codes, path, prefix, name):
 
 		code.gen_tables(prefix, f, shared_tables = shared)
 
-def generate_vectors(codes, path, prefix, name, inc = None):
+def generate_vectors(codes, path, prefix, name, inc = None,
+		with_codes = False):
 	# Open a new file for writing
 	f = open_for_writing(path, name)
 	f.write(mod_license + "\n")
@@ -347,9 +357,17 @@ def generate_vectors(codes, path, prefix, name, inc = None):
 	if inc is not None:
 		for item in inc:
 			f.write("%s\n" % item)
+	if with_codes:
+		f.write("#include <stdint.h>\n")
 	f.write("#include <osmocom/core/conv.h>\n")
 	f.write("#include \"conv.h\"\n\n")
 
+	# Codes that aren't part of any library are defined along
+	if with_codes:
+		for code in codes.conv_codes:
+			sys.stderr.write("Generate '%s' definition\n" % code.name)
+			code.gen_tables(prefix, f)
+
 	sys.stderr.write("Generating test vectors...\n")
 
 	vec_count = len(codes.conv_codes)
@@ -400,7 +418,7 @@ def parse_argv():
 		choices = ["gen_codes", "gen_vectors", "gen_header"])
 	parser.add_argument("family",
 		help = "convolutional code family",
-		choices = ["gsm"])
+		choices = ["gsm", "misc"])
 
 	# Optional arguments
 	parser.add_argument("-p", "--prefix",
@@ -417,12 +435,19 @@ if __name__ == '__main__':
 	argv = parse_argv()
 	path = argv.target_path or os.getcwd()
 	inc = None
+	with_codes = False
 
 	# Determine convolutional code family
 	if argv.family == "gsm":
 		codes = conv_codes_gsm
 		prefix = argv.prefix or "gsm0503"
 		inc = [ "#include <osmocom/gsm/gsm0503.h>" ]
+	elif argv.family == "misc":
+		# Imported here, as it refers to the partially imported conv_gen
+		import conv_codes_misc
+		codes = conv_codes_misc
+		prefix = argv.prefix or "misc"
+		with_codes = True
 
 	# What to generate?
 	if argv.action == "gen_codes":
@@ -430,7 +455,7 @@ if __name__ == '__main__':
 		generate_codes(codes, path, prefix, name)
 	elif argv.action == "gen_vectors":
 		name = argv.target_name or prefix + "_test_vectors.c"
-		generate_vectors(codes, path, prefix, name, inc)
+		generate_vectors(codes, path, prefix, name, inc, with_codes)
 	elif argv.action == "gen_header":
 		name = argv.target_name or prefix + ".h"
 		generate_header(codes, path, prefix, name)
@@ -70,6 +70,74 @@ static struct osmo_sub_auth_data test_aud = {
 	.algo = OSMO_AUTH_ALG_NONE,
 };
 
+static double elapsed(const struct timespec *start, const struct timespec *stop)
+{
+	return (stop->tv_sec - start->tv_sec) + (stop->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/* Generate num vectors in calls of batch vectors each, or with batch
+ * single osmo_auth_gen_vec() calls each. Returns vectors per second. */
+static double run_throughput(const struct osmo_sub_auth_data *aud,
+			     const uint8_t *_rand, unsigned int num,
+			     unsigned int batch, int single)
+{
+	struct osmo_sub_auth_data a = *aud;
+	struct osmo_auth_vector *vec;
+	struct timespec start, stop;
+	unsigned int i, j, n = batch;
+	uint8_t *rands;
+	int rc = 0;
+
+	vec = calloc(n, sizeof(*vec));
+	rands = malloc(n * 16);
+	if (!vec || !rands) {
+		fprintf(stderr, "out of memory\n");
+		exit(1);
+	}
+
+	/* Distinct challenges, derived from the given or random one */
+	for (i = 0; i < n * 16; i++)
+		rands[i] = _rand[i % 16] ^ (i / 16);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < num && rc >= 0; i += n) {
+		if (n > num - i)
+			n = num - i;
+		if (!single) {
+			rc = osmo_auth_gen_vec_batch(vec, &a, rands, n);
+			continue;
+		}
+		for (j = 0; j < n && rc >= 0; j++)
+			rc = osmo_auth_gen_vec(&vec[j], &a, &rands[16 * j]);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &stop);
+
+	free(vec);
+	free(rands);
+
+	if (rc < 0) {
+		fprintf(stderr, "error generating auth vector\n");
+		exit(1);
+	}
+
+	return num / elapsed(&start, &stop);
+}
+
+static void throughput(const struct osmo_sub_auth_data *aud,
+		       const uint8_t *_rand, unsigned int num,
+		       unsigned int batch)
+{
+	double single, batched;
+
+	printf("Generating %u vectors with %s\n", num,
+	       osmo_auth_alg_name(aud->algo));
+	single = run_throughput(aud, _rand, num, batch, 1);
+	printf("single:\t%.0f vectors/s\n", single);
+	batched = run_throughput(aud, _rand, num, batch, 0);
+	printf("batch of %u:\t%.0f vectors/s (%.2fx)\n", batch, batched,
+	       batched / single);
+}
+
 static void help()
 {
 	int alg;
@@ -85,7 +153,9 @@ static void help()
 		"-l  --ind-len\tSpecify IND bit length (default=5) (only for 3G)\n"
 		"-A  --auts\tSpecify AUTS (only for 3G)\n"
 		"-r  --rand\tSpecify random value\n"
-		"-I  --ipsec\tOutput in triplets.dat format for strongswan\n");
+		"-I  --ipsec\tOutput in triplets.dat format for strongswan\n"
+		"-T  --throughput\tGenerate the given number of vectors and report vectors/s\n"
+		"-B  --batch\tNumber of vectors per batch for -T (default=32)\n");
 
 	fprintf(stderr, "\nAvailable algorithms for option -a:\n");
 	for (alg = 1; alg < _OSMO_AUTH_ALG_NUM; alg++)
@@ -107,6 +177,8 @@ int main(int argc, char **argv)
 	int ind_is_set = 0;
 	int fmt_triplets_dat = 0;
 	uint64_t ind_mask = 0;
+	unsigned int tp_num = 0;
+	unsigned int tp_batch = 32;
 
 	printf("osmo-auc-gen (C) 2011-2012 by Harald Welte\n");
 	printf("This is FREE SOFTWARE with ABSOLUTELY NO WARRANTY\n\n");
@@ -128,13 +200,15 @@ int main(int argc, char **argv)
 			{ "ind-len", 1, 0, 'l' },
 			{ "rand", 1, 0, 'r' },
 			{ "auts", 1, 0, 'A' },
+			{ "throughput", 1, 0, 'T' },
+			{ "batch", 1, 0, 'B' },
 			{ "help", 0, 0, 'h' },
 			{ 0, 0, 0, 0 }
 		};
 
 		rc = 0;
 
-		c = getopt_long(argc, argv, "23a:k:o:f:s:i:l:r:hO:A:I", long_options,
+		c = getopt_long(argc, argv, "23a:k:o:f:s:i:l:r:hO:A:IT:B:", long_options,
 				&option_index);
 
 		if (c == -1)
@@ -232,6 +306,14 @@ int main(int argc, char **argv)
 		case 'I':
 			fmt_triplets_dat = 1;
 			break;
+		case 'T':
+			tp_num = atoi(optarg);
+			break;
+		case 'B':
+			tp_batch = atoi(optarg);
+			if (tp_batch < 1)
+				rc = -1;
+			break;
 		case 'h':
 			help();
 			exit(0);
@@ -295,6 +377,11 @@ int main(int argc, char **argv)
 		}
 	}
 
+	if (tp_num) {
+		throughput(&test_aud, _rand, tp_num, tp_batch);
+		exit(0);
+	}
+
 	if (!auts_is_set)
 		rc = osmo_auth_gen_vec(vec, &test_aud, _rand);
 	else